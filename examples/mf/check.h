@@ -0,0 +1,65 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Minimal support for the test programs in this directory (test-*.cc). Each check that fails
+ * is reported on stderr; a test program returns mf::test::result() from main so that ctest
+ * reports it as failed.
+ */
+
+#ifndef MF_EXAMPLES_CHECK_H
+#define MF_EXAMPLES_CHECK_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace mf {
+namespace test {
+
+inline int& failures() {
+	static int n = 0;
+	return n;
+}
+
+inline void check(bool ok, const char* what, const char* file, int line) {
+	if (!ok) {
+		std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+		failures()++;
+	}
+}
+
+/** Returns true if a and b differ by at most tol, relative to their magnitude (but at least
+ * absolute tol) */
+inline bool near(double a, double b, double tol) {
+	return std::fabs(a-b) <= tol * std::max(1., std::max(std::fabs(a), std::fabs(b)));
+}
+
+/** Exit code of a test program */
+inline int result() {
+	if (failures() > 0) {
+		std::cerr << failures() << " check(s) failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+} // namespace test
+} // namespace mf
+
+#define MF_CHECK(cond) mf::test::check((cond), #cond, __FILE__, __LINE__)
+#define MF_CHECK_NEAR(a, b, tol) mf::test::check(mf::test::near((a), (b), (tol)), \
+		#a " == " #b " (+-" #tol ")", __FILE__, __LINE__)
+
+#endif
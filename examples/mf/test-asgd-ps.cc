@@ -0,0 +1,119 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Multi-rank smoke test of ASGD with a parameter server (ASGD_SYNC_PS) and a tight staleness
+ * bound: factorizes a small synthetic matrix, and checks that the loss decreases and that the
+ * observed staleness never exceeds the bound.
+ *
+ * Run with: mpirun -np 3 test-asgd-ps (registered with ctest)
+ */
+#include <boost/math/distributions/normal.hpp>
+#include <boost/random/uniform_real.hpp>
+
+#include <mpi2/mpi2.h>
+#include <mf/mf.h>
+
+#include "check.h"
+
+log4cxx::LoggerPtr logger(log4cxx::Logger::getLogger("main"));
+
+using namespace mf;
+using namespace rg;
+
+typedef UpdateTruncate<UpdateNzslL2> Update;
+typedef RegularizeNone Regularize;
+typedef SumLoss<NzslLoss, L2Loss> Loss;
+
+int main(int argc, char* argv[]) {
+	boost::mpi::communicator& world = mfInit(argc, argv);
+
+	// small synthetic problem
+	mf_size_type size1 = 600;
+	mf_size_type size2 = 500;
+	mf_size_type nnz = 30000;
+	double sigma = sqrt(10);
+	double lambda = 1/sigma/sigma;
+	mf_size_type r = 5;
+	int tasksPerRank = 2;
+	mf_size_type blocks = world.size();
+	unsigned staleness = 1; // tightest bound short of lock step
+	mf_size_type epochs = 5;
+
+	mpi2::registerTask<mf::detail::AsgdTask<Update, Regularize> >();
+	mfStart();
+
+	int result = 0;
+	if (world.rank() == 0) {
+		if (world.size() < 2) {
+			LOG4CXX_WARN(logger, "Run with several ranks (e.g., mpirun -np 3) to test synchronization");
+		}
+
+		// data from known factors plus noise
+		Random32 random(42);
+		DenseMatrix wIn(size1, r);
+		DenseMatrixCM hIn(r, size2);
+		generateRandom(wIn, random, boost::normal_distribution<>(0, sigma));
+		generateRandom(hIn, random, boost::normal_distribution<>(0, sigma));
+		SparseMatrix v;
+		generateRandom(v, nnz, wIn, hIn, random);
+		addRandom(v, random, boost::normal_distribution<>(0, 0.1));
+
+		// initial factors
+		DenseMatrix w(size1, r);
+		DenseMatrixCM h(r, size2);
+		generateRandom(w, random, boost::uniform_real<>(-0.5, 0.5));
+		generateRandom(h, random, boost::uniform_real<>(-0.5, 0.5));
+
+		DistributedSparseMatrix dv = distributeMatrix("V", blocks, 1, true, v);
+		DistributedDenseMatrix dw = distributeMatrix("W", blocks, 1, true, w);
+		DistributedDenseMatrixCM dh = distributeMatrix("H", 1, blocks, false, h);
+
+		// run ASGD with the parameter server
+		Update update = Update(UpdateNzslL2(lambda), -10*sigma, 10*sigma);
+		Regularize regularize;
+		Loss loss((NzslLoss()), L2Loss(lambda));
+		AsgdRunner asgdRunner(random);
+		AsgdJob<Update,Regularize> asgdJob(dv, dw, dh, update, regularize, SGD_ORDER_WOR,
+				STRATUM_ORDER_WOR, tasksPerRank, true);
+		asgdJob.sync = ASGD_SYNC_PS;
+		asgdJob.staleness = staleness;
+		BoldDriver decay(0.0025);
+		Trace trace;
+		asgdRunner.run(asgdJob, loss, epochs, decay, trace);
+
+		// convergence
+		MF_CHECK(trace.trace.size() == epochs + 1);
+		double initialLoss = trace.trace.front()->loss;
+		double finalLoss = trace.trace.back()->loss;
+		LOG4CXX_INFO(logger, "Loss: " << initialLoss << " -> " << finalLoss);
+		MF_CHECK(finalLoss == finalLoss); // not NaN
+		MF_CHECK(finalLoss < 0.1 * initialLoss);
+
+		// staleness bound
+		MF_CHECK(trace.doubleFields["staleness_bound"] == staleness);
+		MF_CHECK(trace.doubleFields["staleness_max"] <= staleness);
+		MF_CHECK(trace.stringFields["staleness_hist"].length() > 0); // synchronized at least once
+		LOG4CXX_INFO(logger, "Staleness: mean " << trace.doubleFields["staleness_mean"]
+				<< ", max " << trace.doubleFields["staleness_max"]
+				<< " (histogram: " << trace.stringFields["staleness_hist"] << ")");
+
+		result = mf::test::result();
+	}
+
+	mfStop();
+	mfFinalize();
+
+	return result;
+}
@@ -0,0 +1,96 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the nnz-balanced block offsets of mf::computeBalancedBlockOffsets and
+ * mf::blockNnzRatio.
+ */
+#include <vector>
+
+#include <mf/matrix/distributed_matrix.h>
+
+#include "check.h"
+
+using namespace mf;
+
+/** Checks that the offsets are valid and returns the maximum number of nonzero entries in a block */
+mf_size_type checkOffsets(const std::vector<mf_size_type>& nnz, mf_size_type blocks,
+		const std::vector<mf_size_type>& offsets) {
+	MF_CHECK(offsets.size() == blocks);
+	MF_CHECK(offsets[0] == 0);
+	mf_size_type max = 0;
+	for (mf_size_type b=0; b<offsets.size(); b++) {
+		mf_size_type end = b+1 < offsets.size() ? offsets[b+1] : nnz.size();
+		MF_CHECK(offsets[b] < end); // every block contains at least one row/column
+		mf_size_type blockNnz = 0;
+		for (mf_size_type i=offsets[b]; i<end; i++) blockNnz += nnz[i];
+		max = std::max(max, blockNnz);
+	}
+	return max;
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<mf_size_type> offsets;
+
+	// uniform rows: blocks of equal size
+	std::vector<mf_size_type> uniform(100, 3);
+	computeBalancedBlockOffsets(uniform, 4, offsets);
+	checkOffsets(uniform, 4, offsets);
+	MF_CHECK(offsets[1] == 25 && offsets[2] == 50 && offsets[3] == 75);
+
+	// power-law rows: each block is within one (largest) row of the mean
+	std::vector<mf_size_type> skewed(1000);
+	mf_size_type total = 0, maxRow = 0;
+	for (mf_size_type i=0; i<skewed.size(); i++) {
+		skewed[i] = 10000 / (i+1) + 1;
+		total += skewed[i];
+		maxRow = std::max(maxRow, skewed[i]);
+	}
+	for (mf_size_type blocks=1; blocks<=16; blocks++) {
+		computeBalancedBlockOffsets(skewed, blocks, offsets);
+		mf_size_type max = checkOffsets(skewed, blocks, offsets);
+		MF_CHECK(max <= total/blocks + maxRow);
+	}
+	computeBalancedBlockOffsets(skewed, 8, offsets);
+	mf_size_type balancedMax = checkOffsets(skewed, 8, offsets);
+	std::vector<mf_size_type> defaultOffsets;
+	computeDefaultBlockOffsets(skewed.size(), 8, defaultOffsets);
+	MF_CHECK(balancedMax < checkOffsets(skewed, 8, defaultOffsets));
+
+	// empty rows and a single heavy row still give non-empty blocks
+	std::vector<mf_size_type> heavy(10, 0);
+	heavy[3] = 1000;
+	computeBalancedBlockOffsets(heavy, 5, offsets);
+	checkOffsets(heavy, 5, offsets);
+	std::vector<mf_size_type> empty(7, 0);
+	computeBalancedBlockOffsets(empty, 7, offsets);
+	checkOffsets(empty, 7, offsets);
+
+	// fewer rows than blocks: default blocking
+	std::vector<mf_size_type> small(3, 1);
+	computeBalancedBlockOffsets(small, 5, offsets);
+	computeDefaultBlockOffsets(small.size(), 5, defaultOffsets);
+	MF_CHECK(offsets == defaultOffsets);
+
+	// imbalance ratio
+	boost::numeric::ublas::matrix<mf_size_type> blockNnz(2, 2);
+	blockNnz(0,0) = blockNnz(0,1) = blockNnz(1,0) = blockNnz(1,1) = 5;
+	MF_CHECK_NEAR(blockNnzRatio(blockNnz), 1., 1e-12);
+	blockNnz(1,1) = 17; // max 17, mean 8
+	MF_CHECK_NEAR(blockNnzRatio(blockNnz), 17./8, 1e-12);
+	blockNnz *= 0;
+	MF_CHECK_NEAR(blockNnzRatio(blockNnz), 1., 1e-12);
+
+	return mf::test::result();
+}
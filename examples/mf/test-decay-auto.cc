@@ -0,0 +1,147 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the step size search of the automatic decays (mf/sgd/decay/decay_auto.h) with a
+ * simulated loss: the search without successive halving restarts right below the step sizes
+ * tried, and successive halving keeps the better half (at least two) of the candidates and
+ * doubles the budget up to a full epoch.
+ */
+#include <cmath>
+#include <vector>
+
+#include <util/random.h>
+
+#include <mf/sgd/decay/decay_auto.h>
+#include <mf/loss/nzsl.h>
+#include <mf/sgd/functions/regularize-none.h>
+#include <mf/sgd/functions/update-nzsl.h>
+
+#include "check.h"
+
+using namespace mf;
+
+/** A call of the simulated step size search */
+struct Call {
+	std::vector<double> epsToTry;
+	double fraction;
+};
+
+/** Simulated loss on the sample: NaN above maxEps, otherwise smallest at bestEps */
+struct SimulatedLoss {
+	SimulatedLoss(std::vector<Call>& calls, double maxEps, double bestEps)
+	: calls(calls), maxEps(maxEps), bestEps(bestEps) {
+	}
+
+	std::vector<double> operator()(int& data, rg::Random32& random, const std::vector<double>& epsToTry,
+			double fraction, bool project) {
+		Call call;
+		call.epsToTry = epsToTry;
+		call.fraction = fraction;
+		calls.push_back(call);
+		std::vector<double> losses;
+		for (unsigned i=0; i<epsToTry.size(); i++) {
+			double d = std::log(epsToTry[i] / bestEps);
+			losses.push_back(epsToTry[i] > maxEps ? NAN : 1 + d*d);
+		}
+		return losses;
+	}
+
+	std::vector<Call>& calls;
+	double maxEps;
+	double bestEps;
+};
+
+typedef mf::detail::AbstractDecayAuto<UpdateNzsl, RegularizeNone, NzslLoss> ADA;
+
+/** Exposes the step size search */
+struct TestDecayAuto : public ADA {
+	TestDecayAuto(double eps, unsigned tries)
+	: ADA(Sgd<UpdateNzsl,RegularizeNone>(UpdateNzsl(), RegularizeNone()), NzslLoss(), eps, tries) {
+	}
+
+	double next(std::vector<Call>& calls, double maxEps, double bestEps, double* previousLoss,
+			double* currentLoss, rg::Random32& random) {
+		int data = 0;
+		return nextEps(data, SimulatedLoss(calls, maxEps, bestEps), previousLoss, currentLoss, random);
+	}
+};
+
+int main(int argc, char* argv[]) {
+	rg::Random32 random(42);
+	double initialLoss = 10;
+
+	// without successive halving, step sizes halve and the search restarts right below them
+	std::vector<Call> calls;
+	TestDecayAuto decay(1., 4);
+	double eps = decay.next(calls, 0.01, 0.005, NULL, &initialLoss, random);
+	MF_CHECK(calls.size() == 3);
+	for (unsigned c=0; c<calls.size(); c++) {
+		MF_CHECK(calls[c].epsToTry.size() == 4);
+		MF_CHECK(calls[c].fraction == 1.);
+		for (unsigned i=1; i<4; i++) {
+			MF_CHECK_NEAR(calls[c].epsToTry[i], calls[c].epsToTry[i-1]/2, 1e-15);
+		}
+		if (c > 0) MF_CHECK_NEAR(calls[c].epsToTry[0], calls[c-1].epsToTry[3]/2, 1e-15);
+	}
+	MF_CHECK_NEAR(calls[0].epsToTry[0], 1., 1e-15);
+	MF_CHECK_NEAR(eps, 1./256, 1e-15); // 1/128 is finite, but the next-larger one is not
+
+	// later calls try step sizes between half and twice (at most the initial) step size
+	calls.clear();
+	double previousLoss = 5, currentLoss = 4;
+	eps = decay.next(calls, 0.01, 0.005, &previousLoss, &currentLoss, random);
+	MF_CHECK(calls.size() == 1);
+	MF_CHECK_NEAR(calls[0].epsToTry[0], 2./256, 1e-15);
+	MF_CHECK_NEAR(calls[0].epsToTry[3], 0.5/256, 1e-15);
+	MF_CHECK(eps <= 2./256 && eps >= 0.5/256);
+
+	// successive halving: 8 candidates on 1/4, 1/2, and a full epoch
+	calls.clear();
+	TestDecayAuto halving(1., 4);
+	halving.setSuccessiveHalving(8);
+	eps = halving.next(calls, 1., 0.1, NULL, &initialLoss, random);
+	MF_CHECK(calls.size() == 3);
+	MF_CHECK(calls[0].epsToTry.size() == 8 && calls[0].fraction == 0.25);
+	MF_CHECK(calls[1].epsToTry.size() == 4 && calls[1].fraction == 0.5);
+	MF_CHECK(calls[2].epsToTry.size() == 2 && calls[2].fraction == 1.);
+	MF_CHECK_NEAR(calls[0].epsToTry[0], 1., 1e-15);
+	MF_CHECK_NEAR(calls[0].epsToTry[7], 1./8, 1e-12); // same range as the 4 tries
+	double best = calls[0].epsToTry[7];
+	for (unsigned i=0; i<8; i++) {
+		double d = std::log(calls[0].epsToTry[i] / 0.1), dBest = std::log(best / 0.1);
+		if (d*d < dBest*dBest) best = calls[0].epsToTry[i];
+	}
+	MF_CHECK_NEAR(eps, best, 1e-15);
+
+	// at least two candidates are kept; the budget is at least minFraction
+	calls.clear();
+	TestDecayAuto few(1., 2);
+	few.setSuccessiveHalving(3, 0.75);
+	few.next(calls, 1., 0.1, NULL, &initialLoss, random);
+	MF_CHECK(calls.size() == 2);
+	MF_CHECK(calls[0].epsToTry.size() == 3 && calls[0].fraction == 0.75);
+	MF_CHECK(calls[1].epsToTry.size() == 2 && calls[1].fraction == 1.);
+
+	// invalid settings
+	bool thrown = false;
+	try {
+		few.setSuccessiveHalving(1);
+	} catch (...) {
+		thrown = true;
+	}
+	MF_CHECK(thrown);
+
+	return mf::test::result();
+}
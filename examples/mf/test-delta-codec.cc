@@ -0,0 +1,131 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the delta codecs of mf/sgd/delta-codec.h: half-precision conversion, round trips
+ * of each codec, skipped columns (small deltas and scales that are not normal), and the
+ * entries and columns sent by DELTA_CODEC_TOPK.
+ */
+#include <cmath>
+#include <vector>
+
+#include <mf/sgd/delta-codec.h>
+
+#include "check.h"
+
+using namespace mf;
+
+const mf_size_type R = 4, N = 6;
+
+/** Decodes an encoded delta into a zero matrix */
+std::vector<double> decode(const EncodedDelta& encoded) {
+	std::vector<double> result(encoded.r * encoded.n, 0.);
+	encoded.addTo(&result[0]);
+	return result;
+}
+
+/** Checks that the decoded delta is within tol (relative to the largest entry of each column)
+ * of the delta for the given columns and zero for all others */
+void checkColumns(const std::vector<double>& delta, const std::vector<double>& decoded,
+		const std::vector<bool>& sent, double tol) {
+	for (mf_size_type j=0; j<N; j++) {
+		double scale = 0;
+		for (mf_size_type z=0; z<R; z++) scale = std::max(scale, std::fabs(delta[j*R + z]));
+		for (mf_size_type z=0; z<R; z++) {
+			MF_CHECK_NEAR(decoded[j*R + z], (sent[j] ? delta[j*R + z] : 0.), tol * scale);
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	// half precision
+	MF_CHECK(halfToFloat(floatToHalf(1.f)) == 1.f);
+	MF_CHECK(halfToFloat(floatToHalf(-0.5f)) == -0.5f);
+	MF_CHECK(halfToFloat(floatToHalf(65504.f)) == 65504.f);
+	MF_CHECK(std::fabs(halfToFloat(floatToHalf(0.1f)) - 0.1f) < 1e-4);
+	MF_CHECK(halfToFloat(floatToHalf(1e-9f)) == 0.f);
+
+	// column 0 is zero, column 1 small, column 4 too small for a float scale
+	std::vector<double> delta(R*N);
+	for (mf_size_type p=0; p<R*N; p++) delta[p] = std::sin(p+1.) * (p/R + 1);
+	for (mf_size_type z=0; z<R; z++) {
+		delta[0*R + z] = 0;
+		delta[1*R + z] = 1e-3;
+		delta[4*R + z] = z == 0 ? 1e-40 : 0;
+	}
+	std::vector<bool> sent(N, true);
+	sent[0] = false;
+
+	// lossless, all non-zero columns
+	EncodedDelta encoded;
+	DeltaCodec(DELTA_CODEC_NONE).encode(&delta[0], R, N, encoded);
+	checkColumns(delta, decode(encoded), sent, 0);
+	std::vector<boost::uint32_t> columns;
+	encoded.sentColumns(columns, 10);
+	MF_CHECK(columns.size() == N-1 && columns[0] == 11);
+
+	// threshold
+	sent[1] = sent[4] = false;
+	DeltaCodec(DELTA_CODEC_NONE, 0.1).encode(&delta[0], R, N, encoded);
+	checkColumns(delta, decode(encoded), sent, 0);
+
+	// quantized; column 4 is skipped since its scale is subnormal as a float
+	sent[1] = true;
+	DeltaCodec(DELTA_CODEC_FP16).encode(&delta[0], R, N, encoded);
+	MF_CHECK(encoded.columns.size() == N-2);
+	checkColumns(delta, decode(encoded), sent, 1e-3);
+	DeltaCodec(DELTA_CODEC_INT8).encode(&delta[0], R, N, encoded);
+	MF_CHECK(encoded.columns.size() == N-2);
+	checkColumns(delta, decode(encoded), sent, 0.5/127 + 1e-9);
+	for (mf_size_type z=0; z<R; z++) delta[4*R + z] = 1e300; // too large for a float scale
+	DeltaCodec(DELTA_CODEC_INT8).encode(&delta[0], R, N, encoded);
+	MF_CHECK(encoded.columns.size() == N-2);
+	for (mf_size_type p=0; p<encoded.bytes8.size(); p++) MF_CHECK(std::abs((int)encoded.bytes8[p]) <= 127);
+	for (mf_size_type z=0; z<R; z++) delta[4*R + z] = 0;
+
+	// candidates
+	std::vector<boost::uint32_t> candidates;
+	candidates.push_back(2);
+	candidates.push_back(5);
+	DeltaCodec(DELTA_CODEC_NONE).encode(&delta[0], R, N, encoded, &candidates);
+	for (mf_size_type j=0; j<N; j++) sent[j] = j == 2 || j == 5;
+	checkColumns(delta, decode(encoded), sent, 0);
+
+	// top-k: the largest entries at their positions, columns in increasing order
+	DeltaCodec(DELTA_CODEC_TOPK, 0, 0.25).encode(&delta[0], R, N, encoded);
+	std::vector<double> decoded = decode(encoded);
+	const mf_size_type k = encoded.floats.size();
+	MF_CHECK(k == 4); // a quarter of the 16 entries of the non-zero columns
+	double smallestSent = INFINITY, largestKept = 0;
+	for (mf_size_type p=0; p<R*N; p++) {
+		if (decoded[p] != 0) {
+			MF_CHECK_NEAR(decoded[p], delta[p], 1e-6 * std::fabs(delta[p]));
+			smallestSent = std::min(smallestSent, std::fabs(delta[p]));
+		} else {
+			largestKept = std::max(largestKept, std::fabs(delta[p]));
+		}
+	}
+	MF_CHECK(smallestSent >= largestKept);
+	columns.clear();
+	encoded.sentColumns(columns);
+	for (mf_size_type c=0; c<columns.size(); c++) {
+		if (c > 0) MF_CHECK(columns[c-1] < columns[c]);
+		bool any = false;
+		for (mf_size_type z=0; z<R; z++) any = any || decoded[columns[c]*R + z] != 0;
+		MF_CHECK(any);
+	}
+	MF_CHECK(encoded.bytes() == k * (2*sizeof(boost::uint32_t) + sizeof(float)));
+
+	return mf::test::result();
+}
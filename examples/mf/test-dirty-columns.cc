@@ -0,0 +1,99 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the dirty-column tracking of mf/sgd/dirty-columns.h: marked columns are reported in
+ * order, and a reader that scans and clears under the column locks (mf::LockTable) while
+ * writers keep marking never misses a change.
+ */
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <mf/sgd/dirty-columns.h>
+#include <mf/sgd/lock-table.h>
+
+#include "check.h"
+
+using namespace mf;
+
+const mf_size_type N = 50, STEPS = 20000;
+
+/** Changes random columns and marks them, holding the column lock */
+void write(LockTable& table, DirtyColumns& dirty, std::vector<mf_size_type>& values, unsigned seed) {
+	for (mf_size_type s=0; s<STEPS; s++) {
+		seed = seed * 1103515245u + 12345u;
+		mf_size_type j = (seed >> 16) % N;
+		SpinLock::scoped_lock lock(table.column(j));
+		values[j]++;
+		dirty.mark(j);
+	}
+}
+
+/** Copies the dirty columns to synced and clears them; returns the number of columns copied */
+mf_size_type sync(LockTable& table, DirtyColumns& dirty, const std::vector<mf_size_type>& values,
+		std::vector<mf_size_type>& synced) {
+	std::vector<boost::uint32_t> columns;
+	dirty.dirtyColumns(0, N, columns);
+	for (mf_size_type c=0; c<columns.size(); c++) {
+		SpinLock::scoped_lock lock(table.column(columns[c]));
+		synced[columns[c]] = values[columns[c]];
+		dirty.clear(columns[c]);
+	}
+	return columns.size();
+}
+
+int main(int argc, char* argv[]) {
+	// marked columns are reported in increasing order within the range
+	DirtyColumns dirty(N);
+	MF_CHECK(dirty.size() == N);
+	dirty.mark(7);
+	dirty.mark(3);
+	dirty.mark(7);
+	dirty.mark(42);
+	std::vector<boost::uint32_t> columns;
+	dirty.dirtyColumns(0, N, columns);
+	MF_CHECK(columns.size() == 3 && columns[0] == 3 && columns[1] == 7 && columns[2] == 42);
+	columns.clear();
+	dirty.dirtyColumns(4, 42, columns);
+	MF_CHECK(columns.size() == 1 && columns[0] == 7);
+	dirty.clear(7);
+	MF_CHECK(!dirty.dirty(7) && dirty.dirty(3));
+	dirty.clear(3);
+	dirty.clear(42);
+
+	// concurrent writers and a syncing reader: nothing is missed
+	LockTable table(1, N);
+	std::vector<mf_size_type> values(N, 0), synced(N, 0);
+	boost::thread_group writers;
+	for (unsigned t=0; t<3; t++) {
+		writers.create_thread(boost::bind(write, boost::ref(table), boost::ref(dirty), boost::ref(values), t+1));
+	}
+	for (int round=0; round<100; round++) {
+		sync(table, dirty, values, synced);
+	}
+	writers.join_all();
+	sync(table, dirty, values, synced);
+	mf_size_type total = 0;
+	for (mf_size_type j=0; j<N; j++) {
+		MF_CHECK(synced[j] == values[j]);
+		MF_CHECK(!dirty.dirty(j));
+		total += values[j];
+	}
+	MF_CHECK(total == 3*STEPS);
+	MF_CHECK(sync(table, dirty, values, synced) == 0);
+
+	return mf::test::result();
+}
@@ -0,0 +1,154 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the (possibly vectorized) SGD kernels in mf/sgd/functions/kernels.h against plain
+ * scalar loops, for all rank specializations and for ranks that are not a multiple of the SIMD
+ * width, and the dense matrix products of mini-batches (mf/sgd/minibatch.h) against naive
+ * triple loops, also for sizes that are not a multiple of their 4-row blocking.
+ */
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <mf/sgd/functions/kernels.h>
+#include <mf/sgd/minibatch.h>
+
+#include "check.h"
+
+using namespace mf;
+
+boost::mt19937 rng(42);
+
+template<typename T>
+void randomVector(std::vector<T>& v, unsigned r) {
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<> > u(rng, boost::uniform_real<>(-1, 1));
+	v.resize(r);
+	for (unsigned z=0; z<r; z++) v[z] = (T)u();
+}
+
+template<unsigned R, typename T>
+void checkKernels(unsigned r, double tol) {
+	std::vector<T> w, h;
+	randomVector(w, r);
+	randomVector(h, r);
+	const double a = 0.03, bw = 0.001, bh = 0.002;
+
+	// inner product (accumulated in double)
+	double expected = 0;
+	for (unsigned z=0; z<r; z++) expected += (double)w[z] * h[z];
+	MF_CHECK_NEAR(kernels::dot<R>(&w[0], &h[0], r), expected, tol);
+
+	// combined update
+	std::vector<T> w2(w), h2(h);
+	kernels::update<R>(&w2[0], &h2[0], r, a, bw, bh);
+	for (unsigned z=0; z<r; z++) {
+		MF_CHECK_NEAR(w2[z], (1.-bw)*w[z] - a*h[z], tol);
+		MF_CHECK_NEAR(h2[z], (1.-bh)*h[z] - a*w[z], tol);
+	}
+
+	// update with separate coefficients
+	w2 = w;
+	h2 = h;
+	kernels::updateScaled<R>(&w2[0], &h2[0], r, a, 2*a);
+	for (unsigned z=0; z<r; z++) {
+		MF_CHECK_NEAR(w2[z], w[z] - a*h[z], tol);
+		MF_CHECK_NEAR(h2[z], h[z] - 2*a*w[z], tol);
+	}
+}
+
+template<typename T>
+void checkAllRanks(double tol) {
+	checkKernels<8,T>(8, tol);
+	checkKernels<16,T>(16, tol);
+	checkKernels<32,T>(32, tol);
+	checkKernels<50,T>(50, tol);
+	checkKernels<64,T>(64, tol);
+	checkKernels<100,T>(100, tol);
+	checkKernels<128,T>(128, tol);
+	for (unsigned r=1; r<=70; r++) {
+		checkKernels<0,T>(r, tol);
+	}
+	checkKernels<0,T>(129, tol);
+}
+
+/** Checks C = A B^T and C += E B (with E and E^T) for an m x l matrix E */
+template<unsigned R, typename T>
+void checkGemm(mf_size_type m, mf_size_type l, unsigned r, double tol) {
+	std::vector<T> a, b;
+	randomVector(a, m*r);
+	randomVector(b, l*r);
+	std::vector<double> bt(r*l), c(m*l, 1.);
+
+	// C = A B^T
+	kernels::gemmNT<R>(&a[0], &b[0], m, l, r, &bt[0], &c[0]);
+	for (mf_size_type i=0; i<m; i++) {
+		for (mf_size_type p=0; p<l; p++) {
+			double expected = 0;
+			for (unsigned z=0; z<r; z++) expected += (double)a[i*r+z] * b[p*r+z];
+			MF_CHECK_NEAR(c[i*l+p], expected, tol);
+		}
+	}
+
+	// C += E B with E stored row-major (m x l), some entries zero
+	std::vector<double> e;
+	randomVector(e, m*l);
+	for (mf_size_type k=0; k<e.size(); k+=3) e[k] = 0.;
+	std::vector<double> c1, c0;
+	randomVector(c0, m*r);
+	c1 = c0;
+	kernels::gemmAdd<R>(&e[0], l, 1, &b[0], m, l, r, &c1[0]);
+	for (mf_size_type i=0; i<m; i++) {
+		for (unsigned z=0; z<r; z++) {
+			double expected = c0[i*r+z];
+			for (mf_size_type p=0; p<l; p++) expected += e[i*l+p] * b[p*r+z];
+			MF_CHECK_NEAR(c1[i*r+z], expected, tol);
+		}
+	}
+
+	// C += E^T A, reading E^T (l x m) from E without a copy
+	std::vector<double> c2;
+	randomVector(c0, l*r);
+	c2 = c0;
+	kernels::gemmAdd<R>(&e[0], 1, l, &a[0], l, m, r, &c2[0]);
+	for (mf_size_type p=0; p<l; p++) {
+		for (unsigned z=0; z<r; z++) {
+			double expected = c0[p*r+z];
+			for (mf_size_type i=0; i<m; i++) expected += e[i*l+p] * a[i*r+z];
+			MF_CHECK_NEAR(c2[p*r+z], expected, tol);
+		}
+	}
+}
+
+template<typename T>
+void checkAllGemm(double tol) {
+	const mf_size_type sizes[] = { 1, 3, 4, 5, 8, 11 };
+	for (unsigned s1=0; s1<6; s1++) {
+		for (unsigned s2=0; s2<6; s2++) {
+			checkGemm<0,T>(sizes[s1], sizes[s2], 7, tol);
+			checkGemm<8,T>(sizes[s1], sizes[s2], 8, tol);
+		}
+	}
+	checkGemm<50,T>(13, 6, 50, tol);
+}
+
+int main(int argc, char* argv[]) {
+	checkAllRanks<double>(1e-12);
+	checkAllRanks<float>(1e-5);
+	checkAllGemm<double>(1e-12);
+	checkAllGemm<float>(1e-5);
+	return mf::test::result();
+}
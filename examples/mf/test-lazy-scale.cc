@@ -0,0 +1,73 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the lazily applied scale of mf/sgd/lazy-scale.h: per-matrix and per-row/column
+ * scales combine, small scales are detected, and applying the scales resets them.
+ */
+#include <mf/sgd/lazy-scale.h>
+
+#include "check.h"
+
+using namespace mf;
+
+int main(int argc, char* argv[]) {
+	const mf_size_type m = 5, n = 4, r = 3;
+	DenseMatrix w(m, r);
+	DenseMatrixCM h(r, n);
+	for (mf_size_type i=0; i<m; i++) for (mf_size_type z=0; z<r; z++) w(i,z) = i + z + 1;
+	for (mf_size_type j=0; j<n; j++) for (mf_size_type z=0; z<r; z++) h(z,j) = j + z + 1;
+
+	// per-matrix and per-row/column scales combine
+	LazyScale scale;
+	MF_CHECK(!scale.small());
+	scale.scale(0.5, 0.25);
+	scale.initRows(m);
+	scale.initColumns(n);
+	scale.scaleRow(2, 0.1);
+	scale.scaleColumn(1, 0.2);
+	MF_CHECK_NEAR(scale.w(0), 0.5, 1e-12);
+	MF_CHECK_NEAR(scale.w(2), 0.05, 1e-12);
+	MF_CHECK_NEAR(scale.h(1), 0.05, 1e-12);
+	MF_CHECK_NEAR(scale.h(3), 0.25, 1e-12);
+	MF_CHECK(!scale.small());
+
+	// a single small row (or column) is detected
+	for (int k=0; k<5; k++) scale.scaleRow(3, 0.01);
+	MF_CHECK(scale.small());
+
+	// applying multiplies the factors and resets the scales
+	DenseMatrix w0(w);
+	DenseMatrixCM h0(h);
+	const double w3 = scale.w(3), w2 = scale.w(2), h1 = scale.h(1);
+	scale.applyW(w);
+	scale.applyH(h);
+	MF_CHECK_NEAR(w(3,1), w3 * w0(3,1), 1e-18);
+	MF_CHECK_NEAR(w(2,0), w2 * w0(2,0), 1e-12);
+	MF_CHECK_NEAR(h(2,1), h1 * h0(2,1), 1e-12);
+	MF_CHECK(!scale.small());
+	MF_CHECK(scale.w(3) == 1. && scale.h(1) == 1.);
+
+	scale.initColumns(n);
+	for (int k=0; k<4; k++) scale.scaleColumn(0, 0.01);
+	MF_CHECK(scale.small());
+	scale.applyH(h);
+	MF_CHECK(!scale.small());
+
+	// the per-matrix scale counts as well
+	scale.scale(1., 1e-7);
+	MF_CHECK(scale.small());
+
+	return mf::test::result();
+}
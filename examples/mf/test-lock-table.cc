@@ -0,0 +1,84 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the striped locks of mf/sgd/lock-table.h: stripe counts and mapping, cache-line
+ * alignment, and mutual exclusion of concurrent updates under LockTable::ScopedLock.
+ */
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <mf/sgd/lock-table.h>
+
+#include "check.h"
+
+using namespace mf;
+
+const mf_size_type M = 100, N = 37, STEPS = 20000;
+
+/** Increments the counters of random rows and columns (not atomically) */
+void run(LockTable& table, std::vector<mf_size_type>& rows, std::vector<mf_size_type>& columns, unsigned seed) {
+	for (mf_size_type s=0; s<STEPS; s++) {
+		seed = seed * 1103515245u + 12345u;
+		mf_size_type i = (seed >> 8) % M, j = (seed >> 16) % N;
+		LockTable::ScopedLock lock(table, i, j);
+		rows[i]++;
+		columns[j]++;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	// stripe counts are powers of two, bounded by the dimension and maxStripes
+	LockTable table(M, N, 32);
+	MF_CHECK(table.stripes1() == 32);
+	MF_CHECK(table.stripes2() == 32);
+	LockTable small(3, 1);
+	MF_CHECK(small.stripes1() == 4);
+	MF_CHECK(small.stripes2() == 1);
+
+	// rows (columns) map to stripes modulo the stripe count; each lock has its own cache line
+	MF_CHECK(&table.row(5) == &table.row(37));
+	MF_CHECK(&table.row(5) != &table.row(6));
+	MF_CHECK(&table.column(0) == &table.column(32));
+	MF_CHECK(&table.row(0) != &table.column(0));
+	MF_CHECK(reinterpret_cast<std::size_t>(&table.row(0)) % CACHE_LINE_SIZE == 0);
+	MF_CHECK(reinterpret_cast<std::size_t>(&table.column(1)) % CACHE_LINE_SIZE == 0);
+	MF_CHECK(sizeof(SpinLock) == CACHE_LINE_SIZE);
+
+	// try_lock fails on held locks
+	SpinLock& lock = table.row(3);
+	MF_CHECK(lock.try_lock());
+	MF_CHECK(!lock.try_lock());
+	lock.unlock();
+	MF_CHECK(lock.try_lock());
+	lock.unlock();
+
+	// concurrent increments under the locks are not lost
+	const unsigned THREADS = 4;
+	std::vector<mf_size_type> rows(M, 0), columns(N, 0);
+	boost::thread_group threads;
+	for (unsigned t=0; t<THREADS; t++) {
+		threads.create_thread(boost::bind(run, boost::ref(table), boost::ref(rows), boost::ref(columns), t+1));
+	}
+	threads.join_all();
+	mf_size_type rowSum = 0, columnSum = 0;
+	for (mf_size_type i=0; i<M; i++) rowSum += rows[i];
+	for (mf_size_type j=0; j<N; j++) columnSum += columns[j];
+	MF_CHECK(rowSum == THREADS*STEPS);
+	MF_CHECK(columnSum == THREADS*STEPS);
+
+	return mf::test::result();
+}
@@ -0,0 +1,185 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks mini-batch SGD (SGD_ORDER_MINIBATCH): batches are chunks of consecutive rows within
+ * the size and density limits, a batch (dense or sparse) gives the same factors as a naive
+ * computation of its gradients, and with regularize steps that can be applied lazily
+ * (mf/sgd/lazy-scale.h), epochs with a lazy scale give the same factors as epochs without.
+ */
+#include <cmath>
+#include <vector>
+
+#include <util/random.h>
+
+#include <mf/sgd/sgd.h>
+#include <mf/sgd/decay/decay_constant.h>
+#include <mf/sgd/functions/update-nzsl.h>
+#include <mf/sgd/functions/regularize-l2.h>
+#include <mf/sgd/functions/regularize-nzl2.h>
+
+#include "check.h"
+
+using namespace mf;
+
+void randomSparse(rg::Random32& random, SparseMatrix& v, mf_size_type m, mf_size_type n, mf_size_type nnz) {
+	v.resize(m, n, false);
+	for (mf_size_type p=0; p<nnz; p++) {
+		v.append_element(random.nextInt(m), random.nextInt(n), random.nextDouble()*4 - 2);
+	}
+	v.sort();
+}
+
+void randomFactors(rg::Random32& random, DenseMatrix& w, DenseMatrixCM& h) {
+	for (mf_size_type p=0; p<w.data().size(); p++) w.data()[p] = random.nextDouble() - 0.5;
+	for (mf_size_type p=0; p<h.data().size(); p++) h.data()[p] = random.nextDouble() - 0.5;
+}
+
+/** Runs mini-batch epochs with and without a lazy scale from the same factors and seed and
+ * checks that the resulting factors agree */
+template<typename Regularize>
+void checkLazyScale(const SparseMatrix& v, const DenseMatrix& w0, const DenseMatrixCM& h0,
+		Regularize regularize, mf_size_type epochs) {
+	const double eps = 0.02;
+
+	// regularize steps applied right away
+	DenseMatrix w1(w0);
+	DenseMatrixCM h1(h0);
+	SgdJob<UpdateNzsl,Regularize> job1(v, w1, h1, UpdateNzsl(), regularize, SGD_ORDER_MINIBATCH);
+	rg::Random32 random1(7);
+	SgdRunner runner1(random1);
+	for (mf_size_type e=0; e<epochs; e++) runner1.epoch(job1, eps);
+
+	// regularize steps recorded in a lazy scale
+	DenseMatrix w2(w0);
+	DenseMatrixCM h2(h0);
+	SgdJob<UpdateNzsl,Regularize> job2(v, w2, h2, UpdateNzsl(), regularize, SGD_ORDER_MINIBATCH);
+	LazyScale scale;
+	job2.scale = &scale;
+	rg::Random32 random2(7);
+	SgdRunner runner2(random2);
+	for (mf_size_type e=0; e<epochs; e++) runner2.epoch(job2, eps);
+	scale.apply(job2);
+
+	for (mf_size_type p=0; p<w1.data().size(); p++) MF_CHECK_NEAR(w2.data()[p], w1.data()[p], 1e-9);
+	for (mf_size_type p=0; p<h1.data().size(); p++) MF_CHECK_NEAR(h2.data()[p], h1.data()[p], 1e-9);
+
+	// the factors have changed
+	double diff = 0;
+	for (mf_size_type p=0; p<w1.data().size(); p++) diff += std::abs(w1.data()[p] - w0.data()[p]);
+	MF_CHECK(diff > 0);
+}
+
+/** Checks that the batches cover the training points in order and stay within the limits */
+void checkBatches(const FactorizationData<>& data, const MiniBatchSpace& space,
+		mf_size_type maxRows, mf_size_type maxCols) {
+	const std::vector<mf_size_type>& offsets = space.offsets;
+	MF_CHECK(offsets.front() == 0 && offsets.back() == data.nnz);
+	for (mf_size_type b=0; b+1<offsets.size(); b++) {
+		MF_CHECK(offsets[b] < offsets[b+1]);
+		mf_size_type i0 = data.vIndex1[offsets[b]], i1 = data.vIndex1[offsets[b+1]-1];
+		std::vector<bool> seen(data.n, false);
+		mf_size_type cols = 0;
+		for (mf_size_type p=offsets[b]; p<offsets[b+1]; p++) {
+			MF_CHECK(data.vIndex1[p] >= i0 && data.vIndex1[p] <= i1);
+			if (!seen[data.vIndex2[p]]) cols++;
+			seen[data.vIndex2[p]] = true;
+		}
+		MF_CHECK(i1 - i0 + 1 <= maxRows && cols <= maxCols);
+		MF_CHECK(offsets[b+1] - offsets[b] >= kernels::miniBatchDenseFraction() * (i1-i0+1) * cols);
+	}
+}
+
+/** Runs the mini-batch of positions [begin,end) and compares the factors with a naive
+ * computation of the gradients */
+void checkBatch(SparseMatrix& v, const DenseMatrix& w0, const DenseMatrixCM& h0,
+		mf_size_type begin, mf_size_type end) {
+	const double eps = 0.05;
+	DenseMatrix w(w0);
+	DenseMatrixCM h(h0);
+	SgdJob<UpdateNzsl,RegularizeNone> job(v, w, h, UpdateNzsl(), RegularizeNone(), SGD_ORDER_MINIBATCH);
+	MiniBatchSpace space;
+	DecayConstant decay(eps);
+	SgdRunner::updateMiniBatch(job, decay, begin, end, 0, space);
+
+	DenseMatrix dw(w0.size1(), w0.size2(), 0.);
+	DenseMatrixCM dh(h0.size1(), h0.size2(), 0.);
+	std::vector<double> epsW(w0.size1(), 0.), epsH(h0.size2(), 0.);
+	for (mf_size_type p=begin; p<end; p++) {
+		const mf_size_type i = job.vIndex1[p], j = job.vIndex2[p];
+		double wh = 0;
+		for (mf_size_type z=0; z<job.r; z++) wh += w0(i,z) * h0(z,j);
+		const double f = eps * -2. * (job.vValues[p] - wh);
+		for (mf_size_type z=0; z<job.r; z++) {
+			dw(i,z) += f * h0(z,j);
+			dh(z,j) += f * w0(i,z);
+		}
+		epsW[i] += eps;
+		epsH[j] += eps;
+	}
+	for (mf_size_type i=0; i<w0.size1(); i++) {
+		const double c = 1. - epsW[i] * mf::detail::MiniBatchTerms<UpdateNzsl>::w(job.update, job, i);
+		for (mf_size_type z=0; z<job.r; z++) MF_CHECK_NEAR(w(i,z), c*w0(i,z) - dw(i,z), 1e-12);
+	}
+	for (mf_size_type j=0; j<h0.size2(); j++) {
+		const double c = 1. - epsH[j] * mf::detail::MiniBatchTerms<UpdateNzsl>::h(job.update, job, j);
+		for (mf_size_type z=0; z<job.r; z++) MF_CHECK_NEAR(h(z,j), c*h0(z,j) - dh(z,j), 1e-12);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	rg::Random32 random(42);
+	const mf_size_type m = 40, n = 36, r = 5;
+	SparseMatrix v;
+	randomSparse(random, v, m, n, 400);
+	DenseMatrix w(m, r);
+	DenseMatrixCM h(r, n);
+	randomFactors(random, w, h);
+
+	// runners use the lazy scale only outside of mini-batches
+	MF_CHECK((mf::detail::useLazyScale<UpdateNzsl,RegularizeL2>(SGD_ORDER_WOR)));
+	MF_CHECK((!mf::detail::useLazyScale<UpdateNzsl,RegularizeL2>(SGD_ORDER_MINIBATCH)));
+	MF_CHECK((!mf::detail::useLazyScale<UpdateNzsl,RegularizeNzl2>(SGD_ORDER_MINIBATCH)));
+	MF_CHECK((!mf::detail::useLazyScale<UpdateNzsl,RegularizeNone>(SGD_ORDER_WOR)));
+
+	// batches are chunks of rows (the matrix is sorted by row) within the limits
+	FactorizationData<> data(v, w, h);
+	std::vector<mf_size_type> rows;
+	for (mf_size_type p=0; p<data.nnz; p++) {
+		if (p == 0 || data.vIndex1[p] != data.vIndex1[p-1]) rows.push_back(p);
+	}
+	rows.push_back(data.nnz);
+	MiniBatchSpace space;
+	mf::detail::formMiniBatches(data, rows, 6, 20, space);
+	checkBatches(data, space, 6, 20);
+	MF_CHECK(space.offsets.size() > 2 && space.offsets.size() < rows.size());
+	mf::detail::formMiniBatches(data, rows, 40, 5, space); // rows with more points are split
+	checkBatches(data, space, 40, 5);
+
+	// a dense batch (a single row) and a sparse one (a few points of the first and last rows)
+	checkBatch(v, w, h, rows[3], rows[4]);
+	checkBatch(v, w, h, rows[0], rows[0]+2);
+	std::swap(v.index1_data()[rows[0]+1], v.index1_data()[data.nnz-1]);
+	std::swap(v.index2_data()[rows[0]+1], v.index2_data()[data.nnz-1]);
+	std::swap(v.value_data()[rows[0]+1], v.value_data()[data.nnz-1]);
+	markUnsorted(v);
+	checkBatch(v, w, h, rows[0], rows[0]+2);
+	v.sort();
+
+	// mini-batches with and without a lazy scale (per matrix for L2, per row/column for NZL2)
+	checkLazyScale(v, w, h, RegularizeL2(0.05), 3);
+	checkLazyScale(v, w, h, RegularizeNzl2(0.05), 3);
+
+	return mf::test::result();
+}
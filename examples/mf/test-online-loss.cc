@@ -0,0 +1,70 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the online loss of mf/sgd/online-loss.h: residuals go to the accumulator of the
+ * current scope only, accumulators merge and scale to the data size, and only the update
+ * functions that report their residuals are marked by mf::HasOnlineLoss.
+ */
+#include <mf/sgd/online-loss.h>
+#include <mf/sgd/functions/update-nzsl.h>
+#include <mf/sgd/functions/update-nzsl-l2.h>
+#include <mf/sgd/functions/update-gkl.h>
+#include <mf/sgd/functions/update-lock.h>
+#include <mf/sgd/functions/update-truncate.h>
+
+#include "check.h"
+
+using namespace mf;
+
+int main(int argc, char* argv[]) {
+	// residuals without a scope are ignored
+	OnlineLoss::add(5);
+
+	// residuals go to the innermost scope
+	OnlineLoss outer, inner;
+	{
+		OnlineLoss::Scope scope(&outer);
+		OnlineLoss::add(1);
+		OnlineLoss::add(-2);
+		{
+			OnlineLoss::Scope scope(&inner);
+			OnlineLoss::add(3);
+		}
+		OnlineLoss::add(1);
+	}
+	OnlineLoss::add(7);
+	MF_CHECK(outer.count() == 3);
+	MF_CHECK_NEAR(outer.sum(), 6., 1e-12);
+	MF_CHECK(inner.count() == 1);
+	MF_CHECK_NEAR(inner.sum(), 9., 1e-12);
+
+	// merged accumulators give the mean squared residual scaled to the data size
+	outer.merge(inner);
+	MF_CHECK(outer.count() == 4);
+	MF_CHECK_NEAR(outer.value(100), 15./4*100, 1e-9);
+	outer.reset();
+	MF_CHECK(outer.count() == 0);
+	MF_CHECK(outer.value(100) == 0);
+
+	// update functions that report their residuals (also when wrapped)
+	MF_CHECK(HasOnlineLoss<UpdateNzsl>::value);
+	MF_CHECK(HasOnlineLoss<UpdateNzslL2>::value);
+	MF_CHECK(HasOnlineLoss<UpdateLock<UpdateNzsl> >::value);
+	MF_CHECK(HasOnlineLoss<UpdateTruncate<UpdateNzslL2> >::value);
+	MF_CHECK(!HasOnlineLoss<UpdateGkl>::value);
+	MF_CHECK(!HasOnlineLoss<UpdateLock<UpdateGkl> >::value);
+
+	return mf::test::result();
+}
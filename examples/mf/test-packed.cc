@@ -0,0 +1,163 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks the in-place arrangement of training points of mf/sgd/packed.h: shuffling and tiling
+ * permute the training points of the data matrix, which ublas sorts again afterwards, tiles
+ * partition the data, and packed copies are filled once per data matrix.
+ */
+#include <algorithm>
+#include <vector>
+
+#include <util/random.h>
+
+#include <mf/factorization.h>
+#include <mf/sgd/packed.h>
+
+#include "check.h"
+
+using namespace mf;
+
+typedef FactorizationData<> FD;
+typedef std::vector<PackedTriple<FD> > Triples;
+
+void randomSparse(rg::Random32& random, SparseMatrix& v, mf_size_type m, mf_size_type n, mf_size_type nnz) {
+	v.resize(m, n, false);
+	for (mf_size_type p=0; p<nnz; p++) {
+		v.append_element(random.nextInt(m), random.nextInt(n), p+1);
+	}
+	v.sort();
+}
+
+bool lessIj(const PackedTriple<FD>& a, const PackedTriple<FD>& b) {
+	return a.i < b.i || (a.i == b.i && (a.j < b.j || (a.j == b.j && a.x < b.x)));
+}
+
+/** Returns the training points of data in storage order */
+Triples points(const FD& data) {
+	Triples triples(data.nnz);
+	for (mf_size_type p=0; p<data.nnz; p++) {
+		triples[p].i = data.vIndex1[p];
+		triples[p].j = data.vIndex2[p];
+		triples[p].x = data.vValues[p];
+	}
+	return triples;
+}
+
+/** Checks that the triples are exactly the expected ones (in any order) */
+void checkSameTriples(Triples expected, Triples triples) {
+	MF_CHECK(triples.size() == expected.size());
+	std::sort(triples.begin(), triples.end(), lessIj);
+	std::sort(expected.begin(), expected.end(), lessIj);
+	for (mf_size_type p=0; p<std::min(triples.size(), expected.size()); p++) {
+		MF_CHECK(triples[p].i == expected[p].i && triples[p].j == expected[p].j && triples[p].x == expected[p].x);
+	}
+}
+
+/** Checks that the triples are the same in the same order */
+bool sameOrder(const Triples& a, const Triples& b) {
+	if (a.size() != b.size()) return false;
+	for (mf_size_type p=0; p<a.size(); p++) {
+		if (a[p].i != b[p].i || a[p].j != b[p].j || a[p].x != b[p].x) return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	rg::Random32 random(42);
+	const mf_size_type r = 4;
+	SparseMatrix v1, v2;
+	randomSparse(random, v1, 50, 40, 300);
+	randomSparse(random, v2, 50, 40, 300); // same size as v1
+	DenseMatrix w(50, r);
+	DenseMatrixCM h(r, 40);
+	FD data1(v1, w, h), data2(v2, w, h);
+	const Triples sorted1 = points(data1);
+
+	// shuffling (fully or partially) permutes the training points in place; ublas sorts them
+	// again when needed
+	{
+		TrainingPoints<FD> tp(data1);
+		shuffle(random, tp, 0, data1.nnz, data1.nnz);
+		checkSameTriples(sorted1, points(data1));
+		MF_CHECK(!sameOrder(sorted1, points(data1)));
+		shuffle(random, tp, 100, 50, 10);
+		checkSameTriples(sorted1, points(data1));
+	}
+	MF_CHECK(v1.nnz() == sorted1.size());
+	MF_CHECK(v1(sorted1[7].i, sorted1[7].j) == sorted1[7].x);
+	v1.sort();
+	MF_CHECK(sameOrder(sorted1, points(data1)));
+
+	// a packed copy is filled on first use only, in storage order, and kept when the data
+	// matrix is reordered; it is refilled for a different data matrix and after invalidate()
+	PackedTriples packed;
+	MF_CHECK(packed.pack(data1));
+	MF_CHECK(!packed.pack(data1));
+	MF_CHECK(sameOrder(sorted1, packed.get<FD>()));
+	{
+		TrainingPoints<FD> tp(data1);
+		shuffle(random, tp, 0, data1.nnz, data1.nnz);
+	}
+	MF_CHECK(!packed.pack(data1));
+	shuffle(random, packed.get<FD>(), data1.nnz);
+	checkSameTriples(sorted1, packed.get<FD>());
+	MF_CHECK(packed.pack(data2));
+	checkSameTriples(points(data2), packed.get<FD>());
+	packed.invalidate();
+	MF_CHECK(packed.pack(data2));
+
+	// tiles partition the training points; each tile lies within a single tile of the data
+	TiledPoints tiled;
+	const mf_size_type tileRows = 8, tileCols = 16;
+	MF_CHECK(tiled.arrange(data1, tileRows, tileCols));
+	MF_CHECK(!tiled.arrange(data1, tileRows, tileCols));
+	const Triples tiles = points(data1);
+	const std::vector<mf_size_type>& offsets = tiled.offsets();
+	checkSameTriples(sorted1, tiles);
+	MF_CHECK(offsets.front() == 0 && offsets.back() == data1.nnz);
+	MF_CHECK(tiled.order().size() == offsets.size()-1);
+	for (mf_size_type t=0; t+1<offsets.size(); t++) {
+		MF_CHECK(offsets[t] < offsets[t+1]);
+		for (mf_size_type p=offsets[t]; p<offsets[t+1]; p++) {
+			MF_CHECK(tiles[p].i/tileRows == tiles[offsets[t]].i/tileRows);
+			MF_CHECK(tiles[p].j/tileCols == tiles[offsets[t]].j/tileCols);
+		}
+		if (t > 0) { // tiles in row-major order
+			const PackedTriple<FD>& a = tiles[offsets[t-1]];
+			const PackedTriple<FD>& b = tiles[offsets[t]];
+			MF_CHECK(a.i/tileRows < b.i/tileRows
+					|| (a.i/tileRows == b.i/tileRows && a.j/tileCols < b.j/tileCols));
+		}
+	}
+
+	// arranging tiled points again does not move them
+	tiled.invalidate();
+	MF_CHECK(tiled.arrange(data1, tileRows, tileCols));
+	MF_CHECK(sameOrder(tiles, points(data1)));
+	MF_CHECK(tiled.arrange(data1, tileRows, 2*tileCols)); // new tile size
+	MF_CHECK(tiled.arrange(data2, tileRows, 2*tileCols)); // new data
+
+	// row chunks (tiles that span all columns)
+	MF_CHECK(tiled.arrange(data1, 1, data1.n));
+	const Triples rows = points(data1);
+	for (mf_size_type p=1; p<rows.size(); p++) MF_CHECK(rows[p-1].i <= rows[p].i);
+	mf_size_type distinctRows = 0;
+	for (mf_size_type p=0; p<rows.size(); p++) {
+		if (p == 0 || rows[p].i != rows[p-1].i) distinctRows++;
+	}
+	MF_CHECK(tiled.offsets().size() == distinctRows + 1);
+
+	return mf::test::result();
+}
@@ -0,0 +1,90 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Checks random relabelings (mf/matrix/op/relabel.h): the maps are permutations, factors
+ * are restored to the original row/column ids, and relabelings survive a round trip through
+ * an mfp descriptor (mf::writeRelabeling, mf::readRelabeling).
+ */
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <util/random.h>
+
+#include <mf/matrix/op/relabel.h>
+#include <mf/matrix/io/ioProjected.h>
+
+#include "check.h"
+
+using namespace mf;
+
+int main(int argc, char* argv[]) {
+	rg::Random32 random(42);
+
+	// random maps are permutations
+	Relabeling relabeling;
+	randomRelabeling(random, 30, 20, relabeling);
+	MF_CHECK(isPermutation(relabeling.map1, 30));
+	MF_CHECK(isPermutation(relabeling.map2, 20));
+	std::vector<mf_size_type> inverse;
+	invertMap(relabeling.map1, inverse);
+	for (mf_size_type i=0; i<30; i++) MF_CHECK(inverse[relabeling.map1[i]] == i);
+	std::vector<mf_size_type> notAPermutation(3, 0);
+	MF_CHECK(!isPermutation(notAPermutation, 3));
+	MF_CHECK(!isPermutation(relabeling.map1, 31));
+	randomRelabeling(random, 0, 1, relabeling);
+	MF_CHECK(relabeling.map1.empty() && relabeling.map2.size() == 1);
+
+	// relabeled factors are restored to the original ids
+	randomRelabeling(random, 30, 20, relabeling);
+	const mf_size_type r = 3;
+	DenseMatrix w(30, r), w0;
+	DenseMatrixCM h(r, 20), h0;
+	for (mf_size_type i=0; i<30; i++) for (mf_size_type z=0; z<r; z++) w(i,z) = 10*i + z;
+	for (mf_size_type j=0; j<20; j++) for (mf_size_type z=0; z<r; z++) h(z,j) = 10*j + z;
+	project1(w, w0, relabeling.map1); // row i of w0 is row map1[i] of w
+	project2(h, h0, relabeling.map2);
+	unrelabel1(w0, relabeling.map1);
+	unrelabel2(h0, relabeling.map2);
+	for (mf_size_type i=0; i<30; i++) for (mf_size_type z=0; z<r; z++) MF_CHECK(w0(i,z) == w(i,z));
+	for (mf_size_type j=0; j<20; j++) for (mf_size_type z=0; z<r; z++) MF_CHECK(h0(z,j) == h(z,j));
+	DenseMatrix w1(w);
+	unrelabel1(w1, std::vector<mf_size_type>()); // empty map: unchanged
+	MF_CHECK(w1(7,1) == w(7,1));
+
+	// round trip through an mfp descriptor
+	boost::filesystem::path dir = boost::filesystem::temp_directory_path()
+			/ boost::filesystem::unique_path("test-relabel-%%%%-%%%%");
+	boost::filesystem::create_directories(dir);
+	std::string descriptor = (dir / "relabeling.mfp").string();
+	writeRelabeling(relabeling, descriptor, "input.mmc");
+	MF_CHECK(boost::filesystem::exists(descriptor));
+	Relabeling read;
+	readRelabeling(read, descriptor);
+	MF_CHECK(read.map1 == relabeling.map1);
+	MF_CHECK(read.map2 == relabeling.map2);
+
+	// relabelings of only one dimension cannot be written
+	bool thrown = false;
+	try {
+		writeRelabeling(relabeling.rows(), (dir / "rows.mfp").string(), "input.mmc");
+	} catch (...) {
+		thrown = true;
+	}
+	MF_CHECK(thrown);
+
+	boost::filesystem::remove_all(dir);
+	return mf::test::result();
+}
@@ -83,10 +83,13 @@ namespace detail {
 	 * has row factors that are also partitioned by row, (3) has column factors that are
 	 * stored on every node.
 	 *
+	 * @tparam M type of the blocks of the data matrix (e.g., mf::SparseMatrix)
+	 * @tparam W type of the blocks of the row factors (e.g., mf::DenseMatrix)
+	 * @tparam H type of the column factors (e.g., mf::DenseMatrixCM)
 	 * @tparam f the function to run on each block
 	 * @tparam UNIQUE_ID a unique identifier used for constructing task name (TODO: replace by string)
 	 */
-	template<double (*f)(const SparseMatrix&, const DenseMatrix&, const DenseMatrixCM&, int threads),
+	template<typename M, typename W, typename H, double (*f)(const M&, const W&, const H&, int threads),
 			unsigned UNIQUE_ID>
 	struct ApTaskWThreads {
 		struct Arg {
@@ -116,12 +119,14 @@ namespace detail {
 
 		static inline Arg
 		constructArg(mf_size_type b1, mf_size_type b2, mpi2::RemoteVar block,
-				const DistributedMatrix<DenseMatrix>& w, const std::string& hUnblockedName,
+				const DistributedMatrix<W>& w, const std::string& hUnblockedName,
 				int threads) {
 			return Arg(block, w.block(b1, b2), hUnblockedName, b1, b2, threads);
 		}
 
-		static const std::string id() { return rg::paste("__mf/matrix/op/ApTaskWThreads_", UNIQUE_ID); }
+		static const std::string id() { return rg::paste("__mf/matrix/op/ApTaskWThreads_",
+				mpi2::TypeTraits<M>::name() + "_" + mpi2::TypeTraits<W>::name() + "_"
+				+ mpi2::TypeTraits<H>::name(), "_", UNIQUE_ID); }
 
 		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
 			std::vector<Arg> args;
@@ -132,9 +137,9 @@ namespace detail {
 			boost::numeric::ublas::vector<double> denom;
 			for (unsigned i=0; i<args.size(); i++) {
 				Arg& arg = args[i];
-				const SparseMatrix& v = *arg.vBlock.template getLocal<SparseMatrix>();
-				const DenseMatrix& w = *arg.wBlock.template getLocal<DenseMatrix>();
-				const DenseMatrixCM& h = *mpi2::env().get<DenseMatrixCM>(arg.hUnblockedName);
+				const M& v = *arg.vBlock.template getLocal<M>();
+				const W& w = *arg.wBlock.template getLocal<W>();
+				const H& h = *mpi2::env().get<H>(arg.hUnblockedName);
 				result[i] = f(v,w,h,arg.threads);
 				reqs[i] = ch.isend(result[i]); // result
 			}
@@ -26,6 +26,8 @@
 
 namespace mf {
 
+class LazyScale;
+
 template<typename M1, typename M2, typename M3>
 bool checkConformity(const M1& v, const M2& w, const M3& h) {
 	if (v.size1() != w.size1()) return false;
@@ -50,11 +52,16 @@ bool checkConformity(const M1& v, const M2& w, const M3& h, const M4* vc) {
  *
  * @tparam Data element type of data matrix
  * @tparam Factor element type of factor matrices
+ * @tparam Index index type of data matrix (e.g., boost::uint32_t for mf::CompactSparseMatrix)
  */
-template<typename Data = double, typename Factor = double>
+template<typename Data = double, typename Factor = double, typename Index = mf_size_type>
 struct FactorizationData {
-	typedef boost::numeric::ublas::coordinate_matrix<Data, boost::numeric::ublas::row_major> V;
-	typedef boost::numeric::ublas::coordinate_matrix<Data, boost::numeric::ublas::column_major> VC;
+	typedef boost::numeric::ublas::coordinate_matrix<Data, boost::numeric::ublas::row_major, 0,
+			boost::numeric::ublas::unbounded_array<Index>,
+			boost::numeric::ublas::unbounded_array<Data> > V;
+	typedef boost::numeric::ublas::coordinate_matrix<Data, boost::numeric::ublas::column_major, 0,
+			boost::numeric::ublas::unbounded_array<Index>,
+			boost::numeric::ublas::unbounded_array<Data> > VC;
 	typedef boost::numeric::ublas::matrix<Factor, boost::numeric::ublas::row_major> W;
 	typedef boost::numeric::ublas::matrix<Factor, boost::numeric::ublas::column_major> H;
 
@@ -67,7 +74,7 @@ struct FactorizationData {
 	  wValues(w.data()), hValues(h.data()),
 	  nnz(v.nnz()), m(v.size1()), n(v.size2()), r(w.size2()),
 	  nnz1(&nnz1), nnz1offset(nnz1offset), nnz2(&nnz2), nnz2offset(nnz2offset) ,nnz12max(nnz12max),
-	  tasks(tasks)
+	  tasks(tasks), scale(NULL)
 	{
 		if (!checkConformity(v, w, h, vc)) RG_THROW(rg::InvalidArgumentException, "");
 	}
@@ -78,8 +85,8 @@ struct FactorizationData {
 	  wValues(w.data()), hValues(h.data()),
 	  nnz(v.nnz()), m(v.size1()), n(v.size2()), r(w.size2()),
 	  nnz1(new std::vector<mf_size_type>(v.size1())), nnz1offset(0),
-	  nnz2(new std::vector<mf_size_type>(v.size2())), nnz2offset(0),
-	  tasks(tasks)
+	  nnz2(new std::vector<mf_size_type>(v.size2())), nnz2offset(0), nnz12max(0),
+	  tasks(tasks), scale(NULL)
 	{
 		if (!checkConformity(v, w, h, vc)) RG_THROW(rg::InvalidArgumentException, "");
 		nnz12(v, *const_cast<std::vector<mf_size_type> *>(nnz1), *const_cast<std::vector<mf_size_type> *>(nnz2), nnz12max);
@@ -141,6 +148,10 @@ struct FactorizationData {
 
 	/** Number of parallel tasks (PSGD only) */
 	int tasks;
+
+	/** Scale of the factors that has not been applied to w and h yet (see mf::LazyScale);
+	 * NULL if w and h hold the actual values */
+	LazyScale* scale;
 };
 
 /** Data structure that describes the data, starting point, and result of a
@@ -148,12 +159,18 @@ struct FactorizationData {
  *
  * @tparam Data element type of data matrix
  * @tparam Factor element type of factor matrices
+ * @tparam Index index type of data matrix (e.g., boost::uint32_t for the blocks of a
+ *         mf::CompactSparseMatrix)
  */
-template<typename Data = double, typename Factor = double>
+template<typename Data = double, typename Factor = double, typename Index = mf_size_type>
 struct DistributedFactorizationData {
 public:
-	typedef boost::numeric::ublas::coordinate_matrix<Data, boost::numeric::ublas::row_major> V;
-	typedef boost::numeric::ublas::coordinate_matrix<Data, boost::numeric::ublas::column_major> VC;
+	typedef boost::numeric::ublas::coordinate_matrix<Data, boost::numeric::ublas::row_major, 0,
+			boost::numeric::ublas::unbounded_array<Index>,
+			boost::numeric::ublas::unbounded_array<Data> > V;
+	typedef boost::numeric::ublas::coordinate_matrix<Data, boost::numeric::ublas::column_major, 0,
+			boost::numeric::ublas::unbounded_array<Index>,
+			boost::numeric::ublas::unbounded_array<Data> > VC;
 	typedef boost::numeric::ublas::matrix<Factor, boost::numeric::ublas::row_major> W;
 	typedef boost::numeric::ublas::matrix<Factor, boost::numeric::ublas::column_major> H;
 	typedef DistributedMatrix<V> DV;
@@ -161,6 +178,9 @@ public:
 	typedef DistributedMatrix<W> DW;
 	typedef DistributedMatrix<H> DH;
 
+	/** Factorization data of a single block (used by the tasks) */
+	typedef FactorizationData<Data,Factor,Index> Local;
+
 	const DV dv;
 	const DVC* dvc;
 	DW dw;
@@ -190,7 +210,7 @@ protected:
 		init();
 	}
 
-	DistributedFactorizationData(DistributedFactorizationData<Data,Factor>& o)
+	DistributedFactorizationData(DistributedFactorizationData<Data,Factor,Index>& o)
 	: dv(o.dv), dvc(o.dvc), dw(o.dw), dh(o.dh), nnz(o.nnz), tasksPerRank(o.tasksPerRank),
 	  nnz1name(o.nnz1name), nnz2name(o.nnz2name),nnz12max(o.nnz12max) {
 	}
@@ -226,4 +246,13 @@ private:
 
 }
 
+/** Like MPI2_SERIALIZATION_CONSTRUCTOR2, but for templates with three parameters */
+#define MF_SERIALIZATION_CONSTRUCTOR3(T) \
+namespace boost { namespace serialization { \
+template<class Archive, typename T1, typename T2, typename T3> \
+inline void load_construct_data(Archive & ar, T<T1,T2,T3> * t, const unsigned int file_version) { \
+	::new(t)T<T1,T2,T3>(mpi2::UNINITIALIZED); \
+} \
+} }
+
 #endif
@@ -38,4 +38,5 @@
 #define ID_NZSL_AP 22
 #define ID_GENERATE_FACTOR 23
 #define ID_GENERATE_DATAMATRIX 24
+#define ID_NZSL_SAMPLE 25
 #endif
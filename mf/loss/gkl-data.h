@@ -26,24 +26,19 @@ namespace mf {
 
 // -- sequential ----------------------------------------------------------------------------------
 
-/** Compute the data part of the gkl loss only */
-inline double gklData(const SparseMatrix& v,const DenseMatrix& w, const DenseMatrixCM& h) {
+/** Compute the data part of the gkl loss only. Only process entries [begin, end). */
+inline double gklData(const SparseMatrix& v,const DenseMatrix& w, const DenseMatrixCM& h,
+		mf_size_type begin, mf_size_type end) {
 	double result = 0;
 
 	// compute data part
 	const SparseMatrix::index_array_type& index1 = rowIndexData(v);
 	const SparseMatrix::index_array_type& index2 = columnIndexData(v);
 	const SparseMatrix::value_array_type& values = v.value_data();
-	mf_size_type rank = w.size2();
-	for (mf_size_type i=0; i<v.nnz(); i++) {
-		double ip = 0;
-		mf_size_type i1 = index1[i];
-		mf_size_type i2 = index2[i];
+	for (mf_size_type i=begin; i<end; i++) {
 		double value = values[i];
-		if (values[i] == 0) continue; // no loss occurs at zeros (shouldn't be in a sparse matrix anyway, but just in case...)
-		for (mf_size_type r=0; r<rank; r++) {
-			ip += w(i1,r) * h(r,i2);
-		}
+		if (value == 0) continue; // no loss occurs at zeros (shouldn't be in a sparse matrix anyway, but just in case...)
+		double ip = detail::lossDot(w, h, index1[i], index2[i]);
 		ip = fabs(ip); // just to be safe
 		if (ip == 0) {
 			result = INFINITY;
@@ -56,6 +51,51 @@ inline double gklData(const SparseMatrix& v,const DenseMatrix& w, const DenseMat
 	//return std::max(0., result); // avoid rounding errors
 }
 
+/** Compute the data part of the gkl loss only */
+inline double gklData(const SparseMatrix& v,const DenseMatrix& w, const DenseMatrixCM& h) {
+	return gklData(v, w, h, 0, v.nnz());
+}
+
+// -- parallel ------------------------------------------------------------------------------------
+
+namespace detail {
+	struct ParallelGklDataTask {
+		static const std::string id() { return std::string("__mf/loss/ParallelGklDataTask"); }
+		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
+			// receive data
+			mpi2::PointerIntType pV, pW, pH, pSplit;
+			ch.recv(*mpi2::unmarshal(pV, pW, pH, pSplit));
+			SparseMatrix& v = *mpi2::intToPointer<SparseMatrix>(pV);
+			DenseMatrix& w = *mpi2::intToPointer<DenseMatrix>(pW);
+			DenseMatrixCM& h = *mpi2::intToPointer<DenseMatrixCM>(pH);
+			std::vector<mf_size_type>& split = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplit);
+
+			// compute loss and send back
+			int p = info.groupId();
+			double loss = gklData(v, w, h, split[p], split[p+1]);
+			ch.send(loss);
+		}
+	};
+}
+
+/** Compute the data part of the gkl loss using the given number of tasks on the local rank */
+inline double gklData(const SparseMatrix& v,const DenseMatrix& w, const DenseMatrixCM& h, int tasks) {
+	BOOST_ASSERT( tasks > 0 );
+	if (tasks == 1) {
+		return gklData(v, w, h);
+	} else {
+		std::vector<mf_size_type> split = mpi2::split((mf_size_type)v.nnz(), tasks);
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		std::vector<mpi2::Channel> channels;
+		tm.spawn<detail::ParallelGklDataTask>(tm.world().rank(), tasks, channels);
+		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&v),
+				mpi2::pointerToInt(&w), mpi2::pointerToInt(&h), mpi2::pointerToInt(&split)));
+		std::vector<double> losses;
+		mpi2::economicRecvAll(channels, losses, tm.pollDelay());
+		return std::accumulate(losses.begin(), losses.end(), 0.);
+	}
+}
+
 // -- distributed ---------------------------------------------------------------------------------
 
 namespace detail {
@@ -109,10 +149,7 @@ struct GklDataLoss : public LossConcept {
 	GklDataLoss(mpi2::SerializationConstructor _) { };
 
 	double operator()(const FactorizationData<>& data) {
-		if (data.tasks > 1) {
-			LOG4CXX_WARN(detail::logger, "Parallel computation of GklDataLoss not yet implemented, using sequential computation.");
-		}
-		return gklData(data.v, data.w, data.h);
+		return gklData(data.v, data.w, data.h, data.tasks);
 	}
 	double operator()(const DsgdFactorizationData<>& data) {
 		return gklData(data.dv, data.dw, data.dh, data.tasksPerRank);
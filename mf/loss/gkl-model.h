@@ -15,15 +15,112 @@
 #define MF_LOSS_GKL_MODEL_H
 
 
+#include <numeric>
+#include <vector>
+
+#include <boost/serialization/vector.hpp>
+
 #include <mf/loss/loss.h>
 #include <mf/matrix/op/sumofprod.h>
 
 namespace mf {
 
+// -- sequential ----------------------------------------------------------------------------------
+
+namespace detail {
+	/** Adds the column sums of rows [begin, end) of w to sums (which must have size w.size2()).
+	 * Reads w in storage order. */
+	inline void addColumnSums(const DenseMatrix& w, mf_size_type begin, mf_size_type end, double* sums) {
+		const mf_size_type rank = w.size2();
+		const double* row = w.data().begin() + begin*rank;
+		for (mf_size_type i=begin; i<end; i++, row+=rank) {
+			for (mf_size_type r=0; r<rank; r++) {
+				sums[r] += row[r];
+			}
+		}
+	}
+
+	/** Adds the row sums of columns [begin, end) of h to sums (which must have size h.size1()).
+	 * Reads h in storage order. */
+	inline void addRowSums(const DenseMatrixCM& h, mf_size_type begin, mf_size_type end, double* sums) {
+		const mf_size_type rank = h.size1();
+		const double* col = h.data().begin() + begin*rank;
+		for (mf_size_type j=begin; j<end; j++, col+=rank) {
+			for (mf_size_type r=0; r<rank; r++) {
+				sums[r] += col[r];
+			}
+		}
+	}
+}
+
 inline double gklModel(const DenseMatrix& w, const DenseMatrixCM& h) {
-	return sumOfProd(w, h);
+	const mf_size_type rank = w.size2();
+	if (rank == 0) return 0;
+	std::vector<double> sumW(rank, 0.), sumH(rank, 0.);
+	detail::addColumnSums(w, 0, w.size1(), &sumW[0]);
+	detail::addRowSums(h, 0, h.size2(), &sumH[0]);
+	return std::inner_product(sumW.begin(), sumW.end(), sumH.begin(), 0.);
+}
+
+// -- parallel ------------------------------------------------------------------------------------
+
+namespace detail {
+	/** Each task computes the column sums of a range of rows of W and the row sums of a range
+	 * of columns of H; it sends back both as a single vector of size 2r. */
+	struct ParallelGklModelTask {
+		static const std::string id() { return std::string("__mf/loss/ParallelGklModelTask"); }
+		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
+			// receive data
+			mpi2::PointerIntType pW, pH, pSplit1, pSplit2;
+			ch.recv(*mpi2::unmarshal(pW, pH, pSplit1, pSplit2));
+			DenseMatrix& w = *mpi2::intToPointer<DenseMatrix>(pW);
+			DenseMatrixCM& h = *mpi2::intToPointer<DenseMatrixCM>(pH);
+			std::vector<mf_size_type>& split1 = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplit1);
+			std::vector<mf_size_type>& split2 = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplit2);
+
+			// compute sums and send back
+			int p = info.groupId();
+			const mf_size_type rank = w.size2();
+			std::vector<double> sums(2*rank, 0.);
+			addColumnSums(w, split1[p], split1[p+1], &sums[0]);
+			addRowSums(h, split2[p], split2[p+1], &sums[rank]);
+			ch.send(sums);
+		}
+	};
 }
 
+/** Computes the model part of the gkl loss using the given number of tasks on the local rank */
+inline double gklModel(const DenseMatrix& w, const DenseMatrixCM& h, int tasks) {
+	BOOST_ASSERT( tasks > 0 );
+	const mf_size_type rank = w.size2();
+	if (tasks == 1 || rank == 0) {
+		return gklModel(w, h);
+	} else {
+		std::vector<mf_size_type> split1 = mpi2::split(w.size1(), tasks);
+		std::vector<mf_size_type> split2 = mpi2::split(h.size2(), tasks);
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		std::vector<mpi2::Channel> channels;
+		tm.spawn<detail::ParallelGklModelTask>(tm.world().rank(), tasks, channels);
+		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&w), mpi2::pointerToInt(&h),
+				mpi2::pointerToInt(&split1), mpi2::pointerToInt(&split2)));
+		std::vector<std::vector<double> > sums;
+		mpi2::economicRecvAll(channels, sums, tm.pollDelay());
+
+		double result = 0;
+		for (mf_size_type r=0; r<rank; r++) {
+			double sumW = 0, sumH = 0;
+			for (int p=0; p<tasks; p++) {
+				sumW += sums[p][r];
+				sumH += sums[p][rank+r];
+			}
+			result += sumW * sumH;
+		}
+		return result;
+	}
+}
+
+// -- distributed ---------------------------------------------------------------------------------
+
 inline double gklModel(const DistributedDenseMatrix& w, const DistributedDenseMatrixCM& h, int tasksPerRank) {
 	return sumOfProd(w, h, tasksPerRank);
 }
@@ -36,10 +133,7 @@ struct GklModelLoss : public LossConcept {
 	GklModelLoss(mpi2::SerializationConstructor _) { };
 
 	double operator()(const FactorizationData<>& data) {
-		if (data.tasks > 1) {
-			LOG4CXX_WARN(detail::logger, "Parallel computation of GklModelLoss not yet implemented, using sequential computation.");
-		}
-		return gklModel(data.w, data.h);
+		return gklModel(data.w, data.h, data.tasks);
 	}
 
 	double operator()(const DsgdFactorizationData<>& data) {
@@ -26,6 +26,13 @@ inline double gkl(const SparseMatrix& v,const DenseMatrix& w, const DenseMatrixC
 	return std::max(0., result); // avoid rounding errors
 }
 
+// -- parallel ------------------------------------------------------------------------------------
+
+inline double gkl(const SparseMatrix& v,const DenseMatrix& w, const DenseMatrixCM& h, int tasks) {
+	double result = gklData(v, w, h, tasks) + gklModel(w, h, tasks);
+	return std::max(0., result); // avoid rounding errors
+}
+
 // -- distributed ---------------------------------------------------------------------------------
 
 inline SparseMatrix::value_type gkl(const DistributedSparseMatrix& v,
@@ -50,10 +57,7 @@ struct GklLoss : public LossConcept {
 
 
 	double operator()(const FactorizationData<>& data) {
-		if (data.tasks > 1) {
-			LOG4CXX_WARN(detail::logger, "Parallel computation of GklLoss not yet implemented, using sequential computation.");
-		}
-		return gkl(data.v, data.w, data.h);
+		return gkl(data.v, data.w, data.h, data.tasks);
 	}
 
 	double operator()(const DsgdFactorizationData<>& data) {
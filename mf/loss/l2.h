@@ -36,10 +36,11 @@ namespace detail {
 	};
 } // detail
 
+/** The sum is always accumulated in double (also for single-precision matrices). */
 template<typename T, typename L, typename A>
 inline T l2(const boost::numeric::ublas::matrix<T,L,A>& m,  mf_size_type begin, mf_size_type end) {
 	BOOST_ASSERT( begin >= 0 && begin < end && end <= m.data().size() );
-	return std::accumulate(m.data().begin() + begin, m.data().begin() + end, (T)0, detail::l2Op<T>());
+	return (T)std::accumulate(m.data().begin() + begin, m.data().begin() + end, 0., detail::l2Op<double>());
 }
 
 template<typename T, typename L, typename A>
@@ -153,20 +154,24 @@ struct L2Loss : public LossConcept, DistributedLossConcept {
 
 	L2Loss(double lambda) : lambda(lambda) { };
 
-	double operator()(const FactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const FactorizationData<Data,Factor,Index>& data) {
 		if(lambda==0) return 0;
 		return lambda*(l2(data.w, data.tasks) + l2(data.h, data.tasks));
 	}
 
-	double operator()(const DsgdFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const DsgdFactorizationData<Data,Factor,Index>& data) {
 		return lambda*(l2(data.dw, data.tasksPerRank) + l2(data.dh, data.tasksPerRank));
 	}
 
-	double operator()(const DsgdPpFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const DsgdPpFactorizationData<Data,Factor,Index>& data) {
 		return lambda*(l2(data.dw, data.tasksPerRank) + l2(data.dh, data.tasksPerRank));
 	}
 
-	double operator()(const AsgdFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const AsgdFactorizationData<Data,Factor,Index>& data) {
 		return lambda*(l2(data.dw, 1, data.tasksPerRank) + l2(data.dh, 1, data.tasksPerRank));
 	}
 
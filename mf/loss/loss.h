@@ -24,6 +24,7 @@
 #include <mf/sgd/dsgd-factorization.h>
 #include <mf/sgd/dsgdpp-factorization.h>
 #include <mf/sgd/asgd-factorization.h>
+#include <mf/sgd/functions/kernels.h>
 
 namespace mf {
 
@@ -56,6 +57,58 @@ class LossConcept {
 class DistributedLossConcept {
 };
 
+/** An estimate of the value of a loss function (e.g., computed from a sample) together with
+ * its standard error and a confidence interval [lower, upper]. */
+struct LossEstimate {
+	LossEstimate() : value(NAN), stdError(NAN), lower(NAN), upper(NAN), sampleSize(0) {
+	}
+
+	/** Creates an estimate with a confidence interval of z standard errors */
+	LossEstimate(double value, double stdError, double z, mf_size_type sampleSize)
+	: value(value), stdError(stdError), lower(value - z*stdError), upper(value + z*stdError),
+	  sampleSize(sampleSize) {
+	}
+
+	double value;
+	double stdError;
+	double lower;
+	double upper;
+	mf_size_type sampleSize;
+};
+
+/** Returns the estimate behind the value last computed by the given loss function, or NULL
+ * if the loss function computes the loss exactly. Loss functions that estimate the loss
+ * provide an overload of this function (see mf::NzslSampleLoss). */
+template<typename Loss>
+inline const LossEstimate* lastLossEstimate(const Loss& loss) {
+	return NULL;
+}
+
+namespace detail {
+	/** Computes the inner product of row i of w and column j of h in double precision. */
+	template<typename W, typename H>
+	inline double lossDot(const W& w, const H& h, mf_size_type i, mf_size_type j) {
+		double result = 0;
+		mf_size_type rank = w.size2();
+		for (mf_size_type r=0; r<rank; r++) {
+			result += (double)w(i,r) * h(r,j);
+		}
+		return result;
+	}
+
+	/** Version for dense factors; the row of w and the column of h are contiguous in memory
+	 * so that the vectorized kernel can be used. */
+	inline double lossDot(const DenseMatrix& w, const DenseMatrixCM& h, mf_size_type i, mf_size_type j) {
+		unsigned rank = w.size2();
+		return kernels::dot<0>(w.data().begin() + i*rank, h.data().begin() + j*rank, rank);
+	}
+
+	inline double lossDot(const DenseMatrixF& w, const DenseMatrixFCM& h, mf_size_type i, mf_size_type j) {
+		unsigned rank = w.size2();
+		return kernels::dot<0>(w.data().begin() + i*rank, h.data().begin() + j*rank, rank);
+	}
+}
+
 struct NoLoss : public LossConcept, DistributedLossConcept {
 	NoLoss() {};
 	NoLoss(mpi2::SerializationConstructor _) { };
@@ -64,11 +117,18 @@ struct NoLoss : public LossConcept, DistributedLossConcept {
 		return 0.;
 	}
 
-	double operator()(const DsgdFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const DsgdFactorizationData<Data,Factor,Index>& data) {
+		return 0.;
+	}
+
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const DsgdPpFactorizationData<Data,Factor,Index>& data) {
 		return 0.;
 	}
 
-	double operator()(const DsgdPpFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const AsgdFactorizationData<Data,Factor,Index>& data) {
 		return 0.;
 	}
 
@@ -26,10 +26,11 @@ namespace mf {
  * 	@param nnz nnz values (weights for each row)
  * 	@param offset starting offset in nnz vector
  */
-inline double nzl2(const DenseMatrix& m, const std::vector<mf_size_type>& nnz, mf_size_type begin, mf_size_type end, mf_size_type nnzOffset = 0) {
-	const DenseMatrix::array_type& values = m.data();
+template<typename T, typename A>
+inline double nzl2(const boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major,A>& m, const std::vector<mf_size_type>& nnz, mf_size_type begin, mf_size_type end, mf_size_type nnzOffset = 0) {
+	const A& values = m.data();
 	mf_size_type p = begin*m.size2();
-	double result;
+	double result = 0;
 
 	for (mf_size_type i=begin; i<end; i++) {
 	//for (mf_size_type i=0; i<m.size1(); i++) {
@@ -49,7 +50,8 @@ inline double nzl2(const DenseMatrix& m, const std::vector<mf_size_type>& nnz, m
  * 	@param nnz nnz values (weights for each row)
  * 	@param offset starting offset in nnz vector
  */
-inline double nzl2(const DenseMatrix& m, const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset = 0) {
+template<typename T, typename A>
+inline double nzl2(const boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major,A>& m, const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset = 0) {
 	return nzl2(m, nnz,0, m.size1(), nnzOffset);
 }
 
@@ -60,11 +62,12 @@ inline double nzl2(const DenseMatrix& m, const std::vector<mf_size_type>& nnz, m
  * 	@param nnz nnz values (weights for each column)
  * 	@param offset starting offset in nnz vector
  */
-inline double nzl2(const DenseMatrixCM& m, const std::vector<mf_size_type>& nnz, mf_size_type begin, mf_size_type end, mf_size_type nnzOffset = 0) {
-	const DenseMatrixCM::array_type& values = m.data();
+template<typename T, typename A>
+inline double nzl2(const boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major,A>& m, const std::vector<mf_size_type>& nnz, mf_size_type begin, mf_size_type end, mf_size_type nnzOffset = 0) {
+	const A& values = m.data();
 
 	mf_size_type p = begin*m.size1();
-	double result;
+	double result = 0;
 
 	for (mf_size_type j=begin; j<end; j++) {
 		double v = 0;
@@ -82,7 +85,8 @@ inline double nzl2(const DenseMatrixCM& m, const std::vector<mf_size_type>& nnz,
  * 	@param nnz nnz values (weights for each column)
  * 	@param offset starting offset in nnz vector
  */
-inline double nzl2(const DenseMatrixCM& m, const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset = 0) {
+template<typename T, typename A>
+inline double nzl2(const boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major,A>& m, const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset = 0) {
 	return nzl2(m, nnz, 0, m.size2(), nnzOffset);
 }
 
@@ -106,14 +110,15 @@ namespace detail {
 			// compute loss and send back
 			int p = info.groupId();
 
-			typename M::value_type loss = nzl2(m, nnz, split[p], split[p+1],nnzOffset);
+			double loss = nzl2(m, nnz, split[p], split[p+1],nnzOffset);
 			ch.send(loss);
 		}
 	};
 }
 
+/** The loss is always accumulated in double (also for single-precision matrices). */
 template<typename T, typename L, typename A>
-inline T nzl2(const boost::numeric::ublas::matrix<T,L,A>& m, const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset, int tasks,bool isRowFactor=true) {
+inline double nzl2(const boost::numeric::ublas::matrix<T,L,A>& m, const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset, int tasks,bool isRowFactor=true) {
 	BOOST_ASSERT( tasks > 0 );
 	if (tasks == 1) {
 		return nzl2(m,nnz,nnzOffset);
@@ -133,9 +138,9 @@ inline T nzl2(const boost::numeric::ublas::matrix<T,L,A>& m, const std::vector<m
 		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&m),mpi2::pointerToInt(&nnz), mpi2::pointerToInt(&split),nnzOffset));
 
 
-		std::vector<T> losses;
+		std::vector<double> losses;
 		mpi2::economicRecvAll(channels, losses, tm.pollDelay());
-		return std::accumulate(losses.begin(), losses.end(), (T)0.);
+		return std::accumulate(losses.begin(), losses.end(), 0.);
 
 	}
 }
@@ -144,8 +149,10 @@ inline T nzl2(const boost::numeric::ublas::matrix<T,L,A>& m, const std::vector<m
 
 namespace detail {
 
-/**	A task for calculating the NZL2 loss (regularization part) */
-struct Nzl2LossTask {
+/**	A task for calculating the NZL2 loss (regularization part) of the blocks of a row-factor
+ * matrix of type W or a column-factor matrix of type H */
+template<typename W, typename H>
+struct Nzl2LossTaskFor {
 	/**
 	 * 	The argument that is necessary for a task NzL2LossTask. Described in terms of:
 	 * 	(1) the block of W or H on which the task will operate
@@ -161,12 +168,12 @@ struct Nzl2LossTask {
 		: data(block), nnzName(nnzName), nnzOffset(nnzOffset), isRowFactor(isRowFactor), threads(threads) {}
 
 		static Arg constructArgW(mf_size_type b1, mf_size_type b2, mpi2::RemoteVar block,
-				const DistributedMatrix<DenseMatrix>& m, const std::string& nnzName, int threads=1) {
+				const DistributedMatrix<W>& m, const std::string& nnzName, int threads=1) {
 			return Arg(block, nnzName, m.blockOffset1(b1), true, threads);
 		}
 
 		static Arg constructArgH(mf_size_type b1, mf_size_type b2, mpi2::RemoteVar block,
-				const DistributedMatrix<DenseMatrixCM>& m, const std::string& nnzName, int threads=1) {
+				const DistributedMatrix<H>& m, const std::string& nnzName, int threads=1) {
 			return Arg(block, nnzName, m.blockOffset2(b2), false, threads);
 		}
 
@@ -188,7 +195,8 @@ struct Nzl2LossTask {
 		}
 	};
 
-	static const std::string id() {	return std::string("__mf/matrix/op/Nzl2LossTask") ;}
+	static const std::string id() {	return std::string("__mf/matrix/op/Nzl2LossTask_")
+			+ mpi2::TypeTraits<W>::name() + "_" + mpi2::TypeTraits<H>::name(); }
 
 	static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
 		std::vector<Arg> args;
@@ -200,11 +208,11 @@ struct Nzl2LossTask {
 			Arg& arg = args[i];
 			const std::vector<mf_size_type>& nnz = *mpi2::env().get<std::vector<mf_size_type> >(arg.nnzName);
 			if (arg.isRowFactor){
-				const DenseMatrix& m = *arg.data.getLocal<DenseMatrix>();
+				const W& m = *arg.data.template getLocal<W>();
 				results[i] = nzl2(m, nnz, arg.nnzOffset, arg.threads,arg.isRowFactor);
 			}
 			else{
-				const DenseMatrixCM& m = *arg.data.getLocal<DenseMatrixCM>();
+				const H& m = *arg.data.template getLocal<H>();
 				results[i] = nzl2(m, nnz, arg.nnzOffset, arg.threads,arg.isRowFactor);
 			}
 			reqs[i] = ch.isend(results[i]);
@@ -213,29 +221,39 @@ struct Nzl2LossTask {
 	}
 };
 
+typedef Nzl2LossTaskFor<DenseMatrix, DenseMatrixCM> Nzl2LossTask;
+
 } // namespace detail
 
 
 
-inline double nzl2(const DistributedMatrix<DenseMatrix>& m, const std::string& nnzName, int tasksPerRank, int threadsPerTask=1) {
+template<typename T>
+inline double nzl2(const DistributedMatrix<boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major> >& m,
+		const std::string& nnzName, int tasksPerRank, int threadsPerTask=1) {
+	typedef boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major> W;
+	typedef detail::Nzl2LossTaskFor<W, boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major> > Task;
 	boost::numeric::ublas::matrix<double> result;
-	runTaskOnBlocks<DenseMatrix, double, detail::Nzl2LossTask::Arg>(
+	runTaskOnBlocks<W, double, typename Task::Arg>(
 			m,
 			result,
-			boost::bind(detail::Nzl2LossTask::Arg::constructArgW, _1, _2, _3, boost::cref(m), boost::cref(nnzName), threadsPerTask),
-			detail::Nzl2LossTask::id(),
+			boost::bind(Task::Arg::constructArgW, _1, _2, _3, boost::cref(m), boost::cref(nnzName), threadsPerTask),
+			Task::id(),
 			tasksPerRank,
 			false);
 	return sum(result);
 }
 
-inline double nzl2(const DistributedMatrix<DenseMatrixCM>& m, const std::string& nnzName, int tasksPerRank, int threadsPerTask=1) {
+template<typename T>
+inline double nzl2(const DistributedMatrix<boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major> >& m,
+		const std::string& nnzName, int tasksPerRank, int threadsPerTask=1) {
+	typedef boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major> H;
+	typedef detail::Nzl2LossTaskFor<boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major>, H> Task;
 	boost::numeric::ublas::matrix<double> result;
-	runTaskOnBlocks<DenseMatrixCM, double, detail::Nzl2LossTask::Arg>(
+	runTaskOnBlocks<H, double, typename Task::Arg>(
 			m,
 			result,
-			boost::bind(detail::Nzl2LossTask::Arg::constructArgH, _1, _2, _3, boost::cref(m), boost::cref(nnzName), threadsPerTask),
-			detail::Nzl2LossTask::id(),
+			boost::bind(Task::Arg::constructArgH, _1, _2, _3, boost::cref(m), boost::cref(nnzName), threadsPerTask),
+			Task::id(),
 			tasksPerRank,
 			false);
 	return sum(result);
@@ -257,21 +275,24 @@ struct Nzl2Loss : public LossConcept, DistributedLossConcept {
 				);
 	}
 
-	double operator()(const DsgdFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const DsgdFactorizationData<Data,Factor,Index>& data) {
 		return lambda*(
 				nzl2(data.dw, data.nnz1name, data.tasksPerRank)
 				+ nzl2(data.dh, data.nnz2name, data.tasksPerRank)
 		);
 	}
 
-	double operator()(const DsgdPpFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const DsgdPpFactorizationData<Data,Factor,Index>& data) {
 		return lambda*(
 				nzl2(data.dw, data.nnz1name, data.tasksPerRank)
 				+ nzl2(data.dh, data.nnz2name, data.tasksPerRank)
 		);
 	}
 
-	double operator()(const AsgdFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const AsgdFactorizationData<Data,Factor,Index>& data) {
 		return lambda*(
 				nzl2(data.dw, data.nnz1name, 1, data.tasksPerRank)
 				+ nzl2(data.dh, data.nnz2name, 1, data.tasksPerRank)
@@ -0,0 +1,254 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Estimation of the NZSL of a distributed factorization from a stratified sample of the
+ * nonzero entries of the data matrix.
+ */
+
+#ifndef MF_LOSS_NZSL_SAMPLE_H
+#define MF_LOSS_NZSL_SAMPLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/serialization/string.hpp>
+
+#include <util/random.h>
+
+#include <mf/id.h>
+#include <mf/logger.h>
+#include <mf/loss/loss.h>
+#include <mf/matrix/coordinate.h>
+#include <mf/matrix/distribute.h>
+
+namespace mf {
+
+namespace detail {
+	/** Argument of NzslSampleTask */
+	struct NzslSampleArg {
+		NzslSampleArg() : fraction(0), minSize(0) {
+		}
+
+		NzslSampleArg(const std::string& dataName, double fraction, mf_size_type minSize,
+				const boost::numeric::ublas::matrix<unsigned>& seeds)
+		: dataName(dataName), fraction(fraction), minSize(minSize), seeds(seeds) {
+		}
+
+		std::string dataName;
+		double fraction;
+		mf_size_type minSize;
+		boost::numeric::ublas::matrix<unsigned> seeds;
+
+		template<class Archive>
+		void serialize(Archive & ar, const unsigned int version) {
+			ar & dataName;
+			ar & fraction;
+			ar & minSize;
+			ar & seeds;
+		}
+	};
+
+	/** Fills a block of the sample with a uniform random sample (without replacement) of the
+	 * nonzero entries of the corresponding data block, which has to be stored at the same rank.
+	 * Returns the number of nonzero entries of the data block. */
+	inline mf_size_type nzslSampleFunction(mf_size_type b1, mf_size_type b2, SparseMatrix& sample,
+			NzslSampleArg arg) {
+		const SparseMatrix& v = *mpi2::env().get<SparseMatrix>(defaultBlockName(arg.dataName, b1, b2));
+		mf_size_type n = v.nnz();
+		mf_size_type k = std::max((mf_size_type)std::ceil(arg.fraction * n), arg.minSize);
+		if (k > n) k = n;
+
+		rg::Random32 random(arg.seeds(b1, b2));
+		std::vector<mf_size_type> positions = rg::sample<mf_size_type>(random, k, n); // sorted
+		const SparseMatrix::index_array_type& index1 = rowIndexData(v);
+		const SparseMatrix::index_array_type& index2 = columnIndexData(v);
+		const SparseMatrix::value_array_type& values = v.value_data();
+		sample.resize(v.size1(), v.size2(), false);
+		sample.reserve(k);
+		for (mf_size_type p=0; p<k; p++) {
+			mf_size_type q = positions[p];
+			sample.append_element(index1[q], index2[q], values[q]);
+		}
+		sample.sort();
+		return n;
+	}
+
+	struct NzslSampleTask
+	: public PerBlockTaskReturnArgIndex<SparseMatrix, mf_size_type, NzslSampleArg,
+	  nzslSampleFunction, ID_NZSL_SAMPLE> {
+	};
+
+	/** Sum and sum of squares of the squared residuals of the entries of a sample block */
+	struct NzslSampleStats {
+		NzslSampleStats() : sum(0), sumSquares(0), n(0) {
+		}
+
+		double sum;
+		double sumSquares;
+		mf_size_type n;
+
+		template<class Archive>
+		void serialize(Archive & ar, const unsigned int version) {
+			ar & sum;
+			ar & sumSquares;
+			ar & n;
+		}
+	};
+
+	struct NzslSampleStatsTask {
+		static const std::string id() { return std::string("__mf/loss/NzslSampleStatsTask"); }
+		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
+			runFunctionPerAssignedBlock3<SparseMatrix,DenseMatrix,DenseMatrixCM,NzslSampleStats>(ch, &f);
+		}
+		static inline NzslSampleStats f(const SparseMatrix& v, const DenseMatrix& w, const DenseMatrixCM& h) {
+			NzslSampleStats result;
+			const SparseMatrix::index_array_type& index1 = rowIndexData(v);
+			const SparseMatrix::index_array_type& index2 = columnIndexData(v);
+			const SparseMatrix::value_array_type& values = v.value_data();
+			for (mf_size_type p=0; p<v.nnz(); p++) {
+				double ip = lossDot(w, h, index1[p], index2[p]);
+				double diff = values[p] - ip;
+				double y = diff*diff;
+				result.sum += y;
+				result.sumSquares += y*y;
+			}
+			result.n = v.nnz();
+			return result;
+		}
+	};
+}
+
+/** Estimates the NZSL of a distributed factorization from a sample of the nonzero entries of
+ * the data matrix. Each block of the data matrix is a stratum: a uniform random sample of
+ * its nonzero entries is taken once (when the loss is first computed for a data matrix) and
+ * kept in memory at the rank that stores the block. Afterwards, only the squared residuals of
+ * the sampled entries have to be computed.
+ *
+ * The estimate of the loss is unbiased; its standard error and a confidence interval are
+ * available via lastEstimate() and are written to the trace by the SGD runners. Since the
+ * same sample is used in every epoch, the losses of subsequent epochs are comparable even
+ * when the confidence interval is wide, so that the estimate can be used by adaptive decay
+ * functions such as mf::BoldDriver.
+ */
+class NzslSampleLoss : public DistributedLossConcept {
+public:
+	/**
+	 * @param random random number generator used to seed the sample
+	 * @param fraction fraction of the nonzero entries of each block to sample
+	 * @param minSize minimum sample size per block (blocks with fewer entries are used entirely)
+	 * @param z z-value of the confidence interval (default: 1.96, i.e., 95%)
+	 */
+	NzslSampleLoss(rg::Random32& random, double fraction, mf_size_type minSize = 1000, double z = 1.96)
+	: random_(random), fraction_(fraction), minSize_(minSize), z_(z),
+	  sample_(mpi2::UNINITIALIZED) {
+		if (fraction <= 0 || fraction > 1) {
+			RG_THROW(rg::InvalidArgumentException, "sample fraction has to be in (0,1]");
+		}
+	}
+
+	double operator()(const DsgdFactorizationData<>& data) {
+		return estimate(data.dv, data.dw, data.dh, data.tasksPerRank);
+	}
+
+	double operator()(const DsgdPpFactorizationData<>& data) {
+		return estimate(data.dv, data.dw, data.dh, data.tasksPerRank);
+	}
+
+	/** Returns the estimate computed by the last call */
+	const LossEstimate& lastEstimate() const {
+		return estimate_;
+	}
+
+	/** Removes the sample from memory (if any) */
+	void erase() {
+		if (dataName_.empty()) return;
+		sample_.erase();
+		dataName_.clear();
+	}
+
+private:
+	double estimate(const DistributedSparseMatrix& v,
+			const DistributedDenseMatrix& w, const DistributedDenseMatrixCM& h, int tasksPerRank) {
+		if (dataName_ != v.name()) {
+			createSample(v, tasksPerRank);
+		}
+
+		boost::numeric::ublas::matrix<detail::NzslSampleStats> stats(v.blocks1(), v.blocks2());
+		runTaskOnBlocks3(sample_, w, h, stats, detail::NzslSampleStatsTask::id(), tasksPerRank);
+
+		// stratified estimate (one stratum per block; finite population correction)
+		double value = 0, variance = 0;
+		mf_size_type sampleSize = 0;
+		for (mf_size_type b1=0; b1<v.blocks1(); b1++) {
+			for (mf_size_type b2=0; b2<v.blocks2(); b2++) {
+				const detail::NzslSampleStats& s = stats(b1,b2);
+				double n = s.n;
+				double N = blockNnz_(b1,b2);
+				if (s.n == 0) continue;
+				double mean = s.sum / n;
+				value += N * mean;
+				sampleSize += s.n;
+				if (s.n > 1 && n < N) {
+					double var = std::max((s.sumSquares - n*mean*mean) / (n-1), 0.);
+					variance += N * N * (1 - n/N) * var / n;
+				}
+			}
+		}
+		estimate_ = LossEstimate(value, std::sqrt(variance), z_, sampleSize);
+		LOG4CXX_DEBUG(detail::logger, "Estimated NZSL: " << value << " (["
+				<< estimate_.lower << ", " << estimate_.upper << "], " << sampleSize << " samples)");
+		return value;
+	}
+
+	void createSample(const DistributedSparseMatrix& v, int tasksPerRank) {
+		erase();
+
+		// the sample blocks are stored at the ranks of the data blocks
+		boost::numeric::ublas::matrix<int> blockLocations(v.blocks1(), v.blocks2());
+		boost::numeric::ublas::matrix<unsigned> seeds(v.blocks1(), v.blocks2());
+		for (mf_size_type b1=0; b1<v.blocks1(); b1++) {
+			for (mf_size_type b2=0; b2<v.blocks2(); b2++) {
+				blockLocations(b1,b2) = v.block(b1,b2).rank();
+				seeds(b1,b2) = random_();
+			}
+		}
+		sample_ = DistributedSparseMatrix(v.name() + "_sample", v.size1(), v.size2(),
+				v.blockOffsets1(), v.blockOffsets2(), blockLocations);
+		sample_.create();
+		detail::NzslSampleArg arg(v.name(), fraction_, minSize_, seeds);
+		runTaskOnBlocks<detail::NzslSampleTask>(sample_, arg, blockNnz_, tasksPerRank);
+		dataName_ = v.name();
+		LOG4CXX_INFO(detail::logger, "Created loss sample with fraction " << fraction_
+				<< " (at least " << minSize_ << " entries per block)");
+	}
+
+	rg::Random32& random_;
+	double fraction_;
+	mf_size_type minSize_;
+	double z_;
+	std::string dataName_; // name of the data matrix the sample has been taken from
+	DistributedSparseMatrix sample_;
+	boost::numeric::ublas::matrix<mf_size_type> blockNnz_; // number of nonzero entries of each data block
+	LossEstimate estimate_;
+};
+
+inline const LossEstimate* lastLossEstimate(const NzslSampleLoss& loss) {
+	return &loss.lastEstimate();
+}
+
+}
+
+#endif
@@ -25,34 +25,27 @@ namespace mf {
 
 // -- sequential ----------------------------------------------------------------------------------
 
-/** Only process entries [begin, end). */
-template<typename W, typename H>
-inline double nzsl(const SparseMatrix& v,
+/** Only process entries [begin, end). The loss is accumulated in double (also for
+ * single-precision data or factors). */
+template<class T, class L, std::size_t IB, class IA, class TA, typename W, typename H>
+inline double nzsl(const boost::numeric::ublas::coordinate_matrix<T,L,IB,IA,TA>& v,
 		const W& w, const H& h, mf_size_type begin, mf_size_type end) {
-	typedef SparseMatrix M;
-	typename M::value_type result = 0;
+	double result = 0;
 
-	const typename M::index_array_type& index1 = rowIndexData(v);
-	const typename M::index_array_type& index2 = columnIndexData(v);
-	const typename M::value_array_type& values = v.value_data();
-	mf_size_type rank = w.size2();
+	const IA& index1 = rowIndexData(v);
+	const IA& index2 = columnIndexData(v);
+	const TA& values = v.value_data();
 	for (mf_size_type i=begin; i<end; i++) {
-		typename M::value_type ip = 0;
-		typename M::size_type i1 = index1[i];
-		typename M::size_type i2 = index2[i];
-		typename M::value_type value = values[i];
-		for (mf_size_type r=0; r<rank; r++) {
-			ip += w(i1,r) * h(r,i2);
-		}
-		typename M::value_type diff = value - ip;
+		double ip = detail::lossDot(w, h, index1[i], index2[i]);
+		double diff = values[i] - ip;
 		result += diff*diff;
 	}
 
 	return result;
 }
 
-template<typename W, typename H>
-inline double nzsl(const SparseMatrix& v,
+template<class T, class L, std::size_t IB, class IA, class TA, typename W, typename H>
+inline double nzsl(const boost::numeric::ublas::coordinate_matrix<T,L,IB,IA,TA>& v,
 		const W& w, const H& h) {
 	return nzsl(v, w, h, 0, v.nnz());
 }
@@ -81,14 +74,15 @@ namespace detail {
 	};
 }
 
-template<typename W, typename H>
-inline double nzsl(const SparseMatrix& v,
+template<class T, class L, std::size_t IB, class IA, class TA, typename W, typename H>
+inline double nzsl(const boost::numeric::ublas::coordinate_matrix<T,L,IB,IA,TA>& v,
 		const W& w, const H& h, int tasks) {
 	BOOST_ASSERT( tasks > 0 );
 	if (tasks == 1) {
 		return nzsl(v, w, h);
 	} else {
-		typedef detail::ParallelNzslTask<SparseMatrix, W, H> Task;
+		typedef boost::numeric::ublas::coordinate_matrix<T,L,IB,IA,TA> M;
+		typedef detail::ParallelNzslTask<M, W, H> Task;
 		std::vector<mf_size_type> split = mpi2::split((mf_size_type)v.nnz(), tasks);
 		
 // 		for(int i=0; i<split.size(); i++){
@@ -116,41 +110,57 @@ namespace detail {
 		static const std::string id() { return std::string("__mf/loss/NzslTask_")
 				+ mpi2::TypeTraits<M1>::name() + "_" + mpi2::TypeTraits<M2>::name() + "_" + mpi2::TypeTraits<M3>::name(); }
 		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
-			runFunctionPerAssignedBlock3<M1,M2,M3, typename M1::value_type>(ch, &f);
+			runFunctionPerAssignedBlock3<M1,M2,M3,double>(ch, &f);
 		}
-		static inline typename M1::value_type f(const M1& v, const M2& w, const M3& h) {
+		static inline double f(const M1& v, const M2& w, const M3& h) {
 			return nzsl(v, w, h);
 		}
 	};
 }
 
-inline void nzsl(const DistributedSparseMatrix& v,
-		const DistributedDenseMatrix& w, const DistributedDenseMatrixCM& h,
-		boost::numeric::ublas::matrix<SparseMatrix::value_type>& result, int tasksPerRank=1) {
+/** Computes the loss of each block of v. The blocks of v may be of any sparse matrix type
+ * for which mf::detail::NzslTask has been registered (e.g., mf::CompactSparseMatrixF). */
+template<typename M1, typename M2, typename M3>
+inline void nzsl(const DistributedMatrix<M1>& v,
+		const DistributedMatrix<M2>& w, const DistributedMatrix<M3>& h,
+		boost::numeric::ublas::matrix<double>& result, int tasksPerRank=1) {
 	runTaskOnBlocks3(v, w, h, result,
-			detail::NzslTask<SparseMatrix,DenseMatrix,DenseMatrixCM>::id(),
+			detail::NzslTask<M1,M2,M3>::id(),
 			tasksPerRank);
 }
 
-inline SparseMatrix::value_type nzsl(const DistributedSparseMatrix& v,
-		const DistributedDenseMatrix& w, const DistributedDenseMatrixCM& h,
+template<typename M1, typename M2, typename M3>
+inline double nzsl(const DistributedMatrix<M1>& v,
+		const DistributedMatrix<M2>& w, const DistributedMatrix<M3>& h,
 		int tasksPerRank=1) {
-	boost::numeric::ublas::matrix<SparseMatrix::value_type> result(v.blocks1(), v.blocks2());
+	boost::numeric::ublas::matrix<double> result(v.blocks1(), v.blocks2());
 	nzsl(v, w, h, result, tasksPerRank);
 	return sum(result);
 }
 
 namespace detail {
-	typedef ApTaskWThreads<mf::nzsl<DenseMatrix,DenseMatrixCM>, ID_NZSL_AP> NzslApTaskWThreads;
+	template<typename M, typename W = DenseMatrix, typename H = DenseMatrixCM>
+	struct NzslApTaskWThreadsFor {
+		typedef ApTaskWThreads<M, W, H, mf::nzsl, ID_NZSL_AP> Task;
+	};
+	typedef NzslApTaskWThreadsFor<SparseMatrix>::Task NzslApTaskWThreads;
 }
 
-inline double nzsl(const DistributedSparseMatrix& v, const DistributedDenseMatrix& w,
+/** Computes the loss using the blocks of w and an unblocked copy of h stored on each rank under
+ * the given name (as created by ASGD). The copy of h is column-major and has the value type of
+ * w. */
+template<typename M, typename T>
+inline double nzsl(const DistributedMatrix<M>& v,
+		const DistributedMatrix<boost::numeric::ublas::matrix<T, boost::numeric::ublas::row_major> >& w,
 		const std::string& hUnblockedName, int tasksPerRank=1, int threadsPerTask=1) {
+	typedef boost::numeric::ublas::matrix<T, boost::numeric::ublas::row_major> W;
+	typedef boost::numeric::ublas::matrix<T, boost::numeric::ublas::column_major> H;
+	typedef typename detail::NzslApTaskWThreadsFor<M, W, H>::Task Task;
 	boost::numeric::ublas::matrix<double> result;
-	runTaskOnBlocks<SparseMatrix,double,detail::NzslApTaskWThreads::Arg>(
+	runTaskOnBlocks<M,double,typename Task::Arg>(
 						v, result,
-						boost::bind(detail::NzslApTaskWThreads::constructArg, _1, _2, _3, boost::cref(w), boost::cref(hUnblockedName), threadsPerTask),
-						detail::NzslApTaskWThreads::id(), tasksPerRank);
+						boost::bind(Task::constructArg, _1, _2, _3, boost::cref(w), boost::cref(hUnblockedName), threadsPerTask),
+						Task::id(), tasksPerRank);
 	double d = std::accumulate(result.data().begin(), result.data().end(), 0.);
 	return d;
 }
@@ -161,19 +171,23 @@ struct NzslLoss : public LossConcept, DistributedLossConcept {
 	NzslLoss() {};
 	NzslLoss(mpi2::SerializationConstructor _) { };
 
-	double operator()(const FactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const FactorizationData<Data,Factor,Index>& data) {
 		return nzsl(data.v, data.w, data.h, data.tasks);
 	}
 
-	double operator()(const DsgdFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const DsgdFactorizationData<Data,Factor,Index>& data) {
 		return nzsl(data.dv, data.dw, data.dh, data.tasksPerRank);
 	}
 
-	double operator()(const DsgdPpFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const DsgdPpFactorizationData<Data,Factor,Index>& data) {
 		return nzsl(data.dv, data.dw, data.dh, data.tasksPerRank);
 	}
 
-	double operator()(const AsgdFactorizationData<>& data) {
+	template<typename Data, typename Factor, typename Index>
+	double operator()(const AsgdFactorizationData<Data,Factor,Index>& data) {
 		return nzsl(data.dv, data.dw, data.hWorkName, 1, data.tasksPerRank);
 	}
 
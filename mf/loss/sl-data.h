@@ -25,28 +25,72 @@ namespace mf {
 
 // -- sequential ----------------------------------------------------------------------------------
 
+/** Compute the data part of the sl loss only. Only process entries [begin, end). */
+template<typename W, typename H>
+inline double slData(const SparseMatrix& v,
+		const W& w, const H& h, mf_size_type begin, mf_size_type end) {
+	double result = 0;
+	const SparseMatrix::index_array_type& index1 = rowIndexData(v);
+	const SparseMatrix::index_array_type& index2 = columnIndexData(v);
+	const SparseMatrix::value_array_type& values = v.value_data();
+	for (mf_size_type i=begin; i<end; i++) {
+		double ip = detail::lossDot(w, h, index1[i], index2[i]);
+		double value = values[i];
+		result += (value * value) - (2. * value * ip);
+	}
+	return result;
+}
+
 /** Compute the data part of the sl loss only */
 template<typename W, typename H>
 inline double slData(const SparseMatrix& v,
 		const W& w, const H& h) {
-	typedef SparseMatrix M;
-	typename M::value_type result = 0;
-	const typename M::index_array_type& index1 = rowIndexData(v);
-	const typename M::index_array_type& index2 = columnIndexData(v);
-	const typename M::value_array_type& values = v.value_data();
-	unsigned rank = w.size2();
-	for (mf_size_type i=0; i<v.nnz(); i++) {
-		typename M::value_type ip = 0;
-		typename M::size_type i1 = index1[i];
-		typename M::size_type i2 = index2[i];
-		typename M::value_type value = values[i];
-		for (mf_size_type r=0; r<rank; r++) {
-			ip += w(i1,r) * h(r,i2);
+	return slData(v, w, h, 0, v.nnz());
+}
+
+// -- parallel ------------------------------------------------------------------------------------
+
+namespace detail {
+	template<typename M2, typename M3>
+	struct ParallelSlDataTask {
+		static const std::string id() { return std::string("__mf/loss/ParallelSlDataTask_")
+				+ mpi2::TypeTraits<M2>::name() + "_" + mpi2::TypeTraits<M3>::name(); }
+		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
+			// receive data
+			mpi2::PointerIntType pV, pW, pH, pSplit;
+			ch.recv(*mpi2::unmarshal(pV, pW, pH, pSplit));
+			SparseMatrix& v = *mpi2::intToPointer<SparseMatrix>(pV);
+			M2& w = *mpi2::intToPointer<M2>(pW);
+			M3& h = *mpi2::intToPointer<M3>(pH);
+			std::vector<mf_size_type>& split = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplit);
+
+			// compute loss and send back
+			int p = info.groupId();
+			double loss = slData(v, w, h, split[p], split[p+1]);
+			ch.send(loss);
 		}
-		typename M::value_type diff = (value * value) - (2. * value * ip);
-		result += diff;
+	};
+}
+
+/** Compute the data part of the sl loss using the given number of tasks on the local rank */
+template<typename W, typename H>
+inline double slData(const SparseMatrix& v,
+		const W& w, const H& h, int tasks) {
+	BOOST_ASSERT( tasks > 0 );
+	if (tasks == 1) {
+		return slData(v, w, h);
+	} else {
+		typedef detail::ParallelSlDataTask<W, H> Task;
+		std::vector<mf_size_type> split = mpi2::split((mf_size_type)v.nnz(), tasks);
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		std::vector<mpi2::Channel> channels;
+		tm.spawn<Task>(tm.world().rank(), tasks, channels);
+		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&v),
+				mpi2::pointerToInt(&w), mpi2::pointerToInt(&h), mpi2::pointerToInt(&split)));
+		std::vector<double> losses;
+		mpi2::economicRecvAll(channels, losses, tm.pollDelay());
+		return std::accumulate(losses.begin(), losses.end(), 0.);
 	}
-	return result;
 }
 
 // -- distributed ---------------------------------------------------------------------------------
@@ -102,15 +146,11 @@ struct SlDataLoss : public LossConcept {
 	SlDataLoss(mpi2::SerializationConstructor _) { };
 
 	double operator()(const FactorizationData<>& data) {
-		if (data.tasks > 1) {
-			LOG4CXX_WARN(detail::logger, "Parallel computation of SlDataLoss not yet implemented, using sequential computation.");
-		}
-
-		return slData(data.v, data.w, data.h);
+		return slData(data.v, data.w, data.h, data.tasks);
 	}
 
 	double operator()(const DsgdFactorizationData<>& data) {
-		return slData(data.dv, data.dw, data.dh);
+		return slData(data.dv, data.dw, data.dh, data.tasksPerRank);
 	}
 
 private:
@@ -14,6 +14,10 @@
 #ifndef MF_LOSS_SL_MODEL_H
 #define MF_LOSS_SL_MODEL_H
 
+#include <vector>
+
+#include <boost/serialization/vector.hpp>
+
 #include <mf/loss/loss.h>
 #include <mf/matrix/op/sums.h>
 
@@ -22,8 +26,114 @@ namespace mf {
 
 // -- sequential ----------------------------------------------------------------------------------
 
+namespace detail {
+	/** Adds the upper triangle of t(w) %*% w, restricted to rows [begin, end) of w, to the
+	 * row-major r x r matrix gram. Reads w in storage order. */
+	inline void addCrossprod(const DenseMatrix& w, mf_size_type begin, mf_size_type end, double* gram) {
+		const mf_size_type rank = w.size2();
+		const double* row = w.data().begin() + begin*rank;
+		for (mf_size_type i=begin; i<end; i++, row+=rank) {
+			for (mf_size_type a=0; a<rank; a++) {
+				const double x = row[a];
+				double* g = gram + a*rank;
+				for (mf_size_type b=a; b<rank; b++) {
+					g[b] += x * row[b];
+				}
+			}
+		}
+	}
+
+	/** Adds the upper triangle of h %*% t(h), restricted to columns [begin, end) of h, to the
+	 * row-major r x r matrix gram. Reads h in storage order. */
+	inline void addTCrossprod(const DenseMatrixCM& h, mf_size_type begin, mf_size_type end, double* gram) {
+		const mf_size_type rank = h.size1();
+		const double* col = h.data().begin() + begin*rank;
+		for (mf_size_type j=begin; j<end; j++, col+=rank) {
+			for (mf_size_type a=0; a<rank; a++) {
+				const double x = col[a];
+				double* g = gram + a*rank;
+				for (mf_size_type b=a; b<rank; b++) {
+					g[b] += x * col[b];
+				}
+			}
+		}
+	}
+
+	/** Computes sum_ab wtw(a,b)*hht(a,b) from the upper triangles of both matrices */
+	inline double slModelFromGrams(const double* wtw, const double* hht, mf_size_type rank) {
+		double result = 0;
+		for (mf_size_type a=0; a<rank; a++) {
+			result += wtw[a*rank+a] * hht[a*rank+a];
+			for (mf_size_type b=a+1; b<rank; b++) {
+				result += 2. * wtw[a*rank+b] * hht[a*rank+b];
+			}
+		}
+		return result;
+	}
+}
+
+/** Computes the sum of squares of W %*% H as tr(t(W) %*% W %*% H %*% t(H)) */
 inline double slModel(const DenseMatrix& w, const DenseMatrixCM& h) {
-	return sumOfSquares(w,h);
+	const mf_size_type rank = w.size2();
+	if (rank == 0) return 0;
+	std::vector<double> wtw(rank*rank, 0.), hht(rank*rank, 0.);
+	detail::addCrossprod(w, 0, w.size1(), &wtw[0]);
+	detail::addTCrossprod(h, 0, h.size2(), &hht[0]);
+	return detail::slModelFromGrams(&wtw[0], &hht[0], rank);
+}
+
+// -- parallel ------------------------------------------------------------------------------------
+
+namespace detail {
+	/** Each task computes the (upper triangles of the) Gram matrices of a range of rows of W and
+	 * of a range of columns of H; it sends back both as a single vector of size 2r^2. */
+	struct ParallelSlModelTask {
+		static const std::string id() { return std::string("__mf/loss/ParallelSlModelTask"); }
+		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
+			// receive data
+			mpi2::PointerIntType pW, pH, pSplit1, pSplit2;
+			ch.recv(*mpi2::unmarshal(pW, pH, pSplit1, pSplit2));
+			DenseMatrix& w = *mpi2::intToPointer<DenseMatrix>(pW);
+			DenseMatrixCM& h = *mpi2::intToPointer<DenseMatrixCM>(pH);
+			std::vector<mf_size_type>& split1 = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplit1);
+			std::vector<mf_size_type>& split2 = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplit2);
+
+			// compute Gram matrices and send back
+			int p = info.groupId();
+			const mf_size_type rank = w.size2();
+			std::vector<double> grams(2*rank*rank, 0.);
+			addCrossprod(w, split1[p], split1[p+1], &grams[0]);
+			addTCrossprod(h, split2[p], split2[p+1], &grams[rank*rank]);
+			ch.send(grams);
+		}
+	};
+}
+
+/** Computes the model part of the sl loss using the given number of tasks on the local rank */
+inline double slModel(const DenseMatrix& w, const DenseMatrixCM& h, int tasks) {
+	BOOST_ASSERT( tasks > 0 );
+	const mf_size_type rank = w.size2();
+	if (tasks == 1 || rank == 0) {
+		return slModel(w, h);
+	} else {
+		std::vector<mf_size_type> split1 = mpi2::split(w.size1(), tasks);
+		std::vector<mf_size_type> split2 = mpi2::split(h.size2(), tasks);
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		std::vector<mpi2::Channel> channels;
+		tm.spawn<detail::ParallelSlModelTask>(tm.world().rank(), tasks, channels);
+		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&w), mpi2::pointerToInt(&h),
+				mpi2::pointerToInt(&split1), mpi2::pointerToInt(&split2)));
+		std::vector<std::vector<double> > grams;
+		mpi2::economicRecvAll(channels, grams, tm.pollDelay());
+
+		std::vector<double> sum(2*rank*rank, 0.);
+		for (int p=0; p<tasks; p++) {
+			for (mf_size_type k=0; k<sum.size(); k++) {
+				sum[k] += grams[p][k];
+			}
+		}
+		return detail::slModelFromGrams(&sum[0], &sum[rank*rank], rank);
+	}
 }
 
 // -- distributed ---------------------------------------------------------------------------------
@@ -39,11 +149,7 @@ struct SlModelLoss : public LossConcept {
 	SlModelLoss(mpi2::SerializationConstructor _) { };
 
 	double operator()(const FactorizationData<>& data) {
-		if (data.tasks > 1) {
-			LOG4CXX_WARN(detail::logger, "Parallel computation of SlModelLoss not yet implemented, using sequential computation.");
-		}
-
-		return slModel(data.w, data.h);
+		return slModel(data.w, data.h, data.tasks);
 	}
 
 	double operator()(const DsgdFactorizationData<>& data) {
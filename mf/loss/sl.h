@@ -25,6 +25,12 @@ inline double sl(const SparseMatrix& v,const DenseMatrix& w, const DenseMatrixCM
 	return slData(v, w, h) + slModel(w, h);
 }
 
+// -- parallel ------------------------------------------------------------------------------------
+
+inline double sl(const SparseMatrix& v,const DenseMatrix& w, const DenseMatrixCM& h, int tasks) {
+	return slData(v, w, h, tasks) + slModel(w, h, tasks);
+}
+
 // -- distributed ---------------------------------------------------------------------------------
 
 inline double sl(const DistributedSparseMatrix& v, const DistributedDenseMatrix& w, const DistributedDenseMatrixCM& h, int tasksPerRank = 1) {
@@ -44,11 +50,7 @@ struct SlLoss : public LossConcept {
 
 
 	double operator()(const FactorizationData<>& data) {
-		if (data.tasks > 1) {
-			LOG4CXX_WARN(detail::logger, "Parallel computation of SlLoss not yet implemented, using sequential computation.");
-		}
-
-		return sl(data.v, data.w, data.h);
+		return sl(data.v, data.w, data.h, data.tasks);
 	}
 
 	double operator()(const DsgdFactorizationData<>& data) {
@@ -25,12 +25,43 @@
 
 #include <mf/logger.h>
 #include <mf/matrix/distributed_matrix.h>
+#include <mf/matrix/transfer.h>
 
 namespace mf {
 
-/** Argument constructor for mf::runTaskOnBlocks for factorization tasks. Produces a vector of
- * three remote variables: one for block (b1,b2) of a distributed matrix, one for block (b1,0) of
- * a conforming row factor matrix, and one for block (0,b2) of a conforming column factor matrix.
+/** Argument of factorization tasks (see mf::argBlockRV3): remote variables for block (b1,b2)
+ * of a distributed matrix, for block (b1,0) of a conforming row factor matrix, and for block
+ * (0,b2) of a conforming column factor matrix, along with the dimensions of the two factor
+ * blocks. The dimensions allow tasks to prefetch remote factor blocks without first asking
+ * for their size (see mf::igetCopy). */
+struct BlockRV3 {
+	BlockRV3() : v(mpi2::UNINITIALIZED), w(mpi2::UNINITIALIZED), h(mpi2::UNINITIALIZED),
+			wSize1(0), wSize2(0), hSize1(0), hSize2(0) {
+	}
+
+	mpi2::RemoteVar v;
+	mpi2::RemoteVar w;
+	mpi2::RemoteVar h;
+	mf_size_type wSize1;
+	mf_size_type wSize2;
+	mf_size_type hSize1;
+	mf_size_type hSize2;
+
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int version) {
+		ar & v;
+		ar & w;
+		ar & h;
+		ar & wSize1;
+		ar & wSize2;
+		ar & hSize1;
+		ar & hSize2;
+	}
+};
+
+/** Argument constructor for mf::runTaskOnBlocks for factorization tasks. Produces the remote
+ * variables of block (b1,b2) of a distributed matrix, of block (b1,0) of a conforming row factor
+ * matrix, and of block (0,b2) of a conforming column factor matrix (see mf::BlockRV3).
  *
  * @param b1 the row block number
  * @param b2 the column block number
@@ -41,13 +72,17 @@ namespace mf {
  * @tparam M3 type of column factor matrix
  */
 template<typename M2, typename M3>
-inline std::vector<mpi2::RemoteVar> argBlockRV3(
+inline BlockRV3 argBlockRV3(
 		mf_size_type b1, mf_size_type b2, mpi2::RemoteVar block,
 		const DistributedMatrix<M2>& w, const DistributedMatrix<M3>& h) {
-	std::vector<mpi2::RemoteVar> result;
-	result.push_back(block);
-	result.push_back(w.block(b1,0));
-	result.push_back(h.block(0,b2));
+	BlockRV3 result;
+	result.v = block;
+	result.w = w.block(b1,0);
+	result.h = h.block(0,b2);
+	result.wSize1 = w.blockSize1(b1);
+	result.wSize2 = w.size2();
+	result.hSize1 = h.size1();
+	result.hSize2 = h.blockSize2(b2);
 	return result;
 }
 
@@ -94,7 +129,7 @@ void runTaskOnBlocks3(const DistributedMatrix<M1>& v,
 		boost::numeric::ublas::matrix<R>& result,
 		const std::string& taskId,
 		int tasksPerRank=1, bool asyncRecv = true, int pollDelay = -1) {
-	runTaskOnBlocks<M1,R,std::vector<mpi2::RemoteVar> >(v, result,
+	runTaskOnBlocks<M1,R,BlockRV3>(v, result,
 			boost::bind(argBlockRV3<M2,M3>, _1, _2, _3, boost::cref(w), boost::cref(h)),
 			taskId, tasksPerRank, asyncRecv, pollDelay);
 }
@@ -134,37 +134,38 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 	mpi2::RemoteVar hhNext(mpi2::UNINITIALIZED);
 
 	// receive work
-	std::vector<std::vector<mpi2::RemoteVar> > vars;
+	std::vector<BlockRV3> vars;
 	ch.recvAsync(vars);
 
 	// split the work into (vars, index) pairs:
 	// localVars: all required data is stored locally
 	// remoteVars: some required data is not stored local
-	std::vector<std::pair<std::vector<mpi2::RemoteVar>, unsigned> > localVars;
-	std::vector<std::pair<std::vector<mpi2::RemoteVar>, unsigned> > remoteVars;
+	std::vector<std::pair<BlockRV3, unsigned> > localVars;
+	std::vector<std::pair<BlockRV3, unsigned> > remoteVars;
 	for (unsigned i=0; i<vars.size(); i++) {
-		if (vars[i][1].isLocal() && vars[i][2].isLocal()) {
-			localVars.push_back( std::pair<std::vector<mpi2::RemoteVar>, unsigned>(vars[i], i) );
+		if (vars[i].w.isLocal() && vars[i].h.isLocal()) {
+			localVars.push_back( std::pair<BlockRV3, unsigned>(vars[i], i) );
 		} else {
-			remoteVars.push_back(std::pair<std::vector<mpi2::RemoteVar>, unsigned>(vars[i], i));
+			remoteVars.push_back(std::pair<BlockRV3, unsigned>(vars[i], i));
 		}
 	}
 	LOG4CXX_TRACE(detail::logger, ch.local() << ": " << localVars.size() << " local blocks, "
 			<< remoteVars.size() << " remote blocks");
 
-	// get the list of remote variables that we need to fetch (in the processing order)
-	std::queue<mpi2::RemoteVar> fetchWs;
-	std::queue<mpi2::RemoteVar> fetchHs;
+	// get the list of remote variables that we need to fetch (in the processing order); the
+	// dimensions are known, so that prefetching does not wait for the remote side
+	std::queue<BlockRV3> fetchWs;
+	std::queue<BlockRV3> fetchHs;
 	for (unsigned iRemote=0; iRemote<remoteVars.size(); iRemote++) {
-		wwNext = remoteVars[iRemote].first[1];
+		wwNext = remoteVars[iRemote].first.w;
 		if (!wwNext.isLocal() && wwNext != ww) {
-			fetchWs.push(wwNext);
+			fetchWs.push(remoteVars[iRemote].first);
 			ww = wwNext;
 		}
 
-		hhNext = remoteVars[iRemote].first[2];
+		hhNext = remoteVars[iRemote].first.h;
 		if (!hhNext.isLocal() && hhNext != hh) {
-			fetchHs.push(hhNext);
+			fetchHs.push(remoteVars[iRemote].first);
 			hh = hhNext;
 		}
 	}
@@ -173,16 +174,18 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 	boost::mpi::request wReq;
 	if (!fetchWs.empty()) {
 		ww = mpi2::RemoteVar(mpi2::UNINITIALIZED);
-		wwNext = fetchWs.front(); fetchWs.pop();
+		wwNext = fetchWs.front().w;
 		LOG4CXX_TRACE(detail::logger, ch.local() << ": Prefetching " << wwNext);
-		wReq = wwNext.igetCopy<M2>(*wNext);
+		wReq = mf::igetCopy(wwNext, *wNext, fetchWs.front().wSize1, fetchWs.front().wSize2);
+		fetchWs.pop();
 	}
 	boost::mpi::request hReq;
 	if (!fetchHs.empty()) {
 		hh = mpi2::RemoteVar(mpi2::UNINITIALIZED);
-		hhNext = fetchHs.front(); fetchHs.pop();
+		hhNext = fetchHs.front().h;
 		LOG4CXX_TRACE(detail::logger, ch.local() << ": Prefetching " << hhNext);
-		hReq = hhNext.igetCopy<M3>(*hNext);
+		hReq = mf::igetCopy(hhNext, *hNext, fetchHs.front().hSize1, fetchHs.front().hSize2);
+		fetchHs.pop();
 	}
 
 	// main loop: process each block
@@ -191,9 +194,9 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 	unsigned iLocal = 0, iRemote = 0;
 	for (; iLocal < localVars.size() && iRemote < remoteVars.size(); ) {
 		// first check if we can process a block with remote data
-		mpi2::RemoteVar vBlock = remoteVars[iRemote].first[0];
-		mpi2::RemoteVar wBlock= remoteVars[iRemote].first[1];
-		mpi2::RemoteVar hBlock= remoteVars[iRemote].first[2];
+		mpi2::RemoteVar vBlock = remoteVars[iRemote].first.v;
+		mpi2::RemoteVar wBlock= remoteVars[iRemote].first.w;
+		mpi2::RemoteVar hBlock= remoteVars[iRemote].first.h;
 
 		// check if prefetching of W has finished; if so, prefetch next required block
 		if (wBlock == wwNext) {
@@ -201,9 +204,10 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 				std::swap(w, wNext);
 				ww = wwNext;
 				if (!fetchWs.empty()) {
-					wwNext = fetchWs.front(); fetchWs.pop();
+					wwNext = fetchWs.front().w;
 					LOG4CXX_TRACE(detail::logger, ch.local() << ": Prefetching " << wwNext);
-					wReq = wwNext.igetCopy<M2>(*wNext);
+					wReq = mf::igetCopy(wwNext, *wNext, fetchWs.front().wSize1, fetchWs.front().wSize2);
+					fetchWs.pop();
 				} else {
 					wwNext = mpi2::RemoteVar(mpi2::UNINITIALIZED);
 				}
@@ -216,9 +220,10 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 				std::swap(h, hNext);
 				hh = hhNext;
 				if (!fetchHs.empty()) {
-					hhNext = fetchHs.front(); fetchHs.pop();
+					hhNext = fetchHs.front().h;
 					LOG4CXX_TRACE(detail::logger, ch.local() << ": Prefetching " << hhNext);
-					hReq = hhNext.igetCopy<M3>(*hNext);
+					hReq = mf::igetCopy(hhNext, *hNext, fetchHs.front().hSize1, fetchHs.front().hSize2);
+					fetchHs.pop();
 				} else {
 					hhNext = mpi2::RemoteVar(mpi2::UNINITIALIZED);
 				}
@@ -239,9 +244,9 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 		} else {
                     //mpi2::logBeginEvent("local");
 			// process a local block
-			vBlock = localVars[iLocal].first[0];
-			wBlock = localVars[iLocal].first[1];
-			hBlock = localVars[iLocal].first[2];
+			vBlock = localVars[iLocal].first.v;
+			wBlock = localVars[iLocal].first.w;
+			hBlock = localVars[iLocal].first.h;
 
 			// run the function
 			unsigned i = localVars[iLocal].second;
@@ -256,9 +261,9 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 
 	// process remaining local blocks
 	for (; iLocal<localVars.size(); iLocal++) {
-		mpi2::RemoteVar vBlock = localVars[iLocal].first[0];
-		mpi2::RemoteVar wBlock = localVars[iLocal].first[1];
-		mpi2::RemoteVar hBlock = localVars[iLocal].first[2];
+		mpi2::RemoteVar vBlock = localVars[iLocal].first.v;
+		mpi2::RemoteVar wBlock = localVars[iLocal].first.w;
+		mpi2::RemoteVar hBlock = localVars[iLocal].first.h;
 
 		// run the function
                 //mpi2::logBeginEvent("local");
@@ -272,9 +277,9 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 
 	// process remaining remote blocks
 	for (; iRemote<remoteVars.size(); iRemote++) {
-		mpi2::RemoteVar vBlock = remoteVars[iRemote].first[0];
-		mpi2::RemoteVar wBlock= remoteVars[iRemote].first[1];
-		mpi2::RemoteVar hBlock= remoteVars[iRemote].first[2];
+		mpi2::RemoteVar vBlock = remoteVars[iRemote].first.v;
+		mpi2::RemoteVar wBlock= remoteVars[iRemote].first.w;
+		mpi2::RemoteVar hBlock= remoteVars[iRemote].first.h;
 
 		// finish prefetching of W (wait)
 		if (wBlock == wwNext) {
@@ -282,9 +287,10 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 			std::swap(w, wNext);
 			ww = wwNext;
 			if (!fetchWs.empty()) {
-				wwNext = fetchWs.front(); fetchWs.pop();
+				wwNext = fetchWs.front().w;
 				LOG4CXX_TRACE(detail::logger, ch.local() << ": Prefetching " << wwNext);
-				wReq = wwNext.igetCopy<M2>(*wNext);
+				wReq = mf::igetCopy(wwNext, *wNext, fetchWs.front().wSize1, fetchWs.front().wSize2);
+				fetchWs.pop();
 			} else {
 				wwNext = mpi2::RemoteVar(mpi2::UNINITIALIZED);
 			}
@@ -296,9 +302,10 @@ void runFunctionPerAssignedBlock3(mpi2::Channel ch,
 			std::swap(h, hNext);
 			hh = hhNext;
 			if (!fetchHs.empty()) {
-				hhNext = fetchHs.front(); fetchHs.pop();
+				hhNext = fetchHs.front().h;
 				LOG4CXX_TRACE(detail::logger, ch.local() << ": Prefetching " << hhNext);
-				hReq = hhNext.igetCopy<M3>(*hNext);
+				hReq = mf::igetCopy(hhNext, *hNext, fetchHs.front().hSize1, fetchHs.front().hSize2);
+				fetchHs.pop();
 			} else {
 				hhNext = mpi2::RemoteVar(mpi2::UNINITIALIZED);
 			}
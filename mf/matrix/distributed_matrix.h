@@ -51,6 +51,29 @@ std::string defaultBlockName(const std::string& name, mf_size_type b1, mf_size_t
 void computeDefaultBlockOffsets(mf_size_type size, mf_size_type blocks,
 		std::vector<mf_size_type>& blockOffsets);
 
+/** Determines how block offsets are chosen when a matrix is blocked automatically */
+enum BlockingType {
+	BLOCKING_EQUAL_SIZE,   /**< blocks have roughly the same number of rows/columns (default) */
+	BLOCKING_BALANCED_NNZ  /**< blocks have roughly the same number of nonzero entries */
+};
+
+/** Computes the block offsets along a dimension (rows/columns) by trying to create blocks
+ * with an equal number of nonzero entries. Balancing both dimensions this way makes the
+ * 2D blocks roughly balanced as well, even for data with skewed (e.g., power-law) row and
+ * column distributions.
+ *
+ * @param nnz number of nonzero entries in each row/column (e.g., as computed by mf::nnz12)
+ * @param blocks number of blocks in the dimension
+ * @param[out] blockOffsets starting offsets for each block (this vector will have size() equal
+ *                          to blocks); every block contains at least one row/column
+ */
+void computeBalancedBlockOffsets(const std::vector<mf_size_type>& nnz, mf_size_type blocks,
+		std::vector<mf_size_type>& blockOffsets);
+
+/** Returns the ratio of the maximum and the mean number of nonzero entries of the given
+ * blocks (1 if the blocks are perfectly balanced). */
+double blockNnzRatio(const boost::numeric::ublas::matrix<mf_size_type>& blockNnz);
+
 /** Determines locations at which to store the blocks of a blocks1 x blocks2 distributed matrix.
  * Tries to evenly distribute the blocks among the available nodes subject to the condition that
  * each row (partitionByRow = true) or each column (partitionByRow = false) is stored on
@@ -11,6 +11,8 @@
 //    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 //    See the License for the specific language governing permissions and
 //    limitations under the License.
+#include <algorithm>
+
 #include <mf/matrix/distributed_matrix.h>
 
 namespace mf {
@@ -39,6 +41,51 @@ void computeDefaultBlockOffsets(mf_size_type size, mf_size_type blocks,
 	}
 };
 
+void computeBalancedBlockOffsets(const std::vector<mf_size_type>& nnz, mf_size_type blocks,
+		std::vector<mf_size_type>& blockOffsets) {
+	mf_size_type size = nnz.size();
+	if (size < blocks) {
+		computeDefaultBlockOffsets(size, blocks, blockOffsets);
+		return;
+	}
+	mf_size_type total = 0;
+	for (mf_size_type i=0; i<size; i++) total += nnz[i];
+
+	// place the boundary of block b where the prefix sum of nnz is closest to b*total/blocks
+	blockOffsets.resize(blocks);
+	blockOffsets[0] = 0;
+	mf_size_type i = 0;
+	mf_size_type prefix = 0; // sum of nnz[0..i-1]
+	for (mf_size_type b=1; b<blocks; b++) {
+		double target = (double)total * b / blocks;
+		while (i < size && prefix + nnz[i] <= target) {
+			prefix += nnz[i];
+			i++;
+		}
+		mf_size_type offset = i;
+		if (i < size && target - prefix > prefix + nnz[i] - target) {
+			offset = i+1; // next boundary is closer
+		}
+
+		// every block gets at least one row/column
+		offset = std::max(offset, blockOffsets[b-1] + 1);
+		offset = std::min(offset, size - (blocks - b));
+		blockOffsets[b] = offset;
+	}
+}
+
+double blockNnzRatio(const boost::numeric::ublas::matrix<mf_size_type>& blockNnz) {
+	mf_size_type max = 0, total = 0;
+	for (mf_size_type b1=0; b1<blockNnz.size1(); b1++) {
+		for (mf_size_type b2=0; b2<blockNnz.size2(); b2++) {
+			max = std::max(max, blockNnz(b1,b2));
+			total += blockNnz(b1,b2);
+		}
+	}
+	if (total == 0) return 1.;
+	return (double)max * blockNnz.size1() * blockNnz.size2() / total;
+}
+
 void computeDefaultBlockLocations(unsigned worldSize,
 		mf_size_type blocks1, mf_size_type blocks2,
 		bool partitionByRow, boost::numeric::ublas::matrix<int>& blockLocations) {
@@ -14,6 +14,10 @@
 #ifndef MF_MATRIX_IO_FORMAT_H
 #define MF_MATRIX_IO_FORMAT_H
 
+#include <string>
+
+#include <util/exception.h>
+
 #define mf_stringify(name) # name
 
 namespace mf {
@@ -27,6 +27,7 @@
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/matrix/distribute.h>
 #include <mf/matrix/io/randomMatrixDescriptor.h>
+#include <mf/matrix/op/relabel.h>
 
 namespace mf{
 /*
@@ -54,11 +55,30 @@ void generateDataMatrices(const RandomMatrixDescriptor& f, DistributedMatrix<M>&
  *
  * if forAsgd=true and you load the data, the code uses 1 taskPerRank to load them
  *
+ * if blockOffsets1 and blockOffsets2 are given, unblocked factor files are blocked with these
+ * offsets (use the offsets of the data matrix when it has not been blocked into blocks of equal size)
+ *
+ * if relabeling is given, the rows of unblocked W files and the columns of unblocked H files are
+ * relabeled like the data matrix
+ *
+ * W and H are the types of the blocks (e.g., DenseMatrixF and DenseMatrixFCM for single-precision
+ * factors); the overload without template arguments uses DenseMatrix and DenseMatrixCM
  *
  */
+template<typename W, typename H>
+std::pair<DistributedMatrix<W>, DistributedMatrix<H> > getFactors(const std::string& fileW,
+		const std::string& fileH, int tasksPerRank, int worldSize,
+		mf_size_type blocks1, mf_size_type blocks2, bool forAsgd,
+		const std::vector<mf_size_type>& blockOffsets1 = std::vector<mf_size_type>(),
+		const std::vector<mf_size_type>& blockOffsets2 = std::vector<mf_size_type>(),
+		const Relabeling* relabeling = NULL);
+
 std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> getFactors(const std::string& fileW,
 		const std::string& fileH, int tasksPerRank, int worldSize,
-		mf_size_type blocks1, mf_size_type blocks2, bool forAsgd);
+		mf_size_type blocks1, mf_size_type blocks2, bool forAsgd,
+		const std::vector<mf_size_type>& blockOffsets1 = std::vector<mf_size_type>(),
+		const std::vector<mf_size_type>& blockOffsets2 = std::vector<mf_size_type>(),
+		const Relabeling* relabeling = NULL);
 /*
  * generates or load the data / test matrix from a file(s)
  *
@@ -72,11 +92,19 @@ std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> getFactors(const std
  *
  * if forDap=true the test matrix needs to be blocked tasksPerRank*worldSize x tasksPerRank*worldSize
  * and not worldSize x tasksPerRank*worldSize as the data matrix
+ *
+ * blocking determines how unblocked input files are blocked; with BLOCKING_BALANCED_NNZ, the test
+ * matrix is blocked with the offsets of the data matrix (generated matrices and .xml files
+ * keep their blocking)
+ *
+ * if relabeling is given, the rows and columns of unblocked input files (data and test matrix)
+ * are relabeled before blocking (see mf::randomRelabeling)
  * */
 template<typename M>
 std::vector<DistributedMatrix<M> > getDataMatrices(const std::string& fileV, const std::string& name, bool partitionByRow,
 		int tasksPerRank, int worldSize, mf_size_type blocks1, mf_size_type blocks2, bool forAsgd, bool forDap,
-		std::string* fileVtest=NULL);
+		std::string* fileVtest=NULL, BlockingType blocking = BLOCKING_EQUAL_SIZE,
+		const Relabeling* relabeling = NULL);
 }
 
 #include <mf/matrix/io/generateDistributedMatrix_impl.h>
@@ -652,39 +652,91 @@ void generateDataMatrices(const RandomMatrixDescriptor& f, DistributedMatrix<M>&
  * generates or loads the factor matrices from a file(s)
  * TO BE USED FOR EXPERIMENTS
  * */
-inline std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> getFactors(const std::string& fileW,
+template<typename W, typename H>
+std::pair<DistributedMatrix<W>, DistributedMatrix<H> > getFactors(const std::string& fileW,
 		const std::string& fileH, int tasksPerRank, int worldSize,
-		mf_size_type blocks1, mf_size_type blocks2, bool forAsgd){
+		mf_size_type blocks1, mf_size_type blocks2, bool forAsgd,
+		const std::vector<mf_size_type>& blockOffsets1, const std::vector<mf_size_type>& blockOffsets2,
+		const Relabeling* relabeling){
+	Relabeling relabeling1, relabeling2; // W: rows only, H: columns only
+	if (relabeling != NULL) {
+		relabeling1 = relabeling->rows();
+		relabeling2 = relabeling->columns();
+	}
 
 	if (mf::detail::endsWith(fileW, ".rm")){
 		LOG4CXX_INFO(detail::logger, "generating factors on the fly...");
 		RandomMatrixDescriptor f;
 		f.load(fileW);
-		DistributedMatrix<DenseMatrix> dw = generateFactor<DenseMatrix> (f, "W",blocks1,1,
+		DistributedMatrix<W> dw = generateFactor<W> (f, "W",blocks1,1,
 				true, tasksPerRank);
 		LOG4CXX_INFO(detail::logger, "Row factor matrix: "
 				<< dw.size1() << " x " << dw.size2() << ", " << dw.blocks1() << " x " << dw.blocks2() << " blocks");
-		DistributedMatrix<DenseMatrixCM> dh = generateFactor<DenseMatrixCM> (f, "H",1, blocks2,
+		DistributedMatrix<H> dh = generateFactor<H> (f, "H",1, blocks2,
 				false, tasksPerRank);
 		LOG4CXX_INFO(detail::logger, "Column factor matrix: "
 				<< dh.size1() << " x " << dh.size2() << ", " << dh.blocks1() << " x " << dh.blocks2() << " blocks");
-		std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> p(dw, dh);
+		std::pair<DistributedMatrix<W>, DistributedMatrix<H> > p(dw, dh);
 		return p;
 
+	}else if (!blockOffsets1.empty() && !mf::detail::endsWith(fileW, ".xml")){
+		// use the same blocking as the data matrix
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		std::vector<mf_size_type> offsets0(1, 0);
+		boost::numeric::ublas::matrix<int> blockLocations;
+		computeDefaultBlockLocations(tm.world().size(), blocks1, 1, true, blockLocations);
+		DistributedMatrix<W> dw = loadMatrix<W>("W", blockLocations,
+				blockOffsets1, offsets0, fileW, AUTOMATIC, BLOCKING_EQUAL_SIZE, &relabeling1);
+		LOG4CXX_INFO(detail::logger, "Row factor matrix: "
+				<< dw.size1() << " x " << dw.size2() << ", " << dw.blocks1() << " x " << dw.blocks2() << " blocks");
+		computeDefaultBlockLocations(tm.world().size(), 1, blocks2, false, blockLocations);
+		DistributedMatrix<H> dh = loadMatrix<H>("H", blockLocations,
+				offsets0, blockOffsets2, fileH, AUTOMATIC, BLOCKING_EQUAL_SIZE, &relabeling2);
+		LOG4CXX_INFO(detail::logger, "Column factor matrix: "
+				<< dh.size1() << " x " << dh.size2() << ", " << dh.blocks1() << " x " << dh.blocks2() << " blocks");
+		std::pair<DistributedMatrix<W>, DistributedMatrix<H> > p(dw, dh);
+		return p;
 	}else{
 		if (forAsgd) tasksPerRank = 1;
-		DistributedMatrix<DenseMatrix> dw = loadMatrix<DenseMatrix>(fileW, "W",
-				true, tasksPerRank, worldSize, blocks1, 1);
+		DistributedMatrix<W> dw = loadMatrix<W>(fileW, "W",
+				true, tasksPerRank, worldSize, blocks1, 1, false, BLOCKING_EQUAL_SIZE, &relabeling1);
 		LOG4CXX_INFO(detail::logger, "Row factor matrix: "
 				<< dw.size1() << " x " << dw.size2() << ", " << dw.blocks1() << " x " << dw.blocks2() << " blocks");
-		DistributedMatrix<DenseMatrixCM> dh = loadMatrix<DenseMatrixCM>(fileH, "H",
-				false, tasksPerRank, worldSize, 1, blocks2);
+		DistributedMatrix<H> dh = loadMatrix<H>(fileH, "H",
+				false, tasksPerRank, worldSize, 1, blocks2, false, BLOCKING_EQUAL_SIZE, &relabeling2);
 		LOG4CXX_INFO(detail::logger, "Column factor matrix: "
 				<< dh.size1() << " x " << dh.size2() << ", " << dh.blocks1() << " x " << dh.blocks2() << " blocks");
-		std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> p(dw, dh);
+		std::pair<DistributedMatrix<W>, DistributedMatrix<H> > p(dw, dh);
 		return p;
 	}
 }
+
+inline std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> getFactors(const std::string& fileW,
+		const std::string& fileH, int tasksPerRank, int worldSize,
+		mf_size_type blocks1, mf_size_type blocks2, bool forAsgd,
+		const std::vector<mf_size_type>& blockOffsets1, const std::vector<mf_size_type>& blockOffsets2,
+		const Relabeling* relabeling){
+	return getFactors<DenseMatrix, DenseMatrixCM>(fileW, fileH, tasksPerRank, worldSize, blocks1, blocks2,
+			forAsgd, blockOffsets1, blockOffsets2, relabeling);
+}
+
+namespace detail {
+	/** Loads a test matrix with the row (and, if it has the same number of column blocks,
+	 * the column) offsets of the given data matrix. */
+	template<typename M>
+	DistributedMatrix<M> loadTestMatrix(const DistributedMatrix<M>& dv, const std::string& fileVtest,
+			const std::string& testName, bool partitionByRow, mf_size_type blocks2,
+			const Relabeling* relabeling) {
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		boost::numeric::ublas::matrix<int> blockLocations;
+		computeDefaultBlockLocations(tm.world().size(), dv.blocks1(), blocks2, partitionByRow, blockLocations);
+		std::vector<mf_size_type> blockOffsets2;
+		if (blocks2 == dv.blocks2()) blockOffsets2 = dv.blockOffsets2();
+		return loadMatrix<M>(testName, blockLocations, dv.blockOffsets1(), blockOffsets2, fileVtest,
+				AUTOMATIC, BLOCKING_EQUAL_SIZE, relabeling);
+	}
+}
+
 /*
  * generates or loads the data / test matrix from a file(s)
  * TO BE USED FOR EXPERIMENTS
@@ -692,7 +744,7 @@ inline std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> getFactors(co
 template<typename M>
 std::vector<DistributedMatrix<M> > getDataMatrices(const std::string& fileV, const std::string& name, bool partitionByRow,
 		int tasksPerRank, int worldSize, mf_size_type blocks1, mf_size_type blocks2, bool forAsgd, bool forDap,
-		std::string* fileVtest){
+		std::string* fileVtest, BlockingType blocking, const Relabeling* relabeling){
 	bool forDapCM = (forDap&&!partitionByRow?true:false);
 	std::vector<DistributedMatrix<M> > dataMatrices;
 	std::string testName = name+"test";
@@ -701,6 +753,12 @@ std::vector<DistributedMatrix<M> > getDataMatrices(const std::string& fileV, con
 		RandomMatrixDescriptor f;
 		f.load(fileV);
 		LOG4CXX_INFO(detail::logger, "generating data matrices on the fly...");
+		if (blocking != BLOCKING_EQUAL_SIZE) {
+			LOG4CXX_WARN(detail::logger, "Generated matrices are always blocked into blocks of equal size");
+		}
+		if (relabeling != NULL && !relabeling->empty()) {
+			LOG4CXX_WARN(detail::logger, "Generated matrices are not relabeled");
+		}
 		DistributedMatrix<M> dv(name, f.size1, f.size2, blocks1, blocks2, partitionByRow);
 
 		if (fileVtest!=NULL){
@@ -723,13 +781,18 @@ std::vector<DistributedMatrix<M> > getDataMatrices(const std::string& fileV, con
 	}else{
 		if (forAsgd) tasksPerRank = 1;
 		DistributedMatrix<M> dv = loadMatrix<M>(fileV,
-				name, partitionByRow, tasksPerRank, worldSize, blocks1, blocks2);
+				name, partitionByRow, tasksPerRank, worldSize, blocks1, blocks2, false, blocking, relabeling);
 		dataMatrices.push_back(dv);
 
 		if (fileVtest!=NULL){
 			if (forDap) blocks2 = blocks1;
-			DistributedMatrix<M> dvTest = loadMatrix<M>(*fileVtest,
-					testName, partitionByRow, tasksPerRank, worldSize,	blocks1, blocks2);
+			bool balanced = blocking == BLOCKING_BALANCED_NNZ
+					&& !mf::detail::endsWith(fileV, ".xml") && !mf::detail::endsWith(*fileVtest, ".xml");
+			DistributedMatrix<M> dvTest = balanced
+					? detail::loadTestMatrix<M>(dv, *fileVtest, testName, partitionByRow, blocks2, relabeling)
+					: loadMatrix<M>(*fileVtest,
+							testName, partitionByRow, tasksPerRank, worldSize,	blocks1, blocks2,
+							false, BLOCKING_EQUAL_SIZE, relabeling);
 			LOG4CXX_INFO(detail::logger, "Test matrix: "
 					<< dvTest.size1() << " x " << dvTest.size2() << ", " << nnz(dvTest) << " nonzeros, "
 					<< dvTest.blocks1() << " x " << dvTest.blocks2() << " blocks");
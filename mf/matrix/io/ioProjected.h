@@ -24,6 +24,7 @@
 #include <vector>
 
 #include <mf/matrix/op/project.h>
+#include <mf/matrix/op/relabel.h>
 #include <mf/matrix/io/mappingDescriptor.h>
 
 namespace mf {
@@ -75,6 +76,26 @@ void readMapFile(const std::string& file, std::vector<mf_size_type>& map, mf_siz
  *	@param 	size the size of the original matrix
  */
 void writeMapFile(const std::string& file, const std::vector<mf_size_type>& map, mf_size_type size);
+
+/*
+ *  writes the maps of a relabeling (see mf::Relabeling) to the map files of an mfp descriptor
+ *  and saves the descriptor; the relabeled matrix itself is not written (its file name is left
+ *  empty in the descriptor)
+ *
+ *	@param	relabeling the relabeling (both maps must be non-empty)
+ *	@param 	indexMapDescriptorFilename the name of the mfp file (the map files are placed next to it)
+ *	@param 	matrixFilename the name of the file of the matrix that has been relabeled
+ */
+void writeRelabeling(const Relabeling& relabeling, const std::string& indexMapDescriptorFilename,
+		const std::string& matrixFilename);
+
+/*
+ *  reads a relabeling written by mf::writeRelabeling
+ *
+ *	@param 	indexMapDescriptorFilename the name of the mfp file
+ *	@param[out]	relabeling the relabeling
+ */
+void readRelabeling(Relabeling& relabeling, const std::string& indexMapDescriptorFilename);
 }
 
 
@@ -116,4 +116,26 @@ void readProjectedMatrix(ProjectedSparseMatrix& projectedMatrix, const  std::str
 			mapDescriptor.completeMap1Filename(),  mapDescriptor.completeMap2Filename());
 }
 
+void writeRelabeling(const Relabeling& relabeling, const std::string& indexMapDescriptorFilename,
+		const std::string& matrixFilename){
+	if (relabeling.map1.empty() || relabeling.map2.empty())
+		RG_THROW(rg::InvalidArgumentException, "Only relabelings of both rows and columns can be written");
+	IndexMapFileDescriptor mapDescriptor(indexMapDescriptorFilename, matrixFilename);
+	mapDescriptor.projectedMatrixFilename = ""; // the relabeled matrix is not stored
+	writeMapFile(mapDescriptor.completeMap1Filename(), relabeling.map1, relabeling.map1.size());
+	writeMapFile(mapDescriptor.completeMap2Filename(), relabeling.map2, relabeling.map2.size());
+	mapDescriptor.save(indexMapDescriptorFilename);
+}
+
+void readRelabeling(Relabeling& relabeling, const std::string& indexMapDescriptorFilename){
+	IndexMapFileDescriptor mapDescriptor;
+	mapDescriptor.load(indexMapDescriptorFilename);
+	mf_size_type size1, size2;
+	relabeling = Relabeling();
+	readMapFile(mapDescriptor.completeMap1Filename(), relabeling.map1, size1);
+	readMapFile(mapDescriptor.completeMap2Filename(), relabeling.map2, size2);
+	if (!isPermutation(relabeling.map1, size1) || !isPermutation(relabeling.map2, size2))
+		RG_THROW(rg::IOException, std::string("Maps of ") + indexMapDescriptorFilename + " do not describe a relabeling");
+}
+
 }
@@ -21,13 +21,16 @@
 #include <mf/matrix/io/format.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/matrix/distribute.h>
+#include <mf/matrix/io/read.h>
+#include <mf/matrix/op/nnz.h>
 
 
 namespace mf {
 
 /** Loads a distributed matrix from an unblocked file, picking block offsets and storage
  * locations automatically.
- * Each block will get roughly the same number of rows and columns.
+ * Each block will get roughly the same number of rows and columns, or roughly the same
+ * number of nonzero entries (with BLOCKING_BALANCED_NNZ).
  *
  * @param name Name of the output matrix (must be unique across the cluster)
  * @param blocks1 number of row blocks
@@ -36,6 +39,9 @@ namespace mf {
  	 	 is performed by column)
  * @param fname name of file to read from
  * @param format file format
+ * @param blocking how to compute the block offsets
+ * @param relabeling if not NULL, rows and columns are relabeled before blocking (see
+ *                   mf::readMatrixBlocks)
  * @return handle for the newly created distributed matrix
  *
  * @tparam M matrix type
@@ -44,7 +50,8 @@ template<typename M>
 DistributedMatrix<M> loadMatrix(
 		const std::string& name, mf_size_type blocks1, mf_size_type blocks2,
 		bool partitionByRow,
-		const std::string& fname, MatrixFileFormat format = AUTOMATIC);
+		const std::string& fname, MatrixFileFormat format = AUTOMATIC,
+		BlockingType blocking = BLOCKING_EQUAL_SIZE, const Relabeling* relabeling = NULL);
 
 /** Loads a distributed matrix from an unblocked file, taking block offsets as input (to be used together with clustering).
  * Each block will get roughly the same number of rows and columns.
@@ -74,6 +81,11 @@ DistributedMatrix<M> loadMatrix(
  * @param[in,out] blockOffsets2 Offsets of column blocks (automatically computed if empty)
  * @param fname name of file to read from
  * @param format file format
+ * @param blocking how to compute the block offsets if both blockOffsets1 and blockOffsets2
+ *                 are empty; with BLOCKING_BALANCED_NNZ, the max/mean ratio of nonzero entries
+ *                 per block is logged before and after balancing
+ * @param relabeling if not NULL, rows and columns are relabeled before blocking (see
+ *                   mf::readMatrixBlocks)
  * @return handle for the newly created distributed matrix
  *
  * @tparam M matrix type
@@ -83,7 +95,8 @@ DistributedMatrix<M> loadMatrix(
 		const std::string& name, const boost::numeric::ublas::matrix<int>& blockLocations,
 		const std::vector<mf_size_type>& blockOffsets1, // can be empty
 		const std::vector<mf_size_type>& blockOffsets2, // can be empty
-		const std::string& fname, MatrixFileFormat format = AUTOMATIC);
+		const std::string& fname, MatrixFileFormat format = AUTOMATIC,
+		BlockingType blocking = BLOCKING_EQUAL_SIZE, const Relabeling* relabeling = NULL);
 
 
 /** Distributes a matrix across a cluster, picking block offsets and storage
@@ -25,7 +25,11 @@
 
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/matrix/distribute.h>
+#include <mf/logger.h>
 #include <mf/matrix/io/descriptor.h>
+#include <mf/matrix/io/load.h>
+#include <mf/matrix/io/ioProjected.h>
+#include <mf/matrix/op/relabel.h>
 
 namespace mf {
 
@@ -51,13 +55,38 @@ DistributedMatrix<M> loadMatrix(const BlockedMatrixFileDescriptor& f,
  * @param worldSize the number of nodes available for the distribution
  * @param blocks1 the # of row-blocks if the input is an mmc file
  * @param blocks2 the # of column-blocks if the input is an mmc file
+ * @param blocking how to block the input if it is an mmc file
+ * @param relabeling how to relabel the rows and columns if the input is an mmc file (NULL for none)
  *
  * @tparam M matrix type
  */
 template<typename M>
 DistributedMatrix<M> loadMatrix(const std::string& file,
 		const std::string& name, bool partitionByRow, int tasksPerRank = 1, int worldSize=1,
-		mf_size_type blocks1=1,mf_size_type blocks2=1,bool test=false);
+		mf_size_type blocks1=1,mf_size_type blocks2=1,bool test=false,
+		BlockingType blocking = BLOCKING_EQUAL_SIZE, const Relabeling* relabeling = NULL);
+
+/** Creates a random relabeling of the rows and columns of the matrix stored in the given
+ * file (see mf::Relabeling). Only unblocked input files can be relabeled; for blocked (.xml)
+ * or generated (.rm) matrices, a warning is logged and the relabeling is left empty.
+ *
+ * @param random random number generator
+ * @param file the input file
+ * @param[out] relabeling the random relabeling
+ * @return whether the input will be relabeled
+ */
+inline bool randomRelabeling(rg::Random32& random, const std::string& file, Relabeling& relabeling);
+
+/** Reads the relabeling of the matrix stored in the given file from an mfp descriptor written
+ * by mf::writeRelabeling. As for mf::randomRelabeling, only unblocked input files can be
+ * relabeled. Throws an exception if the relabeling does not fit the dimensions of the matrix.
+ *
+ * @param relabelFile the mfp descriptor of the relabeling
+ * @param file the input file
+ * @param[out] relabeling the relabeling
+ * @return whether the input will be relabeled
+ */
+inline bool readRelabeling(const std::string& relabelFile, const std::string& file, Relabeling& relabeling);
 
 } // namespace mf
 
@@ -148,19 +148,54 @@ DistributedMatrix<M> loadMatrix(const BlockedMatrixFileDescriptor& f, const std:
 template<typename M>
 DistributedMatrix<M> loadMatrix(const std::string& file,
 		const std::string& name, bool partitionByRow, int tasksPerRank, int worldSize,
-		mf_size_type blocks1,mf_size_type blocks2,bool test){
+		mf_size_type blocks1,mf_size_type blocks2,bool test, BlockingType blocking,
+		const Relabeling* relabeling){
 	if(mf::detail::endsWith(file, ".rm")){
 	//	DistributedMatrix<M> m=generateRandomMatrix<M>(file,name, partitionByRow,tasksPerRank, worldSize,blocks1,blocks2,test);
 	}else if (mf::detail::endsWith(file, ".xml")){
+		if (relabeling != NULL && !relabeling->empty()) {
+			LOG4CXX_WARN(detail::logger, "Blocked matrix '" << file << "' cannot be relabeled");
+		}
 		BlockedMatrixFileDescriptor f;
 		f.load(file);
 		DistributedMatrix<M> m=loadMatrix<M>(f,name,partitionByRow,tasksPerRank);
 		return m;
 	}else{
-		DistributedMatrix<M> m = loadMatrix<M>(name, blocks1, blocks2, partitionByRow, file);
+		DistributedMatrix<M> m = loadMatrix<M>(name, blocks1, blocks2, partitionByRow, file, AUTOMATIC,
+				blocking, relabeling);
 		return m;
 	}
 }
 
+inline bool randomRelabeling(rg::Random32& random, const std::string& file, Relabeling& relabeling) {
+	relabeling = Relabeling();
+	if (mf::detail::endsWith(file, ".xml") || mf::detail::endsWith(file, ".rm")) {
+		LOG4CXX_WARN(detail::logger, "Only unblocked input files can be relabeled; '"
+				<< file << "' will not be relabeled");
+		return false;
+	}
+	mf_size_type size1, size2;
+	readMatrixSize(file, size1, size2);
+	randomRelabeling(random, size1, size2, relabeling);
+	return true;
+}
+
+inline bool readRelabeling(const std::string& relabelFile, const std::string& file, Relabeling& relabeling) {
+	relabeling = Relabeling();
+	if (mf::detail::endsWith(file, ".xml") || mf::detail::endsWith(file, ".rm")) {
+		LOG4CXX_WARN(detail::logger, "Only unblocked input files can be relabeled; '"
+				<< file << "' will not be relabeled");
+		return false;
+	}
+	readRelabeling(relabeling, relabelFile);
+	mf_size_type size1, size2;
+	readMatrixSize(file, size1, size2);
+	if (relabeling.map1.size() != size1 || relabeling.map2.size() != size2) {
+		RG_THROW(rg::InvalidArgumentException, std::string("Relabeling ") + relabelFile
+				+ " does not fit the dimensions of " + file);
+	}
+	return true;
+}
+
 } // namespace mf
 
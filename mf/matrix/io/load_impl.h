@@ -25,6 +25,7 @@ struct BlockAndLoadMatrixTask {
 		boost::numeric::ublas::matrix<int> blockLocations;
 		std::vector<mf_size_type> blockOffsets1, blockOffsets2;
 		MatrixFileFormat format;
+		Relabeling relabeling;
 
 		// get data
 		ch.recv(name);
@@ -33,6 +34,8 @@ struct BlockAndLoadMatrixTask {
 		ch.recvAsync(blockOffsets2); // since vector was sent async, need asynchronous recv
 		ch.recv(fname);
 		ch.recv(format);
+		ch.recvAsync(relabeling.map1);
+		ch.recvAsync(relabeling.map2);
 
 		// create the list of blocks for this node
 		int rank = ch.world().rank();
@@ -49,7 +52,7 @@ struct BlockAndLoadMatrixTask {
 		std::vector<M*> blocks;
 		readMatrixBlocks(fname,
 				blocks1, blocks2, blockList, blockOffsets1, blockOffsets2,
-				size1, size2, blocks, format);
+				size1, size2, blocks, format, BLOCKING_EQUAL_SIZE, &relabeling);
 
 		// store the blocks in the local environment
 		for (unsigned i=0; i<blockList.size(); i++) {
@@ -63,10 +66,30 @@ struct BlockAndLoadMatrixTask {
 		if (info.groupId() == 0) {
 			ch.send(size1);
 			ch.send(size2);
+			ch.send(blockOffsets1);
+			ch.send(blockOffsets2);
 		}
 	}
 };
 
+/** Logs how well the nonzero entries of a matrix blocked with balanced offsets are balanced */
+template<typename M>
+void logBalancedBlocking(const DistributedMatrix<M>& m, const std::string& fname,
+		double equalSizeRatio) {
+	// dense blocks have no nonzero entries to balance
+}
+
+template<class T, class L, std::size_t IB, class IA, class TA>
+void logBalancedBlocking(
+		const DistributedMatrix<boost::numeric::ublas::coordinate_matrix<T,L,IB,IA,TA> >& m,
+		const std::string& fname, double equalSizeRatio) {
+	boost::numeric::ublas::matrix<mf_size_type> nnzs(m.blocks1(), m.blocks2());
+	nnz(m, nnzs);
+	LOG4CXX_INFO(logger, "Balanced blocking of '" << fname << "': max/mean nonzero entries "
+			"per block is " << blockNnzRatio(nnzs) << " (was " << equalSizeRatio
+			<< " with blocks of equal size)");
+}
+
 } // namespace detail
 
 template<typename M>
@@ -74,11 +97,30 @@ DistributedMatrix<M> loadMatrix(
 		const std::string& name, const boost::numeric::ublas::matrix<int>& blockLocations,
 		const std::vector<mf_size_type>& blockOffsets1, // can be empty
 		const std::vector<mf_size_type>& blockOffsets2, // can be empty
-		const std::string& fname, MatrixFileFormat format) {
+		const std::string& fname, MatrixFileFormat format, BlockingType blocking,
+		const Relabeling* relabeling) {
 	if (blockLocations.size1() > 1 || blockLocations.size2() > 1) {
 		LOG4CXX_INFO(detail::logger, "File '" << fname << "' is not blocked; it will be "
 				"blocked automatically");
 	}
+	Relabeling noRelabeling;
+	if (relabeling == NULL) {
+		relabeling = &noRelabeling;
+	}
+	if (blocking == BLOCKING_BALANCED_NNZ && !relabeling->empty()) {
+		LOG4CXX_WARN(detail::logger, "Balanced blocking is not supported for relabeled matrices; "
+				"using blocks of equal size for '" << fname << "'");
+		blocking = BLOCKING_EQUAL_SIZE;
+	}
+
+	// compute balanced offsets once here instead of on every rank
+	std::vector<mf_size_type> offsets1 = blockOffsets1, offsets2 = blockOffsets2;
+	double equalSizeRatio = 0;
+	bool balance = blocking == BLOCKING_BALANCED_NNZ && offsets1.empty() && offsets2.empty();
+	if (balance) {
+		computeBalancedBlockOffsets(fname, blockLocations.size1(), blockLocations.size2(),
+				offsets1, offsets2, format, &equalSizeRatio);
+	}
 
 	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
 	boost::mpi::communicator& world = tm.world();
@@ -89,16 +131,24 @@ DistributedMatrix<M> loadMatrix(
 
 	mpi2::sendAll(channels, name);
 	mpi2::sendAll(channels, blockLocations);
-	mpi2::sendAll(channels, blockOffsets1);
-	mpi2::sendAll(channels, blockOffsets2);
+	mpi2::sendAll(channels, offsets1);
+	mpi2::sendAll(channels, offsets2);
 	mpi2::sendAll(channels, fname);
 	mpi2::sendAll(channels, format);
+	mpi2::sendAll(channels, relabeling->map1);
+	mpi2::sendAll(channels, relabeling->map2);
 	mpi2::recvAll(channels);
 
 	mf_size_type size1, size2;
 	channels[0].recv(size1);
 	channels[0].recv(size2);
-	DistributedMatrix<M> result(name, size1, size2, blockLocations);
+	channels[0].recv(offsets1);
+	channels[0].recv(offsets2);
+	DistributedMatrix<M> result(name, size1, size2, offsets1, offsets2, blockLocations);
+
+	if (balance) {
+		detail::logBalancedBlocking(result, fname, equalSizeRatio);
+	}
 	return result;
 }
 
@@ -106,14 +156,15 @@ template<typename M>
 DistributedMatrix<M> loadMatrix(
 		const std::string& name, mf_size_type blocks1, mf_size_type blocks2,
 		bool partitionByRow,
-		const std::string& fname, MatrixFileFormat format) {
+		const std::string& fname, MatrixFileFormat format, BlockingType blocking,
+		const Relabeling* relabeling) {
 	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
 	boost::mpi::communicator& world = tm.world();
 	boost::numeric::ublas::matrix<int> blockLocations(blocks1,blocks2);
 	computeDefaultBlockLocations(world.size(), blocks1, blocks2, partitionByRow, blockLocations);
 	std::vector<mf_size_type> emptyOffsets;
 	return loadMatrix<M>(name, blockLocations, emptyOffsets, emptyOffsets,
-			fname, format);
+			fname, format, blocking, relabeling);
 }
 
 //template<typename M>
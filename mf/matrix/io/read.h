@@ -15,7 +15,9 @@
 #define MF_MATRIX_IO_READ_H
 
 #include <mf/types.h>
+#include <mf/matrix/distributed_matrix.h>
 #include <mf/matrix/io/format.h>
+#include <mf/matrix/op/relabel.h>
 
 namespace mf {
 
@@ -29,6 +31,17 @@ namespace mf {
 template<typename M>
 void readMatrix(const std::string& fname, M& m, MatrixFileFormat format = AUTOMATIC);
 
+/** Reads the dimensions of a matrix stored in a file. Only the header is read for the
+ * matrix-market formats; the entire matrix is read for all other formats.
+ *
+ * @param fname file name
+ * @param[out] size1 number of rows
+ * @param[out] size2 number of columns
+ * @param format file format
+ */
+inline void readMatrixSize(const std::string& fname, mf_size_type& size1, mf_size_type& size2,
+		MatrixFileFormat format = AUTOMATIC);
+
 
 /** Reads some blocks of a matrix from a file into memory. This method is efficient for
  * the matrix-file formats, but inefficient for all other formats.
@@ -43,6 +56,11 @@ void readMatrix(const std::string& fname, M& m, MatrixFileFormat format = AUTOMA
  * @param[out] size2 total number of columns in the matrix
  * @param[out] blocks a list of read blocks (same order as sortedBlockList)
  * @param format file format
+ * @param blocking how to compute block offsets that are not given (BLOCKING_BALANCED_NNZ
+ *                 requires an additional pass over the file)
+ * @param relabeling if not NULL, the rows and columns are relabeled before blocking (entry
+ *                   (map1[i],map2[j]) of the file becomes entry (i,j) of the result); only
+ *                   supported for the matrix-market formats
  * @tparam M matrix type
  * @tparam SparseOut (internal) whether the output matrix type is sparse
  */
@@ -52,19 +70,40 @@ void readMatrixBlocks(const std::string& fname,
 		const std::vector<std::pair<mf_size_type, mf_size_type> >& sortedBlockList,
 		std::vector<mf_size_type>& blockOffsets1, std::vector<mf_size_type>& blockOffsets2,
 		mf_size_type& size1, mf_size_type& size2, std::vector<M*>& blocks,
-		MatrixFileFormat format = AUTOMATIC);
+		MatrixFileFormat format = AUTOMATIC, BlockingType blocking = BLOCKING_EQUAL_SIZE,
+		const Relabeling* relabeling = NULL);
 
 
 /** Specialization of mf::readMatrixBlocks for sparse matrices. */
-template<class L, std::size_t IB, class IA, class TA>
+template<class T, class L, std::size_t IB, class IA, class TA>
 void readMatrixBlocks(
 		const std::string& fname,
 		mf_size_type blocks1, mf_size_type blocks2,
 		const std::vector<std::pair<mf_size_type, mf_size_type> >& sortedBlockList,
 		std::vector<mf_size_type>& blockOffsets1, std::vector<mf_size_type>& blockOffsets2,
 		mf_size_type& size1, mf_size_type& size2,
-		std::vector<boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>*>& blocks,
-		MatrixFileFormat format = AUTOMATIC);
+		std::vector<boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>*>& blocks,
+		MatrixFileFormat format = AUTOMATIC, BlockingType blocking = BLOCKING_EQUAL_SIZE,
+		const Relabeling* relabeling = NULL);
+
+/** Computes block offsets for the matrix stored in a file such that all blocks have roughly
+ * the same number of nonzero entries (see mf::computeBalancedBlockOffsets). Makes a single
+ * pass over the file. Matrices in dense formats are blocked into blocks of equal size.
+ *
+ * @param fname file name
+ * @param blocks1 number of row blocks
+ * @param blocks2 number of column blocks
+ * @param[out] blockOffsets1 offsets of row blocks
+ * @param[out] blockOffsets2 offsets of column blocks
+ * @param format file format
+ * @param[out] equalSizeRatio if not NULL, the max/mean ratio of the number of nonzero entries
+ *                            per block when blocks of equal size would have been used
+ *                            (see mf::blockNnzRatio)
+ */
+inline void computeBalancedBlockOffsets(const std::string& fname,
+		mf_size_type blocks1, mf_size_type blocks2,
+		std::vector<mf_size_type>& blockOffsets1, std::vector<mf_size_type>& blockOffsets2,
+		MatrixFileFormat format = AUTOMATIC, double* equalSizeRatio = NULL);
 
 } // namespace mf
 
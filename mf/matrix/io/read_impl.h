@@ -13,6 +13,8 @@
 //    limitations under the License.
 #include <mf/matrix/io/read.h>   // compiler hint
 
+#include <algorithm>
+#include <limits>
 #include <sstream>
 #include <iostream>
 #include <fstream>
@@ -32,6 +34,9 @@
 #include <util/exception.h>
 #include <util/io.h>
 
+#include <mf/matrix/coordinate.h>
+#include <mf/matrix/op/copy.h>
+
 namespace mf {
 
 namespace detail {
@@ -136,30 +141,34 @@ template<typename M>
 inline void mmFreeze(M& m) {
 }
 
-template<class L, std::size_t IB, class IA, class TA>
-inline bool mmInitSparse(boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>& m,
+template<class T, class L, std::size_t IB, class IA, class TA>
+inline bool mmInitSparse(boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>& m,
 		bool read, mf_size_type size1, mf_size_type size2, mf_size_type nnz) {
+	const mf_size_type maxIndex = std::numeric_limits<typename IA::value_type>::max();
+	if (size1 > maxIndex || size2 > maxIndex || nnz > maxIndex) {
+		RG_THROW(rg::InvalidArgumentException, "matrix too large for its index type (block it first)");
+	}
 	m.resize(size1, size2, false);
 	m.clear();
 	m.reserve(nnz);
 	return read;
 }
 
-template<class L, std::size_t IB, class IA, class TA>
-inline bool mmCheckProcessSparse(boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>& m,
+template<class T, class L, std::size_t IB, class IA, class TA>
+inline bool mmCheckProcessSparse(boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>& m,
 		mf_size_type i, mf_size_type j) {
 	return true;
 }
 
-template<class L, std::size_t IB, class IA, class TA>
-inline void mmProcessSparse(boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>& m,
+template<class T, class L, std::size_t IB, class IA, class TA>
+inline void mmProcessSparse(boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>& m,
 		mf_size_type i, mf_size_type j,
-		typename boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>::value_type x) {
+		typename boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>::value_type x) {
 	m.append_element(i, j, x);
 }
 
-template<class L, std::size_t IB, class IA, class TA>
-inline void mmFreezeSparse(boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>& m) {
+template<class T, class L, std::size_t IB, class IA, class TA>
+inline void mmFreezeSparse(boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>& m) {
 	m.sort();
 }
 
@@ -174,14 +183,14 @@ void readMmCoord(const std::string& fname, M& m) {
 			);
 }
 
-template<class L, std::size_t IB, class IA, class TA>
-void readMmCoord(const std::string& fname, boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>& m) {
+template<class T, class L, std::size_t IB, class IA, class TA>
+void readMmCoord(const std::string& fname, boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>& m) {
 	readMmCoord(
 			fname,
-			boost::bind(mmInitSparse<L,IB,IA,TA>, boost::ref(m), true, _1, _2, _3),
-			boost::bind(mmCheckProcessSparse<L,IB,IA,TA>, boost::ref(m), _1, _2),
-			boost::bind(mmProcessSparse<L,IB,IA,TA>, boost::ref(m), _1, _2, _3),
-			boost::bind(mmFreezeSparse<L,IB,IA,TA>, boost::ref(m))
+			boost::bind(mmInitSparse<T,L,IB,IA,TA>, boost::ref(m), true, _1, _2, _3),
+			boost::bind(mmCheckProcessSparse<T,L,IB,IA,TA>, boost::ref(m), _1, _2),
+			boost::bind(mmProcessSparse<T,L,IB,IA,TA>, boost::ref(m), _1, _2, _3),
+			boost::bind(mmFreezeSparse<T,L,IB,IA,TA>, boost::ref(m))
 			);
 }
 
@@ -223,7 +232,7 @@ void readMmArray(const std::string& fname, Init init, CheckProcess checkProcess,
 	}
 
 	// resize matrix
-	init(size1, size2, size1*size2);
+	if (!init(size1, size2, size1*size2)) return;
 
 	// read matrix
 	for (mf_size_type j=0; j<size2; j++) {
@@ -266,14 +275,14 @@ void readMmArray(const std::string& fname, M& m) {
 			);
 }
 
-template<class L, std::size_t IB, class IA, class TA>
-void readMmArray(const std::string& fname, boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>& m) {
+template<class T, class L, std::size_t IB, class IA, class TA>
+void readMmArray(const std::string& fname, boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>& m) {
 	readMmArray(
 			fname,
-			boost::bind(mmInitSparse<L,IB,IA,TA>, boost::ref(m), true, _1, _2, _3),
-			boost::bind(mmCheckProcessSparse<L,IB,IA,TA>, boost::ref(m), _1, _2),
-			boost::bind(mmProcessSparse<L,IB,IA,TA>, boost::ref(m), _1, _2, _3),
-			boost::bind(mmFreezeSparse<L,IB,IA,TA>, boost::ref(m))
+			boost::bind(mmInitSparse<T,L,IB,IA,TA>, boost::ref(m), true, _1, _2, _3),
+			boost::bind(mmCheckProcessSparse<T,L,IB,IA,TA>, boost::ref(m), _1, _2),
+			boost::bind(mmProcessSparse<T,L,IB,IA,TA>, boost::ref(m), _1, _2, _3),
+			boost::bind(mmFreezeSparse<T,L,IB,IA,TA>, boost::ref(m))
 			);
 }
 
@@ -291,6 +300,28 @@ void readBoostBin(const std::string& fname, Matrix& M) {
 	ia >> M;
 }
 
+/** Compact sparse matrices are stored as mf::SparseMatrix */
+template<typename T>
+void readBoostText(const std::string& fname,
+		boost::numeric::ublas::coordinate_matrix<T, boost::numeric::ublas::row_major, 0,
+				boost::numeric::ublas::unbounded_array<boost::uint32_t>,
+				boost::numeric::ublas::unbounded_array<T> >& M) {
+	SparseMatrix m;
+	readBoostText(fname, m);
+	copyCompact(m, M);
+}
+
+/** Compact sparse matrices are stored as mf::SparseMatrix */
+template<typename T>
+void readBoostBin(const std::string& fname,
+		boost::numeric::ublas::coordinate_matrix<T, boost::numeric::ublas::row_major, 0,
+				boost::numeric::ublas::unbounded_array<boost::uint32_t>,
+				boost::numeric::ublas::unbounded_array<T> >& M) {
+	SparseMatrix m;
+	readBoostBin(fname, m);
+	copyCompact(m, M);
+}
+
 } // namespace detail
 
 template<typename M>
@@ -360,7 +391,8 @@ namespace detail {
 
 	/** Main worker class for efficient blocking of matrices stored in matrix-market format.
 	 * Builds an index that allows to quickly find the block to which an entry read from the input
-	 * belongs to (if any). */
+	 * belongs to (if any). Rows and columns are relabeled on the fly if relabel1 (relabel2) is
+	 * not empty; it then maps original to new row (column) indexes. */
 	template<typename M, bool SparseIn, bool SparseOut>
 	class ReadMatrixBlocksMm {
 	public:
@@ -372,10 +404,13 @@ namespace detail {
 				std::vector<mf_size_type>& blockOffsets2,
 				mf_size_type& size1,
 				mf_size_type& size2,
-				std::vector<M*>& blocks)
+				std::vector<M*>& blocks,
+				const std::vector<mf_size_type>& relabel1,
+				const std::vector<mf_size_type>& relabel2)
 		: blocks1(blocks1), blocks2(blocks2), sortedBlockList(sortedBlockList),
 		  blockOffsets1(blockOffsets1), blockOffsets2(blockOffsets2),
-		  size1(size1), size2(size2), blocks(blocks)
+		  size1(size1), size2(size2), blocks(blocks),
+		  relabel1(relabel1), relabel2(relabel2)
 		{
 		}
 
@@ -383,6 +418,9 @@ namespace detail {
 		inline bool init(bool read, mf_size_type size1, mf_size_type size2, mf_size_type nnz) {
 			this->size1 = size1;
 			this->size2 = size2;
+			if ((!relabel1.empty() && relabel1.size() != size1) || (!relabel2.empty() && relabel2.size() != size2)) {
+				RG_THROW(rg::InvalidArgumentException, "Relabeling does not match the size of the matrix");
+			}
 
 			// create block offsets (if not given)
 			if (blockOffsets1.empty()) computeDefaultBlockOffsets(size1, blocks1, blockOffsets1);
@@ -408,12 +446,14 @@ namespace detail {
 		}
 
 		inline bool checkProcess(mf_size_type i, mf_size_type j) {
+			relabel(i, j);
 			int b = blockOf(i, j, blockIndex1, blockIndex2);
 			return b>=0;
 		}
 
 		/** Puts the matrix entry into the right block (if any) */
 		inline void process(mf_size_type i, mf_size_type j, typename M::value_type x) {
+			relabel(i, j);
 			int b = blockOf(i, j, blockIndex1, blockIndex2);
 			BOOST_ASSERT( b>=0 );
 			mf_size_type b1 = sortedBlockList[b].first;
@@ -466,6 +506,11 @@ namespace detail {
 			}
 		}
 
+		inline void relabel(mf_size_type& i, mf_size_type& j) const {
+			if (!relabel1.empty()) i = relabel1[i];
+			if (!relabel2.empty()) j = relabel2[j];
+		}
+
 		inline int blockOf(mf_size_type i, mf_size_type j,
 				const std::vector<int>& blockIndex1, const std::vector<int>& blockIndex2) {
 			if (blockIndex1[i] < 0 || blockIndex2[j] < 0) {
@@ -482,10 +527,45 @@ namespace detail {
 		mf_size_type& size1;
 		mf_size_type& size2;
 		std::vector<M*>& blocks;
+		const std::vector<mf_size_type>& relabel1;
+		const std::vector<mf_size_type>& relabel2;
 		std::vector<int> blockIndex1, blockIndex2;
 	};
 
 
+	/** Type of the matrix stored in a (non matrix-market) file that is read into blocks of
+	 * type M. Compact sparse matrices are stored as mf::SparseMatrix. */
+	template<typename M>
+	struct FileMatrix {
+		typedef M type;
+	};
+
+	template<typename T>
+	struct FileMatrix<boost::numeric::ublas::coordinate_matrix<T, boost::numeric::ublas::row_major, 0,
+			boost::numeric::ublas::unbounded_array<boost::uint32_t>,
+			boost::numeric::ublas::unbounded_array<T> > > {
+		typedef SparseMatrix type;
+	};
+
+	/** Extracts a block from a matrix read by readMatrixBlocks() */
+	template<typename Min, typename Mout>
+	inline void projectBlock(const Min& m, Mout& block, mf_size_type rowLow, mf_size_type rowHigh,
+			mf_size_type colLow, mf_size_type colHigh) {
+		projectSubrange(m, block, rowLow, rowHigh, colLow, colHigh);
+	}
+
+	/** Extracts a block from a sparse matrix and stores it as a compact sparse matrix */
+	template<typename T>
+	inline void projectBlock(const SparseMatrix& m,
+			boost::numeric::ublas::coordinate_matrix<T, boost::numeric::ublas::row_major, 0,
+					boost::numeric::ublas::unbounded_array<boost::uint32_t>,
+					boost::numeric::ublas::unbounded_array<T> >& block,
+			mf_size_type rowLow, mf_size_type rowHigh, mf_size_type colLow, mf_size_type colHigh) {
+		SparseMatrix b;
+		projectSubrange(m, b, rowLow, rowHigh, colLow, colHigh);
+		copyCompact(b, block);
+	}
+
 	/** Selects the method to read the input depending on whether the input file is
 	 * in one of the matrix market format and whether the output file is sparse. Falls
 	 * back to slow default method for non matrix market formats. */
@@ -495,13 +575,20 @@ namespace detail {
 			const std::vector<std::pair<mf_size_type, mf_size_type> >& sortedBlockList,
 			std::vector<mf_size_type>& blockOffsets1, std::vector<mf_size_type>& blockOffsets2,
 			mf_size_type& size1, mf_size_type& size2, std::vector<M*>& blocks,
-			MatrixFileFormat format = AUTOMATIC) {
+			MatrixFileFormat format = AUTOMATIC, const Relabeling* relabeling = NULL) {
 		typedef std::pair<mf_size_type, mf_size_type> Block;
 
 		if (format == AUTOMATIC) {
 			format = getMatrixFormat(fname);
 		}
 
+		// maps from original to new indexes
+		std::vector<mf_size_type> relabel1, relabel2;
+		if (relabeling != NULL) {
+			invertMap(relabeling->map1, relabel1);
+			invertMap(relabeling->map2, relabel2);
+		}
+
 		switch (format) {
 		case MM_COORD:
 		{
@@ -522,7 +609,7 @@ namespace detail {
 			ReadMatrixBlocksMm<M, true, SparseOut> reader(
 					blocks1, blocks2, sortedBlockList,
 					blockOffsets1, blockOffsets2,
-					size1, size2, blocks);
+					size1, size2, blocks, relabel1, relabel2);
 
 			readMmCoord(
 					fname,
@@ -558,7 +645,7 @@ namespace detail {
 			ReadMatrixBlocksMm<M, false, SparseOut> reader(
 					blocks1, blocks2, sortedBlockList,
 					blockOffsets1, blockOffsets2,
-					size1, size2, blocks);
+					size1, size2, blocks, relabel1, relabel2);
 
 			readMmArray(
 					fname,
@@ -577,6 +664,10 @@ namespace detail {
 		}
 		break;
 		default:
+			if (relabeling != NULL && !relabeling->empty()) {
+				RG_THROW(rg::InvalidArgumentException, std::string("Relabeling is only supported for "
+						"matrix-market files: ") + fname);
+			}
 			LOG4CXX_WARN(detail::logger, "Input matrix '" << fname
 					<< "' is not in MM format: readMatrixBlocks() will be memory intensive");
 			if (SparseOut) {
@@ -586,7 +677,7 @@ namespace detail {
 			}
 
 			// read the entire matrix (wastes memory)
-			M m;
+			typename FileMatrix<M>::type m;
 			LOG4CXX_INFO(detail::logger, "Reading " << fname << "...");
 			readMatrix(fname, m, format);
 			size1 = m.size1();
@@ -607,7 +698,7 @@ namespace detail {
 				mf_size_type colLow = blockOffsets2[b2];
 				mf_size_type colHigh = b2+1 < blockOffsets2.size() ? blockOffsets2[b2+1] : m.size2();
 				M *block = new M();
-				projectSubrange(m, *block, rowLow, rowHigh, colLow, colHigh);
+				projectBlock(m, *block, rowLow, rowHigh, colLow, colHigh);
 				blocks.push_back(block);
 			};
 			break;
@@ -615,6 +706,166 @@ namespace detail {
 	}
 }
 
+namespace detail {
+	/** Init function for the matrix-market readers that only reads the matrix size */
+	inline bool mmReadSize(mf_size_type& size1Out, mf_size_type& size2Out,
+			mf_size_type size1, mf_size_type size2, mf_size_type nnz) {
+		size1Out = size1;
+		size2Out = size2;
+		return false; // stop reading
+	}
+
+	/** CheckProcess function for the matrix-market readers that skips all entries */
+	inline bool mmSkipEntry(mf_size_type i, mf_size_type j) {
+		return false;
+	}
+
+	/** Process function for the matrix-market readers that ignores the entry */
+	inline void mmSkipValue(mf_size_type i, mf_size_type j, double x) {
+	}
+
+	/** Freeze function for the matrix-market readers that does nothing */
+	inline void mmSkipFreeze() {
+	}
+
+	/** Counts the nonzero entries per row, per column, and per block of equal size while
+	 * reading a matrix-market file (the values themselves are not parsed). */
+	struct CountNnzMm {
+		CountNnzMm(mf_size_type blocks1, mf_size_type blocks2)
+		: blocks1(blocks1), blocks2(blocks2), blockNnz(blocks1, blocks2) {
+		}
+
+		inline bool init(mf_size_type size1, mf_size_type size2, mf_size_type nnz) {
+			nnz1.assign(size1, 0);
+			nnz2.assign(size2, 0);
+			computeDefaultBlockOffsets(size1, blocks1, equalOffsets1);
+			computeDefaultBlockOffsets(size2, blocks2, equalOffsets2);
+			blockNnz.clear();
+			return true;
+		}
+
+		inline bool checkProcess(mf_size_type i, mf_size_type j) {
+			nnz1[i]++;
+			nnz2[j]++;
+			mf_size_type b1 = std::upper_bound(equalOffsets1.begin(), equalOffsets1.end(), i) - equalOffsets1.begin() - 1;
+			mf_size_type b2 = std::upper_bound(equalOffsets2.begin(), equalOffsets2.end(), j) - equalOffsets2.begin() - 1;
+			blockNnz(b1, b2)++;
+			return false; // do not parse the value
+		}
+
+		inline void process(mf_size_type i, mf_size_type j, double x) {
+		}
+
+		inline void freeze() {
+		}
+
+		mf_size_type blocks1, blocks2;
+		std::vector<mf_size_type> nnz1, nnz2;
+		std::vector<mf_size_type> equalOffsets1, equalOffsets2;
+		boost::numeric::ublas::matrix<mf_size_type> blockNnz;
+	};
+
+	/** Computes the block offsets for readMatrixBlocks() if they are not given */
+	inline void computeBlockOffsets(const std::string& fname, mf_size_type blocks1, mf_size_type blocks2,
+			std::vector<mf_size_type>& blockOffsets1, std::vector<mf_size_type>& blockOffsets2,
+			MatrixFileFormat format, BlockingType blocking) {
+		if (blocking != BLOCKING_BALANCED_NNZ || !blockOffsets1.empty() || !blockOffsets2.empty()) {
+			return; // keep given offsets or use the default ones
+		}
+		double ratio;
+		computeBalancedBlockOffsets(fname, blocks1, blocks2, blockOffsets1, blockOffsets2, format, &ratio);
+		LOG4CXX_INFO(detail::logger, "Balanced blocking of '" << fname << "': max/mean nonzero entries per "
+				<< "block is " << ratio << " with blocks of equal size");
+	}
+}
+
+inline void readMatrixSize(const std::string& fname, mf_size_type& size1, mf_size_type& size2,
+		MatrixFileFormat format) {
+	if (format == AUTOMATIC) {
+		format = getMatrixFormat(fname);
+	}
+
+	switch (format) {
+	case MM_COORD:
+		detail::readMmCoord(
+				fname,
+				boost::bind(&detail::mmReadSize, boost::ref(size1), boost::ref(size2), _1, _2, _3),
+				boost::bind(&detail::mmSkipEntry, _1, _2),
+				boost::bind(&detail::mmSkipValue, _1, _2, _3),
+				boost::bind(&detail::mmSkipFreeze));
+		break;
+	case MM_ARRAY:
+		detail::readMmArray(
+				fname,
+				boost::bind(&detail::mmReadSize, boost::ref(size1), boost::ref(size2), _1, _2, _3),
+				boost::bind(&detail::mmSkipEntry, _1, _2),
+				boost::bind(&detail::mmSkipValue, _1, _2, _3),
+				boost::bind(&detail::mmSkipFreeze));
+		break;
+	default:
+		if (isSparse(format)) {
+			SparseMatrix m;
+			readMatrix(fname, m, format);
+			size1 = m.size1();
+			size2 = m.size2();
+		} else {
+			DenseMatrix m;
+			readMatrix(fname, m, format);
+			size1 = m.size1();
+			size2 = m.size2();
+		}
+	}
+}
+
+inline void computeBalancedBlockOffsets(const std::string& fname,
+		mf_size_type blocks1, mf_size_type blocks2,
+		std::vector<mf_size_type>& blockOffsets1, std::vector<mf_size_type>& blockOffsets2,
+		MatrixFileFormat format, double* equalSizeRatio) {
+	if (format == AUTOMATIC) {
+		format = getMatrixFormat(fname);
+	}
+
+	detail::CountNnzMm counter(blocks1, blocks2);
+	switch (format) {
+	case MM_COORD:
+		detail::readMmCoord(
+				fname,
+				boost::bind(&detail::CountNnzMm::init, boost::ref(counter), _1, _2, _3),
+				boost::bind(&detail::CountNnzMm::checkProcess, boost::ref(counter), _1, _2),
+				boost::bind(&detail::CountNnzMm::process, boost::ref(counter), _1, _2, _3),
+				boost::bind(&detail::CountNnzMm::freeze, boost::ref(counter)));
+		break;
+	case MM_ARRAY:
+	case BOOST_DENSE_BIN:
+	case BOOST_DENSE_TEXT:
+	{
+		// dense matrices are balanced when blocks have the same size
+		mf_size_type size1, size2;
+		readMatrixSize(fname, size1, size2, format);
+		computeDefaultBlockOffsets(size1, blocks1, blockOffsets1);
+		computeDefaultBlockOffsets(size2, blocks2, blockOffsets2);
+		if (equalSizeRatio != NULL) *equalSizeRatio = 1.;
+		return;
+	}
+	default:
+	{
+		SparseMatrix m;
+		readMatrix(fname, m, format);
+		counter.init(m.size1(), m.size2(), m.nnz());
+		const SparseMatrix::index_array_type& index1 = rowIndexData(m);
+		const SparseMatrix::index_array_type& index2 = columnIndexData(m);
+		for (mf_size_type p=0; p<m.nnz(); p++) {
+			counter.checkProcess(index1[p], index2[p]);
+		}
+	}
+		break;
+	}
+
+	computeBalancedBlockOffsets(counter.nnz1, blocks1, blockOffsets1);
+	computeBalancedBlockOffsets(counter.nnz2, blocks2, blockOffsets2);
+	if (equalSizeRatio != NULL) *equalSizeRatio = blockNnzRatio(counter.blockNnz);
+}
+
 template<class M>
 void readMatrixBlocks(
 		const std::string& fname,
@@ -623,24 +874,26 @@ void readMatrixBlocks(
 		std::vector<mf_size_type>& blockOffsets1, std::vector<mf_size_type>& blockOffsets2,
 		mf_size_type& size1, mf_size_type& size2,
 		std::vector<M*>& blocks,
-		MatrixFileFormat format) {
+		MatrixFileFormat format, BlockingType blocking, const Relabeling* relabeling) {
+	detail::computeBlockOffsets(fname, blocks1, blocks2, blockOffsets1, blockOffsets2, format, blocking);
 	detail::readMatrixBlocks<M, false>(fname, blocks1, blocks2, sortedBlockList,
-			blockOffsets1, blockOffsets2, size1, size2, blocks, format);
+			blockOffsets1, blockOffsets2, size1, size2, blocks, format, relabeling);
 }
 
-template<class L, std::size_t IB, class IA, class TA>
+template<class T, class L, std::size_t IB, class IA, class TA>
 void readMatrixBlocks(
 		const std::string& fname,
 		mf_size_type blocks1, mf_size_type blocks2,
 		const std::vector<std::pair<mf_size_type, mf_size_type> >& sortedBlockList,
 		std::vector<mf_size_type>& blockOffsets1, std::vector<mf_size_type>& blockOffsets2,
 		mf_size_type& size1, mf_size_type& size2,
-		std::vector<boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA>*>& blocks,
-		MatrixFileFormat format) {
-	typedef boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA> M;
+		std::vector<boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA>*>& blocks,
+		MatrixFileFormat format, BlockingType blocking, const Relabeling* relabeling) {
+	typedef boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA> M;
+	detail::computeBlockOffsets(fname, blocks1, blocks2, blockOffsets1, blockOffsets2, format, blocking);
 	detail::readMatrixBlocks<M, true>(fname, blocks1, blocks2, sortedBlockList,
-			blockOffsets1, blockOffsets2, size1, size2, blocks, format);
-	typedef boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA> M;
+			blockOffsets1, blockOffsets2, size1, size2, blocks, format, relabeling);
+	typedef boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA> M;
 }
 
 }
@@ -39,8 +39,8 @@ void writeMmCoord(const std::string& fname, const Matrix& M) {
 	RG_THROW(rg::NotImplementedException, "writing non-coordinate matrices to MatrixMarket coordinate format");
 }
 
-template<typename L, std::size_t IB, class IA, class TA>
-void writeMmCoord(const std::string& fname, const boost::numeric::ublas::coordinate_matrix<double, L, IB, IA, TA> &M) {
+template<typename T, typename L, std::size_t IB, class IA, class TA>
+void writeMmCoord(const std::string& fname, const boost::numeric::ublas::coordinate_matrix<T, L, IB, IA, TA> &M) {
 	// open file
 	std::ofstream out(fname.c_str());
 	if (!out.is_open())
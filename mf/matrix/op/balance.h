@@ -14,8 +14,12 @@
 #ifndef MF_MATRIX_OP_BALANCE_H
 #define MF_MATRIX_OP_BALANCE_H
 
+#include <cmath>
+
 #include <boost/numeric/ublas/vector.hpp>
 #include <util/exception.h>
+#include <mf/logger.h>
+#include <mf/loss/l2.h>
 #include <mf/factorization.h>
 #include <mf/sgd/dsgd-factorization.h>
 #include <mf/sgd/dsgdpp-factorization.h>
@@ -30,18 +34,32 @@ enum BalanceMethod {
 	BALANCE_OPTIMAL         /**< Balance using a different constant for each factor */
 };
 
-boost::numeric::ublas::vector<double> balanceSimple(FactorizationData<>& data, BalanceType type);
-boost::numeric::ublas::vector<double> balanceOptimal(FactorizationData<>& data, BalanceType type);
-boost::numeric::ublas::vector<double> balance(FactorizationData<>& data, BalanceType type = BALANCE_L2, BalanceMethod method = BALANCE_SIMPLE);
+/** Balances the factors of a shared-memory factorization (double or single-precision
+ * factors, any type of training data) */
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceSimple(FactorizationData<Data,Factor,Index>& data, BalanceType type);
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceOptimal(FactorizationData<Data,Factor,Index>& data, BalanceType type);
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balance(FactorizationData<Data,Factor,Index>& data,
+		BalanceType type = BALANCE_L2, BalanceMethod method = BALANCE_SIMPLE);
 
-boost::numeric::ublas::vector<double> balanceSimple(DsgdFactorizationData<>& data, BalanceType type);
-boost::numeric::ublas::vector<double> balanceOptimal(DsgdFactorizationData<>& data, BalanceType type);
-boost::numeric::ublas::vector<double> balance(DsgdFactorizationData<>& data,
+/** Balances the factors of a DSGD job (any type of data blocks) */
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceSimple(DsgdFactorizationData<Data,Factor,Index>& data, BalanceType type);
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceOptimal(DsgdFactorizationData<Data,Factor,Index>& data, BalanceType type);
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balance(DsgdFactorizationData<Data,Factor,Index>& data,
 		BalanceType type = BALANCE_L2, BalanceMethod method = BALANCE_SIMPLE);
 
-boost::numeric::ublas::vector<double> balanceSimple(DsgdPpFactorizationData<>& data, BalanceType type);
-boost::numeric::ublas::vector<double> balanceOptimal(DsgdPpFactorizationData<>& data, BalanceType type);
-boost::numeric::ublas::vector<double> balance(DsgdPpFactorizationData<>& data,
+/** Balances the factors of a DSGD++ job (any type of data blocks) */
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceSimple(DsgdPpFactorizationData<Data,Factor,Index>& data, BalanceType type);
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceOptimal(DsgdPpFactorizationData<Data,Factor,Index>& data, BalanceType type);
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balance(DsgdPpFactorizationData<Data,Factor,Index>& data,
 		BalanceType type = BALANCE_L2, BalanceMethod method = BALANCE_SIMPLE);
 
 boost::numeric::ublas::vector<double> balanceSimple(DapFactorizationData<>& data, BalanceType type);
@@ -49,15 +67,34 @@ boost::numeric::ublas::vector<double> balanceOptimal(DapFactorizationData<>& dat
 boost::numeric::ublas::vector<double> balance(DapFactorizationData<>& data,
 		BalanceType type = BALANCE_L2, BalanceMethod method = BALANCE_SIMPLE);
 
-inline boost::numeric::ublas::vector<double> balance(AsgdFactorizationData<>& data,
-		BalanceType type = BALANCE_L2, BalanceMethod method = BALANCE_SIMPLE) {
-	boost::numeric::ublas::vector<double> factors;
-	if (type == BALANCE_NONE) {
-		return factors;
-	}
-	RG_THROW(rg::NotImplementedException, "balancing for ASGD");
-};
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceSimple(AsgdFactorizationData<Data,Factor,Index>& data, BalanceType type);
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceOptimal(AsgdFactorizationData<Data,Factor,Index>& data, BalanceType type);
+
+/** Balances the factors of an ASGD job. Besides W and the master H, also rescales the copies
+ * of H replicated at every rank during ASGD (the work copy data.hWorkName and its cache), so
+ * that balancing does not show up as a delta at the next synchronization. Must be called
+ * between ASGD epochs (when all copies of H agree). The squared sums of the factors are
+ * combined with a single all-to-all exchange among the ranks. */
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balance(AsgdFactorizationData<Data,Factor,Index>& data,
+		BalanceType type = BALANCE_L2, BalanceMethod method = BALANCE_SIMPLE);
+
+namespace detail {
+	/** Balances the local blocks of an ASGD job (see balance(AsgdFactorizationData<>&)).
+	 * Receives the factors, the names of the nnz vectors and of the work copy of H, and the
+	 * type and method of balancing. W and H are the types of the blocks of the factors. */
+	template<typename W = DenseMatrix, typename H = DenseMatrixCM>
+	struct AsgdBalanceTask {
+		static const std::string id() { return std::string("__mf/matrix/op/AsgdBalanceTask_")
+				+ mpi2::TypeTraits<W>::name() + "_" + mpi2::TypeTraits<H>::name(); }
+		static void run(mpi2::Channel ch, mpi2::TaskInfo info);
+	};
+}
 
 }
 
+#include <mf/matrix/op/balance_impl.h>
+
 #endif
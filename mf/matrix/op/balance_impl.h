@@ -0,0 +1,343 @@
+//    Copyright 2017 Rainer Gemulla
+// 
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+// 
+//        http://www.apache.org/licenses/LICENSE-2.0
+// 
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Implementation for matrix/op/balance.h
+ * DO NOT INCLUDE DIRECTLY
+ */
+
+#include <mf/matrix/op/balance.h> // help for compilers
+
+#include <mf/loss/nzl2.h>
+#include <mf/matrix/op/scale.h>
+#include <mf/matrix/op/sums.h>
+
+namespace mf {
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceSimple(FactorizationData<Data,Factor,Index>& data, BalanceType type) {
+	if (type == BALANCE_NONE) return boost::numeric::ublas::vector<double>(1, 1);
+
+	double wFactor, hFactor, regW, regH;
+
+	if (type == BALANCE_L2) {
+		regW = l2(data.w);
+		regH = l2(data.h);
+	} else {
+		regW = nzl2(data.w, *data.nnz1, data.nnz1offset);
+		regH = nzl2(data.h, *data.nnz2, data.nnz2offset);
+	}
+
+	wFactor = sqrt( sqrt(regH/regW) ); // the inner square root is the x that minimizes of x*l2w + 1/x*l2h
+	if (std::isnan(wFactor)) {
+		LOG4CXX_INFO(detail::logger, "Invalid multiplier in balancing (regW=" << regW << ", regH=" << regH << "); replacing factor matrices by 0 matrices");
+		wFactor = 0;
+		hFactor = 0;
+	} else {
+		hFactor = 1./wFactor;
+	}
+
+	data.w *= (Factor)wFactor;
+	data.h *= (Factor)hFactor;
+
+	return boost::numeric::ublas::vector<double>(1, wFactor);
+}
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceOptimal(FactorizationData<Data,Factor,Index>& data, BalanceType type) {
+	if (type == BALANCE_NONE) return boost::numeric::ublas::vector<double>(data.r, 1);
+
+	boost::numeric::ublas::vector<double> wFactor(data.r), hFactor(data.r), regW, regH;
+
+	if (type==BALANCE_L2) {
+		regW = squaredSums2(data.w);
+		regH = squaredSums1(data.h);
+	} else {
+		regW = nzl2SquaredSums2(data.w,*data.nnz1, data.nnz1offset);
+		regH = nzl2SquaredSums1(data.h,*data.nnz2, data.nnz2offset);
+	}
+
+	for (mf_size_type k=0; k<data.r; k++) {
+		wFactor[k] = sqrt( sqrt(regH[k] / regW[k]) );
+		if (std::isnan(wFactor[k])) {
+			LOG4CXX_INFO(detail::logger, "Invalid multiplier in balancing (k=" << k << ", regW=" << regW[k] << ", regH=" << regH[k] << "); replacing factor " << k << " by 0");
+			wFactor[k] = 0;
+			hFactor[k] = 0;
+		} else {
+			hFactor[k] = 1./wFactor[k];
+		}
+	}
+	mult2(data.w, wFactor);
+	mult1(data.h, hFactor);
+
+	return wFactor;
+}
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balance(FactorizationData<Data,Factor,Index>& data, BalanceType type, BalanceMethod method) {
+	boost::numeric::ublas::vector<double> factors;
+	switch (method) {
+	case BALANCE_SIMPLE:
+		if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Starting simple balancing");
+		factors = balanceSimple(data, type);
+		if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Balancing factor (W)" << factors[0]);
+		if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Finished simple balancing");
+		break;
+	case BALANCE_OPTIMAL:
+		if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Starting optimal balancing");
+		factors = balanceOptimal(data, type);
+		if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Balancing factors (W): " << factors);
+		if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Finished optimal balancing");
+		break;
+	}
+
+	return factors;
+}
+
+namespace detail {
+	template<typename FD>
+	boost::numeric::ublas::vector<double> distributedBalanceSimple(FD& data, BalanceType type) {
+		if (type == BALANCE_NONE) return boost::numeric::ublas::vector<double>(1, 1);
+
+		double wFactor, hFactor, regW, regH;
+
+		if (type == BALANCE_L2) {
+			regW = l2(data.dw, data.tasksPerRank);
+			regH = l2(data.dh, data.tasksPerRank);
+		} else {
+			regW = nzl2(data.dw, data.nnz1name, data.tasksPerRank);
+			regH = nzl2(data.dh, data.nnz2name, data.tasksPerRank);
+		}
+
+		wFactor = sqrt( sqrt(regH/regW) ); // the inner square root is the x that minimizes of x*l2w + 1/x*l2h
+		if (std::isnan(wFactor)) {
+			LOG4CXX_INFO(detail::logger, "Invalid multiplier in balancing (regW=" << regW << ", regH=" << regH << "); replacing factor matrices by 0 matrices");
+			wFactor = 0;
+			hFactor = 0;
+		} else {
+			hFactor = 1./wFactor;
+		}
+
+		mult(data.dw, wFactor, data.tasksPerRank);
+		mult(data.dh, hFactor, data.tasksPerRank);
+
+		return boost::numeric::ublas::vector<double>(1, wFactor);
+	}
+
+	template<typename FD>
+	boost::numeric::ublas::vector<double> distributedBalanceOptimal(FD& data, BalanceType type) {
+		mf_size_type r = data.dw.size2();
+		if (type == BALANCE_NONE) return boost::numeric::ublas::vector<double>(r, 1);
+
+		boost::numeric::ublas::vector<double> wFactor(r), hFactor(r), regW, regH;
+
+		if (type==BALANCE_L2) {
+			regW = squaredSums2(data.dw, data.tasksPerRank);
+			regH = squaredSums1(data.dh, data.tasksPerRank);
+		} else {
+			//RG_THROW(rg::NotImplementedException, "distributed balancing with Nzl2 is implemented now!");
+			regW = nzl2SquaredSums2(data.dw, data.nnz1name, data.tasksPerRank);
+			regH = nzl2SquaredSums1(data.dh, data.nnz2name, data.tasksPerRank);
+		}
+
+		for (mf_size_type k=0; k<r; k++) {
+			wFactor[k] = sqrt( sqrt(regH[k] / regW[k]) );
+			if (std::isnan(wFactor[k])) {
+				LOG4CXX_INFO(detail::logger, "Invalid multiplier in balancing (k=" << k << ", regW=" << regW[k] << ", regH=" << regH[k] << "); replacing factor " << k << " by 0");
+				wFactor[k] = 0;
+				hFactor[k] = 0;
+			} else {
+				hFactor[k] = 1./wFactor[k];
+			}
+		}
+		mult2(data.dw, wFactor, data.tasksPerRank);
+		mult1(data.dh, hFactor, data.tasksPerRank);
+
+		return wFactor;
+	}
+
+	template<typename FD>
+	boost::numeric::ublas::vector<double> distributedBalance(FD& data, BalanceType type, BalanceMethod method) {
+		boost::numeric::ublas::vector<double> factors;
+		switch (method) {
+		case BALANCE_SIMPLE:
+			if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Starting simple balancing");
+			factors = balanceSimple(data, type);
+			if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Balancing factor (W): " << factors[0]);
+			if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Finished simple balancing");
+			break;
+		case BALANCE_OPTIMAL:
+			if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Starting optimal balancing");
+			factors = balanceOptimal(data, type);
+			if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Balancing factors (W): " << factors);
+			if (type != BALANCE_NONE) LOG4CXX_INFO(mf::detail::logger, "Finished optimal balancing");
+			break;
+		}
+
+		return factors;
+	}
+}
+
+namespace detail {
+	template<typename W, typename H>
+	void AsgdBalanceTask<W,H>::run(mpi2::Channel ch, mpi2::TaskInfo info) {
+		DistributedMatrix<W> dw(mpi2::UNINITIALIZED);
+		DistributedMatrix<H> dh(mpi2::UNINITIALIZED);
+		BalanceType type;
+		BalanceMethod method;
+		ch.recv(*mpi2::unmarshal(dw, dh, type, method));
+		std::string nnz1name, nnz2name, hWorkName;
+		ch.recv(*mpi2::unmarshal(nnz1name, nnz2name, hWorkName));
+		std::vector<mpi2::Channel>& pairwiseChannels = info.pairwiseChannels();
+		mf_size_type d = pairwiseChannels.size();
+		int groupId = info.groupId();
+		W& w = *dw.block(groupId, 0).template getLocal<W>();
+		H& h = *dh.block(0, groupId).template getLocal<H>();
+		mf_size_type r = w.size2();
+
+		// squared sums of the local blocks (per factor)
+		boost::numeric::ublas::vector<double> regW, regH;
+		if (type == BALANCE_L2) {
+			regW = squaredSums2(w);
+			regH = squaredSums1(h);
+		} else {
+			const std::vector<mf_size_type>& nnz1 = *mpi2::env().get<std::vector<mf_size_type> >(nnz1name);
+			const std::vector<mf_size_type>& nnz2 = *mpi2::env().get<std::vector<mf_size_type> >(nnz2name);
+			regW = nzl2SquaredSums2(w, nnz1, dw.blockOffsets1()[groupId]);
+			regH = nzl2SquaredSums1(h, nnz2, dh.blockOffsets2()[groupId]);
+		}
+		std::vector<double> sums(2*r);
+		std::copy(regW.begin(), regW.end(), sums.begin());
+		std::copy(regH.begin(), regH.end(), sums.begin() + r);
+
+		// all-reduce; the sums are added in the same order on all ranks so that all ranks
+		// compute the same factors
+		std::vector<double> allSums(2*r*d);
+		std::vector<boost::mpi::request> reqs;
+		for (int i=0; i<d; i++) {
+			reqs.push_back( pairwiseChannels[i].isend(&sums[0], 2*r) );
+			reqs.push_back( pairwiseChannels[i].irecv(&allSums[i*2*r], 2*r) );
+		}
+		mpi2::economicWaitAll(reqs, mpi2::TaskManager::getInstance().pollDelay());
+		std::fill(regW.begin(), regW.end(), 0.);
+		std::fill(regH.begin(), regH.end(), 0.);
+		for (int i=0; i<d; i++) {
+			for (mf_size_type k=0; k<r; k++) {
+				regW[k] += allSums[i*2*r + k];
+				regH[k] += allSums[i*2*r + r + k];
+			}
+		}
+
+		// compute the factors
+		boost::numeric::ublas::vector<double> wFactor(r), hFactor(r), result;
+		if (method == BALANCE_SIMPLE) {
+			double f = sqrt( sqrt(boost::numeric::ublas::sum(regH) / boost::numeric::ublas::sum(regW)) ); // the inner square root is the x that minimizes of x*l2w + 1/x*l2h
+			if (std::isnan(f)) {
+				if (groupId == 0) LOG4CXX_INFO(detail::logger, "Invalid multiplier in balancing (regW=" << boost::numeric::ublas::sum(regW) << ", regH=" << boost::numeric::ublas::sum(regH) << "); replacing factor matrices by 0 matrices");
+				f = 0;
+			}
+			std::fill(wFactor.begin(), wFactor.end(), f);
+			std::fill(hFactor.begin(), hFactor.end(), f == 0 ? 0. : 1./f);
+			result = boost::numeric::ublas::vector<double>(1, f);
+		} else {
+			for (mf_size_type k=0; k<r; k++) {
+				wFactor[k] = sqrt( sqrt(regH[k] / regW[k]) );
+				if (std::isnan(wFactor[k])) {
+					if (groupId == 0) LOG4CXX_INFO(detail::logger, "Invalid multiplier in balancing (k=" << k << ", regW=" << regW[k] << ", regH=" << regH[k] << "); replacing factor " << k << " by 0");
+					wFactor[k] = 0;
+					hFactor[k] = 0;
+				} else {
+					hFactor[k] = 1./wFactor[k];
+				}
+			}
+			result = wFactor;
+		}
+
+		// rescale the local blocks and the local copies of H (see AsgdInitTask)
+		mult2(w, wFactor);
+		mult1(h, hFactor);
+		mult1(*mpi2::env().get<H>(hWorkName), hFactor);
+		mult1(*mpi2::env().get<H>("asgd_h_cache"), hFactor);
+
+		ch.send(result);
+	}
+}
+
+namespace detail {
+	/** Runs AsgdBalanceTask on all ranks and returns the balancing factors of W */
+	template<typename Data, typename Factor, typename Index>
+	boost::numeric::ublas::vector<double> balanceAsgd(AsgdFactorizationData<Data,Factor,Index>& data, BalanceType type,
+			BalanceMethod method) {
+		mf_size_type r = data.dw.size2();
+		if (type == BALANCE_NONE) {
+			return boost::numeric::ublas::vector<double>(method == BALANCE_SIMPLE ? 1 : r, 1);
+		}
+
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		std::vector<mpi2::Channel> channels;
+		tm.spawnAll<AsgdBalanceTask<typename AsgdFactorizationData<Data,Factor,Index>::W,
+				typename AsgdFactorizationData<Data,Factor,Index>::H> >(channels, true);
+		mpi2::sendAll(channels, mpi2::marshal(data.dw, data.dh, type, method));
+		mpi2::sendAll(channels, mpi2::marshal(data.nnz1name, data.nnz2name, data.hWorkName));
+		std::vector<boost::numeric::ublas::vector<double> > factors(channels.size());
+		mpi2::economicRecvAll(channels, factors, tm.pollDelay());
+		return factors[0]; // same on all ranks
+	}
+}
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceSimple(DsgdFactorizationData<Data,Factor,Index>& data, BalanceType type) {
+	return detail::distributedBalanceSimple(data, type);
+}
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceOptimal(DsgdFactorizationData<Data,Factor,Index>& data, BalanceType type) {
+	return detail::distributedBalanceOptimal(data, type);
+}
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balance(DsgdFactorizationData<Data,Factor,Index>& data,
+		BalanceType type, BalanceMethod method) {
+	return detail::distributedBalance(data, type, method);
+}
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceSimple(DsgdPpFactorizationData<Data,Factor,Index>& data, BalanceType type) {
+	return detail::distributedBalanceSimple(data, type);
+}
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceOptimal(DsgdPpFactorizationData<Data,Factor,Index>& data, BalanceType type) {
+	return detail::distributedBalanceOptimal(data, type);
+}
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balance(DsgdPpFactorizationData<Data,Factor,Index>& data,
+		BalanceType type, BalanceMethod method) {
+	return detail::distributedBalance(data, type, method);
+}
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceSimple(AsgdFactorizationData<Data,Factor,Index>& data, BalanceType type) {
+	return detail::balanceAsgd(data, type, BALANCE_SIMPLE);
+}
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balanceOptimal(AsgdFactorizationData<Data,Factor,Index>& data, BalanceType type) {
+	return detail::balanceAsgd(data, type, BALANCE_OPTIMAL);
+}
+
+template<typename Data, typename Factor, typename Index>
+boost::numeric::ublas::vector<double> balance(AsgdFactorizationData<Data,Factor,Index>& data,
+		BalanceType type, BalanceMethod method) {
+	return detail::distributedBalance(data, type, method);
+}
+
+}
@@ -14,6 +14,15 @@
 #ifndef MF_MATRIX_OP_COPY
 #define MF_MATRIX_OP_COPY
 
+#include <algorithm>
+#include <limits>
+
+#include <boost/cstdint.hpp>
+
+#include <util/exception.h>
+
+#include <mf/types.h>
+
 namespace mf {
 
 /** Copies a row-major sparse matrix into a column-major sparse matrix. */
@@ -28,6 +37,27 @@ inline void copyCm(const SparseMatrix& m, SparseMatrixCM& mc) {
 	mc.sort();
 }
 
+/** Copies a row-major sparse matrix into a compact sparse matrix with 32-bit indexes (such as
+ * mf::CompactSparseMatrix or mf::CompactSparseMatrixF). Values are converted to type T. */
+template<typename T>
+void copyCompact(const SparseMatrix& m,
+		boost::numeric::ublas::coordinate_matrix<T, boost::numeric::ublas::row_major, 0,
+				boost::numeric::ublas::unbounded_array<boost::uint32_t>,
+				boost::numeric::ublas::unbounded_array<T> >& mc) {
+	const mf_size_type maxSize = std::numeric_limits<boost::uint32_t>::max();
+	if (m.size1() > maxSize || m.size2() > maxSize || m.nnz() > maxSize) {
+		RG_THROW(rg::InvalidArgumentException, "matrix too large for compact representation (block it first)");
+	}
+	mc.clear();
+	mc.resize(m.size1(), m.size2(), false);
+	mc.reserve(m.nnz(), false);
+	std::copy(m.index1_data().begin(), m.index1_data().begin() + m.nnz(), mc.index1_data().begin());
+	std::copy(m.index2_data().begin(), m.index2_data().begin() + m.nnz(), mc.index2_data().begin());
+	std::copy(m.value_data().begin(), m.value_data().begin() + m.nnz(), mc.value_data().begin());
+	mc.set_filled(m.nnz());
+	mc.sort();
+}
+
 }
 
 #endif
@@ -33,8 +33,8 @@ namespace mf {
  * @param function to apply to each element; double f(mf_size_type i, mf_size_type j, double x)
  * @tparam F type of function
  */
-template<typename L, typename A, typename F>
-void apply(boost::numeric::ublas::matrix<double, L, A>& m,
+template<typename T, typename L, typename A, typename F>
+void apply(boost::numeric::ublas::matrix<T, L, A>& m,
 		F f,
 		mf_size_type start1, mf_size_type end1,
 		mf_size_type start2, mf_size_type end2) {
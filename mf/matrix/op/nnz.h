@@ -26,12 +26,15 @@ namespace mf {
 
 // -- sequential ----------------------------------------------------------------------------------
 
-inline mf_size_type nnz(const SparseMatrix& m) { return m.nnz(); }
-
-inline mf_size_type nnz(const SparseMatrixCM& m) { return m.nnz(); }
+template<class T, class L, std::size_t IB, class IA, class TA>
+inline mf_size_type nnz(const boost::numeric::ublas::coordinate_matrix<T,L,IB,IA,TA>& m) {
+	return m.nnz();
+}
 
 /** Counts the number of nonzero entries in each row / column of the matrix */
-inline void nnz12(const SparseMatrix& m, std::vector<mf_size_type>& nnz1,
+template<class T, class L, std::size_t IB, class IA, class TA>
+inline void nnz12(const boost::numeric::ublas::coordinate_matrix<T,L,IB,IA,TA>& m,
+		std::vector<mf_size_type>& nnz1,
 		std::vector<mf_size_type>& nnz2,
 		mf_size_type& nnz12max) {
 	// start with zeroes
@@ -40,8 +43,8 @@ inline void nnz12(const SparseMatrix& m, std::vector<mf_size_type>& nnz1,
 	std::fill(nnz1.begin(), nnz1.end(), 0);
 	std::fill(nnz2.begin(), nnz2.end(), 0);
 
-	const SparseMatrix::index_array_type& index1 = rowIndexData(m);
-	const SparseMatrix::index_array_type& index2 = columnIndexData(m);
+	const IA& index1 = rowIndexData(m);
+	const IA& index2 = columnIndexData(m);
 	for (mf_size_type p=0; p<m.nnz(); p++) {
 		nnz1[index1[p]]++;
 		nnz2[index2[p]]++;
@@ -58,12 +61,13 @@ inline void nnz12(const SparseMatrix& m, std::vector<mf_size_type>& nnz1,
 }
 
 /** Counts the number of nonzero entries in each row / column of the matrix */
-inline void nnz12Incremental(const SparseMatrix& m,
+template<class T, class L, std::size_t IB, class IA, class TA>
+inline void nnz12Incremental(const boost::numeric::ublas::coordinate_matrix<T,L,IB,IA,TA>& m,
 		std::vector<mf_size_type>& nnz1, mf_size_type nnz1offset,
 		std::vector<mf_size_type>& nnz2, mf_size_type nnz2offset,
 		mf_size_type& nnz12max) {
-	const SparseMatrix::index_array_type& index1 = rowIndexData(m);
-	const SparseMatrix::index_array_type& index2 = columnIndexData(m);
+	const IA& index1 = rowIndexData(m);
+	const IA& index2 = columnIndexData(m);
 	for (mf_size_type p=0; p<m.nnz(); p++) {
 		nnz1[index1[p] + nnz1offset]++;
 		nnz2[index2[p] + nnz2offset]++;
@@ -121,15 +125,16 @@ inline mf_size_type nnz(const DistributedMatrix<M>& m, int tasksPerRank=1) {
 
 /** Counts the number of nonzero entries in each row / column of a distributed matrix.
  * Current implementation is not efficient (neither memory nor CPU, but that's OK for now). */
-inline void nnz12(const DistributedSparseMatrix& m,
+template<typename M>
+inline void nnz12(const DistributedMatrix<M>& m,
 		std::vector<mf_size_type>& nnz1,
 		std::vector<mf_size_type>& nnz2,
 		mf_size_type& nnz12max,
 		unsigned tasksPerRank = 1) {
 	boost::numeric::ublas::matrix<
-		detail::Nnz12Task<SparseMatrix>::Return
+		typename detail::Nnz12Task<M>::Return
 		> localNnzPairs(m.blocks1(), m.blocks2());
-	runTaskOnBlocks< detail::Nnz12Task<SparseMatrix> >(m, localNnzPairs, tasksPerRank, false);
+	runTaskOnBlocks< detail::Nnz12Task<M> >(m, localNnzPairs, tasksPerRank, false);
 
 	// clear result
 	nnz1.clear();
@@ -141,7 +146,7 @@ inline void nnz12(const DistributedSparseMatrix& m,
 	for (mf_size_type b1 = 0; b1<m.blocks1(); b1++) {
 		mf_size_type b1offset = m.blockOffsets1()[b1];
 		for (mf_size_type b2 = 0; b2<m.blocks2(); b2++) {
-			const detail::Nnz12Task<SparseMatrix>::Return& localPair = localNnzPairs(b1,b2);
+			const typename detail::Nnz12Task<M>::Return& localPair = localNnzPairs(b1,b2);
 			mf_size_type b2offset = m.blockOffsets2()[b2];
 
 			for (mf_size_type i = 0; i<localPair.first.size(); i++) {
@@ -0,0 +1,129 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Random relabeling of the rows and columns of a matrix. Input files are often sorted
+ * (e.g., by popularity), so that blocks of equal size differ vastly in their number of
+ * nonzero entries; relabeling the rows and columns randomly before blocking removes
+ * this skew.
+ */
+
+#ifndef MF_MATRIX_OP_RELABEL_H
+#define MF_MATRIX_OP_RELABEL_H
+
+#include <algorithm>
+#include <vector>
+
+#include <util/random.h>
+
+#include <mf/types.h>
+#include <mf/matrix/op/project.h>
+
+namespace mf {
+
+/** A relabeling of the rows and columns of a matrix. As in ProjectedSparseMatrix, map1[i]
+ * (map2[j]) is the index of row i (column j) of the relabeled matrix in the original matrix.
+ * An empty map leaves the corresponding dimension unchanged. */
+struct Relabeling {
+	std::vector<mf_size_type> map1;
+	std::vector<mf_size_type> map2;
+
+	bool empty() const {
+		return map1.empty() && map2.empty();
+	}
+
+	/** Returns the relabeling of the rows only (for the row factors) */
+	Relabeling rows() const {
+		Relabeling result;
+		result.map1 = map1;
+		return result;
+	}
+
+	/** Returns the relabeling of the columns only (for the column factors) */
+	Relabeling columns() const {
+		Relabeling result;
+		result.map2 = map2;
+		return result;
+	}
+};
+
+/** Computes the inverse of a map, i.e., inverse[map[i]] = i. */
+inline void invertMap(const std::vector<mf_size_type>& map, std::vector<mf_size_type>& inverse) {
+	inverse.resize(map.size());
+	for (mf_size_type i=0; i<map.size(); i++) {
+		inverse[map[i]] = i;
+	}
+}
+
+/** Checks whether map is a permutation of [0,size). */
+inline bool isPermutation(const std::vector<mf_size_type>& map, mf_size_type size) {
+	if (map.size() != size) return false;
+	std::vector<bool> seen(size, false);
+	for (mf_size_type i=0; i<size; i++) {
+		if (map[i] >= size || seen[map[i]]) return false;
+		seen[map[i]] = true;
+	}
+	return true;
+}
+
+/** Creates a random permutation of [0,size) (empty if size is 0). */
+inline void randomMap(rg::Random32& random, mf_size_type size, std::vector<mf_size_type>& map) {
+	map.resize(size);
+	for (mf_size_type i=0; i<size; i++) {
+		map[i] = i;
+	}
+	for (mf_size_type i=size; i>1; i--) {
+		std::swap(map[i-1], map[random.nextInt(i)]);
+	}
+}
+
+/** Creates a random relabeling of the rows and columns of a size1 x size2 matrix. */
+inline void randomRelabeling(rg::Random32& random, mf_size_type size1, mf_size_type size2,
+		Relabeling& result) {
+	randomMap(random, size1, result.map1);
+	randomMap(random, size2, result.map2);
+}
+
+/** Restores the original order of the rows of a relabeled (dense) matrix.
+ *
+ * @param[in,out] m matrix in which row i corresponds to row map1[i] of the original matrix
+ * @param map1 the row map of the relabeling (nothing is done if empty)
+ */
+template<typename M>
+void unrelabel1(M& m, const std::vector<mf_size_type>& map1) {
+	if (map1.empty()) return;
+	std::vector<mf_size_type> inverse;
+	invertMap(map1, inverse);
+	M temp;
+	project1(m, temp, inverse);
+	m.swap(temp);
+}
+
+/** Restores the original order of the columns of a relabeled (dense) matrix.
+ *
+ * @param[in,out] m matrix in which column j corresponds to column map2[j] of the original matrix
+ * @param map2 the column map of the relabeling (nothing is done if empty)
+ */
+template<typename M>
+void unrelabel2(M& m, const std::vector<mf_size_type>& map2) {
+	if (map2.empty()) return;
+	std::vector<mf_size_type> inverse;
+	invertMap(map2, inverse);
+	M temp;
+	project2(m, temp, inverse);
+	m.swap(temp);
+}
+
+} // namespace mf
+
+#endif
@@ -55,7 +55,7 @@ boost::numeric::ublas::vector<typename M::value_type> squaredSums1(M &m) {
 	boost::numeric::ublas::vector<T> squaredSums(n);
     for(mf_size_type i=0; i<n; i++) {
     	boost::numeric::ublas::matrix_row<M> row(m, i);
-    	T s = 0;
+    	double s = 0; // accumulated in double also for single-precision matrices
     	BOOST_FOREACH(T v, row) {
     		s += v*v;
     	}
@@ -67,9 +67,8 @@ boost::numeric::ublas::vector<typename M::value_type> squaredSums1(M &m) {
  * 	make sure that nnz.size()=m.size2()
  */
 template<typename M>
-boost::numeric::ublas::vector<typename M::value_type> nzl2SquaredSums1(M &m,const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset = 0) {
-	typedef typename M::value_type T;
-	boost::numeric::ublas::vector<T> squaredSums( m.size1(), 0 );
+boost::numeric::ublas::vector<double> nzl2SquaredSums1(M &m,const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset = 0) {
+	boost::numeric::ublas::vector<double> squaredSums( m.size1(), 0 );
 
 	for (mf_size_type j=0;j<m.size2(); j++) {
     	mf_size_type nnzj = nnz[j + nnzOffset];
@@ -101,10 +100,8 @@ boost::numeric::ublas::vector<typename M::value_type> sums2(M &m) {
  * 	make sure that nnz.size()=m.size1()
  */
 template<typename M>
-boost::numeric::ublas::vector<typename M::value_type> nzl2SquaredSums2(M &m, const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset = 0) {
-	typedef typename M::value_type T;
-
-	boost::numeric::ublas::vector<T> squaredSums( m.size2(), 0 );
+boost::numeric::ublas::vector<double> nzl2SquaredSums2(M &m, const std::vector<mf_size_type>& nnz, mf_size_type nnzOffset = 0) {
+	boost::numeric::ublas::vector<double> squaredSums( m.size2(), 0 );
 	for (mf_size_type i=0;i<m.size1();i++){
     	mf_size_type nnzi = nnz[i + nnzOffset];
     	for(mf_size_type j=0; j<m.size2(); j++) {
@@ -124,7 +121,7 @@ boost::numeric::ublas::vector<typename M::value_type> squaredSums2(M &m) {
 	boost::numeric::ublas::vector<T> squaredSums(n);
     for(mf_size_type i=0; i<n; i++) {
     	boost::numeric::ublas::matrix_column<M> col(m, i);
-    	T s = 0;
+    	double s = 0; // accumulated in double also for single-precision matrices
     	BOOST_FOREACH(T v, col) {
     		s += v*v;
     	}
@@ -268,8 +265,10 @@ inline double sumOfSquares(const DistributedDenseMatrix& w, const DistributedDen
 
 namespace detail {
 
-/**	A task for calculating nzl2SquaredSums1 and szl2SquaredSums2 */
-struct Nzl2SquaredSumsTask {
+/**	A task for calculating nzl2SquaredSums1 and szl2SquaredSums2 of the blocks of a
+ * row-factor matrix of type W or a column-factor matrix of type H */
+template<typename W, typename H>
+struct Nzl2SquaredSumsTaskFor {
 	/**
 	 * 	The argument that is necessary for a task Nzl2SquaredSumsTask. Described in terms of:
 	 * 	(1) the block of W or H on which the task will operate
@@ -285,12 +284,12 @@ struct Nzl2SquaredSumsTask {
 		: data(block), nnzName(nnzName), nnzOffset(nnzOffset), isRowFactor(isRowFactor){}
 
 		static Arg constructArgW(mf_size_type b1, mf_size_type b2, mpi2::RemoteVar block,
-				const DistributedMatrix<DenseMatrix>& m, const std::string& nnzName) {
+				const DistributedMatrix<W>& m, const std::string& nnzName) {
 			return Arg(block, nnzName, m.blockOffset1(b1), true);
 		}
 
 		static Arg constructArgH(mf_size_type b1, mf_size_type b2, mpi2::RemoteVar block,
-				const DistributedMatrix<DenseMatrixCM>& m, const std::string& nnzName) {
+				const DistributedMatrix<H>& m, const std::string& nnzName) {
 			return Arg(block, nnzName, m.blockOffset2(b2), false);
 		}
 
@@ -310,7 +309,8 @@ struct Nzl2SquaredSumsTask {
 		}
 	};
 
-	static const std::string id() {	return std::string("__mf/matrix/op/Nzl2SquaredSumsTask") ;}
+	static const std::string id() {	return std::string("__mf/matrix/op/Nzl2SquaredSumsTask_")
+			+ mpi2::TypeTraits<W>::name() + "_" + mpi2::TypeTraits<H>::name(); }
 
 	static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
 		std::vector<Arg> args;
@@ -321,11 +321,11 @@ struct Nzl2SquaredSumsTask {
 			Arg& arg = args[i];
 			const std::vector<mf_size_type>& nnz = *mpi2::env().get<std::vector<mf_size_type> >(arg.nnzName);
 			if (arg.isRowFactor){
-				const DenseMatrix& m = *arg.data.getLocal<DenseMatrix>();
+				const W& m = *arg.data.template getLocal<W>();
 				results[i] = nzl2SquaredSums2(m, nnz, arg.nnzOffset);
 			}
 			else{
-				const DenseMatrixCM& m = *arg.data.getLocal<DenseMatrixCM>();
+				const H& m = *arg.data.template getLocal<H>();
 				results[i] = nzl2SquaredSums1(m, nnz, arg.nnzOffset);
 			}
 			reqs[i] = ch.isend(results[i]);
@@ -334,31 +334,43 @@ struct Nzl2SquaredSumsTask {
 	}
 };
 
+typedef Nzl2SquaredSumsTaskFor<DenseMatrix, DenseMatrixCM> Nzl2SquaredSumsTask;
+
 } // namespace detail
 
 
 
-inline boost::numeric::ublas::vector<double> nzl2SquaredSums2(const DistributedMatrix<DenseMatrix>& m, const std::string& nnzName, int tasksPerRank) {
+template<typename T>
+inline boost::numeric::ublas::vector<double> nzl2SquaredSums2(
+		const DistributedMatrix<boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major> >& m,
+		const std::string& nnzName, int tasksPerRank) {
+	typedef boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major> W;
+	typedef detail::Nzl2SquaredSumsTaskFor<W, boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major> > Task;
 	BOOST_ASSERT( m.blocks2() == 1);
 	boost::numeric::ublas::matrix<boost::numeric::ublas::vector<double> > nzl2SquaredSums2result(m.blocks1(), m.blocks2());
-	runTaskOnBlocks<DenseMatrix, boost::numeric::ublas::vector<double>, detail::Nzl2SquaredSumsTask::Arg>(
+	runTaskOnBlocks<W, boost::numeric::ublas::vector<double>, typename Task::Arg>(
 			m,
 			nzl2SquaredSums2result,
-			boost::bind(detail::Nzl2SquaredSumsTask::Arg::constructArgW, _1, _2, _3, boost::cref(m), boost::cref(nnzName)),
-			detail::Nzl2SquaredSumsTask::id(),
+			boost::bind(Task::Arg::constructArgW, _1, _2, _3, boost::cref(m), boost::cref(nnzName)),
+			Task::id(),
 			tasksPerRank,
 			false);
 	return vectorSum(nzl2SquaredSums2result);
 }
 
-inline boost::numeric::ublas::vector<double> nzl2SquaredSums1(const DistributedMatrix<DenseMatrixCM>& m, const std::string& nnzName, int tasksPerRank) {
+template<typename T>
+inline boost::numeric::ublas::vector<double> nzl2SquaredSums1(
+		const DistributedMatrix<boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major> >& m,
+		const std::string& nnzName, int tasksPerRank) {
+	typedef boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major> H;
+	typedef detail::Nzl2SquaredSumsTaskFor<boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major>, H> Task;
 	BOOST_ASSERT( m.blocks1() == 1);
 	boost::numeric::ublas::matrix<boost::numeric::ublas::vector<double> > nzl2SquaredSums1result(m.blocks1(), m.blocks2());
-	runTaskOnBlocks<DenseMatrixCM, boost::numeric::ublas::vector<double>, detail::Nzl2SquaredSumsTask::Arg>(
+	runTaskOnBlocks<H, boost::numeric::ublas::vector<double>, typename Task::Arg>(
 			m,
 			nzl2SquaredSums1result,
-			boost::bind(detail::Nzl2SquaredSumsTask::Arg::constructArgH, _1, _2, _3, boost::cref(m), boost::cref(nnzName)),
-			detail::Nzl2SquaredSumsTask::id(),
+			boost::bind(Task::Arg::constructArgH, _1, _2, _3, boost::cref(m), boost::cref(nnzName)),
+			Task::id(),
 			tasksPerRank,
 			false);
 	return vectorSum(nzl2SquaredSums1result);
@@ -37,7 +37,7 @@ void unblock(const DistributedMatrix<Min>& source, Mout& target) {
 			if (var.isLocal()) {
 				block = var.getLocal<Min>();
 			} else {
-				var.getCopy(temp);
+				mf::getCopy(var, temp);
 				block = &temp;
 			}
 			boost::numeric::ublas::subrange(target,
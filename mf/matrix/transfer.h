@@ -0,0 +1,117 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Transfer of matrix blocks between tasks and nodes. Dense matrices (mf::DenseMatrix,
+ * mf::DenseMatrixCM and their float variants) are transferred as raw buffers: their
+ * dimensions are sent first, then their data array is sent as is and received directly into
+ * the target matrix. This avoids building (and copying into) a serialization archive on both
+ * ends. All other matrix types are transferred using serialization.
+ */
+
+#ifndef MF_MATRIX_TRANSFER_H
+#define MF_MATRIX_TRANSFER_H
+
+#include <string>
+
+#include <boost/mpi/request.hpp>
+
+#include <mpi2/mpi2.h>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** Copies the matrix referenced by a remote variable into m (like mpi2::RemoteVar::getCopy).
+ * Dense matrices are received directly into m; m is resized only if its dimensions differ.
+ */
+template<typename M>
+void getCopy(mpi2::RemoteVar var, M& m);
+
+/** Asynchronous version of mf::getCopy (like mpi2::RemoteVar::igetCopy). For dense matrices,
+ * the dimensions are fetched (and m resized) before this method returns; only the transfer
+ * of the data is asynchronous. Use the overload below when the dimensions are known. m must
+ * not be accessed until the request has completed.
+ */
+template<typename M>
+boost::mpi::request igetCopy(mpi2::RemoteVar var, M& m);
+
+/** Asynchronous version of mf::getCopy for a matrix of known dimensions (e.g., a block of a
+ * mf::DistributedMatrix). Dense matrices are resized to size1 x size2 right away and only the
+ * receive of the data is posted, i.e., this method does not wait for the remote side. The
+ * remote matrix must have the given dimensions. m must not be accessed until the request has
+ * completed.
+ */
+template<typename M>
+boost::mpi::request igetCopy(mpi2::RemoteVar var, M& m, mf_size_type size1, mf_size_type size2);
+
+/** Stores a copy of m in the matrix referenced by a remote variable (like
+ * mpi2::RemoteVar::setCopy). Dense matrices are received directly into the target matrix. */
+template<typename M>
+void setCopy(mpi2::RemoteVar var, const M& m);
+
+/** Asynchronous version of mf::setCopy (like mpi2::RemoteVar::isetCopy). The request
+ * completes once the data has been stored; m must not be modified before. */
+template<typename M>
+boost::mpi::request isetCopy(mpi2::RemoteVar var, const M& m);
+
+/** Sends the data array of a dense matrix over a channel (without dimensions; see
+ * mf::irecvDense). m must not be modified until the request has completed. */
+template<typename T, typename L>
+boost::mpi::request isendDense(mpi2::Channel ch,
+		const boost::numeric::ublas::matrix<T, L>& m);
+
+/** Receives the data array of a dense matrix sent with mf::isendDense directly into m. m must
+ * have the dimensions of the matrix being sent (receiving a larger matrix fails). */
+template<typename T, typename L>
+boost::mpi::request irecvDense(mpi2::Channel ch,
+		boost::numeric::ublas::matrix<T, L>& m);
+
+/** Sends columns [begin,end) of a column-major matrix, which are contiguous in its data
+ * array, without copying them (see mf::irecvDenseColumns). */
+template<typename T>
+boost::mpi::request isendDenseColumns(mpi2::Channel ch,
+		const boost::numeric::ublas::matrix<T, boost::numeric::ublas::column_major>& m,
+		mf_size_type begin, mf_size_type end);
+
+/** Receives columns [begin,end) of a column-major matrix sent with mf::isendDenseColumns
+ * directly into m. */
+template<typename T>
+boost::mpi::request irecvDenseColumns(mpi2::Channel ch,
+		boost::numeric::ublas::matrix<T, boost::numeric::ublas::column_major>& m,
+		mf_size_type begin, mf_size_type end);
+
+namespace detail {
+	/** Sends a dense matrix stored in the environment to the task that spawned this task (see
+	 * mf::getCopy). The dimensions are sent first unless the receiver already knows them. */
+	template<typename M>
+	struct GetDenseTask {
+		static const std::string id() { return std::string("__mf/matrix/GetDenseTask_") + mpi2::TypeTraits<M>::name(); }
+		static void run(mpi2::Channel ch, mpi2::TaskInfo info);
+	};
+
+	/** Receives a dense matrix from the task that spawned this task and stores it in the
+	 * environment (see mf::setCopy) */
+	template<typename M>
+	struct SetDenseTask {
+		static const std::string id() { return std::string("__mf/matrix/SetDenseTask_") + mpi2::TypeTraits<M>::name(); }
+		static void run(mpi2::Channel ch, mpi2::TaskInfo info);
+	};
+}
+
+}
+
+#include <mf/matrix/transfer_impl.h>
+
+#endif
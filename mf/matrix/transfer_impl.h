@@ -0,0 +1,206 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+#include <limits>
+
+#include <util/exception.h>
+
+#include <mf/matrix/transfer.h> // IDE hint
+
+namespace mf {
+
+namespace detail {
+	/** Number of entries as an MPI count */
+	inline int rawSize(mf_size_type n) {
+		if (n > (mf_size_type)std::numeric_limits<int>::max()) {
+			RG_THROW(rg::InvalidArgumentException, "Matrix too large for a raw transfer");
+		}
+		return (int)n;
+	}
+
+	/** Number of entries of a dense matrix as an MPI count */
+	template<typename T, typename L>
+	inline int rawSize(const boost::numeric::ublas::matrix<T, L>& m) {
+		return rawSize((mf_size_type)m.data().size());
+	}
+
+	/** Dimension sent to mf::detail::GetDenseTask when the receiver does not know the
+	 * dimensions of the matrix */
+	inline mf_size_type unknownSize() {
+		return std::numeric_limits<mf_size_type>::max();
+	}
+
+	/** Resizes a dense matrix if (and only if) its dimensions differ from the given ones */
+	template<typename T, typename L>
+	inline void resizeDense(boost::numeric::ublas::matrix<T, L>& m,
+			mf_size_type size1, mf_size_type size2) {
+		if (m.size1() != size1 || m.size2() != size2) {
+			m.resize(size1, size2, false);
+		}
+	}
+
+	/** Transfers remote variables using the methods of mpi2::RemoteVar (serialization) */
+	template<typename M>
+	struct Transfer {
+		static void get(mpi2::RemoteVar& var, M& m) {
+			var.getCopy(m);
+		}
+		static boost::mpi::request iget(mpi2::RemoteVar& var, M& m) {
+			return var.igetCopy<M>(m);
+		}
+		static boost::mpi::request iget(mpi2::RemoteVar& var, M& m,
+				mf_size_type size1, mf_size_type size2) {
+			return var.igetCopy<M>(m);
+		}
+		static void set(mpi2::RemoteVar& var, const M& m) {
+			var.setCopy(m);
+		}
+		static boost::mpi::request iset(mpi2::RemoteVar& var, const M& m) {
+			return var.isetCopy(m);
+		}
+	};
+
+	/** Transfers dense matrices as raw buffers */
+	template<typename T, typename L>
+	struct Transfer<boost::numeric::ublas::matrix<T, L> > {
+		typedef boost::numeric::ublas::matrix<T, L> M;
+
+		static void get(mpi2::RemoteVar& var, M& m) {
+			if (var.isLocal()) {
+				m = *var.getLocal<M>();
+			} else {
+				iget(var, m).wait();
+			}
+		}
+		static boost::mpi::request iget(mpi2::RemoteVar& var, M& m) {
+			mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+			mpi2::Channel ch = tm.spawn<GetDenseTask<M> >(var.rank());
+			ch.send(var.var());
+			mf_size_type header[2] = { unknownSize(), unknownSize() };
+			ch.send(header, 2);
+			ch.recv(header, 2);
+			resizeDense(m, header[0], header[1]);
+			return ch.irecv(m.data().begin(), rawSize(m));
+		}
+		static boost::mpi::request iget(mpi2::RemoteVar& var, M& m,
+				mf_size_type size1, mf_size_type size2) {
+			mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+			mpi2::Channel ch = tm.spawn<GetDenseTask<M> >(var.rank());
+			ch.send(var.var());
+			mf_size_type header[2] = { size1, size2 };
+			ch.send(header, 2);
+			resizeDense(m, size1, size2);
+			return ch.irecv(m.data().begin(), rawSize(m));
+		}
+		static void set(mpi2::RemoteVar& var, const M& m) {
+			if (var.isLocal()) {
+				*var.getLocal<M>() = m;
+			} else {
+				iset(var, m).wait();
+			}
+		}
+		static boost::mpi::request iset(mpi2::RemoteVar& var, const M& m) {
+			mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+			mpi2::Channel ch = tm.spawn<SetDenseTask<M> >(var.rank());
+			ch.send(var.var());
+			mf_size_type header[2] = { m.size1(), m.size2() };
+			ch.send(header, 2);
+			boost::mpi::request req = ch.isend(m.data().begin(), rawSize(m));
+			tm.finalizeRequest(req); // completed before the acknowledgment arrives
+			return ch.irecv();
+		}
+	};
+
+	template<typename M>
+	void GetDenseTask<M>::run(mpi2::Channel ch, mpi2::TaskInfo info) {
+		std::string name;
+		ch.recv(name);
+		mf_size_type header[2];
+		ch.recv(header, 2);
+		const M& m = *mpi2::env().get<M>(name);
+		if (header[0] == unknownSize()) {
+			header[0] = m.size1();
+			header[1] = m.size2();
+			ch.send(header, 2);
+		} else if (header[0] != m.size1() || header[1] != m.size2()) {
+			RG_THROW(rg::InvalidArgumentException, "Dimensions of dense matrix " + name
+					+ " differ from the requested ones");
+		}
+		ch.send(m.data().begin(), rawSize(m));
+	}
+
+	template<typename M>
+	void SetDenseTask<M>::run(mpi2::Channel ch, mpi2::TaskInfo info) {
+		std::string name;
+		ch.recv(name);
+		mf_size_type header[2];
+		ch.recv(header, 2);
+		M& m = *mpi2::env().get<M>(name);
+		resizeDense(m, header[0], header[1]);
+		ch.recv(m.data().begin(), rawSize(m));
+		ch.send();
+	}
+}
+
+template<typename M>
+void getCopy(mpi2::RemoteVar var, M& m) {
+	detail::Transfer<M>::get(var, m);
+}
+
+template<typename M>
+boost::mpi::request igetCopy(mpi2::RemoteVar var, M& m) {
+	return detail::Transfer<M>::iget(var, m);
+}
+
+template<typename M>
+boost::mpi::request igetCopy(mpi2::RemoteVar var, M& m, mf_size_type size1, mf_size_type size2) {
+	return detail::Transfer<M>::iget(var, m, size1, size2);
+}
+
+template<typename M>
+void setCopy(mpi2::RemoteVar var, const M& m) {
+	detail::Transfer<M>::set(var, m);
+}
+
+template<typename M>
+boost::mpi::request isetCopy(mpi2::RemoteVar var, const M& m) {
+	return detail::Transfer<M>::iset(var, m);
+}
+
+template<typename T, typename L>
+boost::mpi::request isendDense(mpi2::Channel ch,
+		const boost::numeric::ublas::matrix<T, L>& m) {
+	return ch.isend(m.data().begin(), detail::rawSize(m));
+}
+
+template<typename T, typename L>
+boost::mpi::request irecvDense(mpi2::Channel ch,
+		boost::numeric::ublas::matrix<T, L>& m) {
+	return ch.irecv(m.data().begin(), detail::rawSize(m));
+}
+
+template<typename T>
+boost::mpi::request isendDenseColumns(mpi2::Channel ch,
+		const boost::numeric::ublas::matrix<T, boost::numeric::ublas::column_major>& m,
+		mf_size_type begin, mf_size_type end) {
+	return ch.isend(m.data().begin() + begin*m.size1(), detail::rawSize((end-begin)*m.size1()));
+}
+
+template<typename T>
+boost::mpi::request irecvDenseColumns(mpi2::Channel ch,
+		boost::numeric::ublas::matrix<T, boost::numeric::ublas::column_major>& m,
+		mf_size_type begin, mf_size_type end) {
+	return ch.irecv(m.data().begin() + begin*m.size1(), detail::rawSize((end-begin)*m.size1()));
+}
+
+}
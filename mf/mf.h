@@ -21,11 +21,13 @@
 #include <mf/types.h>
 
 #include <mf/init.h>
+#include <mf/numa.h>
 
 #include <mf/lapack/lapack_wrapper.h>
 
 #include <mf/matrix/coordinate.h>
 #include <mf/matrix/distributed_matrix.h>
+#include <mf/matrix/transfer.h>
 #include <mf/matrix/distribute.h>
 #include <mf/ap/aptask.h>
 #include <mf/ap/apupdate.h>
@@ -40,6 +42,7 @@
 #include <mf/matrix/op/scale.h>
 #include <mf/matrix/op/project.h>
 #include <mf/matrix/op/shuffle.h>
+#include <mf/matrix/op/relabel.h>
 
 #include <mf/matrix/io/format.h>
 #include <mf/matrix/io/read.h>
@@ -58,6 +61,7 @@
 
 #include <mf/loss/loss.h>
 #include <mf/loss/nzsl.h>
+#include <mf/loss/nzsl-sample.h>
 #include <mf/loss/nzrmse.h>
 #include <mf/loss/l1.h>
 #include <mf/loss/l2.h>
@@ -86,6 +90,7 @@
 #include <mf/sgd/decay/decay_constant.h>
 
 #include <mf/sgd/functions/functions.h>
+#include <mf/sgd/functions/kernels.h>
 #include <mf/sgd/functions/regularize-none.h>
 #include <mf/sgd/functions/regularize-l1.h>
 #include <mf/sgd/functions/regularize-l2.h>
@@ -108,6 +113,12 @@
 #include <mf/sgd/functions/update-maxnorm.h>
 #include <mf/sgd/functions/update-biased-nzsl-nzl2.h>
 
+#include <mf/sgd/online-loss.h>
+#include <mf/sgd/lazy-scale.h>
+#include <mf/sgd/lock-table.h>
+#include <mf/sgd/minibatch.h>
+#include <mf/sgd/delta-codec.h>
+#include <mf/sgd/dirty-columns.h>
 #include <mf/sgd/sgd.h>
 #include <mf/sgd/psgd.h>
 #include <mf/sgd/asgd.h>
@@ -0,0 +1,128 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Placement of tasks and memory on machines with multiple NUMA nodes (sockets). Tasks can
+ * be pinned to cores; memory that is written first by a pinned task (first touch) is then
+ * allocated on the task's node. Memory shared by the tasks of several nodes can be
+ * interleaved across all nodes.
+ *
+ * The topology is read from /sys/devices/system/node; pinning and interleaving are only
+ * supported on Linux and do nothing elsewhere.
+ */
+
+#ifndef MF_NUMA_H
+#define MF_NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** The NUMA nodes of the local machine and their CPUs. Without NUMA information, there is
+ * a single node containing all CPUs. */
+class NumaTopology {
+public:
+	/** Returns the topology of the local machine (read on first use) */
+	static const NumaTopology& get();
+
+	unsigned nodes() const {
+		return cpus_.size();
+	}
+
+	/** Returns the CPUs of the given node (an index in [0,nodes())) */
+	const std::vector<int>& cpus(unsigned node) const {
+		return cpus_[node];
+	}
+
+	/** Returns the operating-system id of the given node */
+	int nodeId(unsigned node) const {
+		return nodeIds_[node];
+	}
+
+	/** Returns the node of the slot-th task of a process. Consecutive slots are spread round
+	 * robin across the nodes so that all memory controllers are used. */
+	unsigned node(unsigned slot) const {
+		return slot % nodes();
+	}
+
+	/** Returns the CPU of the slot-th task of a process */
+	int cpu(unsigned slot) const {
+		const std::vector<int>& c = cpus_[node(slot)];
+		return c[(slot / nodes()) % c.size()];
+	}
+
+private:
+	NumaTopology();
+
+	std::vector<int> nodeIds_;
+	std::vector<std::vector<int> > cpus_;
+};
+
+/** Sets whether the worker tasks of the SGD runners are pinned to cores (default: false).
+ * Only needs to be set at the rank that runs the SGD runner. */
+void setPinTasks(bool pin);
+
+/** Returns true if the worker tasks of the SGD runners should be pinned to cores */
+bool pinTasks();
+
+/** Returns the rank of this process among the MPI processes on the same machine and the
+ * number of these processes, as reported by the MPI launcher (Open MPI, MVAPICH, MPICH/Hydra);
+ * 0 and 1 if unknown. */
+void localRank(unsigned& rank, unsigned& ranks);
+
+/** Pins the calling thread to the CPU of the slot-th task of this process. When several
+ * processes run on the same machine (see localRank()), their slots are interleaved: the
+ * slot-th task of local rank r gets machine-wide slot slot*ranks+r (see NumaTopology::cpu()).
+ * Does nothing if slot is negative. Returns true if the thread has been pinned. */
+bool pinCurrentTask(int slot);
+
+/** Interleaves the pages of the given memory region across all NUMA nodes and moves pages
+ * that have already been allocated. Only whole pages inside the region are affected. Returns
+ * true on success; returns false if there is only one node or interleaving is not supported. */
+bool interleave(void* p, std::size_t bytes);
+
+/** Interleaves the values of a dense matrix across all NUMA nodes (the values are not changed) */
+template<typename M>
+bool interleaveDense(const M& m) {
+	if (m.data().size() == 0) return false;
+	return interleave(const_cast<typename M::value_type*>(&m.data()[0]),
+			m.data().size() * sizeof(typename M::value_type));
+}
+
+/** Interleaves the entries of a sparse matrix across all NUMA nodes (the entries are not changed) */
+template<typename M>
+bool interleaveSparse(const M& m) {
+	typedef typename M::index_array_type::value_type Index;
+	typedef typename M::value_type Value;
+	if (m.nnz() == 0) return false;
+	bool result = interleave(const_cast<Index*>(&m.index1_data()[0]), m.nnz() * sizeof(Index));
+	result &= interleave(const_cast<Index*>(&m.index2_data()[0]), m.nnz() * sizeof(Index));
+	result &= interleave(const_cast<Value*>(&m.value_data()[0]), m.nnz() * sizeof(Value));
+	return result;
+}
+
+/** Reallocates the storage of a matrix from the calling thread. Under the first-touch policy
+ * of the operating system, the new storage is allocated on the NUMA node of the calling
+ * thread; call this from a pinned task that works on the matrix. */
+template<typename M>
+void firstTouch(M& m) {
+	M copy(m);
+	m.swap(copy);
+}
+
+}
+
+#endif
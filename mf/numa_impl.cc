@@ -0,0 +1,185 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+#include <mf/numa.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <mf/logger.h>
+
+namespace mf {
+
+namespace {
+
+/** Parses a Linux list format (e.g., "0-3,8,10-11") */
+std::vector<int> parseList(const std::string& s) {
+	std::vector<int> result;
+	std::stringstream in(s);
+	std::string range;
+	while (std::getline(in, range, ',')) {
+		if (range.empty() || range[0] == '\n') continue;
+		std::string::size_type dash = range.find('-');
+		int first = std::atoi(range.substr(0, dash).c_str());
+		int last = dash == std::string::npos ? first : std::atoi(range.substr(dash+1).c_str());
+		for (int i=first; i<=last; i++) {
+			result.push_back(i);
+		}
+	}
+	return result;
+}
+
+/** Reads the first line of a file (empty if the file does not exist) */
+std::string readLine(const std::string& fileName) {
+	std::ifstream in(fileName.c_str());
+	std::string line;
+	std::getline(in, line);
+	return line;
+}
+
+boost::atomic<bool> pinTasks_(false);
+
+/** Reads a non-negative integer from the first of the given environment variables that is set */
+bool readEnv(const char* const* names, unsigned& value) {
+	for (; *names != NULL; names++) {
+		const char* s = std::getenv(*names);
+		if (s != NULL && *s != 0) {
+			value = std::atoi(s);
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
+NumaTopology::NumaTopology() {
+	std::vector<int> ids = parseList(readLine("/sys/devices/system/node/online"));
+	for (unsigned i=0; i<ids.size(); i++) {
+		std::stringstream fileName;
+		fileName << "/sys/devices/system/node/node" << ids[i] << "/cpulist";
+		std::vector<int> cpus = parseList(readLine(fileName.str()));
+		if (cpus.empty()) continue; // memory-only node
+		nodeIds_.push_back(ids[i]);
+		cpus_.push_back(cpus);
+	}
+
+	if (cpus_.empty()) {
+		// no NUMA information: a single node with all CPUs
+		unsigned n = boost::thread::hardware_concurrency();
+		if (n == 0) n = 1;
+		std::vector<int> cpus;
+		for (unsigned i=0; i<n; i++) {
+			cpus.push_back(i);
+		}
+		nodeIds_.push_back(0);
+		cpus_.push_back(cpus);
+	}
+	LOG4CXX_DEBUG(detail::logger, "NUMA topology: " << nodes() << " node(s)");
+}
+
+const NumaTopology& NumaTopology::get() {
+	static NumaTopology topology;
+	return topology;
+}
+
+void setPinTasks(bool pin) {
+	pinTasks_.store(pin);
+}
+
+bool pinTasks() {
+	return pinTasks_.load();
+}
+
+void localRank(unsigned& rank, unsigned& ranks) {
+	static const char* const RANK[] = { "OMPI_COMM_WORLD_LOCAL_RANK", "MV2_COMM_WORLD_LOCAL_RANK",
+			"MPI_LOCALRANKID", NULL };
+	static const char* const RANKS[] = { "OMPI_COMM_WORLD_LOCAL_SIZE", "MV2_COMM_WORLD_LOCAL_SIZE",
+			"MPI_LOCALNRANKS", NULL };
+	if (!readEnv(RANK, rank) || !readEnv(RANKS, ranks) || ranks == 0 || rank >= ranks) {
+		rank = 0;
+		ranks = 1;
+	}
+}
+
+bool pinCurrentTask(int slot) {
+	if (slot < 0) return false;
+#ifdef __linux__
+	unsigned rank, ranks;
+	localRank(rank, ranks);
+	slot = slot*ranks + rank; // slot on this machine
+	const NumaTopology& topology = NumaTopology::get();
+	int cpu = topology.cpu(slot);
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		LOG4CXX_WARN(detail::logger, "Could not pin task " << slot << " to CPU " << cpu);
+		return false;
+	}
+	LOG4CXX_DEBUG(detail::logger, "Pinned task " << slot << " to CPU " << cpu
+			<< " (node " << topology.nodeId(topology.node(slot)) << ")");
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool interleave(void* p, std::size_t bytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+	const NumaTopology& topology = NumaTopology::get();
+	if (topology.nodes() <= 1) return false;
+
+	// whole pages only
+	const std::size_t page = sysconf(_SC_PAGESIZE);
+	std::size_t begin = (reinterpret_cast<std::size_t>(p) + page - 1) / page * page;
+	std::size_t end = (reinterpret_cast<std::size_t>(p) + bytes) / page * page;
+	if (end <= begin) return false;
+
+	// mask of all nodes (the kernel reads maxnode-1 bits)
+	const std::size_t bits = 8*sizeof(unsigned long);
+	int maxId = 0;
+	for (unsigned i=0; i<topology.nodes(); i++) {
+		if (topology.nodeId(i) > maxId) maxId = topology.nodeId(i);
+	}
+	std::vector<unsigned long> mask(maxId / bits + 2, 0);
+	for (unsigned i=0; i<topology.nodes(); i++) {
+		mask[topology.nodeId(i) / bits] |= 1ul << (topology.nodeId(i) % bits);
+	}
+
+	const int MPOL_INTERLEAVE_ = 3;
+	const unsigned MPOL_MF_MOVE_ = 1u << 1;
+	if (syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE_, &mask[0],
+			mask.size() * bits, MPOL_MF_MOVE_) != 0) {
+		LOG4CXX_DEBUG(detail::logger, "Could not interleave " << (end - begin) << " bytes");
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+}
@@ -42,11 +42,51 @@ template<>
 void registerSparseMatrixTasksFor<Nil>() {
 };
 
+template<typename Types>
+void registerCompactSparseMatrixTasksFor() {
+	typedef typename Types::Head M;
+	registerTask<CreateMatrixTask<M> >();
+	registerTask<BlockAndLoadMatrixTask<M> >();
+	registerTask<ReadDistributedMatrixTask<M> >();
+	registerTask<NnzTask<M> >();
+	registerTask<Nnz12Task<M> >();
+	registerTask<NzslTask<M, DenseMatrix, DenseMatrixCM> >();
+	registerTask<typename NzslApTaskWThreadsFor<M>::Task>();
+	registerTask<AsgdInitTask<M> >();
+	registerTask<GenerateRandomDataMatrixTask<M> >();
+
+	registerCompactSparseMatrixTasksFor<typename Types::Tail>();
+};
+
+template<>
+void registerCompactSparseMatrixTasksFor<Nil>() {
+};
+
+/** Registers the DSGD, DSGD++ and ASGD tasks for the given data, factor and index types with
+ * update function U (plain and truncated, as used by the tools) */
+template<typename U, typename Data, typename Factor, typename Index>
+void registerSgdTasksFor() {
+	typedef DsgdFactorizationData<Data,Factor,Index> DsgdData;
+	typedef DsgdPpFactorizationData<Data,Factor,Index> DsgdPpData;
+	typedef AsgdFactorizationData<Data,Factor,Index> AsgdData;
+	registerTask<DsgdTask<U,RegularizeNone,DsgdData> >();
+	registerTask<DsgdTask<UpdateTruncate<U>,RegularizeNone,DsgdData> >();
+	registerTask<DsgdTask<UpdateTruncate<U>,RegularizeNoneTruncate,DsgdData> >();
+	registerTask<DsgdPpTask<U,RegularizeNone,DsgdPpData> >();
+	registerTask<DsgdPpTask<UpdateTruncate<U>,RegularizeNone,DsgdPpData> >();
+	registerTask<DsgdPpTask<UpdateTruncate<U>,RegularizeNoneTruncate,DsgdPpData> >();
+	registerTask<AsgdTask<U,RegularizeNone,AsgdData> >();
+	registerTask<AsgdTask<UpdateTruncate<U>,RegularizeNone,AsgdData> >();
+	registerTask<AsgdTask<UpdateTruncate<U>,RegularizeNoneTruncate,AsgdData> >();
+}
+
 template<typename Types>
 void registerDenseMatrixTasksFor() {
 	registerTask<ProjectTask<typename Types::Head> >();
 	registerTask<MultTask<typename Types::Head> >();
 	registerTask<DivTask<typename Types::Head> >();
+	registerTask<GetDenseTask<typename Types::Head> >();
+	registerTask<SetDenseTask<typename Types::Head> >();
 
 	registerDenseMatrixTasksFor<typename Types::Tail>();
 };
@@ -58,8 +98,13 @@ void registerDenseMatrixTasksFor<Nil>() {
 void registerMatrixTasks() {
 	registerMatrixTasksFor<MatrixTypes>();
 	registerSparseMatrixTasksFor<SparseMatrixTypes>();
+	registerCompactSparseMatrixTasksFor<CompactSparseMatrixTypes>();
 	registerDenseMatrixTasksFor<DenseMatrixTypes>();
+	registerMatrixTasksFor<FloatDenseMatrixTypes>();
+	registerDenseMatrixTasksFor<FloatDenseMatrixTypes>();
 	registerTask<NzslTask<SparseMatrix, DenseMatrix, DenseMatrixCM> >();
+	registerTask<NzslSampleTask>();
+	registerTask<NzslSampleStatsTask>();
 	registerTask<SlDataTask<SparseMatrix, DenseMatrix, DenseMatrixCM> >();
 	registerTask<KlTask<SparseMatrix, DenseMatrix, DenseMatrixCM> >();
 	registerTask<GklDataTask<SparseMatrix, DenseMatrix, DenseMatrixCM> >();
@@ -70,25 +115,44 @@ void registerMatrixTasks() {
 	registerTask<Div1Task<DenseMatrixCM, boost::numeric::ublas::vector<double> > >();
 	registerTask<Mult1Task<DenseMatrixCM, boost::numeric::ublas::vector<double> > >();
 	registerTask<Mult2Task<DenseMatrix, boost::numeric::ublas::vector<double> > >();
+	registerTask<NzslTask<SparseMatrix, DenseMatrixF, DenseMatrixFCM> >();
+	registerTask<Sums1Task<DenseMatrixFCM> >();
+	registerTask<Sums2Task<DenseMatrixF> >();
+	registerTask<SquaredSums1Task<DenseMatrixFCM> >();
+	registerTask<SquaredSums2Task<DenseMatrixF> >();
+	registerTask<Mult1Task<DenseMatrixFCM, boost::numeric::ublas::vector<double> > >();
+	registerTask<Mult2Task<DenseMatrixF, boost::numeric::ublas::vector<double> > >();
 	registerTask<GklApTaskW>();
 	registerTask<NzslApTaskWThreads>();
+	registerTask<NzslApTaskWThreadsFor<SparseMatrix, DenseMatrixF, DenseMatrixFCM>::Task>();
 	registerTask<SlDataApTaskW>();
  	dlee01GklRegisterTasks();
 	dalsRegisterTasks();
  	dgnmfRegisterTasks();
 	registerTask<Nnz12Task<SparseMatrix> >();
 	registerTask<Nzl2LossTask>();
-	mpi2::registerTask<mf::detail::AsgdInitTask>();
-	mpi2::registerTask<mf::detail::AsgdShuffleTask>();
-	mpi2::registerTask<mf::detail::AsgdDestroyTask>();
+	registerTask<Nzl2LossTaskFor<DenseMatrixF, DenseMatrixFCM> >();
+	mpi2::registerTask<mf::detail::AsgdInitTask<SparseMatrix> >();
+	mpi2::registerTask<mf::detail::AsgdShuffleTask<> >();
+	mpi2::registerTask<mf::detail::AsgdPsTask<> >();
+	mpi2::registerTask<mf::detail::AsgdDestroyTask<> >();
+	mpi2::registerTask<mf::detail::AsgdBalanceTask<> >();
+	mpi2::registerTask<mf::detail::AsgdInitTask<SparseMatrix, DenseMatrixFCM> >();
+	mpi2::registerTask<mf::detail::AsgdShuffleTask<DenseMatrixFCM> >();
+	mpi2::registerTask<mf::detail::AsgdPsTask<DenseMatrixFCM> >();
+	mpi2::registerTask<mf::detail::AsgdDestroyTask<DenseMatrixFCM> >();
+	mpi2::registerTask<mf::detail::AsgdBalanceTask<DenseMatrixF, DenseMatrixFCM> >();
 
 	registerTask<mf::detail::GenerateRandomFactorsTask<DenseMatrix> >();
 	registerTask<mf::detail::GenerateRandomFactorsTask<DenseMatrixCM> >();
+	registerTask<mf::detail::GenerateRandomFactorsTask<DenseMatrixF> >();
+	registerTask<mf::detail::GenerateRandomFactorsTask<DenseMatrixFCM> >();
 	registerTask<mf::detail::GenerateRandomDataMatrixTask<SparseMatrix> >();
 	registerTask<mf::detail::GenerateRandomDataMatrixTask<SparseMatrixCM> >();
 
 	// added by me
 	registerTask<Nzl2SquaredSumsTask>();
+	registerTask<Nzl2SquaredSumsTaskFor<DenseMatrixF, DenseMatrixFCM> >();
 
 	// ASGD tasks (TODO: generate automatically)
 	registerTask<mf::detail::AsgdTask<UpdateNzsl,RegularizeNone> >();
@@ -105,6 +169,16 @@ void registerMatrixTasks() {
 	registerTask<mf::detail::DsgdPpTask<UpdateNzslNzl2,RegularizeNone> >();
 	registerTask<mf::detail::DsgdPpTask<UpdateTruncate<UpdateNzslNzl2>,RegularizeNoneTruncate> >();
 
+	// DSGD, DSGD++ and ASGD tasks for compact data blocks (NZSL losses only)
+	registerSgdTasksFor<UpdateNzsl,float,double,boost::uint32_t>();
+	registerSgdTasksFor<UpdateNzslL2,float,double,boost::uint32_t>();
+	registerSgdTasksFor<UpdateNzslNzl2,float,double,boost::uint32_t>();
+
+	// DSGD, DSGD++ and ASGD tasks for single-precision factors (NZSL losses only)
+	registerSgdTasksFor<UpdateNzsl,double,float,mf_size_type>();
+	registerSgdTasksFor<UpdateNzslL2,double,float,mf_size_type>();
+	registerSgdTasksFor<UpdateNzslNzl2,double,float,mf_size_type>();
+
 	registerTask<BiasedNzslTask<SparseMatrix, DenseMatrix, DenseMatrixCM> >();
 	registerTask<BiasedNzl2FactorsTask>();
 	registerTask<BiasedNzl2BiasTask>();
@@ -44,16 +44,17 @@ bool checkBlockingAsgd(const DistributedMatrix<M1>& v, const DistributedMatrix<M
  * (6) each rank holds exactly 1 blocks of H.
  * (7) hWorkName is a variable name that refers to an unblocked version of H stored at all ranks
  */
-template<typename Data = double, typename Factor = double>
-struct AsgdFactorizationData : public DistributedFactorizationData<Data,Factor> {
+template<typename Data = double, typename Factor = double, typename Index = mf_size_type>
+struct AsgdFactorizationData : public DistributedFactorizationData<Data,Factor,Index> {
 public:
-	typedef DistributedFactorizationData<Data,Factor> Base;
+	typedef DistributedFactorizationData<Data,Factor,Index> Base;
 	typedef typename Base::V V;
 	typedef typename Base::W W;
 	typedef typename Base::H H;
 	typedef typename Base::DV DV;
 	typedef typename Base::DW DW;
 	typedef typename Base::DH DH;
+	typedef typename Base::Local Local;
 
 	AsgdFactorizationData(
 			const DV& dv,
@@ -65,7 +66,7 @@ public:
 		hWorkName = "asgd_h_work";
 	}
 
-	AsgdFactorizationData(DsgdFactorizationData<Data,Factor>& o)
+	AsgdFactorizationData(DsgdFactorizationData<Data,Factor,Index>& o)
 	: Base(o), hWorkName(o.hUnblockedName) {
 	}
 
@@ -86,6 +87,6 @@ private:
 
 }
 
-MPI2_SERIALIZATION_CONSTRUCTOR2(mf::AsgdFactorizationData);
+MF_SERIALIZATION_CONSTRUCTOR3(mf::AsgdFactorizationData);
 
 #endif
@@ -22,50 +22,81 @@
 
 #include <mf/sgd/sgd.h>
 #include <mf/sgd/dsgd.h>
+#include <mf/sgd/psgd.h>
+#include <mf/sgd/delta-codec.h>
 #include <mf/sgd/asgd-factorization.h>
 
 namespace mf {
 
+/** How the local copies of H are synchronized during ASGD */
+enum AsgdSync {
+	/** All ranks repeatedly shuffle their deltas in bulk-synchronous rounds */
+	ASGD_SYNC_SHUFFLE,
 
-template<typename Update, typename Regularize>
-struct AsgdJob : public AsgdFactorizationData<>, public Dsgd<Update,Regularize> {
-	AsgdJob(const DistributedSparseMatrix& dv,
-			DistributedDenseMatrix &dw, DistributedDenseMatrixCM& dh,
+	/** Parameter server: each rank owns a range of columns of H; ranks push their deltas and
+	 * pull fresh columns asynchronously. A rank may run at most AsgdJob::staleness rounds
+	 * ahead of the slowest rank (stale synchronous parallel). */
+	ASGD_SYNC_PS
+};
+
+/** Describes an ASGD job.
+ *
+ * @tparam Update type of update function (model of UpdateConcept)
+ * @tparam Regularize type of regularize function (model of RegularizeConcept)
+ * @tparam FD type of data description (see mf::DsgdJob)
+ */
+template<typename Update, typename Regularize, typename FD = AsgdFactorizationData<> >
+struct AsgdJob : public FD, public Dsgd<Update,Regularize> {
+	AsgdJob(const typename FD::DV& dv,
+			typename FD::DW &dw, typename FD::DH& dh,
 			Update update, Regularize regularize,
 			SgdOrder order = STRATUM_ORDER_WOR, StratumOrder stratumOrder = STRATUM_ORDER_WOR,
 			unsigned tasksPerRank=1, bool averageDeltas = false)
-	: AsgdFactorizationData<>(dv, dw, dh, tasksPerRank),
+	: FD(dv, dw, dh, tasksPerRank),
 	  Dsgd<Update,Regularize>(update, regularize, order, stratumOrder),
-	  averageDeltas(averageDeltas) {
+	  averageDeltas(averageDeltas), sync(ASGD_SYNC_SHUFFLE), staleness(3) {
 	}
 
-	AsgdJob(AsgdFactorizationData<> job,
+	AsgdJob(FD job,
 			Update update, Regularize regularize, SgdOrder order = STRATUM_ORDER_WR,
 			bool averageDeltas = false)
-	: AsgdFactorizationData<>(job),
+	: FD(job),
 	  Dsgd<Update,Regularize>(update, regularize, order),
-	  averageDeltas(averageDeltas) {
+	  averageDeltas(averageDeltas), sync(ASGD_SYNC_SHUFFLE), staleness(3) {
 	}
 
 	AsgdJob(mpi2::SerializationConstructor _)
-	: AsgdFactorizationData<>(mpi2::UNINITIALIZED), Dsgd<Update,Regularize>(mpi2::UNINITIALIZED) {
+	: FD(mpi2::UNINITIALIZED), Dsgd<Update,Regularize>(mpi2::UNINITIALIZED) {
 	}
 
 	bool averageDeltas;
 
+	/** Compression of the deltas exchanged during synchronization (default: none) */
+	DeltaCodec codec;
+
+	/** How the local copies of H are synchronized (default: shuffles) */
+	AsgdSync sync;
+
+	/** Maximum staleness for ASGD_SYNC_PS: the rounds of the slowest rank that may be missing
+	 * from the columns pulled by a rank (at least 1; 1 means lock step; 0 means unbounded) */
+	unsigned staleness;
+
 private:
 	friend class boost::serialization::access;
 	template<class Archive>
 	void serialize(Archive & ar, const unsigned int version) {
-		ar & boost::serialization::base_object<AsgdFactorizationData<>  >(*this);
+		ar & boost::serialization::base_object<FD>(*this);
 		ar & boost::serialization::base_object<Dsgd<Update, Regularize> >(*this);
 		ar & averageDeltas;
+		ar & codec;
+		ar & sync;
+		ar & staleness;
 	}
 };
 
 }
 
-MPI2_SERIALIZATION_CONSTRUCTOR2(mf::AsgdJob);
+MF_SERIALIZATION_CONSTRUCTOR3(mf::AsgdJob);
 
 namespace mf {
 
@@ -90,10 +121,10 @@ public:
  	 * @tparam Loss type of loss function (model of DistributedLossConcept)
  	 * @tparam AdaptiveDecay type of decay function (model of DistributedAdaptiveDecayConcept)
 	 */
-	template<typename Update, typename Regularize, typename DistributedLoss,
+	template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 		typename DistributedAdaptiveDecay,
 		typename TestData, typename TestLoss>
-	void run(AsgdJob<Update, Regularize>& job,
+	void run(AsgdJob<Update, Regularize, FD>& job,
 			DistributedLoss& loss,
 			mf_size_type epochs,
 			DistributedAdaptiveDecay& decay,
@@ -101,18 +132,22 @@ public:
 			BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE,
 			TestData* testData = NULL, TestLoss *testLoss = NULL);
 
-	template<typename Update, typename Regularize, typename DistributedLoss,
+	template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 		typename DistributedAdaptiveDecay>
-	void run(AsgdJob<Update, Regularize>& job, DistributedLoss& loss,
+	void run(AsgdJob<Update, Regularize, FD>& job, DistributedLoss& loss,
 			mf_size_type epochs, DistributedAdaptiveDecay& decay,
 			Trace& trace, BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE);
 
 
 private:
-	template<typename Update, typename Regularize>
-	void epoch(AsgdJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void epoch(AsgdJob<Update, Regularize, FD>& job, double eps);
+
+	template<typename Update, typename Regularize, typename FD>
+	void epochPs(AsgdJob<Update, Regularize, FD>& job, double eps);
 
 	rg::Random32& random_;
+	std::vector<mf_size_type> staleness_; // number of rounds per staleness (ASGD_SYNC_PS)
 };
 
 }
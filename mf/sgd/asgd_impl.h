@@ -17,26 +17,60 @@
  */
 
 #include <algorithm>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <sstream>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <mf/sgd/asgd.h> // help for compilers
 
 #include <mf/matrix/op/shuffle.h>
+#include <mf/sgd/delta-codec.h>
+#include <mf/sgd/dirty-columns.h>
+#include <mf/sgd/lock-table.h>
+#include <mf/sgd/functions/update-lock.h>
 
 namespace mf {
 
 namespace detail {
+	/** State of the shuffle tasks of a rank. The scratch matrices hold r x n column-major values
+	 * and are zero outside of shuffles. */
+	struct AsgdShuffleState {
+		AsgdShuffleState(mf_size_type r, mf_size_type n)
+		: dirty(new DirtyColumns(n)), masterDirty(n, false), delta(r*n, 0.), decoded(r*n, 0.) {
+		}
+
+		/** Columns of the local copy of H that differ from the cache (shared with AsgdTask) */
+		boost::shared_ptr<DirtyColumns> dirty;
+
+		/** Columns of the local block of the master H that differ from the cache (only used
+		 * by the shuffle task) */
+		std::vector<bool> masterDirty;
+
+		std::vector<double> delta;
+		std::vector<double> decoded;
+	};
+
+	/** Creates the state of ASGD on each rank; M is the type of the blocks of the data matrix, H
+	 * the one of the blocks of H */
+	template<typename M, typename H = DenseMatrixCM>
 	struct AsgdInitTask {
-		static const std::string id() { return std::string("__mf/sgd/AsgdInitTask_"); }
+		static const std::string id() { return std::string("__mf/sgd/AsgdInitTask_")
+			+ mpi2::TypeTraits<M>::name() + "_" + mpi2::TypeTraits<H>::name(); }
 
 		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
-			DistributedSparseMatrix dv(mpi2::UNINITIALIZED);
+			DistributedMatrix<M> dv(mpi2::UNINITIALIZED);
 			ch.recv(dv);
 			unsigned groupId = info.groupId();
 			mpi2::RemoteVar var = dv.block(groupId, 0);
-			const SparseMatrix& localV = *var.getLocal<SparseMatrix>();
-			mpi2::env().create("asgd_locks1", new boost::shared_array<boost::mutex>(new boost::mutex[localV.size1()]));
-			mpi2::env().create("asgd_locks2", new boost::shared_array<boost::mutex>(new boost::mutex[localV.size2()]));
-			mpi2::env().create("asgd_h_cache", new DenseMatrixCM(*mpi2::env().get<DenseMatrixCM>("asgd_h_work"))); // TODO: get name from fact. data
+			const M& localV = *var.template getLocal<M>();
+			mpi2::env().create("asgd_locks", new boost::shared_ptr<LockTable>(new LockTable(localV.size1(), localV.size2())));
+			mpi2::env().create("asgd_h_cache", new H(*mpi2::env().get<H>("asgd_h_work"))); // TODO: get name from fact. data
+			const H& localH = *mpi2::env().get<H>("asgd_h_work");
+			mpi2::env().create("asgd_shuffle_state", new AsgdShuffleState(localH.size1(), localH.size2()));
 			rg::Random32* random = new rg::Random32();
 			mpi2::env().create("asgd_runner_random", random);
 			mpi2::env().create("asgd_runner", new PsgdRunner(*random)); // runner stored in env so that we can reuse permutation vector
@@ -44,21 +78,36 @@ namespace detail {
 		}
 	};
 
+	template<typename H = DenseMatrixCM>
 	struct AsgdDestroyTask {
-		static const std::string id() { return std::string("__mf/sgd/AsgdDestroyTask_"); }
+		static const std::string id() { return std::string("__mf/sgd/AsgdDestroyTask_")
+			+ mpi2::TypeTraits<H>::name(); }
 
 		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
-			mpi2::env().erase<boost::shared_array<boost::mutex> >("asgd_locks1");
-			mpi2::env().erase<boost::shared_array<boost::mutex> >("asgd_locks2");
-			mpi2::env().erase<DenseMatrixCM>("asgd_h_cache");
+			mpi2::env().erase<boost::shared_ptr<LockTable> >("asgd_locks");
+			mpi2::env().erase<H>("asgd_h_cache");
+			mpi2::env().erase<AsgdShuffleState>("asgd_shuffle_state");
 			mpi2::env().erase<PsgdRunner>("asgd_runner");
 			mpi2::env().erase<rg::Random32>("asgd_runner_random");
 			ch.send();
 		}
 	};
 
+	/** Synchronizes the local copies of H with the master H. Here cachedH holds the last
+	 * synchronized version of H, which is identical on all ranks. Each rank sends the deltas
+	 * (localH - cachedH) of its dirty columns to the owners of the respective blocks of the
+	 * master; each owner adds the deltas to its block and sends the changes of the block
+	 * (masterHblock - cachedH) to all ranks. Deltas are sent in a sparse format and may be
+	 * compressed (see mf::DeltaCodec); the parts of the deltas that are not transmitted remain in
+	 * localH and masterHblock, respectively, and are sent in a later shuffle. A full shuffle
+	 * considers all columns; it is needed after the factors have been modified without marking
+	 * columns dirty (e.g., by regularization or balancing). H is the type of the blocks of H; the
+	 * deltas are always computed in double.
+	 */
+	template<typename H = DenseMatrixCM>
 	struct AsgdShuffleTask {
-		static const std::string id() { return std::string("__mf/sgd/AsgdShuffleTask_"); }
+		static const std::string id() { return std::string("__mf/sgd/AsgdShuffleTask_")
+			+ mpi2::TypeTraits<H>::name(); }
 
 		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
 			mpi2::logBeginEvent("shuffle");
@@ -68,44 +117,72 @@ namespace detail {
 			int groupId = info.groupId();
 
 			// get relevant data
-			DenseMatrixCM& localH = *mpi2::env().get<DenseMatrixCM>("asgd_h_work");
-			DenseMatrixCM& cachedH = *mpi2::env().get<DenseMatrixCM>("asgd_h_cache");
-			boost::shared_array<boost::mutex>& locks2 =
-					*mpi2::env().get<boost::shared_array<boost::mutex> >("asgd_locks2");
+			H& localH = *mpi2::env().get<H>("asgd_h_work");
+			H& cachedH = *mpi2::env().get<H>("asgd_h_cache");
+			LockTable& locks = **mpi2::env().get<boost::shared_ptr<LockTable> >("asgd_locks");
+			AsgdShuffleState& state = *mpi2::env().get<AsgdShuffleState>("asgd_shuffle_state");
+			DirtyColumns& dirty = *state.dirty;
 			mf_size_type n = localH.size2();
 			mf_size_type r = localH.size1();
-			DistributedMatrix<DenseMatrixCM> masterH(mpi2::UNINITIALIZED);
+			DistributedMatrix<H> masterH(mpi2::UNINITIALIZED);
 			bool averageDeltas;
-			ch.recv(*mpi2::unmarshal(masterH, averageDeltas));
-			DenseMatrixCM& masterHblock = *masterH.block(0, groupId).getLocal<DenseMatrixCM>();
+			DeltaCodec codec;
+			bool full;
+			ch.recv(*mpi2::unmarshal(masterH, averageDeltas, codec, full));
+			H& masterHblock = *masterH.block(0, groupId).template getLocal<H>();
 			double weight = averageDeltas ? 1./d : 1;
-
-			// compute delta between local and cache; update cache
-			DenseMatrixCM deltaH(localH.size1(), localH.size2());
-			for (mf_size_type j=0; j<n; j++) {
-				boost::mutex::scoped_lock lock2(locks2[j]);
+			std::vector<mf_size_type> splits = mpi2::split(n, d); // TODO: splits need to be chosen conformingly to H (which by default is just this)
+			mf_size_type jbegin = splits[groupId];
+			mf_size_type jend = splits[groupId+1];
+			double* delta = &state.delta[0];
+			double* decoded = &state.decoded[0];
+			mf_size_type bytesSent = 0;
+
+			// compute delta between local and cache for the dirty columns
+			std::vector<boost::uint32_t> columns;
+			if (full) {
+				for (mf_size_type j=0; j<n; j++) columns.push_back(j);
+			} else {
+				dirty.dirtyColumns(0, n, columns);
+			}
+			for (mf_size_type c=0; c<columns.size(); c++) {
+				mf_size_type j = columns[c];
+				SpinLock::scoped_lock lock2(locks.column(j));
+				dirty.clear(j);
 				for (mf_size_type i=0; i<r; i++) {
-					deltaH(i,j) = localH(i,j)-cachedH(i,j);
-					cachedH(i,j) = localH(i,j);
+					delta[j*r+i] = localH(i,j)-cachedH(i,j);
 				}
 			}
 
-			// send the delta to the respective nodes (including myself; could be optimized)
+			// encode and send the deltas to the respective nodes (including myself; could be optimized)
+			std::vector<EncodedDelta> sent(d);
+			std::vector<EncodedDelta> received(d);
 			std::vector<boost::mpi::request> reqs;
-			std::vector<mf_size_type> splits = mpi2::split(n, d); // TODO: splits need to be chosen conformingly to H (which by default is just this)
+			std::vector<boost::uint32_t> candidates;
+			std::vector<boost::uint32_t>::iterator it = columns.begin();
 			for (int i=0; i<d; i++) {
-				mf_size_type begin = splits[i] * r;
-				mf_size_type end = splits[i+1] * r;
-				reqs.push_back( pairwiseChannels[i].isend((double *)&deltaH.data()[begin], end-begin) );
+				candidates.clear();
+				for (; it != columns.end() && *it < splits[i+1]; ++it) {
+					candidates.push_back(*it - splits[i]);
+				}
+				codec.encode(delta + splits[i]*r, r, splits[i+1]-splits[i], sent[i], &candidates);
+				bytesSent += sent[i].bytes();
+				reqs.push_back( pairwiseChannels[i].isend(sent[i]) );
+				reqs.push_back( pairwiseChannels[i].irecv(received[i]) );
 			}
 
-			// receive the delta from all nodes
-			mf_size_type jbegin = splits[groupId];
-			mf_size_type jend = splits[groupId+1];
-			std::vector<DenseMatrixCM> deltas(d);
+			// keep what has been sent; the remainder stays in the local copy
+			std::vector<bool> residual(columns.size(), false);
 			for (int i=0; i<d; i++) {
-				deltas[i].resize(r, jend-jbegin, false);
-				reqs.push_back( pairwiseChannels[i].irecv((double *)&deltas[i].data()[0], (jend-jbegin)*r) );
+				sent[i].addTo(decoded + splits[i]*r);
+				sent[i].addTo(delta + splits[i]*r, -1.);
+			}
+			for (mf_size_type c=0; c<columns.size(); c++) {
+				double* p = delta + columns[c]*r;
+				for (mf_size_type i=0; i<r; i++) {
+					if (p[i] != 0.) residual[c] = true;
+					p[i] = 0.;
+				}
 			}
 
 			// wait until communication finished
@@ -113,65 +190,423 @@ namespace detail {
 
 			// add the deltas to the master
 			for (int i=0; i<d; i++) {
-				boost::numeric::ublas::noalias(masterHblock) += deltas[i] * weight;
+				received[i].addTo(&masterHblock.data()[0], weight);
+				std::vector<boost::uint32_t> masterColumns;
+				received[i].sentColumns(masterColumns, jbegin);
+				for (mf_size_type c=0; c<masterColumns.size(); c++) {
+					state.masterDirty[masterColumns[c]] = true;
+				}
+			}
+
+			// encode the changes of the master; the remainder stays in the master
+			candidates.clear();
+			for (mf_size_type j=jbegin; j<jend; j++) {
+				if (!full && !state.masterDirty[j]) continue;
+				state.masterDirty[j] = false;
+				candidates.push_back(j - jbegin);
+				for (mf_size_type i=0; i<r; i++) {
+					delta[j*r+i] = masterHblock(i,j-jbegin) - cachedH(i,j);
+				}
+			}
+			EncodedDelta encodedMaster;
+			codec.encode(delta + jbegin*r, r, jend-jbegin, encodedMaster, &candidates);
+			bytesSent += d*encodedMaster.bytes();
+			encodedMaster.addTo(delta + jbegin*r, -1.);
+			for (mf_size_type c=0; c<candidates.size(); c++) {
+				mf_size_type j = candidates[c] + jbegin;
+				for (mf_size_type i=0; i<r; i++) {
+					if (delta[j*r+i] != 0.) state.masterDirty[j] = true;
+					delta[j*r+i] = 0.;
+				}
 			}
 
-			// send/recv the master to/from all nodes
+			// send/recv the changes of the master to/from all nodes
 			reqs.clear();
 			for (int i=0; i<d; i++) {
-				mf_size_type begin = splits[i] * r;
-				mf_size_type end = splits[i+1] * r;
-				reqs.push_back( pairwiseChannels[i].isend((double *)&masterHblock.data()[0], (jend-jbegin)*r) );
-				reqs.push_back( pairwiseChannels[i].irecv((double *)&deltaH.data()[begin], end-begin) );
+				reqs.push_back( pairwiseChannels[i].isend(encodedMaster) );
+				reqs.push_back( pairwiseChannels[i].irecv(received[i]) );
 			}
 			mpi2::economicWaitAll(reqs, mpi2::TaskManager::getInstance().pollDelay());
+			std::vector<boost::uint32_t> changed;
+			for (int i=0; i<d; i++) {
+				received[i].addTo(delta + splits[i]*r);
+				received[i].sentColumns(changed, splits[i]);
+			}
 
-			// update work and cached H
-			for (mf_size_type j=0; j<n; j++) {
-				boost::mutex::scoped_lock lock2(locks2[j]);
+			// update work and cached H (for all columns sent or received)
+			std::vector<boost::uint32_t> merged;
+			merged.reserve(columns.size() + changed.size());
+			std::merge(columns.begin(), columns.end(), changed.begin(), changed.end(),
+					std::back_inserter(merged));
+			merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+			std::vector<boost::uint32_t>::const_iterator res = columns.begin();
+			for (mf_size_type c=0; c<merged.size(); c++) {
+				mf_size_type j = merged[c];
+				double* m = delta + j*r;
+				double* s = decoded + j*r;
+				while (res != columns.end() && *res < j) ++res;
+				bool hasResidual = res != columns.end() && *res == j && residual[res - columns.begin()];
+				SpinLock::scoped_lock lock2(locks.column(j));
 				for (mf_size_type i=0; i<r; i++) {
-					double delta = deltaH(i,j) - cachedH(i,j);
-					cachedH(i,j) = deltaH(i,j);
-					localH(i,j) += delta;
+					cachedH(i,j) += m[i];
+					localH(i,j) += m[i] - s[i];
+					m[i] = 0.;
+					s[i] = 0.;
 				}
+				if (hasResidual) dirty.mark(j);
 			}
 
 			ch.send();
 
+			LOG4CXX_DEBUG(detail::logger, "Shuffle sent " << bytesSent << " bytes for " << columns.size()
+					<< " dirty columns (dense: " << 2*r*n*sizeof(typename H::value_type) << " bytes)");
 			mpi2::logEndEvent("shuffle");
 		}
 	};
 
-	template<typename Update, typename Regularize>
+	/** A message of the parameter-server mode (see AsgdPsTask) */
+	struct AsgdPsMessage {
+		enum Type {
+			PUSH,        /**< worker to owner: deltas of a round */
+			PULL,        /**< worker to owner: request for fresh columns only */
+			REPLY,       /**< owner to worker: current values of the columns changed since the last reply */
+			FINAL_PUSH,  /**< worker to owner: all remaining deltas of the epoch */
+			FINAL_REPLY  /**< owner to worker: sent after the final pushes of all workers */
+		};
+
+		AsgdPsMessage(unsigned type = PULL, boost::uint64_t clock = 0) : type(type), clock(clock) {
+		}
+
+		unsigned type;
+		boost::uint64_t clock; // worker: rounds pushed so far; owner: smallest such clock of all workers
+		EncodedDelta values;   // PUSH: deltas; REPLY: current values (DELTA_CODEC_NONE)
+
+	private:
+		friend class boost::serialization::access;
+		template<class Archive>
+		void serialize(Archive & ar, const unsigned int version) {
+			ar & type;
+			ar & clock;
+			ar & values;
+		}
+	};
+
+	/** Synchronizes the local copies of H using a parameter server (ASGD_SYNC_PS). Runs on
+	 * every rank concurrently with AsgdTask and acts both as the owner of the local block of the
+	 * master H and as a worker that synchronizes the local copy of H. A worker repeatedly pushes
+	 * the deltas of its dirty columns (localH - cachedH, possibly compressed) to the owners; each
+	 * owner adds them to its block and replies with the current values of the columns that
+	 * changed since its last reply to this worker. Here cachedH holds the values of the master
+	 * last seen by the worker plus the deltas pushed since. A worker does not push round c+1
+	 * before all workers have pushed round c+1-staleness; while waiting, it pulls fresh
+	 * columns. Once the SGD task of its rank is done, a worker pushes all remaining deltas; the
+	 * owners reply once they have received the final pushes of all workers, so that all local
+	 * copies agree with the master at the end of the epoch. Sends the number of rounds per
+	 * observed staleness (the rounds of the slowest worker missing from a reply) to the runner.
+	 * H is the type of the blocks of H.
+	 */
+	template<typename H = DenseMatrixCM>
+	struct AsgdPsTask {
+		static const std::string id() { return std::string("__mf/sgd/AsgdPsTask_")
+			+ mpi2::TypeTraits<H>::name(); }
+
+		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
+			mpi2::logBeginEvent("sync");
+
+			std::vector<mpi2::Channel>& pairwiseChannels = info.pairwiseChannels();
+			mf_size_type d = pairwiseChannels.size();
+			int groupId = info.groupId();
+			int pollDelay = mpi2::TaskManager::getInstance().pollDelay();
+
+			// get relevant data
+			H& localH = *mpi2::env().get<H>("asgd_h_work");
+			H& cachedH = *mpi2::env().get<H>("asgd_h_cache");
+			LockTable& locks = **mpi2::env().get<boost::shared_ptr<LockTable> >("asgd_locks");
+			AsgdShuffleState& state = *mpi2::env().get<AsgdShuffleState>("asgd_shuffle_state");
+			mf_size_type n = localH.size2();
+			DistributedMatrix<H> masterH(mpi2::UNINITIALIZED);
+			bool averageDeltas;
+			DeltaCodec codec;
+			unsigned staleness;
+			ch.recv(*mpi2::unmarshal(masterH, averageDeltas, codec, staleness));
+			H& masterHblock = *masterH.block(0, groupId).template getLocal<H>();
+			double weight = averageDeltas ? 1./d : 1;
+			std::vector<mf_size_type> splits = mpi2::split(n, d); // TODO: splits need to be chosen conformingly to H (which by default is just this)
+			boost::mpi::request sgdRequest = ch.irecv(); // signals that the SGD task is done
+			bool sgdDone = false;
+
+			// owner state; all columns are sent in the first reply to each worker since the
+			// master may have been changed between epochs
+			std::vector<boost::uint64_t> applied(d, 0);  // clock of the last push of each worker
+			std::vector<boost::uint64_t> replied(d, 0);  // version of the block at the last reply to each worker
+			std::vector<boost::uint64_t> version(masterHblock.size2(), 1); // version of each column
+			boost::uint64_t blockVersion = 1;
+			unsigned finalPushes = 0;
+
+			// worker state
+			boost::uint64_t clock = 0;     // rounds pushed
+			boost::uint64_t minClock = 0;  // smallest clock of all workers (as last reported)
+			boost::uint64_t roundMin = 0;
+			unsigned pending = 0;          // outstanding replies
+			bool pushed = false;           // whether the outstanding replies belong to a push
+			bool finalPushed = false;
+			mf_size_type stalls = 0;
+			std::vector<mf_size_type> histogram;
+
+			// post receives from all ranks; a rank is finished once it sent its final push
+			// and its final reply
+			std::vector<AsgdPsMessage> incoming(d);
+			std::vector<boost::mpi::request> recvReqs(d);
+			std::vector<unsigned> finals(d, 0);
+			unsigned finished = 0;
+			for (int i=0; i<d; i++) {
+				recvReqs[i] = pairwiseChannels[i].irecv(incoming[i]);
+			}
+			std::list<AsgdPsMessage> outgoing; // kept alive until sent
+			std::list<boost::mpi::request> sendReqs;
+
+			while (finished < d || !sendReqs.empty()) {
+				bool idle = true;
+				if (!sgdDone && sgdRequest.test()) {
+					sgdDone = true;
+					idle = false;
+				}
+
+				// handle incoming messages
+				for (int i=0; i<d; i++) {
+					if (finals[i] == 2 || !recvReqs[i].test()) continue;
+					idle = false;
+					AsgdPsMessage& msg = incoming[i];
+					switch (msg.type) {
+					case AsgdPsMessage::PUSH:
+					case AsgdPsMessage::FINAL_PUSH:
+					{
+						msg.values.addTo(&masterHblock.data()[0], weight);
+						std::vector<boost::uint32_t> columns;
+						msg.values.sentColumns(columns);
+						if (!columns.empty()) blockVersion++;
+						for (mf_size_type c=0; c<columns.size(); c++) {
+							version[columns[c]] = blockVersion;
+						}
+						// workers that are done do not hold back the others
+						applied[i] = msg.type == AsgdPsMessage::PUSH
+								? msg.clock : std::numeric_limits<boost::uint64_t>::max();
+						if (msg.type == AsgdPsMessage::PUSH) {
+							reply(pairwiseChannels[i], AsgdPsMessage::REPLY, masterHblock,
+									version, blockVersion, replied[i], applied, outgoing, sendReqs);
+						} else {
+							finals[i]++;
+							if (++finalPushes == d) {
+								for (int q=0; q<d; q++) {
+									reply(pairwiseChannels[q], AsgdPsMessage::FINAL_REPLY, masterHblock,
+											version, blockVersion, replied[q], applied, outgoing, sendReqs);
+								}
+							}
+						}
+						break;
+					}
+					case AsgdPsMessage::PULL:
+						reply(pairwiseChannels[i], AsgdPsMessage::REPLY, masterHblock,
+								version, blockVersion, replied[i], applied, outgoing, sendReqs);
+						break;
+					case AsgdPsMessage::REPLY:
+					case AsgdPsMessage::FINAL_REPLY:
+						apply(msg.values, splits[i], localH, cachedH, locks);
+						if (msg.type == AsgdPsMessage::FINAL_REPLY) {
+							finals[i]++;
+							break;
+						}
+						roundMin = std::min(roundMin, msg.clock);
+						if (--pending == 0) {
+							minClock = roundMin;
+							if (pushed) {
+								mf_size_type s = clock > minClock ? clock - minClock : 0;
+								if (histogram.size() <= s) histogram.resize(s+1, 0);
+								histogram[s]++;
+							}
+						}
+						break;
+					}
+					if (finals[i] == 2) {
+						finished++;
+					} else {
+						recvReqs[i] = pairwiseChannels[i].irecv(incoming[i]);
+					}
+				}
+
+				// start the next round
+				if (pending == 0 && !finalPushed) {
+					idle = false;
+					roundMin = std::numeric_limits<boost::uint64_t>::max();
+					if (sgdDone) {
+						push(pairwiseChannels, AsgdPsMessage::FINAL_PUSH, clock, true, DeltaCodec(),
+								splits, localH, cachedH, locks, state, outgoing, sendReqs);
+						finalPushed = true;
+					} else if (staleness == 0 || clock + 1 <= minClock + staleness) {
+						clock++;
+						push(pairwiseChannels, AsgdPsMessage::PUSH, clock, false, codec,
+								splits, localH, cachedH, locks, state, outgoing, sendReqs);
+						pending = d;
+						pushed = true;
+					} else {
+						for (int i=0; i<d; i++) {
+							outgoing.push_back(AsgdPsMessage(AsgdPsMessage::PULL, clock));
+							sendReqs.push_back( pairwiseChannels[i].isend(outgoing.back()) );
+						}
+						pending = d;
+						pushed = false;
+						stalls++;
+					}
+				}
+
+				// clean up completed sends
+				std::list<AsgdPsMessage>::iterator msgIt = outgoing.begin();
+				for (std::list<boost::mpi::request>::iterator it = sendReqs.begin(); it != sendReqs.end(); ) {
+					if (it->test()) {
+						it = sendReqs.erase(it);
+						msgIt = outgoing.erase(msgIt);
+					} else {
+						++it;
+						++msgIt;
+					}
+				}
+
+				if (idle) boost::this_thread::sleep(boost::posix_time::microseconds(pollDelay));
+			}
+
+			LOG4CXX_DEBUG(detail::logger, "Parameter server: " << clock << " rounds, "
+					<< stalls << " pulls while waiting for slower ranks");
+			ch.send(histogram);
+			mpi2::logEndEvent("sync");
+		}
+
+	private:
+		/** Pushes the deltas of the dirty columns (of all columns if full) to all owners as
+		 * message of the given type. Adds the parts that are sent to cachedH; columns that have
+		 * not been sent completely remain dirty. */
+		static void push(std::vector<mpi2::Channel>& pairwiseChannels, unsigned type,
+				boost::uint64_t clock, bool full, const DeltaCodec& codec,
+				const std::vector<mf_size_type>& splits, H& localH, H& cachedH,
+				LockTable& locks, AsgdShuffleState& state,
+				std::list<AsgdPsMessage>& outgoing, std::list<boost::mpi::request>& sendReqs) {
+			mf_size_type d = pairwiseChannels.size();
+			mf_size_type n = localH.size2();
+			mf_size_type r = localH.size1();
+			DirtyColumns& dirty = *state.dirty;
+			double* delta = &state.delta[0];
+
+			std::vector<boost::uint32_t> columns;
+			if (full) {
+				for (mf_size_type j=0; j<n; j++) columns.push_back(j);
+			} else {
+				dirty.dirtyColumns(0, n, columns);
+			}
+			for (mf_size_type c=0; c<columns.size(); c++) {
+				mf_size_type j = columns[c];
+				SpinLock::scoped_lock lock2(locks.column(j));
+				dirty.clear(j);
+				for (mf_size_type i=0; i<r; i++) {
+					delta[j*r+i] = localH(i,j)-cachedH(i,j);
+				}
+			}
+
+			std::vector<boost::uint32_t> candidates;
+			std::vector<boost::uint32_t>::iterator it = columns.begin();
+			for (int i=0; i<d; i++) {
+				candidates.clear();
+				for (; it != columns.end() && *it < splits[i+1]; ++it) {
+					candidates.push_back(*it - splits[i]);
+				}
+				outgoing.push_back(AsgdPsMessage(type, clock));
+				EncodedDelta& values = outgoing.back().values;
+				codec.encode(delta + splits[i]*r, r, splits[i+1]-splits[i], values, &candidates);
+				sendReqs.push_back( pairwiseChannels[i].isend(outgoing.back()) );
+				values.addTo(&cachedH.data()[splits[i]*r]);
+				values.addTo(delta + splits[i]*r, -1.);
+			}
+
+			for (mf_size_type c=0; c<columns.size(); c++) {
+				mf_size_type j = columns[c];
+				bool residual = false;
+				for (mf_size_type i=0; i<r; i++) {
+					if (delta[j*r+i] != 0.) residual = true;
+					delta[j*r+i] = 0.;
+				}
+				if (residual) {
+					SpinLock::scoped_lock lock2(locks.column(j));
+					dirty.mark(j);
+				}
+			}
+		}
+
+		/** Sends the current values of the columns of the block that changed since the last
+		 * reply to a worker, along with the smallest clock of all workers */
+		static void reply(mpi2::Channel& channel, unsigned type, const H& block,
+				const std::vector<boost::uint64_t>& version, boost::uint64_t blockVersion,
+				boost::uint64_t& replied, const std::vector<boost::uint64_t>& applied,
+				std::list<AsgdPsMessage>& outgoing, std::list<boost::mpi::request>& sendReqs) {
+			mf_size_type r = block.size1();
+			outgoing.push_back(AsgdPsMessage(type, *std::min_element(applied.begin(), applied.end())));
+			EncodedDelta& values = outgoing.back().values;
+			values.type = DELTA_CODEC_NONE;
+			values.r = r;
+			values.n = block.size2();
+			for (mf_size_type j=0; j<block.size2(); j++) {
+				if (version[j] <= replied) continue;
+				values.columns.push_back(j);
+				values.doubles.insert(values.doubles.end(), &block.data()[j*r], &block.data()[j*r] + r);
+			}
+			replied = blockVersion;
+			sendReqs.push_back( channel.isend(outgoing.back()) );
+		}
+
+		/** Applies the current values of columns of the master (starting at column offset) to
+		 * the local copy of H */
+		static void apply(const EncodedDelta& values, mf_size_type offset,
+				H& localH, H& cachedH, LockTable& locks) {
+			mf_size_type r = values.r;
+			for (mf_size_type c=0; c<values.columns.size(); c++) {
+				mf_size_type j = values.columns[c] + offset;
+				const double* v = &values.doubles[c*r];
+				SpinLock::scoped_lock lock2(locks.column(j));
+				for (mf_size_type i=0; i<r; i++) {
+					localH(i,j) += v[i] - cachedH(i,j);
+					cachedH(i,j) = v[i];
+				}
+			}
+		}
+	};
+
+	template<typename Update, typename Regularize, typename FD = AsgdFactorizationData<> >
 	struct AsgdTask {
 		static const std::string id() { return std::string("__mf/sgd/AsgdTask_")
-			+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name(); }
+			+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name()
+			+ "_" + mpi2::TypeTraits<typename FD::V>::name() + "_" + mpi2::TypeTraits<typename FD::H>::name(); }
 
 		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
 			rg::Random32 random = mpi2::getSeed(ch);
 			// receive factorization data
-			AsgdJob<Update, Regularize> job(mpi2::UNINITIALIZED);
+			AsgdJob<Update, Regularize, FD> job(mpi2::UNINITIALIZED);
 			double eps;
 			ch.recv(*mpi2::unmarshal(job, eps));
 
 			// get the data
 			unsigned groupId = info.groupId();
 			mpi2::RemoteVar var = job.dv.block(groupId, 0);
-			const SparseMatrix& localV = *var.getLocal<SparseMatrix>();
+			const typename FD::V& localV = *var.template getLocal<typename FD::V>();
 			var = job.dw.block(groupId, 0);
-			DenseMatrix& localW = *var.getLocal<DenseMatrix>();
-			DenseMatrixCM& localH = *mpi2::env().get<DenseMatrixCM>("asgd_h_work");
+			typename FD::W& localW = *var.template getLocal<typename FD::W>();
+			typename FD::H& localH = *mpi2::env().get<typename FD::H>("asgd_h_work");
 
-			// create locked updates and put column locks in environment
-			boost::shared_array<boost::mutex>& locks1 =
-					*mpi2::env().get<boost::shared_array<boost::mutex> >("asgd_locks1");
-			boost::shared_array<boost::mutex>& locks2 =
-					*mpi2::env().get<boost::shared_array<boost::mutex> >("asgd_locks2");
-			UpdateLock<Update> updateLock(job.update, localV.size1(), localV.size2(), locks1, locks2);
+			// create locked updates; the lock table and the dirty columns are shared with AsgdShuffleTask
+			boost::shared_ptr<LockTable>& locks =
+					*mpi2::env().get<boost::shared_ptr<LockTable> >("asgd_locks");
+			AsgdShuffleState& state = *mpi2::env().get<AsgdShuffleState>("asgd_shuffle_state");
+			UpdateLock<Update> updateLock(job.update, localV.size1(), localV.size2(), locks, state.dirty);
 
 			// run an epoch
 			mpi2::logBeginEvent("computation");
-			PsgdJob<UpdateLock<Update>,Regularize> localJob(
+			PsgdJob<UpdateLock<Update>,Regularize,typename FD::Local> localJob(
 					localV,
 					localW,
 					localH,
@@ -192,11 +627,16 @@ namespace detail {
 
 } // mf::detail
 
-template<typename Update, typename Regularize>
-void AsgdRunner::epoch(AsgdJob<Update, Regularize>& job, double eps) {
+template<typename Update, typename Regularize, typename FD>
+void AsgdRunner::epoch(AsgdJob<Update, Regularize, FD>& job, double eps) {
+	if (job.sync == ASGD_SYNC_PS) {
+		epochPs(job, eps);
+		return;
+	}
+
 	// start the ASGD task on all ranks
 	std::vector<mpi2::Channel> sgdChannels;
-	mpi2::TaskManager::getInstance().spawnAll<detail::AsgdTask<Update,Regularize> >(sgdChannels);
+	mpi2::TaskManager::getInstance().spawnAll<detail::AsgdTask<Update,Regularize,FD> >(sgdChannels);
 	mpi2::seed(sgdChannels, random_);
 	mpi2::sendAll(sgdChannels, mpi2::marshal(job, eps));
 
@@ -217,9 +657,14 @@ void AsgdRunner::epoch(AsgdJob<Update, Regularize>& job, double eps) {
 
 		// start the shuffle tasks on all ranks
 		// (Once more even after SGD is done; need to make sure everybody has same local copy.)
+		// The first shuffle is full since the master may have been changed between epochs; the
+		// final shuffle is full and not compressed so that it picks up the regularization and
+		// transmits all residuals.
 		std::vector<mpi2::Channel> shuffleChannels;
-		mpi2::TaskManager::getInstance().spawnAll<detail::AsgdShuffleTask>(shuffleChannels, true);
-		mpi2::sendAll(shuffleChannels, mpi2::marshal(job.dh, job.averageDeltas));
+		mpi2::TaskManager::getInstance().spawnAll<detail::AsgdShuffleTask<typename FD::H> >(shuffleChannels, true);
+		bool full = noShuffles == 0 || sgdRequests.empty();
+		DeltaCodec codec = sgdRequests.empty() ? DeltaCodec() : job.codec;
+		mpi2::sendAll(shuffleChannels, mpi2::marshal(job.dh, job.averageDeltas, codec, full));
 		noShuffles++;
 
 		// wait for shuffle tasks to finish
@@ -229,9 +674,53 @@ void AsgdRunner::epoch(AsgdJob<Update, Regularize>& job, double eps) {
 	LOG4CXX_INFO(detail::logger, "Synchronized " << noShuffles << " times");
 }
 
-template<typename Update, typename Regularize, typename Loss,
+template<typename Update, typename Regularize, typename FD>
+void AsgdRunner::epochPs(AsgdJob<Update, Regularize, FD>& job, double eps) {
+	int pollDelay = mpi2::TaskManager::getInstance().pollDelay();
+
+	// start the ASGD task and the parameter-server task on all ranks
+	std::vector<mpi2::Channel> sgdChannels;
+	mpi2::TaskManager::getInstance().spawnAll<detail::AsgdTask<Update,Regularize,FD> >(sgdChannels);
+	mpi2::seed(sgdChannels, random_);
+	mpi2::sendAll(sgdChannels, mpi2::marshal(job, eps));
+	std::vector<mpi2::Channel> psChannels;
+	mpi2::TaskManager::getInstance().spawnAll<detail::AsgdPsTask<typename FD::H> >(psChannels, true);
+	mpi2::sendAll(psChannels, mpi2::marshal(job.dh, job.averageDeltas, job.codec, job.staleness));
+
+	// tell each parameter-server task when the ASGD task of its rank is done
+	std::vector<boost::mpi::request> sgdRequests = mpi2::irecvAll(sgdChannels);
+	std::vector<bool> done(sgdRequests.size(), false);
+	for (mf_size_type remaining = sgdRequests.size(); remaining > 0; ) {
+		bool progress = false;
+		for (mf_size_type i=0; i<sgdRequests.size(); i++) {
+			if (done[i] || !sgdRequests[i].test()) continue;
+			done[i] = true;
+			remaining--;
+			psChannels[i].send();
+			progress = true;
+		}
+		if (!progress) boost::this_thread::sleep(boost::posix_time::microseconds(pollDelay));
+	}
+
+	// collect the staleness distributions
+	std::vector<std::vector<mf_size_type> > histograms(psChannels.size());
+	mpi2::economicRecvAll(psChannels, histograms, pollDelay);
+	mf_size_type rounds = 0, sum = 0;
+	for (mf_size_type i=0; i<histograms.size(); i++) {
+		if (staleness_.size() < histograms[i].size()) staleness_.resize(histograms[i].size(), 0);
+		for (mf_size_type s=0; s<histograms[i].size(); s++) {
+			staleness_[s] += histograms[i][s];
+			rounds += histograms[i][s];
+			sum += s * histograms[i][s];
+		}
+	}
+	LOG4CXX_INFO(detail::logger, "Synchronized " << rounds << " times (average staleness: "
+			<< (rounds == 0 ? 0. : (double)sum / rounds) << ")");
+}
+
+template<typename Update, typename Regularize, typename FD, typename Loss,
 	typename DistributedAdaptiveDecay,typename TestData,typename TestLoss>
-void AsgdRunner::run(AsgdJob<Update, Regularize>& job, Loss& loss,
+void AsgdRunner::run(AsgdJob<Update, Regularize, FD>& job, Loss& loss,
 		mf_size_type epochs, DistributedAdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod,
 		TestData* testData, TestLoss *testLoss) {
@@ -256,40 +745,67 @@ void AsgdRunner::run(AsgdJob<Update, Regularize>& job, Loss& loss,
 		LOG4CXX_INFO(detail::logger, "Deltas will not be averaged");
 	}
 
+	if (job.sync == ASGD_SYNC_PS) {
+		LOG4CXX_INFO(detail::logger, "Using a parameter server (staleness bound: "
+				<< (job.staleness == 0 ? std::string("none") : boost::lexical_cast<std::string>(job.staleness)) << ")");
+	} else {
+		LOG4CXX_INFO(detail::logger, "Using shuffles");
+	}
+	if (job.codec.enabled()) {
+		LOG4CXX_INFO(detail::logger, "Deltas will be compressed (codec: " << job.codec.type
+				<< ", threshold: " << job.codec.threshold << ", top-k fraction: " << job.codec.fraction << ")");
+	}
+
 	// create a copy of H on all ranks
 	LOG4CXX_INFO(detail::logger, "Unblocking H...");
 	const std::string hUnblockedName = "asgd_h_work";
-	mpi2::createCopyAll(hUnblockedName, AsgdFactorizationData<>::H(0,0));
+	mpi2::createCopyAll(hUnblockedName, typename FD::H(0,0));
 	unblockAll(job.dh, hUnblockedName);
 
 	// initialize ASGD
 	LOG4CXX_INFO(detail::logger, "Initializing...");
 	std::vector<mpi2::Channel> channels;
-	mpi2::TaskManager::getInstance().spawnAll<detail::AsgdInitTask>(channels);
+	mpi2::TaskManager::getInstance().spawnAll<detail::AsgdInitTask<typename FD::V, typename FD::H> >(channels);
 	mpi2::sendAll(channels, job.dv);
 	mpi2::recvAll(channels);
 
 	// run ASGD
+	staleness_.clear();
 	detail::defaultRunner(job, loss, epochs, decay,
-			boost::bind(&AsgdRunner::epoch<Update,Regularize>, this, _1, _2),
+			boost::bind(&AsgdRunner::epoch<Update,Regularize,FD>, this, _1, _2),
 			trace, random_, balanceType, balanceMethod, testData, testLoss);
 
+	// add the staleness distribution of the parameter server to the trace
+	if (job.sync == ASGD_SYNC_PS) {
+		std::stringstream hist;
+		mf_size_type rounds = 0, sum = 0;
+		for (mf_size_type s=0; s<staleness_.size(); s++) {
+			hist << (s == 0 ? "" : " ") << staleness_[s];
+			rounds += staleness_[s];
+			sum += s * staleness_[s];
+		}
+		trace.addField("staleness_bound", job.staleness);
+		trace.addField("staleness_mean", rounds == 0 ? 0. : (double)sum / rounds);
+		trace.addField("staleness_max", staleness_.empty() ? 0. : staleness_.size() - 1.);
+		trace.addField("staleness_hist", hist.str());
+	}
+
 	// destroy ASGD
-	mpi2::TaskManager::getInstance().spawnAll<detail::AsgdDestroyTask>(channels);
+	mpi2::TaskManager::getInstance().spawnAll<detail::AsgdDestroyTask<typename FD::H> >(channels);
 	mpi2::recvAll(channels);
 
 	// delete the copy of H from all ranks
-	mpi2::eraseAll<AsgdFactorizationData<>::H>(hUnblockedName);
+	mpi2::eraseAll<typename FD::H>(hUnblockedName);
 
 	LOG4CXX_INFO(detail::logger, "Finished ASGD");
 }
 
-template<typename Update, typename Regularize, typename DistributedLoss,
+template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 	typename DistributedAdaptiveDecay>
-void AsgdRunner::run(AsgdJob<Update, Regularize>& job, DistributedLoss& loss,
+void AsgdRunner::run(AsgdJob<Update, Regularize, FD>& job, DistributedLoss& loss,
 		mf_size_type epochs, DistributedAdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod) {
-	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (DsgdFactorizationData<>*)NULL, (NoLoss*)NULL);
+	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (FD*)NULL, (NoLoss*)NULL);
 }
 
 
@@ -18,6 +18,8 @@
 #ifndef SGD_DECAY_DECAY_H
 #define SGD_DECAY_DECAY_H
 
+#include <boost/type_traits/integral_constant.hpp>
+
 /** Static decay concept. The decay is computed as a function of the step number
  * (e.g., eps_n = 1/n), but does not have access to data or progress information.
  *
@@ -66,6 +68,18 @@ class AdaptiveDecayConcept {
 class DistributedAdaptiveDecayConcept {
 };
 
+namespace mf {
+
+/** Indicates whether an adaptive decay function reads the factors of the job it is given.
+ * Decay functions that only look at the losses should specialize this to false, so that
+ * lazily applied regularize steps (see mf::LazyScale) do not have to be applied before
+ * each call. */
+template<typename Decay>
+struct DecayUsesFactors : public boost::true_type {
+};
+
+}
+
 
 
 #endif
@@ -15,6 +15,9 @@
 #define MF_SGD_DECAY_DECAY_AUTO_H
 
 #include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
 
 #include <boost/foreach.hpp>
 
@@ -30,12 +33,32 @@ namespace mf {
 
 namespace detail {
 
+/** Runs a trial of step size eps on an SGD job over the sample: the given fraction of an
+ * epoch's SGD update steps (at least one) followed by a regularize step of the same fraction,
+ * or a full epoch if fraction is 1. */
+template<typename Update, typename Regularize, typename FD>
+inline void decayAutoTrial(SgdRunner& sgdRunner, SgdJob<Update,Regularize,FD>& job,
+		double eps, double fraction) {
+	if (fraction >= 1) {
+		sgdRunner.epoch(job, eps);
+		return;
+	}
+	mf_size_type steps = std::max((mf_size_type)(fraction * job.nnz), (mf_size_type)1);
+	sgdRunner.update(job, steps, eps);
+	sgdRunner.regularize(job, eps * steps / job.nnz);
+}
+
 /** A decay function that tries to automatically select the optimum step size based on
  * a sample. Initially, the step size that works best on the sample is selected. This
  * choice works well initially, but will lead to overly large choices once the solution
  * is close to the optimum (which maybe away from the sample-local optimum). As soon
  * as this is detected, the BoldDriver is used for the remaining steps.
  *
+ * By default, each of the tries step sizes is run for a full epoch on the sample. With
+ * setSuccessiveHalving(), many more candidates are run on a small budget instead; the
+ * worse half is discarded (keeping at least two) and the budget doubled until the remaining
+ * candidates have been run for a full epoch. The best of these is selected.
+ *
  * @tparam Update type of update function (model of UpdateConcept)
  * @tparam Regularize type of regularization function (model of RegularizeConcept)
  * @tparam Loss type of loss function (model of LossConcept)
@@ -48,13 +71,59 @@ public:
 			allowIncrease = false)
 	: sgd(sgd), loss(loss),
 	  eps_(eps), initialEps_(eps_), tries(tries), decrease_(decrease), increase_(increase),
-	  fallback(false), allowIncrease(allowIncrease) {
+	  fallback(false), allowIncrease(allowIncrease), candidates_(0), minFraction_(1) {
 		if (tries <= 1) {
 			RG_THROW(rg::InvalidArgumentException, "tries has to be larger than 1");
 		}
 	};
 
+	/** Selects the step size by successive halving. The given number of candidate step sizes
+	 * (spanning the same range as the tries step sizes) is run on a fraction of an epoch on the
+	 * sample; the better half is kept and run again, from the same starting point, with twice
+	 * the budget (keeping at least two candidates), until the remaining candidates have been run
+	 * for a full epoch; the best of them is selected. The budget of the first round is
+	 * 2^-(rounds-1) of an epoch, but at least minFraction. Candidate evaluations are spread
+	 * over at most tries concurrent tasks. If candidates is 0, halving is disabled.
+	 */
+	void setSuccessiveHalving(unsigned candidates, double minFraction = 1./64) {
+		if (candidates == 1) {
+			RG_THROW(rg::InvalidArgumentException, "candidates has to be 0 or larger than 1");
+		}
+		if (minFraction <= 0 || minFraction > 1) {
+			RG_THROW(rg::InvalidArgumentException, "minFraction has to be in (0,1]");
+		}
+		candidates_ = candidates;
+		minFraction_ = minFraction;
+	}
+
 protected:
+	/** Constructs count step sizes, starting with the largest one that may be tried. On the first
+	 * call, they decrease geometrically (by a factor of two for count=tries); afterwards, they
+	 * decrease linearly to half the current step size. */
+	std::vector<double> stepSizes(unsigned count, bool first) {
+		double maxEps = 2*eps_;
+		if (!allowIncrease && maxEps>initialEps_) maxEps = initialEps_;
+		double delta = (maxEps - (eps_/2)) / (count-1);
+		double factor = std::pow(2., -(double)(tries-1) / (count-1));
+		std::vector<double> epsToTry;
+		double eps = maxEps;
+		for (unsigned i=0; i<count; i++) {
+			epsToTry.push_back(eps);
+			if (first) {
+				eps *= factor;
+			} else {
+				eps -= delta;
+			}
+		}
+		return epsToTry;
+	}
+
+	/** Function F has signature
+	 * <code>std::vector<double> f(FD& data, rg::Random32& random, const std::vector<double>& epsToTry,
+	 * double fraction, bool project)</code>; it returns the losses on the sample after running
+	 * the given fraction of an epoch with each step size, starting from the current factors
+	 * projected to the sample. The factors are projected only if project is true; otherwise,
+	 * the projection of the previous call is reused. */
 	template<typename FD, typename F>
 	inline double nextEps(FD& data, F findBestEps, double* previousLoss, double* currentLoss,
 			rg::Random32& random) {
@@ -62,35 +131,28 @@ protected:
 			LOG4CXX_INFO(detail::logger, "Falling back to bold driver decay");
 			fallback = true;
 		}
-		if (!fallback) {
+		if (!fallback && candidates_ > 0) {
+			bool project = true;
+			while (!successiveHalving(data, findBestEps, previousLoss == NULL, project, random)) {
+				LOG4CXX_WARN(detail::logger, "Could not find an initial step size with "
+						<< candidates_ << " candidates. Trying again.");
+				eps_ /= 2;
+				project = false;
+			}
+		} else if (!fallback) {
+			bool project = true;
 retry:
 			// construct a set of step sizes to try
-			double maxEps = 2*eps_;
-			if (!allowIncrease && maxEps>initialEps_) maxEps = initialEps_;
-			double delta = (maxEps - (eps_/2)) / (tries-1);
-			//std::cout<<" delta: "<<delta<<std::endl;
-			eps_ = maxEps;
-			std::vector<double> epsToTry;
-			for (unsigned i=0; i<tries; i++) {
-				epsToTry.push_back(eps_);
-				//std::cout<<" eps: "<<eps_<<std::endl;
-				if (previousLoss == NULL) {
-					//std::cout<<" Null previous loss "<<std::endl;
-					eps_/=2;
-				} else if (i != tries-1) {
-					eps_ -= delta;
-				}
-			}
-
-			//std::cout<<"After loop eps: "<<eps_<<std::endl;
+			std::vector<double> epsToTry = stepSizes(tries, previousLoss == NULL);
 
-			// find the best loss on these step sizes
-			std::vector<double> losses = findBestEps(data, random, epsToTry);
+			// find the best loss on these step sizes (on a full epoch)
+			double fraction = 1.;
+			std::vector<double> losses = findBestEps(data, random, epsToTry, fraction, project);
+			project = false;
 			int bestIndex = -1;
 			double bestLoss = INFINITY;
 			for(int i=0; i<tries; i++) {
 				LOG4CXX_DEBUG(detail::logger, "Tried eps=" << epsToTry[i] << ", loss=" << losses[i]);
-				//std::cout<<"Tried eps=" << epsToTry[i] << ", loss=" << losses[i]<<std::endl;
 
 				if (!isnan(losses[i]) && losses[i] < bestLoss) {
 					bestLoss = losses[i];
@@ -100,7 +162,9 @@ retry:
 
 			// decide whether to accept the step size that gave the best loss
 			bool accept = false;
-			if (bestIndex == 0) {
+			if (bestIndex == -1) {
+				// no step size gave a finite loss
+			} else if (bestIndex == 0) {
 				// accept when it is the biggest one tried
 				accept = true;
 			} else if (!isnan(losses[bestIndex-1]) && losses[bestIndex-1]<losses[bestIndex]*100) {
@@ -114,12 +178,12 @@ retry:
 
 			if (accept) {
 				eps_ = epsToTry[bestIndex];
-				//std::cout<<"after acceptance eps: "<<eps_<<std::endl;
 			} else {
 				LOG4CXX_WARN(detail::logger, "Could not find an initial step size after "
 						<< tries << " tries. Trying again.");
-				eps_ /= 2;
-				//std::cout<<" Go to retry with eps: "<<eps_<<std::endl;
+				// continue below the step sizes tried: the next step size of the sequence
+				// (halved on the first call, unchanged afterwards), halved
+				eps_ = previousLoss == NULL ? epsToTry[tries-1] / 4 : epsToTry[tries-1] / 2;
 				goto retry;
 			}
 		} else {
@@ -132,6 +196,47 @@ retry:
 		return eps_;
 	}
 
+	/** Runs successive halving on candidates_ step sizes and sets eps_ to the winner. Returns
+	 * false if none of the candidates gave a finite loss. */
+	template<typename FD, typename F>
+	bool successiveHalving(FD& data, F& findBestEps, bool first, bool project, rg::Random32& random) {
+		std::vector<double> epsToTry = stepSizes(candidates_, first);
+		unsigned rounds = 0;
+		while ((1u << rounds) < candidates_) rounds++;
+		double fraction = std::max(std::ldexp(1., -(int)rounds+1), minFraction_);
+
+		while (true) {
+			std::vector<double> losses = findBestEps(data, random, epsToTry, fraction, project);
+			project = false;
+
+			// rank the candidates (NaN and infinite losses last)
+			std::vector<std::pair<double,double> > ranked; // (loss, eps)
+			for (unsigned i=0; i<epsToTry.size(); i++) {
+				LOG4CXX_DEBUG(detail::logger, "Tried eps=" << epsToTry[i] << " on " << fraction
+						<< " of an epoch, loss=" << losses[i]);
+				double loss = isnan(losses[i]) ? INFINITY : losses[i];
+				ranked.push_back(std::make_pair(loss, epsToTry[i]));
+			}
+			std::stable_sort(ranked.begin(), ranked.end());
+			if (isinf(ranked[0].first)) {
+				eps_ = *std::min_element(epsToTry.begin(), epsToTry.end());
+				return false;
+			}
+			if (fraction >= 1) {
+				eps_ = ranked[0].second;
+				return true;
+			}
+
+			// keep the better half (at least two) and double the budget
+			epsToTry.clear();
+			unsigned keep = std::max((unsigned)(ranked.size()+1)/2, 2u);
+			for (unsigned i=0; i<keep && i<ranked.size(); i++) {
+				epsToTry.push_back(ranked[i].second);
+			}
+			fraction = std::min(2*fraction, 1.);
+		}
+	}
+
 protected:
 	Sgd<Update,Regularize> sgd;
 	Loss loss;
@@ -143,8 +248,29 @@ protected:
 	bool fallback;
 	bool allowIncrease;
 	double scaleFactor;
+	unsigned candidates_; // number of candidates for successive halving (0 = disabled)
+	double minFraction_;  // minimum budget of a candidate (fraction of an epoch on the sample)
 };
 
+/** Assigns the step sizes to tasks round robin; task t gets epsToTry[t], epsToTry[t+tasks], ... */
+inline std::vector<std::vector<double> > assignStepSizes(const std::vector<double>& epsToTry, unsigned tasks) {
+	std::vector<std::vector<double> > result(tasks);
+	for (unsigned i=0; i<epsToTry.size(); i++) {
+		result[i % tasks].push_back(epsToTry[i]);
+	}
+	return result;
+}
+
+/** Inverse of assignStepSizes() for the losses returned by the tasks */
+inline std::vector<double> collectLosses(const std::vector<std::vector<double> >& taskLosses, unsigned n) {
+	std::vector<double> result(n);
+	unsigned tasks = taskLosses.size();
+	for (unsigned i=0; i<n; i++) {
+		result[i] = taskLosses[i % tasks][i / tasks];
+	}
+	return result;
+}
+
 } // namespace detail
 
 /** @copydoc detail::AbstractDecayAuto */
@@ -173,12 +299,14 @@ public:
 		LOG4CXX_INFO(detail::logger, "Initialized automatic decay with scale factor of " << ADA::scaleFactor);
 	};
 
-	inline std::vector<double> findBestEps(FactorizationData<>& data, rg::Random32& random,
-			const std::vector<double> epsToTry) {
+	/** The step sizes are always tried on the (double-precision) sample, i.e., single-precision
+	 * factors are converted to double when projected to the sample. */
+	template<typename Data, typename Factor, typename Index>
+	inline std::vector<double> findBestEps(FactorizationData<Data,Factor,Index>& data, rg::Random32& random,
+			const std::vector<double>& epsToTry, double fraction, bool project) {
 		std::vector<double> losses;
 		SgdRunner sgdRunner(random);
-		project1(data.w, wSample, sample.map1);
-		project2(data.h, hSample, sample.map2);
+		if (project) projectSample(data.w, data.h);
 
 		for (unsigned index=0; index<epsToTry.size(); index++) {
 			double eps = epsToTry[index];
@@ -186,7 +314,7 @@ public:
 			hSampleCopy = hSample;
 			FactorizationData<> jobData(sample.data, wSampleCopy, hSampleCopy, nnz1, 0, nnz2, 0, nnz12max);
 			SgdJob<Update,Regularize> job(jobData, sgd.update, sgd.regularize, sgd.order);
-			sgdRunner.epoch(job, eps);
+			detail::decayAutoTrial(sgdRunner, job, eps, fraction);
 			double loss = this->loss(job);
 			losses.push_back(loss);
 		};
@@ -194,14 +322,30 @@ public:
 		return losses;
 	}
 
-	inline double operator()(FactorizationData<>& data, double* previousLoss, double* currentLoss,
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(FactorizationData<Data,Factor,Index>& data, double* previousLoss, double* currentLoss,
 			rg::Random32& random) {
 		return this->nextEps(data,
-				boost::bind(&DecayAuto<Update,Regularize,Loss>::findBestEps, this, _1, _2, _3),
+				boost::bind(&DecayAuto<Update,Regularize,Loss>::template findBestEps<Data,Factor,Index>, this, _1, _2, _3, _4, _5),
 				previousLoss, currentLoss, random) * detail::AbstractDecayAuto<Update,Regularize,Loss>::scaleFactor;
 	}
 
 protected:
+	void projectSample(const DenseMatrix& w, const DenseMatrixCM& h) {
+		project1(w, wSample, sample.map1);
+		project2(h, hSample, sample.map2);
+	}
+
+	template<typename W, typename H>
+	void projectSample(const W& w, const H& h) {
+		W wProjected;
+		H hProjected;
+		project1(w, wProjected, sample.map1);
+		project2(h, hProjected, sample.map2);
+		wSample = wProjected;
+		hSample = hProjected;
+	}
+
 	const ProjectedSparseMatrix& sample;
 	std::vector<mf_size_type> nnz1;
 	std::vector<mf_size_type> nnz2;
@@ -224,42 +368,42 @@ public:
 	ParallelDecayAuto(Sgd<Update,Regularize> sgd, Loss loss, const ProjectedSparseMatrix& sample,
 			double eps, unsigned tries, double decrease = 0.5, double increase=1.05, bool
 			allowIncrease = false, bool scale=false)
-	: DecayAuto<Update,Regularize,Loss>(sgd, loss, sample, eps, tries, decrease, increase, allowIncrease, scale),
-	  mySgd(sgd) {
+	: DecayAuto<Update,Regularize,Loss>(sgd, loss, sample, eps, tries, decrease, increase, allowIncrease, scale) {
 	}
 
 	inline std::vector<double> findBestEps(FactorizationData<>& data, rg::Random32& random,
-			const std::vector<double> epsToTry) {
-		project1(data.w, wSample, sample.map1);
-		project2(data.h, hSample, sample.map2);
+			const std::vector<double>& epsToTry, double fraction, bool project) {
+		if (project) {
+			project1(data.w, wSample, sample.map1);
+			project2(data.h, hSample, sample.map2);
+		}
 
-		// run tasks that compute the losses
+		// run tasks that compute the losses (at most tries, each one for one or more step sizes)
 		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
 		boost::mpi::communicator& world = tm.world();
+		unsigned tasks = std::min((unsigned)epsToTry.size(), this->tries);
 		std::vector<mpi2::Channel> channels;
-		tm.spawn<ParallelDecayAutoTask>(world.rank(), epsToTry.size(), channels);
+		tm.spawn<ParallelDecayAutoTask>(world.rank(), tasks, channels);
 		mpi2::seed(channels, random);
-		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&data), mpi2::pointerToInt(this)));
-		mpi2::sendEach(channels, epsToTry);
+		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&data), mpi2::pointerToInt(this), fraction));
+		mpi2::sendEach(channels, detail::assignStepSizes(epsToTry, tasks));
 
 		// receive results
-		std::vector<double> losses;
-		mpi2::economicRecvAll(channels, losses, tm.pollDelay());
+		std::vector<std::vector<double> > taskLosses;
+		mpi2::economicRecvAll(channels, taskLosses, tm.pollDelay());
 
 		// return result
-		return losses;
+		return detail::collectLosses(taskLosses, epsToTry.size());
 	}
 
 	inline double operator()(FactorizationData<>& data, double* previousLoss, double* currentLoss,
 			rg::Random32& random) {
 		return this->nextEps(data,
-				boost::bind(&ParallelDecayAuto<Update,Regularize,Loss>::findBestEps, this, _1, _2, _3),
+				boost::bind(&ParallelDecayAuto<Update,Regularize,Loss>::findBestEps, this, _1, _2, _3, _4, _5),
 				previousLoss, currentLoss, random) * detail::AbstractDecayAuto<Update,Regularize,Loss>::scaleFactor;
 	}
 
 private:
-	Sgd<Update,Regularize>& mySgd;
-
 	struct ParallelDecayAutoTask {
 		static const std::string id() {
 			return std::string("__mf/sgd/decay_ParallelDecayAutoTask")
@@ -272,20 +416,24 @@ private:
 			rg::Random32 random = mpi2::getSeed(ch);
 			mpi2::PointerIntType pData;
 			mpi2::PointerIntType pDecay;
-			ch.recv(*mpi2::unmarshal(pData, pDecay));
+			double fraction;
+			ch.recv(*mpi2::unmarshal(pData, pDecay, fraction));
 			FactorizationData<>& data = *mpi2::intToPointer<FactorizationData<> >(pData);
 			ParallelDecayAuto<Update, Regularize, Loss>& decay = *mpi2::intToPointer<ParallelDecayAuto<Update, Regularize, Loss> >(pDecay);
-			double eps;
-			ch.recv(eps);
+			std::vector<double> epsToTry;
+			ch.recv(epsToTry);
 
-			DenseMatrix wSampleCopy = decay.wSample;
-			DenseMatrixCM hSampleCopy = decay.hSample;
-			FactorizationData<> jobData(decay.sample.data, wSampleCopy, hSampleCopy, decay.nnz1, 0, decay.nnz2, 0, decay.nnz12max);
-			SgdJob<Update,Regularize> job(jobData, decay.mySgd.update, decay.mySgd.regularize, decay.mySgd.order);
 			SgdRunner sgdRunner(random);
-			sgdRunner.epoch(job, eps);
-			double loss = decay.loss(job);
-			ch.send(loss);
+			std::vector<double> losses;
+			for (unsigned i=0; i<epsToTry.size(); i++) {
+				DenseMatrix wSampleCopy = decay.wSample;
+				DenseMatrixCM hSampleCopy = decay.hSample;
+				FactorizationData<> jobData(decay.sample.data, wSampleCopy, hSampleCopy, decay.nnz1, 0, decay.nnz2, 0, decay.nnz12max);
+				SgdJob<Update,Regularize> job(jobData, decay.sgd.update, decay.sgd.regularize, decay.sgd.order);
+				detail::decayAutoTrial(sgdRunner, job, epsToTry[i], fraction);
+				losses.push_back(decay.loss(job));
+			}
+			ch.send(losses);
 		}
 	};
 };
@@ -307,29 +455,34 @@ namespace detail {
 			Loss loss(mpi2::UNINITIALIZED);
 			std::string varNameBase;
 			mf_size_type nnz12max;
-			double eps;
+			double fraction;
+			std::vector<double> epsToTry;
 			ch.recv(*mpi2::unmarshal(sgd, loss, varNameBase));
-			ch.recv(nnz12max);
-			ch.recv(eps);
+			ch.recv(*mpi2::unmarshal(nnz12max, fraction));
+			ch.recv(epsToTry);
 
 			ProjectedSparseMatrix* sample =
 					mpi2::env().get<ProjectedSparseMatrix>(varNameBase + "_sample");
-			DenseMatrix wSampleCopy =
-					*mpi2::env().get<DenseMatrix>(varNameBase + "_wSample");
-			DenseMatrixCM hSampleCopy =
-					*mpi2::env().get<DenseMatrixCM>(varNameBase + "_hSample");
+			DenseMatrix* wSample =
+					mpi2::env().get<DenseMatrix>(varNameBase + "_wSample");
+			DenseMatrixCM* hSample =
+					mpi2::env().get<DenseMatrixCM>(varNameBase + "_hSample");
 			std::vector<mf_size_type>* nnz1 =
 					mpi2::env().get<std::vector<mf_size_type> >(varNameBase + "_sample_nnz1");
 			std::vector<mf_size_type>* nnz2 =
 					mpi2::env().get<std::vector<mf_size_type> >(varNameBase + "_sample_nnz2");
 
-
-			FactorizationData<> jobData(sample->data, wSampleCopy, hSampleCopy, *nnz1, 0, *nnz2, 0, nnz12max);
-			SgdJob<Update,Regularize> job(jobData, sgd.update, sgd.regularize, sgd.order);
 			SgdRunner sgdRunner(random);
-			sgdRunner.epoch(job, eps);
-			double result = loss(job);
-			ch.send(result);
+			std::vector<double> losses;
+			for (unsigned i=0; i<epsToTry.size(); i++) {
+				DenseMatrix wSampleCopy = *wSample;
+				DenseMatrixCM hSampleCopy = *hSample;
+				FactorizationData<> jobData(sample->data, wSampleCopy, hSampleCopy, *nnz1, 0, *nnz2, 0, nnz12max);
+				SgdJob<Update,Regularize> job(jobData, sgd.update, sgd.regularize, sgd.order);
+				detail::decayAutoTrial(sgdRunner, job, epsToTry[i], fraction);
+				losses.push_back(loss(job));
+			}
+			ch.send(losses);
 		}
 	};
 }
@@ -342,7 +495,6 @@ class DistributedDecayAuto : public detail::AbstractDecayAuto<Update,Regularize,
 	using detail::AbstractDecayAuto<Update,Regularize,Loss>::loss;
 
 public:
-	/** tries currently MUST BE a multiple of the number of ranks */
 	DistributedDecayAuto(Sgd<Update,Regularize> sgd, Loss loss,
 			const ProjectedSparseMatrix& sample, const std::string& varNameBase,
 			double eps, unsigned tries, double decrease = 0.5, double increase=1.05, bool
@@ -374,47 +526,71 @@ public:
 		LOG4CXX_INFO(detail::logger, "Initialized automatic decay with scale factor of " << ADA::scaleFactor);
 	};
 
-	inline std::vector<double> findBestEps(DsgdFactorizationData<>& data, rg::Random32& random,
-			const std::vector<double>& epsToTry) {
-		// get sample rows/columns of current factors
-		ProjectedSparseMatrix* sample =
-				mpi2::env().get<ProjectedSparseMatrix>(varNameBase + "_sample");
-		project1(data.dw, wSample, sample->map1, data.tasksPerRank);
-		project2(data.dh, hSample, sample->map2, data.tasksPerRank);
+	template<typename Data, typename Factor, typename Index>
+	inline std::vector<double> findBestEps(DsgdFactorizationData<Data,Factor,Index>& data,
+			rg::Random32& random, const std::vector<double>& epsToTry, double fraction,
+			bool project) {
+		if (project) {
+			// get sample rows/columns of current factors
+			ProjectedSparseMatrix* sample =
+					mpi2::env().get<ProjectedSparseMatrix>(varNameBase + "_sample");
+			projectSample(data.dw, data.dh, *sample, data.tasksPerRank);
 
-		// store them on all ranks
-		mpi2::setCopyAll(varNameBase + "_wSample", wSample);
-		mpi2::setCopyAll(varNameBase + "_hSample", hSample);
+			// store them on all ranks
+			mpi2::setCopyAll(varNameBase + "_wSample", wSample);
+			mpi2::setCopyAll(varNameBase + "_hSample", hSample);
+		}
 
-		// run a tasks on all ranks that compute the losses
+		// run tasks on all ranks that compute the losses (at most tries in total, each one
+		// for one or more step sizes)
 		// TODO: add support for automatic selection of the number of tasks
 		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
 		boost::mpi::communicator& world = tm.world();
+		unsigned tasks = std::min((unsigned)epsToTry.size(), this->tries);
 		std::vector<mpi2::Channel> channels;
 		tm.spawnAll<detail::DistributedDecayAutoTask<Update,Regularize,Loss> >(
-				epsToTry.size()/world.size(), channels);
+				(tasks + world.size() - 1) / world.size(), channels);
 		mpi2::seed(channels, random);
 		mpi2::sendAll(channels, mpi2::marshal(sgd, loss, varNameBase));
-		mpi2::sendAll(channels, data.nnz12max);
-		mpi2::sendEach(channels, epsToTry);
+		mpi2::sendAll(channels, mpi2::marshal(data.nnz12max, fraction));
+		mpi2::sendEach(channels, detail::assignStepSizes(epsToTry, channels.size()));
 
 		// receive results
-		std::vector<double> losses;
-		mpi2::recvAll(channels, losses);
+		std::vector<std::vector<double> > taskLosses;
+		mpi2::recvAll(channels, taskLosses);
 
 		// return result
-		return losses;
+		return detail::collectLosses(taskLosses, epsToTry.size());
 	}
 
-	inline double operator()(DsgdFactorizationData<>& data,
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdFactorizationData<Data,Factor,Index>& data,
 			double* previousLoss, double* currentLoss, rg::Random32& random) {
 		return this->nextEps(data,
-				boost::bind(&DistributedDecayAuto<Update,Regularize,Loss>::findBestEps, this, _1, _2, _3),
+				boost::bind(&DistributedDecayAuto<Update,Regularize,Loss>::template findBestEps<Data,Factor,Index>, this, _1, _2, _3, _4, _5),
 				previousLoss, currentLoss, random) * detail::AbstractDecayAuto<Update,Regularize,Loss>::scaleFactor;
 	}
 
 
 private:
+	void projectSample(const DistributedDenseMatrix& dw, const DistributedDenseMatrixCM& dh,
+			const ProjectedSparseMatrix& sample, int tasksPerRank) {
+		project1(dw, wSample, sample.map1, tasksPerRank);
+		project2(dh, hSample, sample.map2, tasksPerRank);
+	}
+
+	/** Projects single-precision factors and converts the result to double */
+	template<typename W, typename H>
+	void projectSample(const DistributedMatrix<W>& dw, const DistributedMatrix<H>& dh,
+			const ProjectedSparseMatrix& sample, int tasksPerRank) {
+		W wProjected;
+		H hProjected;
+		project1(dw, wProjected, sample.map1, tasksPerRank);
+		project2(dh, hProjected, sample.map2, tasksPerRank);
+		wSample = wProjected;
+		hSample = hProjected;
+	}
+
 	const std::string varNameBase;
 	DenseMatrix wSample;
 	DenseMatrixCM hSample;
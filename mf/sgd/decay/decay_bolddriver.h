@@ -46,7 +46,8 @@ public:
 		return eps_;
 	}
 
-	inline double operator()(DsgdFactorizationData<>& data, double* previousLoss, double* currentLoss, rg::Random32& random) {
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdFactorizationData<Data,Factor,Index>& data, double* previousLoss, double* currentLoss, rg::Random32& random) {
 		if (previousLoss == NULL) return eps_;
 		if (*previousLoss <= *currentLoss) {
 			eps_ *= decrease_;
@@ -56,7 +57,8 @@ public:
 		return eps_;
 	}
 
-	inline double operator()(DsgdPpFactorizationData<>& data, double* previousLoss, double* currentLoss, rg::Random32& random) {
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdPpFactorizationData<Data,Factor,Index>& data, double* previousLoss, double* currentLoss, rg::Random32& random) {
 		if (previousLoss == NULL) return eps_;
 		if (*previousLoss <= *currentLoss) {
 			eps_ *= decrease_;
@@ -66,7 +68,8 @@ public:
 		return eps_;
 	}
 
-	inline double operator()(AsgdFactorizationData<>& data, double* previousLoss, double* currentLoss, rg::Random32& random) {
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(AsgdFactorizationData<Data,Factor,Index>& data, double* previousLoss, double* currentLoss, rg::Random32& random) {
 		if (previousLoss == NULL) return eps_;
 		if (*previousLoss <= *currentLoss) {
 			eps_ *= decrease_;
@@ -91,6 +94,10 @@ private:
 	}
 };
 
+template<>
+struct DecayUsesFactors<BoldDriver> : public boost::false_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::BoldDriver);
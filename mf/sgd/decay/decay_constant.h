@@ -40,15 +40,21 @@ public:
 
 	inline double operator()(FactorizationData<>& data){ return eps_; }
 
-	inline double operator()(DsgdFactorizationData<>& data, double* prevLoss, double* curLoss, rg::Random32& random){ return eps_; }
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdFactorizationData<Data,Factor,Index>& data, double* prevLoss, double* curLoss, rg::Random32& random){ return eps_; }
 
-	inline double operator()(DsgdFactorizationData<>& data){ return eps_; }
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdFactorizationData<Data,Factor,Index>& data){ return eps_; }
 
-	inline double operator()(DsgdPpFactorizationData<>& data, double* prevLoss, double* curLoss, rg::Random32& random){ return eps_; }
-	inline double operator()(DsgdPpFactorizationData<>& data){ return eps_; }
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdPpFactorizationData<Data,Factor,Index>& data, double* prevLoss, double* curLoss, rg::Random32& random){ return eps_; }
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdPpFactorizationData<Data,Factor,Index>& data){ return eps_; }
 
-	inline double operator()(AsgdFactorizationData<>& data){ return eps_; }
-	inline double operator()(AsgdFactorizationData<>& data, double* prevLoss, double* curLoss, rg::Random32& random){ return eps_; }
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(AsgdFactorizationData<Data,Factor,Index>& data){ return eps_; }
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(AsgdFactorizationData<Data,Factor,Index>& data, double* prevLoss, double* curLoss, rg::Random32& random){ return eps_; }
 	/**/
 
 private:
@@ -62,6 +68,10 @@ private:
 	}
 };
 
+template<>
+struct DecayUsesFactors<DecayConstant> : public boost::false_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::DecayConstant);
@@ -54,9 +54,11 @@ public:
 
 	inline double operator()(FactorizationData<>& data){ return nextStep(); }
 
-	inline double operator()(DsgdFactorizationData<>& data, double* prevLoss, double* curLoss, rg::Random32& random){ return nextStep(); }
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdFactorizationData<Data,Factor,Index>& data, double* prevLoss, double* curLoss, rg::Random32& random){ return nextStep(); }
 
-	inline double operator()(DsgdFactorizationData<>& data){ return nextStep(); }
+	template<typename Data, typename Factor, typename Index>
+	inline double operator()(DsgdFactorizationData<Data,Factor,Index>& data){ return nextStep(); }
 
 
 private:
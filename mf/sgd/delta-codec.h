@@ -0,0 +1,139 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Lossy compression of the deltas of the column factors that are exchanged when ASGD
+ * synchronizes. Columns whose delta is small are not sent at all; the other columns are
+ * quantized or sparsified. Callers keep the part of a delta that has not been transmitted
+ * (the difference between the delta and its decoded version) and send it in a later round,
+ * so that no updates are lost.
+ */
+
+#ifndef MF_SGD_DELTA_CODEC_H
+#define MF_SGD_DELTA_CODEC_H
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** Encoding of the columns of a delta that are sent */
+enum DeltaCodecType {
+	DELTA_CODEC_NONE, /**< double precision */
+	DELTA_CODEC_FP16, /**< half precision, scaled per column */
+	DELTA_CODEC_INT8, /**< 8-bit integers, scaled per column */
+	DELTA_CODEC_TOPK  /**< only the entries of largest magnitude (single precision) */
+};
+
+/** An encoded delta of r x n column-major values (see mf::DeltaCodec) */
+struct EncodedDelta {
+	EncodedDelta() : type(DELTA_CODEC_NONE), r(0), n(0) {
+	}
+
+	/** Adds weight times the decoded delta to the r x n column-major matrix starting at out.
+	 * Columns that have not been sent are left unchanged. */
+	void addTo(double* out, double weight = 1.) const;
+
+	/** Like addTo above, for a single-precision matrix */
+	void addTo(float* out, double weight = 1.) const;
+
+	/** Appends offset plus the indexes of the columns that have (partly) been sent to out, in
+	 * increasing order */
+	void sentColumns(std::vector<boost::uint32_t>& out, boost::uint32_t offset = 0) const;
+
+	/** Returns the size of the payload in bytes */
+	mf_size_type bytes() const;
+
+	DeltaCodecType type;
+	boost::uint32_t r;
+	boost::uint32_t n;
+	std::vector<boost::uint32_t> columns; // the columns sent (column of each entry for TOPK)
+	std::vector<boost::uint32_t> rows;    // row of each entry (TOPK)
+	std::vector<float> scales;            // per column (FP16, INT8)
+	std::vector<double> doubles;          // NONE
+	std::vector<float> floats;            // TOPK
+	std::vector<boost::uint16_t> halfs;   // FP16
+	std::vector<boost::int8_t> bytes8;    // INT8
+
+private:
+	friend class boost::serialization::access;
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int version) {
+		ar & type;
+		ar & r;
+		ar & n;
+		ar & columns;
+		ar & rows;
+		ar & scales;
+		ar & doubles;
+		ar & floats;
+		ar & halfs;
+		ar & bytes8;
+	}
+};
+
+/** Compresses deltas of column factors. A codec is enabled if it quantizes or sparsifies
+ * (type other than DELTA_CODEC_NONE) or if it skips columns (threshold > 0).
+ *
+ * With DELTA_CODEC_FP16 and DELTA_CODEC_INT8, columns whose scale (largest magnitude) is not
+ * a normal single-precision number are not sent either; their delta is too small (or too
+ * large) to be scaled.
+ */
+struct DeltaCodec {
+	/**
+	 * @param type encoding of the columns that are sent
+	 * @param threshold columns whose delta has a smaller L2 norm are not sent (columns with
+	 *                  a zero delta are never sent)
+	 * @param fraction fraction of the entries of the sent columns that are sent with
+	 *                 DELTA_CODEC_TOPK
+	 */
+	DeltaCodec(DeltaCodecType type = DELTA_CODEC_NONE, double threshold = 0., double fraction = 0.01)
+	: type(type), threshold(threshold), fraction(fraction) {
+	}
+
+	bool enabled() const {
+		return type != DELTA_CODEC_NONE || threshold > 0;
+	}
+
+	/** Encodes the r x n column-major delta starting at delta. If candidates is given, only
+	 * the listed columns (in increasing order) are considered; all others are treated as zero. */
+	void encode(const double* delta, mf_size_type r, mf_size_type n, EncodedDelta& out,
+			const std::vector<boost::uint32_t>* candidates = NULL) const;
+
+	DeltaCodecType type;
+	double threshold;
+	double fraction;
+
+private:
+	friend class boost::serialization::access;
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int version) {
+		ar & type;
+		ar & threshold;
+		ar & fraction;
+	}
+};
+
+/** Converts a float to half precision (round to nearest even) */
+boost::uint16_t floatToHalf(float f);
+
+/** Converts a half-precision value to float */
+float halfToFloat(boost::uint16_t h);
+
+}
+
+#endif
@@ -0,0 +1,249 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+#include <mf/sgd/delta-codec.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <util/exception.h>
+
+namespace mf {
+
+boost::uint16_t floatToHalf(float f) {
+	boost::uint32_t x;
+	std::memcpy(&x, &f, sizeof(x));
+	const boost::uint32_t sign = (x >> 16) & 0x8000;
+	const boost::uint32_t exp32 = (x >> 23) & 0xff;
+	boost::uint32_t mant = x & 0x7fffff;
+	if (exp32 == 0xff) { // infinity or NaN
+		return sign | 0x7c00 | (mant != 0 ? 0x200 : 0);
+	}
+	const int exp = (int)exp32 - 127 + 15;
+	if (exp >= 31) { // overflow
+		return sign | 0x7c00;
+	}
+	if (exp <= 0) { // subnormal or zero
+		if (exp < -10) return sign;
+		mant |= 0x800000;
+		const int shift = 14 - exp;
+		boost::uint32_t half = mant >> shift;
+		const boost::uint32_t rest = mant & ((1u << shift) - 1);
+		const boost::uint32_t middle = 1u << (shift - 1);
+		if (rest > middle || (rest == middle && (half & 1))) half++;
+		return sign | half;
+	}
+	boost::uint32_t half = sign | (exp << 10) | (mant >> 13);
+	const boost::uint32_t rest = mant & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++; // carries into the exponent
+	return half;
+}
+
+float halfToFloat(boost::uint16_t h) {
+	const boost::uint32_t sign = (boost::uint32_t)(h & 0x8000) << 16;
+	const boost::uint32_t exp = (h >> 10) & 0x1f;
+	const boost::uint32_t mant = h & 0x3ff;
+	if (exp == 0) { // subnormal or zero
+		float result = std::ldexp((float)mant, -24);
+		return sign ? -result : result;
+	}
+	boost::uint32_t x;
+	if (exp == 31) {
+		x = sign | 0x7f800000 | (mant << 13);
+	} else {
+		x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+	}
+	float result;
+	std::memcpy(&result, &x, sizeof(result));
+	return result;
+}
+
+void DeltaCodec::encode(const double* delta, mf_size_type r, mf_size_type n, EncodedDelta& out,
+		const std::vector<boost::uint32_t>* candidates) const {
+	out = EncodedDelta();
+	out.type = type;
+	out.r = r;
+	out.n = n;
+
+	// select the columns to send
+	std::vector<boost::uint32_t> columns;
+	mf_size_type count = candidates == NULL ? n : candidates->size();
+	for (mf_size_type c=0; c<count; c++) {
+		const mf_size_type j = candidates == NULL ? c : (*candidates)[c];
+		double norm2 = 0;
+		for (mf_size_type z=0; z<r; z++) {
+			norm2 += delta[j*r + z] * delta[j*r + z];
+		}
+		if (norm2 > 0 && norm2 >= threshold * threshold) {
+			columns.push_back(j);
+		}
+	}
+
+	switch (type) {
+	case DELTA_CODEC_NONE:
+		out.columns = columns;
+		out.doubles.reserve(columns.size() * r);
+		for (mf_size_type c=0; c<columns.size(); c++) {
+			const double* d = delta + columns[c]*r;
+			out.doubles.insert(out.doubles.end(), d, d + r);
+		}
+		break;
+	case DELTA_CODEC_FP16:
+	case DELTA_CODEC_INT8:
+		out.columns.reserve(columns.size());
+		out.scales.reserve(columns.size());
+		if (type == DELTA_CODEC_FP16) {
+			out.halfs.reserve(columns.size() * r);
+		} else {
+			out.bytes8.reserve(columns.size() * r);
+		}
+		for (mf_size_type c=0; c<columns.size(); c++) {
+			const double* d = delta + columns[c]*r;
+			double scale = 0;
+			for (mf_size_type z=0; z<r; z++) {
+				scale = std::max(scale, std::fabs(d[z]));
+			}
+			const float rounded = (float)scale; // decoding uses the rounded scale
+			if (!(rounded >= std::numeric_limits<float>::min() && rounded <= std::numeric_limits<float>::max())) {
+				continue; // not normal: 1/rounded is not finite or loses precision (the caller keeps the delta)
+			}
+			out.columns.push_back(columns[c]);
+			out.scales.push_back(rounded);
+			const double f = 1. / rounded;
+			for (mf_size_type z=0; z<r; z++) {
+				if (type == DELTA_CODEC_FP16) {
+					out.halfs.push_back(floatToHalf((float)(d[z] * f)));
+				} else {
+					double q = std::floor(d[z] * f * 127. + 0.5);
+					out.bytes8.push_back((boost::int8_t)std::max(-127., std::min(127., q)));
+				}
+			}
+		}
+		break;
+	case DELTA_CODEC_TOPK:
+	{
+		// magnitude of the k-th largest entry of the selected columns
+		std::vector<double> magnitudes;
+		magnitudes.reserve(columns.size() * r);
+		for (mf_size_type c=0; c<columns.size(); c++) {
+			for (mf_size_type z=0; z<r; z++) {
+				magnitudes.push_back(std::fabs(delta[columns[c]*r + z]));
+			}
+		}
+		if (magnitudes.empty()) break;
+		mf_size_type k = std::max<mf_size_type>(1,
+				std::min<mf_size_type>(magnitudes.size(), (mf_size_type)std::ceil(fraction * magnitudes.size())));
+		std::nth_element(magnitudes.begin(), magnitudes.begin() + (k-1), magnitudes.end(),
+				std::greater<double>());
+		const double kth = magnitudes[k-1];
+
+		// send the entries at least as large (at most k of them)
+		out.columns.reserve(k);
+		out.rows.reserve(k);
+		out.floats.reserve(k);
+		for (mf_size_type c=0; c<columns.size() && out.floats.size()<k; c++) {
+			for (mf_size_type z=0; z<r && out.floats.size()<k; z++) {
+				const mf_size_type p = (mf_size_type)columns[c]*r + z;
+				if (delta[p] != 0 && std::fabs(delta[p]) >= kth) {
+					out.columns.push_back(columns[c]);
+					out.rows.push_back(z);
+					out.floats.push_back((float)delta[p]);
+				}
+			}
+		}
+		break;
+	}
+	default:
+		RG_THROW(rg::InvalidArgumentException, "Unknown delta codec");
+	}
+}
+
+namespace {
+
+/** Implementation of EncodedDelta::addTo for double and single-precision targets */
+template<typename T>
+void addDeltaTo(const EncodedDelta& delta, T* out, double weight) {
+	const mf_size_type r = delta.r;
+	switch (delta.type) {
+	case DELTA_CODEC_NONE:
+		for (mf_size_type c=0; c<delta.columns.size(); c++) {
+			T* o = out + (mf_size_type)delta.columns[c]*r;
+			const double* d = &delta.doubles[c*r];
+			for (mf_size_type z=0; z<r; z++) {
+				o[z] += weight * d[z];
+			}
+		}
+		break;
+	case DELTA_CODEC_FP16:
+		for (mf_size_type c=0; c<delta.columns.size(); c++) {
+			T* o = out + (mf_size_type)delta.columns[c]*r;
+			const double f = weight * delta.scales[c];
+			for (mf_size_type z=0; z<r; z++) {
+				o[z] += f * halfToFloat(delta.halfs[c*r + z]);
+			}
+		}
+		break;
+	case DELTA_CODEC_INT8:
+		for (mf_size_type c=0; c<delta.columns.size(); c++) {
+			T* o = out + (mf_size_type)delta.columns[c]*r;
+			const double f = weight * delta.scales[c] / 127.;
+			for (mf_size_type z=0; z<r; z++) {
+				o[z] += f * delta.bytes8[c*r + z];
+			}
+		}
+		break;
+	case DELTA_CODEC_TOPK:
+		for (mf_size_type p=0; p<delta.columns.size(); p++) {
+			out[(mf_size_type)delta.columns[p]*r + delta.rows[p]] += weight * delta.floats[p];
+		}
+		break;
+	default:
+		RG_THROW(rg::InvalidArgumentException, "Unknown delta codec");
+	}
+}
+
+}
+
+void EncodedDelta::addTo(double* out, double weight) const {
+	addDeltaTo(*this, out, weight);
+}
+
+void EncodedDelta::addTo(float* out, double weight) const {
+	addDeltaTo(*this, out, weight);
+}
+
+void EncodedDelta::sentColumns(std::vector<boost::uint32_t>& out, boost::uint32_t offset) const {
+	if (type != DELTA_CODEC_TOPK) {
+		for (mf_size_type c=0; c<columns.size(); c++) {
+			out.push_back(columns[c] + offset);
+		}
+		return;
+	}
+
+	// entries are sorted by column
+	for (mf_size_type p=0; p<columns.size(); p++) {
+		if (p == 0 || columns[p] != columns[p-1]) {
+			out.push_back(columns[p] + offset);
+		}
+	}
+}
+
+mf_size_type EncodedDelta::bytes() const {
+	return (columns.size() + rows.size()) * sizeof(boost::uint32_t) + scales.size() * sizeof(float)
+			+ doubles.size() * sizeof(double) + floats.size() * sizeof(float)
+			+ halfs.size() * sizeof(boost::uint16_t) + bytes8.size() * sizeof(boost::int8_t);
+}
+
+}
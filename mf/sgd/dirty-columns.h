@@ -0,0 +1,80 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Tracking of the columns of a factor matrix that have been modified since they were last
+ * synchronized (used by ASGD to exchange only the columns of H that have changed).
+ */
+
+#ifndef MF_SGD_DIRTY_COLUMNS_H
+#define MF_SGD_DIRTY_COLUMNS_H
+
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** One dirty flag per column. Writers mark a column while holding its lock (see
+ * mf::LockTable); readers may scan the flags without locks, but must clear a flag only while
+ * holding the lock of the column. A column marked after it has been scanned is picked up by
+ * the next scan.
+ */
+class DirtyColumns : boost::noncopyable {
+public:
+	DirtyColumns(mf_size_type n) : n_(n), flags_(new boost::atomic<bool>[n]) {
+		for (mf_size_type j=0; j<n; j++) {
+			flags_[j].store(false, boost::memory_order_relaxed);
+		}
+	}
+
+	mf_size_type size() const {
+		return n_;
+	}
+
+	/** Marks column j as dirty. Avoids the write (and the cache-line transfer) if the column
+	 * is already marked. */
+	inline void mark(mf_size_type j) {
+		if (!flags_[j].load(boost::memory_order_relaxed)) {
+			flags_[j].store(true, boost::memory_order_relaxed);
+		}
+	}
+
+	inline bool dirty(mf_size_type j) const {
+		return flags_[j].load(boost::memory_order_relaxed);
+	}
+
+	inline void clear(mf_size_type j) {
+		flags_[j].store(false, boost::memory_order_relaxed);
+	}
+
+	/** Appends the dirty columns in [begin,end) to out (in increasing order) */
+	void dirtyColumns(mf_size_type begin, mf_size_type end, std::vector<boost::uint32_t>& out) const {
+		for (mf_size_type j=begin; j<end; j++) {
+			if (dirty(j)) out.push_back(j);
+		}
+	}
+
+private:
+	mf_size_type n_;
+	boost::scoped_array<boost::atomic<bool> > flags_;
+};
+
+}
+
+#endif
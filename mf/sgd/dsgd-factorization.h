@@ -44,16 +44,17 @@ bool checkBlockingDsgd(const DistributedMatrix<M1>& v, const DistributedMatrix<M
  * (5) each rank holds exactly t rows of blocks of V,
  * (6) each rank holds exactly t blocks of H.
  */
-template<typename Data = double, typename Factor = double>
-struct DsgdFactorizationData : public DistributedFactorizationData<Data,Factor> {
+template<typename Data = double, typename Factor = double, typename Index = mf_size_type>
+struct DsgdFactorizationData : public DistributedFactorizationData<Data,Factor,Index> {
 public:
-	typedef DistributedFactorizationData<Data,Factor> Base;
+	typedef DistributedFactorizationData<Data,Factor,Index> Base;
 	typedef typename Base::V V;
 	typedef typename Base::W W;
 	typedef typename Base::H H;
 	typedef typename Base::DV DV;
 	typedef typename Base::DW DW;
 	typedef typename Base::DH DH;
+	typedef typename Base::Local Local;
 
 	DsgdFactorizationData(
 			const DV& dv,
@@ -63,7 +64,7 @@ public:
 		if (!checkBlockingDsgd(dv, dw, dh)) RG_THROW(rg::InvalidArgumentException, "");
 	}
 
-	DsgdFactorizationData(DsgdFactorizationData<Data,Factor>& o)
+	DsgdFactorizationData(DsgdFactorizationData<Data,Factor,Index>& o)
 	: Base(o) {
 	}
 
@@ -81,6 +82,6 @@ private:
 
 }
 
-MPI2_SERIALIZATION_CONSTRUCTOR2(mf::DsgdFactorizationData);
+MF_SERIALIZATION_CONSTRUCTOR3(mf::DsgdFactorizationData);
 
 #endif
@@ -21,6 +21,7 @@
 #include <mpi2/mpi2.h>
 
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/workers.h>
 #include <mf/sgd/dsgd-factorization.h>
 
 namespace mf {
@@ -39,12 +40,13 @@ struct Dsgd : public Sgd<Update, Regularize> {
 	Dsgd(Update update, Regularize regularize,
 			SgdOrder order = SGD_ORDER_WOR, StratumOrder stratumOrder = STRATUM_ORDER_WOR,
 			bool mapReduce = false)
-	: Sgd<Update, Regularize>(update, regularize, order), stratumOrder(stratumOrder), mapReduce(mapReduce) {
+	: Sgd<Update, Regularize>(update, regularize, order), stratumOrder(stratumOrder), mapReduce(mapReduce),
+	  pipelineChunks(1) {
 	}
 
 	Dsgd(Dsgd<Update,Regularize>& o)
 	:  Sgd<Update, Regularize>(o.update, o.regularize, o.order),
-	   stratumOrder(o.stratumOrder), mapReduce(o.mapReduce) {
+	   stratumOrder(o.stratumOrder), mapReduce(o.mapReduce), pipelineChunks(o.pipelineChunks) {
 	}
 
 	Dsgd(mpi2::SerializationConstructor _)
@@ -54,6 +56,16 @@ struct Dsgd : public Sgd<Update, Regularize> {
 	StratumOrder stratumOrder;
 	bool mapReduce;
 
+	/** Number of chunks (of columns) in which a block of H is sent from one task to the next
+	 * (default: 1). With more than one chunk, a task starts its SGD steps as soon as the first
+	 * chunk has arrived and processes the training points chunk by chunk, so that the transfer
+	 * of the remaining chunks overlaps with computation. The SGD steps of a block are then
+	 * partitioned by column chunk: SEQ, WR, and WOR order apply within each chunk, and the
+	 * chunks are processed one after the other. Each task keeps an index of the training points
+	 * of its data blocks by chunk. Only used by the DSGD+ implementation on multiple ranks, and
+	 * only with SGD orders SEQ, WR, and WOR (blocks are sent whole for the other orders). */
+	unsigned pipelineChunks;
+
 private:
 	friend class boost::serialization::access;
 	template<class Archive>
@@ -61,6 +73,7 @@ private:
 		ar & boost::serialization::base_object<Sgd<Update,Regularize> >(*this);
 		ar & stratumOrder;
 		ar & mapReduce;
+		ar & pipelineChunks;
 	}
 };
 
@@ -77,40 +90,42 @@ namespace mf {
  *
  * @tparam Update type of update function (model of UpdateConcept)
  * @tparam Regularize type of regularize function (model of RegularizeConcept)
+ * @tparam FD type of data description (e.g., DsgdFactorizationData<float,double,boost::uint32_t>
+ *         for data matrices with blocks of type mf::CompactSparseMatrixF)
  */
-template<typename Update, typename Regularize>
-struct DsgdJob : public DsgdFactorizationData<>, public Dsgd<Update,Regularize> {
-	DsgdJob(const DistributedSparseMatrix& dv,
-			DistributedDenseMatrix &dw, DistributedDenseMatrixCM& dh,
+template<typename Update, typename Regularize, typename FD = DsgdFactorizationData<> >
+struct DsgdJob : public FD, public Dsgd<Update,Regularize> {
+	DsgdJob(const typename FD::DV& dv,
+			typename FD::DW &dw, typename FD::DH& dh,
 			Update update, Regularize regularize,
 			SgdOrder order = SGD_ORDER_WOR, StratumOrder stratumOrder = STRATUM_ORDER_WOR,
 			bool mapReduce = false, unsigned tasksPerRank=1)
-	: DsgdFactorizationData<>(dv, dw, dh, tasksPerRank),
+	: FD(dv, dw, dh, tasksPerRank),
 	  Dsgd<Update,Regularize>(update, regularize, order, stratumOrder, mapReduce) {
 	}
 
-	DsgdJob(DsgdFactorizationData<> job,
+	DsgdJob(FD job,
                 Update update, Regularize regularize, 
                 SgdOrder order = SGD_ORDER_WOR, StratumOrder stratumOrder = STRATUM_ORDER_WOR,
                 bool mapReduce=false)
-	: DsgdFactorizationData<>(job),
+	: FD(job),
         Dsgd<Update,Regularize>(update, regularize, order, stratumOrder, mapReduce) {
 	}
 
-	DsgdJob(DsgdFactorizationData<>& job,
+	DsgdJob(FD& job,
 			Dsgd<Update,Regularize>& sgd)
-	: DsgdFactorizationData<>(job), Dsgd<Update,Regularize>(sgd) {
+	: FD(job), Dsgd<Update,Regularize>(sgd) {
 	}
 
 	DsgdJob(mpi2::SerializationConstructor _)
-	: DsgdFactorizationData<>(mpi2::UNINITIALIZED), Dsgd<Update,Regularize>(mpi2::UNINITIALIZED) {
+	: FD(mpi2::UNINITIALIZED), Dsgd<Update,Regularize>(mpi2::UNINITIALIZED) {
 	}
 
 private:
 	friend class boost::serialization::access;
 	template<class Archive>
 	void serialize(Archive & ar, const unsigned int version) {
-		ar & boost::serialization::base_object<DsgdFactorizationData<>  >(*this);
+		ar & boost::serialization::base_object<FD>(*this);
 		ar & boost::serialization::base_object<Dsgd<Update, Regularize> >(*this);
 	}
 };
@@ -118,14 +133,20 @@ private:
 
 } // namespace mf
 
-MPI2_SERIALIZATION_CONSTRUCTOR2(mf::DsgdJob);
+MF_SERIALIZATION_CONSTRUCTOR3(mf::DsgdJob);
 
 namespace mf {
 
 /** Runs a distributed SGD-based factorization job */
 class DsgdRunner {
 public:
-	DsgdRunner(rg::Random32& random) : random_(random) {
+	DsgdRunner(rg::Random32& random) : random_(random), onlineLossEvery_(0) {
+	}
+
+	/** Uses the training loss accumulated by the workers during each epoch instead of the
+	 * exact loss, which is then computed only every k epochs (see SgdRunner::setOnlineLoss()). */
+	void setOnlineLoss(mf_size_type k) {
+		onlineLossEvery_ = k;
 	}
 
 	/** Runs a number of DSGD epochs using a distributed adaptive decay function. This is the most
@@ -140,13 +161,14 @@ public:
 	 *
  	 * @tparam Update type of update function (model of UpdateConcept)
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
+ 	 * @tparam FD type of data description (see mf::DsgdJob)
  	 * @tparam Loss type of loss function (model of DistributedLossConcept)
  	 * @tparam AdaptiveDecay type of decay function (model of DistributedAdaptiveDecayConcept)
 	 */
-	template<typename Update, typename Regularize, typename DistributedLoss,
+	template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 		typename DistributedAdaptiveDecay,
 		typename TestData, typename TestLoss>
-	void run(DsgdJob<Update, Regularize>& job,
+	void run(DsgdJob<Update, Regularize, FD>& job,
 			DistributedLoss& loss,
 			mf_size_type epochs,
 			DistributedAdaptiveDecay& decay,
@@ -154,9 +176,9 @@ public:
 			BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE,
 			TestData* testData = NULL, TestLoss *testLoss = NULL);
 
-	template<typename Update, typename Regularize, typename DistributedLoss,
+	template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 		typename DistributedAdaptiveDecay>
-	void run(DsgdJob<Update, Regularize>& job, DistributedLoss& loss,
+	void run(DsgdJob<Update, Regularize, FD>& job, DistributedLoss& loss,
 			mf_size_type epochs, DistributedAdaptiveDecay& decay,
 			Trace& trace, BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE);
 
@@ -170,11 +192,14 @@ public:
  	 * @tparam Update type of update function (model of UpdateConcept)
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
 	 */
-	template<typename Update, typename Regularize>
-	void epoch(DsgdJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void epoch(DsgdJob<Update, Regularize, FD>& job, double eps);
 
 private:
 	rg::Random32& random_;
+	WorkerGroup workers_; // tasks of the job that is currently run
+	mf_size_type onlineLossEvery_;
+	OnlineLoss onlineLoss_; // online loss of the current epoch (merged from all workers)
 };
 
 }
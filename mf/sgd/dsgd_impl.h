@@ -20,13 +20,21 @@
 
 #include <mf/sgd/dsgd.h> // help for compilers
 
+#include <mf/matrix/coordinate.h>
+#include <mf/matrix/transfer.h>
 #include <mf/matrix/op/shuffle.h>
+#include <mf/sgd/decay/decay_constant.h>
 
 namespace mf {
 
-template<typename Update, typename Regularize, typename DistributedLoss,
+namespace detail {
+	template<typename Update, typename Regularize, typename FD = DsgdFactorizationData<> >
+	struct DsgdTask; // started by run()
+}
+
+template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 	typename DistributedAdaptiveDecay,typename TestData,typename TestLoss>
-void DsgdRunner::run(DsgdJob<Update, Regularize>& job, DistributedLoss& loss,
+void DsgdRunner::run(DsgdJob<Update, Regularize, FD>& job, DistributedLoss& loss,
 		mf_size_type epochs, DistributedAdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod,
 		TestData* testData, TestLoss *testLoss) {
@@ -57,30 +65,121 @@ void DsgdRunner::run(DsgdJob<Update, Regularize>& job, DistributedLoss& loss,
 		LOG4CXX_INFO(detail::logger, "Using slow MapReduce-style implementation");
 	} else {
 		LOG4CXX_INFO(detail::logger, "Using fast DSGD+ implementation");
+		if (job.pipelineChunks > 1) {
+			LOG4CXX_INFO(detail::logger, "Sending blocks of H in " << job.pipelineChunks << " chunks");
+		}
 	}
 
+	// start the tasks once; they stay alive for all epochs
+	workers_.start<detail::DsgdTask<Update, Regularize, FD> >(job, job.tasksPerRank, random_);
 	detail::defaultRunner(job, loss, epochs, decay,
-			boost::bind(&DsgdRunner::epoch<Update,Regularize>, this, _1, _2),
-			trace, random_, balanceType, balanceMethod, testData, testLoss);
+			boost::bind(&DsgdRunner::epoch<Update,Regularize,FD>, this, _1, _2),
+			trace, random_, balanceType, balanceMethod, testData, testLoss,
+			onlineLossEvery_, &onlineLoss_);
+	workers_.stop();
 
 	LOG4CXX_INFO(detail::logger, "Finished DSGD");
 }
 
-template<typename Update, typename Regularize, typename DistributedLoss,
+template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 	typename DistributedAdaptiveDecay>
-void DsgdRunner::run(DsgdJob<Update, Regularize>& job, DistributedLoss& loss,
+void DsgdRunner::run(DsgdJob<Update, Regularize, FD>& job, DistributedLoss& loss,
 		mf_size_type epochs, DistributedAdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod) {
-	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (DsgdFactorizationData<>*)NULL, (NoLoss*)NULL);
+	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (FD*)NULL, (NoLoss*)NULL);
 }
 
 
 namespace detail {
 
-template<typename Update, typename Regularize>
+/** Returns the first columns of the chunks in which an H block with n columns is sent when
+ * pipelining (see Dsgd::pipelineChunks) */
+inline std::vector<mf_size_type> pipelineChunkOffsets(mf_size_type n, unsigned chunks) {
+	std::vector<mf_size_type> offsets;
+	computeDefaultBlockOffsets(n, std::max<mf_size_type>(1, std::min<mf_size_type>(chunks, n)), offsets);
+	return offsets;
+}
+
+/** Returns true if the training points of a data block can be processed chunk by chunk in
+ * the given SGD order when pipelining (see Dsgd::pipelineChunks) */
+inline bool pipelineSupportsOrder(SgdOrder order) {
+	return order == SGD_ORDER_SEQ || order == SGD_ORDER_WR || order == SGD_ORDER_WOR;
+}
+
+/** The training points of a data block grouped by the column chunks of pipelining. Positions
+ * [offsets[k], offsets[k+1]) of positions hold the storage positions of the training points
+ * in chunk k (in storage order, unless shuffled). */
+struct ColumnChunkIndex {
+	std::vector<mf_size_type> positions;
+	std::vector<mf_size_type> offsets;
+	std::vector<mf_size_type> sample; // temp space for WR order
+
+	bool empty() const {
+		return offsets.empty();
+	}
+};
+
+/** Indexes the training points of a data block by the column chunks with the given offsets */
+template<typename M>
+void indexColumnChunks(const M& v, const std::vector<mf_size_type>& chunkOffsets,
+		ColumnChunkIndex& index) {
+	const typename M::index_array_type& index2 = columnIndexData(v);
+	std::vector<mf_size_type> chunkOf(v.nnz());
+	index.offsets.assign(chunkOffsets.size()+1, 0);
+	for (mf_size_type p=0; p<v.nnz(); p++) {
+		chunkOf[p] = std::upper_bound(chunkOffsets.begin(), chunkOffsets.end(), (mf_size_type)index2[p])
+				- chunkOffsets.begin() - 1;
+		index.offsets[chunkOf[p]+1]++;
+	}
+	for (mf_size_type k=0; k<chunkOffsets.size(); k++) {
+		index.offsets[k+1] += index.offsets[k];
+	}
+	std::vector<mf_size_type> next(index.offsets.begin(), index.offsets.end()-1);
+	index.positions.resize(v.nnz());
+	for (mf_size_type p=0; p<v.nnz(); p++) {
+		index.positions[next[chunkOf[p]]++] = p;
+	}
+}
+
+/** Runs the SGD steps of chunk k of a data block (one per training point of the chunk) in
+ * the SGD order of the job, which must be supported by pipelineSupportsOrder(). */
+template<typename Update, typename Regularize, typename FD>
+void updateColumnChunk(SgdJob<Update,Regularize,FD>& job, ColumnChunkIndex& index, mf_size_type k,
+		double eps, rg::Random32& random) {
+	DecayConstant decay(eps);
+	const mf_size_type begin = index.offsets[k], end = index.offsets[k+1], n = end - begin;
+	switch (job.order) {
+	case SGD_ORDER_SEQ:
+		SgdRunner::updateWor(job, decay, random, begin, end, 0, index.positions);
+		break;
+	case SGD_ORDER_WOR:
+		for (mf_size_type i=begin; i+1<end; i++) {
+			std::swap(index.positions[i], index.positions[i + random.nextInt(end - i)]);
+		}
+		SgdRunner::updateWor(job, decay, random, begin, end, 0, index.positions);
+		break;
+	case SGD_ORDER_WR:
+		index.sample.resize(n);
+		for (mf_size_type i=0; i<n; i++) {
+			index.sample[i] = index.positions[begin + random.nextInt(n)];
+		}
+		SgdRunner::updateWor(job, decay, random, 0, n, 0, index.sample);
+		break;
+	default:
+		RG_THROW(rg::InvalidArgumentException, "SGD order not supported when pipelining");
+		break;
+	}
+}
+
+template<typename Update, typename Regularize, typename FD>
 struct DsgdTask {
+	typedef typename FD::V BlockV;
+	typedef typename FD::W BlockW;
+	typedef typename FD::H BlockH;
+
 	static const std::string id() { return std::string("__mf/sgd/DsgdTask_")
-			+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name(); }
+			+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name()
+			+ "_" + mpi2::TypeTraits<BlockV>::name() + "_" + mpi2::TypeTraits<BlockH>::name(); }
 
 	static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
 		rg::Random32 random = mpi2::getSeed(ch);
@@ -90,146 +189,208 @@ struct DsgdTask {
 		int id = info.groupId();
 		const mf_size_type d = info.groupSize();
 
-		// receive data descriptor
-		DsgdJob<Update,Regularize> job(mpi2::UNINITIALIZED);
+		// receive data descriptor (once; the task then runs one epoch per received command)
+		DsgdJob<Update,Regularize,FD> job(mpi2::UNINITIALIZED);
+		ch.recv(job);
+		bool pinned;
+		WorkerSync* sync = recvWorkerSync(ch, &pinned); // non-NULL when all tasks run in this process
+		if (pinned) placeWorkerData(job, id, ch.world().size() == 1 && !job.mapReduce);
 		double eps;
 		boost::numeric::ublas::matrix<mf_size_type> schedule(d, d);
-		ch.recv(*mpi2::unmarshal(job, eps, schedule));
 
 		// run
-		DenseMatrixCM *H = NULL;
-		DenseMatrixCM *Hprev  = NULL;
-		if (ch.world().size() > 1  || job.mapReduce) {
-			H =  new DenseMatrixCM(0,0);
-			Hprev = new DenseMatrixCM(0,0);
+		BlockH *H = NULL;
+		BlockH *Hprev  = NULL;
+		bool ownH = ch.world().size() > 1  || job.mapReduce;
+		if (ownH) {
+			H =  new BlockH(0,0);
+			Hprev = new BlockH(0,0);
 		}
 		SgdRunner runner(random);
-		for (mf_size_type subepoch = 0; subepoch < d; subepoch++) {
-			LOG4CXX_DEBUG(detail::logger, id << ": "
-					<< "Starting subepoch " << subepoch);
-
-			mpi2::logBeginEvent("subepoch");
-			mpi2::logBeginEvent("communication");
-
-			mf_size_type b1 = id;
-			mf_size_type b2 = schedule(subepoch, id);
-
-			// get W and V
-			mpi2::RemoteVar rv = job.dw.block(b1,0); // compiler yells if I don't use a temp...!
-			DenseMatrix *bW = rv.getLocal<DenseMatrix>();
-			rv = job.dv.block(b1, b2);
-			SparseMatrix *bV = rv.getLocal<SparseMatrix>();
-
-			// get H
-			if (job.mapReduce) {
-				mpi2::RemoteVar vH = job.dh.block(0,b2);
-				vH.getCopy(*H);
-			} else {
-				// fetch H directly from previous task / send my previous H to next task
-				std::swap(H, Hprev);
-				if (ch.world().size() == 1) { // single node
-					mpi2::RemoteVar vH = job.dh.block(0,b2);
-					H = vH.getLocal<DenseMatrixCM>();
-				} else if (subepoch == 0) { // first epoch: read from env
+		std::vector<TiledPoints> tiles(job.dv.blocks2()); // tiles of the data block per column block (on first use)
+		LazyScale scale; // W stays at this task during an epoch; its regularize steps are applied at the end
+		const bool lazy = detail::useLazyScale<Update,Regularize>(job.order);
+
+		// pipelining: H blocks are received in chunks, the data blocks are processed accordingly
+		const bool pipeline = job.pipelineChunks > 1 && ch.world().size() > 1 && !job.mapReduce
+				&& pipelineSupportsOrder(job.order);
+		std::vector<ColumnChunkIndex> chunkIndex(pipeline ? job.dv.blocks2() : 0); // per column block (on first use)
+		std::vector<boost::mpi::request> sendReqs, recvReqs; // requests of the chunks
+		while (recvWorkerCommand(ch, eps, schedule)) {
+			OnlineLoss loss;
+			OnlineLoss::Scope lossScope(&loss);
+			for (mf_size_type subepoch = 0; subepoch < d; subepoch++) {
+				LOG4CXX_DEBUG(detail::logger, id << ": "
+						<< "Starting subepoch " << subepoch);
+
+				mpi2::logBeginEvent("subepoch");
+				mpi2::logBeginEvent("communication");
+
+				mf_size_type b1 = id;
+				mf_size_type b2 = schedule(subepoch, id);
+
+				// get W and V
+				mpi2::RemoteVar rv = job.dw.block(b1,0); // compiler yells if I don't use a temp...!
+				BlockW *bW = rv.getLocal<BlockW>();
+				rv = job.dv.block(b1, b2);
+				BlockV *bV = rv.getLocal<BlockV>();
+
+				// get H
+				if (job.mapReduce) {
 					mpi2::RemoteVar vH = job.dh.block(0,b2);
-					vH.getCopy(*H);
-				} else { // subsequent epoch: communicate directly
-					boost::mpi::request reqs[4];
-					int numReqs = 0;
-					mpi2::PointerIntType
-						pH_cur = mpi2::pointerToInt(H),								// current pointer to H
-						pHprev_cur = mpi2::pointerToInt(Hprev),                     // current pointer to Hprev
-						pH_new = mpi2::pointerToInt(H),                             // new pointer to H
-						pHprev_new = mpi2::pointerToInt(Hprev);                     // new pointer to Hprev
-					bool exchangePointersH = false, exchangePointersHprev = false;
-
-					// send the previous block of H to the next task
-					mf_size_type idNext;
-					for (idNext=0; idNext<d; idNext++) {
-						if (schedule(subepoch,idNext) == schedule(subepoch-1,id)) break;
-					}
-					if (channels[idNext].remote().rank == channels[idNext].local().rank) {
-						reqs[numReqs++] = channels[idNext].isend(pHprev_cur); // send pointer
-						exchangePointersHprev = true;
-					} else {
-						reqs[numReqs++] = channels[idNext].isend(*Hprev);     // send data
-					}
+					mf::getCopy(vH, *H);
+				} else {
+					// fetch H directly from previous task / send my previous H to next task
+					std::swap(H, Hprev);
+					if (ch.world().size() == 1) { // single node
+						mpi2::RemoteVar vH = job.dh.block(0,b2);
+						H = vH.getLocal<BlockH>();
+					} else if (subepoch == 0) { // first epoch: read from env
+						mpi2::RemoteVar vH = job.dh.block(0,b2);
+						mf::getCopy(vH, *H);
+					} else { // subsequent epoch: communicate directly
+						std::vector<boost::mpi::request> reqs;
+						mpi2::PointerIntType
+							pH_cur = mpi2::pointerToInt(H),								// current pointer to H
+							pHprev_cur = mpi2::pointerToInt(Hprev),                     // current pointer to Hprev
+							pH_new = mpi2::pointerToInt(H),                             // new pointer to H
+							pHprev_new = mpi2::pointerToInt(Hprev);                     // new pointer to Hprev
+						bool exchangePointersH = false, exchangePointersHprev = false;
+
+						// send the previous block of H to the next task
+						mf_size_type idNext;
+						for (idNext=0; idNext<d; idNext++) {
+							if (schedule(subepoch,idNext) == schedule(subepoch-1,id)) break;
+						}
+						if (channels[idNext].remote().rank == channels[idNext].local().rank) {
+							reqs.push_back(channels[idNext].isend(pHprev_cur)); // send pointer
+							exchangePointersHprev = true;
+						} else if (pipeline) {
+							// send data in chunks of columns (completed after the SGD steps of this subepoch)
+							std::vector<mf_size_type> offsets = pipelineChunkOffsets(Hprev->size2(), job.pipelineChunks);
+							for (mf_size_type k=0; k<offsets.size(); k++) {
+								mf_size_type n = blockSize(k, Hprev->size2(), offsets);
+								sendReqs.push_back(isendDenseColumns(channels[idNext], *Hprev, offsets[k], offsets[k]+n));
+							}
+						} else {
+							reqs.push_back(isendDense(channels[idNext], *Hprev));     // send data
+						}
 
-					// receive the next block of H from the previous task
-					mf_size_type idPrev;
-					for (idPrev=0; idPrev<d; idPrev++) {
-						if (schedule(subepoch-1,idPrev) == b2) break;
-					}
-					if (channels[idPrev].remote().rank == channels[idPrev].local().rank) {
-						reqs[numReqs++] = channels[idPrev].irecv(pH_new); // recv pointer
-						exchangePointersH = true;
-					} else {
-						reqs[numReqs++] = channels[idPrev].irecv(*H);     // recv data
-					}
+						// receive the next block of H from the previous task
+						mf_size_type idPrev;
+						for (idPrev=0; idPrev<d; idPrev++) {
+							if (schedule(subepoch-1,idPrev) == b2) break;
+						}
+						if (channels[idPrev].remote().rank == channels[idPrev].local().rank) {
+							reqs.push_back(channels[idPrev].irecv(pH_new)); // recv pointer
+							exchangePointersH = true;
+						} else if (pipeline) {
+							// receive data in chunks of columns (waited for chunk by chunk during the SGD steps)
+							detail::resizeDense(*H, job.dh.size1(), job.dh.blockSize2(b2));
+							std::vector<mf_size_type> offsets = pipelineChunkOffsets(H->size2(), job.pipelineChunks);
+							for (mf_size_type k=0; k<offsets.size(); k++) {
+								mf_size_type n = blockSize(k, H->size2(), offsets);
+								recvReqs.push_back(irecvDenseColumns(channels[idPrev], *H, offsets[k], offsets[k]+n));
+							}
+						} else {
+							detail::resizeDense(*H, job.dh.size1(), job.dh.blockSize2(b2));
+							reqs.push_back(irecvDense(channels[idPrev], *H));     // recv data
+						}
 
-					// wait for communication to finish
-					boost::mpi::wait_all(reqs, reqs+numReqs);
+						// wait for communication to finish
+						boost::mpi::wait_all(reqs.begin(), reqs.end());
 
-					// if a pointer was received, we send back our pointer (pointers will be exchanged)
-					// similarly, if a pointer was sent, we receive a new pointer
-					numReqs = 0;
-					if (exchangePointersH) reqs[numReqs++] = channels[idPrev].isend(pH_cur); // send pointer
-					if (exchangePointersHprev) reqs[numReqs++] = channels[idNext].irecv(pHprev_new); // receive pointer
-					boost::mpi::wait_all(reqs, reqs+numReqs);
+						// if a pointer was received, we send back our pointer (pointers will be exchanged)
+						// similarly, if a pointer was sent, we receive a new pointer
+						reqs.clear();
+						if (exchangePointersH) reqs.push_back(channels[idPrev].isend(pH_cur)); // send pointer
+						if (exchangePointersHprev) reqs.push_back(channels[idNext].irecv(pHprev_new)); // receive pointer
+						boost::mpi::wait_all(reqs.begin(), reqs.end());
 
-					// update my pointers in case pointers were exchanged
-					if (exchangePointersH) H = mpi2::intToPointer<DenseMatrixCM>(pH_new);
-					if (exchangePointersHprev) Hprev = mpi2::intToPointer<DenseMatrixCM>(pHprev_new);
+						// update my pointers in case pointers were exchanged
+						if (exchangePointersH) H = mpi2::intToPointer<BlockH>(pH_new);
+						if (exchangePointersHprev) Hprev = mpi2::intToPointer<BlockH>(pHprev_new);
+					}
 				}
-			}
-			mpi2::logEndEvent("communication");
-
-			// run the SGD
-			mpi2::logBeginEvent("computation");
-			FactorizationData<> jobData(*bV, *bW, *H, job.nnz1(), job.dv.blockOffset1(b1),
-					job.nnz2(), job.dv.blockOffset2(b2),job.nnz12max);
-			SgdJob<Update,Regularize> sgdJob(jobData, job.update, job.regularize, job.order);
-			double epsRegularize = job.regularize.rescaleStratumStepsize() ? eps/d : eps;
-			runner.epoch(sgdJob, eps, epsRegularize); // regularize called d times per row/column block!
-			mpi2::logEndEvent("computation");
-
-			// store H back
-			if (job.mapReduce) {
-				// store H in every epoch
-				mpi2::logBeginEvent("communication");
-				mpi2::RemoteVar vH = job.dh.block(0,b2);
-				vH.setCopy(*H);
 				mpi2::logEndEvent("communication");
-			} else {
-				// store H in last epoch
-				if (subepoch == d-1 && ch.world().size()>1) {
+
+				// run the SGD
+				mpi2::logBeginEvent("computation");
+				typename FD::Local jobData(*bV, *bW, *H, job.nnz1(), job.dv.blockOffset1(b1),
+						job.nnz2(), job.dv.blockOffset2(b2),job.nnz12max);
+				if (lazy) jobData.scale = &scale;
+				SgdJob<Update,Regularize,typename FD::Local> sgdJob(jobData, job.update, job.regularize, job.order);
+				double epsRegularize = job.regularize.rescaleStratumStepsize() ? eps/d : eps;
+				runner.setTiles(&tiles[b2]);
+				if (recvReqs.empty()) {
+					runner.epoch(sgdJob, eps, epsRegularize); // regularize called d times per row/column block!
+				} else {
+					// process the training points chunk by chunk as the chunks of H arrive
+					std::vector<mf_size_type> offsets = pipelineChunkOffsets(job.dh.blockSize2(b2), job.pipelineChunks);
+					if (chunkIndex[b2].empty()) indexColumnChunks(*bV, offsets, chunkIndex[b2]);
+					for (mf_size_type k=0; k<offsets.size(); k++) {
+						recvReqs[k].wait(); // chunk k of H is received in place
+						updateColumnChunk(sgdJob, chunkIndex[b2], k, eps, random);
+					}
+					runner.regularize(sgdJob, epsRegularize); // regularize called d times per row/column block!
+					recvReqs.clear();
+				}
+				if (lazy) scale.applyH(*H); // H moves on to another task
+				mpi2::logEndEvent("computation");
+
+				// finish sending the chunks of the previous block of H
+				if (!sendReqs.empty()) {
+					mpi2::logBeginEvent("communication");
+					boost::mpi::wait_all(sendReqs.begin(), sendReqs.end());
+					sendReqs.clear();
+					mpi2::logEndEvent("communication");
+				}
+
+				// store H back
+				if (job.mapReduce) {
+					// store H in every epoch
 					mpi2::logBeginEvent("communication");
 					mpi2::RemoteVar vH = job.dh.block(0,b2);
-					vH.setCopy(*H);
+					mf::setCopy(vH, *H);
 					mpi2::logEndEvent("communication");
+				} else {
+					// store H in last epoch
+					if (subepoch == d-1 && ch.world().size()>1) {
+						mpi2::logBeginEvent("communication");
+						mpi2::RemoteVar vH = job.dh.block(0,b2);
+						mf::setCopy(vH, *H);
+						mpi2::logEndEvent("communication");
+					}
 				}
-			}
 
-			// signal that subepoch is done
-			LOG4CXX_DEBUG(detail::logger, id << ": "
-					<< "Finished subepoch " << subepoch);
+				// signal that subepoch is done
+				LOG4CXX_DEBUG(detail::logger, id << ": "
+						<< "Finished subepoch " << subepoch);
 
-			// wait for go to next subepoch (for single-node and MapReduce version only)
-			if (ch.world().size() == 1 || job.mapReduce) {
-				mpi2::logBeginEvent("barrier");
-				barrier(channels);
-				mpi2::logEndEvent("barrier");
+				// wait for go to next subepoch (for single-node and MapReduce version only)
+				if (ch.world().size() == 1 || job.mapReduce) {
+					mpi2::logBeginEvent("barrier");
+					workerBarrier(sync, channels);
+					mpi2::logEndEvent("barrier");
+				}
+
+				mpi2::logEndEvent("subepoch");
+			}
+
+			// apply the regularize steps of this epoch to W
+			if (lazy) {
+				mpi2::RemoteVar rv = job.dw.block(id,0);
+				scale.applyW(*rv.getLocal<BlockW>());
 			}
 
-			mpi2::logEndEvent("subepoch");
+			// signal that the epoch is done
+			signalEpochDone(sync, ch, loss);
 		}
 
-		// signal done
-		if (ch.world().size() > 1) {
+		if (ownH) {
 			delete H;
 			delete Hprev;
 		}
-		ch.send();
 	}
 };
 }
@@ -325,8 +486,8 @@ namespace detail {
 	}
 }
 
-template<typename Update, typename Regularize>
-void DsgdRunner::epoch(DsgdJob<Update, Regularize>& job, double eps) {
+template<typename Update, typename Regularize, typename FD>
+void DsgdRunner::epoch(DsgdJob<Update, Regularize, FD>& job, double eps) {
 	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
 	boost::mpi::communicator& world = tm.world();
 	unsigned worldSize = world.size();
@@ -337,16 +498,15 @@ void DsgdRunner::epoch(DsgdJob<Update, Regularize>& job, double eps) {
 	boost::numeric::ublas::matrix<mf_size_type> schedule = detail::computeDsgdSchedule(worldSize, tasksPerRank, job.stratumOrder, random_);
 	LOG4CXX_DEBUG(detail::logger, "Schedule: " << schedule);
 
-	// fire up the tasks
-	std::vector<mpi2::Channel> channels(worldSize*tasksPerRank, mpi2::UNINITIALIZED);
-	tm.spawnAll<detail::DsgdTask<Update, Regularize> >(tasksPerRank, channels, true);
-
-	// send necessary data to each task
-	mpi2::seed(channels, random_);
-	mpi2::sendAll(channels, mpi2::marshal(job, eps, schedule));
-
-	// wait for completion (use same polling delay as task manager)
-	mpi2::economicRecvAll(channels, tm.pollDelay());
+	// run the epoch on the workers started by run(); if called directly, fire up the tasks
+	// for this epoch only
+	if (workers_.runs(&job)) {
+		workers_.runEpoch(eps, schedule, onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	} else {
+		WorkerGroup workers;
+		workers.start<detail::DsgdTask<Update, Regularize, FD> >(job, tasksPerRank, random_);
+		workers.runEpoch(eps, schedule, onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	}
 }
 
 
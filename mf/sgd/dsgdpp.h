@@ -22,6 +22,7 @@
 
 #include <mf/sgd/sgd.h>
 #include <mf/sgd/dsgd.h>
+#include <mf/sgd/workers.h>
 #include <mf/sgd/dsgdpp-factorization.h>
 
 
@@ -34,39 +35,40 @@ namespace mf {
  *
  * @tparam Update type of update function (model of UpdateConcept)
  * @tparam Regularize type of regularize function (model of RegularizeConcept)
+ * @tparam FD type of data description (see mf::DsgdJob)
  */
-template<typename Update, typename Regularize>
-struct DsgdPpJob : public DsgdPpFactorizationData<>, public Dsgd<Update,Regularize> {
-	DsgdPpJob(const DistributedSparseMatrix& dv,
-			DistributedDenseMatrix &dw, DistributedDenseMatrixCM& dh,
+template<typename Update, typename Regularize, typename FD = DsgdPpFactorizationData<> >
+struct DsgdPpJob : public FD, public Dsgd<Update,Regularize> {
+	DsgdPpJob(const typename FD::DV& dv,
+			typename FD::DW &dw, typename FD::DH& dh,
 			Update update, Regularize regularize,
 			SgdOrder order = STRATUM_ORDER_WOR, StratumOrder stratumOrder = STRATUM_ORDER_WOR,
 			unsigned tasksPerRank=1)
-	: DsgdPpFactorizationData<>(dv, dw, dh, tasksPerRank),
+	: FD(dv, dw, dh, tasksPerRank),
 	  Dsgd<Update,Regularize>(update, regularize, order, stratumOrder) {
 	}
 
-	DsgdPpJob(DsgdPpFactorizationData<> job,
+	DsgdPpJob(FD job,
                   Update update, Regularize regularize, SgdOrder order = STRATUM_ORDER_WR, 
                   StratumOrder stratumOrder = STRATUM_ORDER_WOR)
-	: DsgdPpFactorizationData<>(job),
+	: FD(job),
         Dsgd<Update,Regularize>(update, regularize, order, stratumOrder) {
 	}
 
-	DsgdPpJob(DsgdPpFactorizationData<>& job,
+	DsgdPpJob(FD& job,
                   Dsgd<Update,Regularize>& sgd)
-	: DsgdPpFactorizationData<>(job), Dsgd<Update,Regularize>(sgd) {
+	: FD(job), Dsgd<Update,Regularize>(sgd) {
 	}
 
 	DsgdPpJob(mpi2::SerializationConstructor _)
-	: DsgdPpFactorizationData<>(mpi2::UNINITIALIZED), Dsgd<Update,Regularize>(mpi2::UNINITIALIZED) {
+	: FD(mpi2::UNINITIALIZED), Dsgd<Update,Regularize>(mpi2::UNINITIALIZED) {
 	}
 
 private:
 	friend class boost::serialization::access;
 	template<class Archive>
 	void serialize(Archive & ar, const unsigned int version) {
-		ar & boost::serialization::base_object<DsgdPpFactorizationData<>  >(*this);
+		ar & boost::serialization::base_object<FD>(*this);
 		ar & boost::serialization::base_object<Dsgd<Update, Regularize> >(*this);
 	}
 };
@@ -74,14 +76,20 @@ private:
 
 } // namespace mf
 
-MPI2_SERIALIZATION_CONSTRUCTOR2(mf::DsgdPpJob);
+MF_SERIALIZATION_CONSTRUCTOR3(mf::DsgdPpJob);
 
 namespace mf {
 
 /** Runs a distributed SGD-based factorization job */
 class DsgdPpRunner {
 public:
-	DsgdPpRunner(rg::Random32& random) : random_(random) {
+	DsgdPpRunner(rg::Random32& random) : random_(random), onlineLossEvery_(0) {
+	}
+
+	/** Uses the training loss accumulated by the workers during each epoch instead of the
+	 * exact loss, which is then computed only every k epochs (see SgdRunner::setOnlineLoss()). */
+	void setOnlineLoss(mf_size_type k) {
+		onlineLossEvery_ = k;
 	}
 
 	/** Runs a number of DSGD epochs using a distributed adaptive decay function. This is the most
@@ -96,13 +104,14 @@ public:
 	 *
  	 * @tparam Update type of update function (model of UpdateConcept)
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
+ 	 * @tparam FD type of data description (see mf::DsgdJob)
  	 * @tparam Loss type of loss function (model of DistributedLossConcept)
  	 * @tparam AdaptiveDecay type of decay function (model of DistributedAdaptiveDecayConcept)
 	 */
-	template<typename Update, typename Regularize, typename DistributedLoss,
+	template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 		typename DistributedAdaptiveDecay,
 		typename TestData, typename TestLoss>
-	void run(DsgdPpJob<Update, Regularize>& job,
+	void run(DsgdPpJob<Update, Regularize, FD>& job,
 			DistributedLoss& loss,
 			mf_size_type epochs,
 			DistributedAdaptiveDecay& decay,
@@ -110,9 +119,9 @@ public:
 			BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE,
 			TestData* testData = NULL, TestLoss *testLoss = NULL);
 
-	template<typename Update, typename Regularize, typename DistributedLoss,
+	template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 		typename DistributedAdaptiveDecay>
-	void run(DsgdPpJob<Update, Regularize>& job, DistributedLoss& loss,
+	void run(DsgdPpJob<Update, Regularize, FD>& job, DistributedLoss& loss,
 			mf_size_type epochs, DistributedAdaptiveDecay& decay,
 			Trace& trace, BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE);
 
@@ -126,11 +135,14 @@ public:
  	 * @tparam Update type of update function (model of UpdateConcept)
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
 	 */
-	template<typename Update, typename Regularize>
-	void epoch(DsgdPpJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void epoch(DsgdPpJob<Update, Regularize, FD>& job, double eps);
 
 private:
 	rg::Random32& random_;
+	WorkerGroup workers_; // tasks of the job that is currently run
+	mf_size_type onlineLossEvery_;
+	OnlineLoss onlineLoss_; // online loss of the current epoch (merged from all workers)
 };
 
 }
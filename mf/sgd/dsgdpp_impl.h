@@ -21,12 +21,18 @@
 #include <mf/sgd/dsgdpp.h> // help for compilers
 
 #include <mf/matrix/op/shuffle.h>
+#include <mf/matrix/transfer.h>
 
 namespace mf {
 
-template<typename Update, typename Regularize, typename DistributedLoss,
+namespace detail {
+	template<typename Update, typename Regularize, typename FD = DsgdPpFactorizationData<> >
+	struct DsgdPpTask; // started by run()
+}
+
+template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 	typename DistributedAdaptiveDecay,typename TestData,typename TestLoss>
-void DsgdPpRunner::run(DsgdPpJob<Update, Regularize>& job, DistributedLoss& loss,
+void DsgdPpRunner::run(DsgdPpJob<Update, Regularize, FD>& job, DistributedLoss& loss,
 		mf_size_type epochs, DistributedAdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod,
 		TestData* testData, TestLoss *testLoss) {
@@ -53,27 +59,36 @@ void DsgdPpRunner::run(DsgdPpJob<Update, Regularize>& job, DistributedLoss& loss
 		RG_THROW(rg::InvalidArgumentException, rg::paste("Invalid stratum order: ", job.stratumOrder));
 	}
 
+	// start the tasks once; they stay alive for all epochs
+	workers_.start<detail::DsgdPpTask<Update, Regularize, FD> >(job, job.tasksPerRank, random_);
 	detail::defaultRunner(job, loss, epochs, decay,
-			boost::bind(&DsgdPpRunner::epoch<Update,Regularize>, this, _1, _2),
-			trace, random_, balanceType, balanceMethod, testData, testLoss);
+			boost::bind(&DsgdPpRunner::epoch<Update,Regularize,FD>, this, _1, _2),
+			trace, random_, balanceType, balanceMethod, testData, testLoss,
+			onlineLossEvery_, &onlineLoss_);
+	workers_.stop();
 
 	LOG4CXX_INFO(detail::logger, "Finished DSGD++");
 }
 
-template<typename Update, typename Regularize, typename DistributedLoss,
+template<typename Update, typename Regularize, typename FD, typename DistributedLoss,
 	typename DistributedAdaptiveDecay>
-void DsgdPpRunner::run(DsgdPpJob<Update, Regularize>& job, DistributedLoss& loss,
+void DsgdPpRunner::run(DsgdPpJob<Update, Regularize, FD>& job, DistributedLoss& loss,
 		mf_size_type epochs, DistributedAdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod) {
-	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (DsgdPpFactorizationData<>*)NULL, (NoLoss*)NULL);
+	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (FD*)NULL, (NoLoss*)NULL);
 }
 
 namespace detail {
 
-template<typename Update, typename Regularize>
+template<typename Update, typename Regularize, typename FD>
 struct DsgdPpTask {
+	typedef typename FD::V BlockV;
+	typedef typename FD::W BlockW;
+	typedef typename FD::H BlockH;
+
 	static const std::string id() { return std::string("__mf/sgd/DsgdPpTask_")
-			+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name(); }
+			+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name()
+			+ "_" + mpi2::TypeTraits<BlockV>::name() + "_" + mpi2::TypeTraits<BlockH>::name(); }
 
 	static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
 		rg::Random32 random = mpi2::getSeed(ch);
@@ -83,17 +98,20 @@ struct DsgdPpTask {
 		int id = info.groupId();
 		const mf_size_type d = info.groupSize();
 
-		// receive data descriptor
-		DsgdPpJob<Update,Regularize> job(mpi2::UNINITIALIZED);
+		// receive data descriptor (once; the task then runs one epoch per received command)
+		DsgdPpJob<Update,Regularize,FD> job(mpi2::UNINITIALIZED);
+		ch.recv(job);
+		bool pinned;
+		WorkerSync* sync = recvWorkerSync(ch, &pinned); // non-NULL when all tasks run in this process
+		if (pinned) placeWorkerData(job, id, ch.world().size() == 1);
 		double eps;
 		boost::numeric::ublas::matrix<mf_size_type> schedule(2*d, d);
-		ch.recv(*mpi2::unmarshal(job, eps, schedule));
 //		LOG4CXX_DEBUG(detail::logger, id << ": schedule=" << schedule);
 
 		// initialize
-		DenseMatrixCM *Hnext  = NULL;    // next block to work on
-		DenseMatrixCM *H = NULL;         // block being worked on
-		DenseMatrixCM *Hprev  = NULL;    // block worked on previously
+		BlockH *Hnext  = NULL;    // next block to work on
+		BlockH *H = NULL;         // block being worked on
+		BlockH *Hprev  = NULL;    // block worked on previously
 		boost::mpi::request HnextReq;    // MPI request for receiving next block to process
 		boost::mpi::request HnextPointerReq; // Additional MPI request for receiving next block to process (only when local)
 		boost::mpi::request HprevReq;    // MPI request for sending previous block being processed
@@ -103,183 +121,191 @@ struct DsgdPpTask {
 		mpi2::PointerIntType HprevPointer = 0; // pointer to previous block (when local, else 0)
 		mpi2::PointerIntType HprevPointerOld = 0; // temporary variable used for sending pointer to Hprev
 		if (ch.world().size() > 1) {
-			Hnext = new DenseMatrixCM(0,0);
-			H =  new DenseMatrixCM(0,0);
-			Hprev = new DenseMatrixCM(0,0);
+			Hnext = new BlockH(0,0);
+			H =  new BlockH(0,0);
+			Hprev = new BlockH(0,0);
 		}
 
 		// run
 		SgdRunner runner(random);
+		std::vector<TiledPoints> tiles(job.dv.blocks2()); // tiles of the data block per column block (on first use)
 		const int FIRST = 0;
 		const int SECOND = 1;
 		const int LAST = 2*d-1;
 		const int LAST_BUT_ONE = 2*d-2;
-		for (mf_size_type subepoch = FIRST; subepoch <= LAST; subepoch++) {
-			LOG4CXX_DEBUG(detail::logger, id << ": " << "Starting subepoch " << subepoch);
-			mpi2::logBeginEvent("subepoch");
-
-			// figure out which blocks to process
-			mf_size_type b1 = id;                                    // current row block of W
-			mf_size_type b2 = schedule(subepoch, id);                // current col block of H
-			mf_size_type b2Prev = -1;                                // previous col block of H
-			if (subepoch > FIRST) b2Prev = schedule(subepoch-1, id);
-			mf_size_type b2Next = -1;                                // next col block of H
-			if (subepoch < LAST) b2Next = schedule(subepoch+1, id);
-
-//			LOG4CXX_DEBUG(detail::logger, id << ": b1=" << b1 << ", b2=" << b2 << ", b2prev=" << b2Prev << ", b2Next=" << b2Next);
-
-			// get W and V
-			mpi2::RemoteVar rv = job.dw.block(b1,0); // compiler yells if I don't use a temp...!
-			DenseMatrix *bW = rv.getLocal<DenseMatrix>();
-			rv = job.dv.block(b1, b2);
-			SparseMatrix *bV = rv.getLocal<SparseMatrix>();
-
-			// get H
-			if (ch.world().size() == 1) { // single node
-				mpi2::RemoteVar vH = job.dh.block(0,b2);
-				H = vH.getLocal<DenseMatrixCM>();
-			} else if (subepoch == FIRST) { // first epoch: read from env
-				// get the current block
-				mpi2::logBeginEvent("communication");
-				mpi2::RemoteVar vH = job.dh.block(0,b2);
-				vH.getCopy(*H); // synchronous
-				mpi2::logEndEvent("communication");
-
-				// prefetch next block
-//				LOG4CXX_DEBUG(detail::logger, id << ": " << "isend HnextReq: (env)");
-				vH = job.dh.block(0,b2Next);
-				HnextReq = vH.igetCopy(*Hnext);
-				HnextPointer = 0;
-			} else { // subsequent epoch: communicate directly
-				mpi2::logBeginEvent("communication");
-
-				// finish up sending and receiving Hprev / Hnext (data or pointers)
-//				LOG4CXX_DEBUG(detail::logger, id << ": " << "Finish communication Hprev/Hnext");
-				std::vector<boost::mpi::request> reqs;
-				if (subepoch > SECOND) reqs.push_back(HprevReq);
-				reqs.push_back(HnextReq);
-				boost::mpi::wait_all(reqs.begin(), reqs.end());
-
-				// if pointers were exchanged (indicated by HprevPointer!=0 and HnextPointer!=0),
-				// finish sending our old pointers
-//				LOG4CXX_DEBUG(detail::logger, id << ": " << "Finish communication Hprev/Hnext pointers");
-				reqs.clear();
-				if (subepoch > SECOND && HprevPointer != 0) reqs.push_back(HprevPointerReq);
-				if (HnextPointer != 0) reqs.push_back(HnextPointerReq);
-				boost::mpi::wait_all(reqs.begin(), reqs.end());
-
-				// if pointers were exchanged, update my pointers
-//				LOG4CXX_DEBUG(detail::logger, id << ": " << "All communication finished");
-				if (subepoch > SECOND && HprevPointer != 0) Hprev = mpi2::intToPointer<DenseMatrixCM>(HprevPointer);
-				if (HnextPointer != 0) Hnext = mpi2::intToPointer<DenseMatrixCM>(HnextPointer);
-
-				mpi2::logEndEvent("communication");
-
-				// update Hprev, H, Hnext
-				std::swap(Hprev, H);
-				std::swap(H, Hnext);
-
-				// send/receive previous / next blocksend block that has been processed in previous subepoch to next node (Hprev)
-				if (subepoch < LAST) {
-					// there are more subepochs
-					mf_size_type idPrev; // id of task who gets Hprev
-					for (idPrev=0; idPrev<d; idPrev++) {
-						if (b2Prev == schedule(subepoch+1,idPrev)) break;
-					}
-					mf_size_type idNext; // id of task who has Hnext
-					for (idNext=0; idNext<d; idNext++) {
-						if (b2Next == schedule(subepoch-1,idNext)) break;
-					}
-//					LOG4CXX_DEBUG(detail::logger, id << ": idPrev=" << idPrev << ", idNext=" << idNext);
-
-
-					// (1) receive HprevPointer
-					if (channels[idPrev].remote().rank == channels[idPrev].local().rank) {
-//						LOG4CXX_DEBUG(detail::logger, id << ": " << "irecv HprevReq (pointer): " << channels[idPrev]);
-						HprevReq = channels[idPrev].irecv(HprevPointer); // receive pointer
-					}
-
-					// (2) receive Hnext / HnextPointer
-					if (channels[idNext].remote().rank == channels[idNext].local().rank) {
-//						LOG4CXX_DEBUG(detail::logger, id << ": " << "irecv HnextReq (pointer)" << channels[idNext]);
-						HnextReq = channels[idNext].irecv(HnextPointer); // receive pointer
+		while (recvWorkerCommand(ch, eps, schedule)) {
+			OnlineLoss loss;
+			OnlineLoss::Scope lossScope(&loss);
+			for (mf_size_type subepoch = FIRST; subepoch <= LAST; subepoch++) {
+				LOG4CXX_DEBUG(detail::logger, id << ": " << "Starting subepoch " << subepoch);
+				mpi2::logBeginEvent("subepoch");
+
+				// figure out which blocks to process
+				mf_size_type b1 = id;                                    // current row block of W
+				mf_size_type b2 = schedule(subepoch, id);                // current col block of H
+				mf_size_type b2Prev = -1;                                // previous col block of H
+				if (subepoch > FIRST) b2Prev = schedule(subepoch-1, id);
+				mf_size_type b2Next = -1;                                // next col block of H
+				if (subepoch < LAST) b2Next = schedule(subepoch+1, id);
+
+//				LOG4CXX_DEBUG(detail::logger, id << ": b1=" << b1 << ", b2=" << b2 << ", b2prev=" << b2Prev << ", b2Next=" << b2Next);
+
+				// get W and V
+				mpi2::RemoteVar rv = job.dw.block(b1,0); // compiler yells if I don't use a temp...!
+				BlockW *bW = rv.getLocal<BlockW>();
+				rv = job.dv.block(b1, b2);
+				BlockV *bV = rv.getLocal<BlockV>();
+
+				// get H
+				if (ch.world().size() == 1) { // single node
+					mpi2::RemoteVar vH = job.dh.block(0,b2);
+					H = vH.getLocal<BlockH>();
+				} else if (subepoch == FIRST) { // first epoch: read from env
+					// get the current block
+					mpi2::logBeginEvent("communication");
+					mpi2::RemoteVar vH = job.dh.block(0,b2);
+					mf::getCopy(vH, *H); // synchronous
+					mpi2::logEndEvent("communication");
+
+					// prefetch next block
+//					LOG4CXX_DEBUG(detail::logger, id << ": " << "isend HnextReq: (env)");
+					vH = job.dh.block(0,b2Next);
+					HnextReq = mf::igetCopy(vH, *Hnext, job.dh.size1(), job.dh.blockSize2(b2Next));
+					HnextPointer = 0;
+				} else { // subsequent epoch: communicate directly
+					mpi2::logBeginEvent("communication");
+
+					// finish up sending and receiving Hprev / Hnext (data or pointers)
+//					LOG4CXX_DEBUG(detail::logger, id << ": " << "Finish communication Hprev/Hnext");
+					std::vector<boost::mpi::request> reqs;
+					if (subepoch > SECOND) reqs.push_back(HprevReq);
+					reqs.push_back(HnextReq);
+					boost::mpi::wait_all(reqs.begin(), reqs.end());
+
+					// if pointers were exchanged (indicated by HprevPointer!=0 and HnextPointer!=0),
+					// finish sending our old pointers
+//					LOG4CXX_DEBUG(detail::logger, id << ": " << "Finish communication Hprev/Hnext pointers");
+					reqs.clear();
+					if (subepoch > SECOND && HprevPointer != 0) reqs.push_back(HprevPointerReq);
+					if (HnextPointer != 0) reqs.push_back(HnextPointerReq);
+					boost::mpi::wait_all(reqs.begin(), reqs.end());
+
+					// if pointers were exchanged, update my pointers
+//					LOG4CXX_DEBUG(detail::logger, id << ": " << "All communication finished");
+					if (subepoch > SECOND && HprevPointer != 0) Hprev = mpi2::intToPointer<BlockH>(HprevPointer);
+					if (HnextPointer != 0) Hnext = mpi2::intToPointer<BlockH>(HnextPointer);
+
+					mpi2::logEndEvent("communication");
+
+					// update Hprev, H, Hnext
+					std::swap(Hprev, H);
+					std::swap(H, Hnext);
+
+					// send/receive previous / next blocksend block that has been processed in previous subepoch to next node (Hprev)
+					if (subepoch < LAST) {
+						// there are more subepochs
+						mf_size_type idPrev; // id of task who gets Hprev
+						for (idPrev=0; idPrev<d; idPrev++) {
+							if (b2Prev == schedule(subepoch+1,idPrev)) break;
+						}
+						mf_size_type idNext; // id of task who has Hnext
+						for (idNext=0; idNext<d; idNext++) {
+							if (b2Next == schedule(subepoch-1,idNext)) break;
+						}
+//						LOG4CXX_DEBUG(detail::logger, id << ": idPrev=" << idPrev << ", idNext=" << idNext);
+
+
+						// (1) receive HprevPointer
+						if (channels[idPrev].remote().rank == channels[idPrev].local().rank) {
+//							LOG4CXX_DEBUG(detail::logger, id << ": " << "irecv HprevReq (pointer): " << channels[idPrev]);
+							HprevReq = channels[idPrev].irecv(HprevPointer); // receive pointer
+						}
+
+						// (2) receive Hnext / HnextPointer
+						if (channels[idNext].remote().rank == channels[idNext].local().rank) {
+//							LOG4CXX_DEBUG(detail::logger, id << ": " << "irecv HnextReq (pointer)" << channels[idNext]);
+							HnextReq = channels[idNext].irecv(HnextPointer); // receive pointer
+						} else {
+//							LOG4CXX_DEBUG(detail::logger, id << ": " << "irecv HnextReq (data)" << channels[idNext]);
+							detail::resizeDense(*Hnext, job.dh.size1(), job.dh.blockSize2(b2Next));
+							HnextReq = irecvDense(channels[idNext], *Hnext);     // recv data
+							HnextPointer = 0; // mark that we did not exchange pointers
+						}
+
+						// (1) send HnextPointerOld
+						if (channels[idNext].remote().rank == channels[idNext].local().rank) {
+//							LOG4CXX_DEBUG(detail::logger, id << ": " << "isend HnextPointerReq: " << channels[idNext]);
+							HnextPointerOld = mpi2::pointerToInt(Hnext);
+							HnextPointerReq = channels[idNext].isend(HnextPointerOld); // send pointer
+						}
+
+						// (2) send Hprev / HprevPointerOld
+						if (channels[idPrev].remote().rank == channels[idPrev].local().rank) {
+//							LOG4CXX_DEBUG(detail::logger, id << ": " << "isend HprevPointerReq: " << channels[idPrev]);
+							HprevPointerOld = mpi2::pointerToInt(Hprev);
+							HprevPointerReq = channels[idPrev].isend(HprevPointerOld); // send pointer
+						} else {
+//							LOG4CXX_DEBUG(detail::logger, id << ": " << "isend HprevReq: " << channels[idPrev]);
+							HprevReq = isendDense(channels[idPrev], *Hprev);     // send data
+							HprevPointer = 0; // mark that we did not exchange pointers
+						}
 					} else {
-//						LOG4CXX_DEBUG(detail::logger, id << ": " << "irecv HnextReq (data)" << channels[idNext]);
-						HnextReq = channels[idNext].irecv(*Hnext);     // recv data
-						HnextPointer = 0; // mark that we did not exchange pointers
-					}
-
-					// (1) send HnextPointerOld
-					if (channels[idNext].remote().rank == channels[idNext].local().rank) {
-//						LOG4CXX_DEBUG(detail::logger, id << ": " << "isend HnextPointerReq: " << channels[idNext]);
-						HnextPointerOld = mpi2::pointerToInt(Hnext);
-						HnextPointerReq = channels[idNext].isend(HnextPointerOld); // send pointer
+						// store H
+						mpi2::RemoteVar vH = job.dh.block(0,b2Prev);
+						HprevReq = mf::isetCopy(vH, *Hprev);
 					}
+				}
 
-					// (2) send Hprev / HprevPointerOld
-					if (channels[idPrev].remote().rank == channels[idPrev].local().rank) {
-//						LOG4CXX_DEBUG(detail::logger, id << ": " << "isend HprevPointerReq: " << channels[idPrev]);
-						HprevPointerOld = mpi2::pointerToInt(Hprev);
-						HprevPointerReq = channels[idPrev].isend(HprevPointerOld); // send pointer
-					} else {
-//						LOG4CXX_DEBUG(detail::logger, id << ": " << "isend HprevReq: " << channels[idPrev]);
-						HprevReq = channels[idPrev].isend(*Hprev);     // send data
-						HprevPointer = 0; // mark that we did not exchange pointers
-					}
-				} else {
-					// store H
-					mpi2::RemoteVar vH = job.dh.block(0,b2Prev);
-					HprevReq = vH.isetCopy(*Hprev);
+				// run the SGD
+				mpi2::logBeginEvent("computation");
+				typename FD::Local jobData(*bV, *bW, *H, job.nnz1(), job.dv.blockOffset1(b1),
+						job.nnz2(), job.dv.blockOffset2(b2),job.nnz12max);
+				SgdJob<Update,Regularize,typename FD::Local> sgdJob(jobData, job.update, job.regularize, job.order);
+				double epsRegularize = job.regularize.rescaleStratumStepsize() ? eps/d : eps;
+				// TODO: regularization may not work here; DON'T USE
+				runner.setTiles(&tiles[b2]);
+				runner.epoch(sgdJob, eps, epsRegularize); // regularize called d times per row/column block!
+				mpi2::logEndEvent("computation");
+
+				// store H back in last two subepoch
+				if (subepoch == LAST && ch.world().size()>1) {
+					mpi2::logBeginEvent("communication");
+					HprevReq.wait();
+					mpi2::RemoteVar vH = job.dh.block(0,b2);
+					mf::setCopy(vH, *H); // synchronous
+					mpi2::logEndEvent("communication");
 				}
-			}
 
-			// run the SGD
-			mpi2::logBeginEvent("computation");
-			FactorizationData<> jobData(*bV, *bW, *H, job.nnz1(), job.dv.blockOffset1(b1),
-					job.nnz2(), job.dv.blockOffset2(b2),job.nnz12max);
-			SgdJob<Update,Regularize> sgdJob(jobData, job.update, job.regularize, job.order);
-			double epsRegularize = job.regularize.rescaleStratumStepsize() ? eps/d : eps;
-			// TODO: regularization may not work here; DON'T USE
-			runner.epoch(sgdJob, eps, epsRegularize); // regularize called d times per row/column block!
-			mpi2::logEndEvent("computation");
-
-			// store H back in last two subepoch
-			if (subepoch == LAST && ch.world().size()>1) {
-				mpi2::logBeginEvent("communication");
-				HprevReq.wait();
-				mpi2::RemoteVar vH = job.dh.block(0,b2);
-				vH.setCopy(*H); // synchronous
-				mpi2::logEndEvent("communication");
-			}
+				// signal that subepoch is done & wait for go to next subepoch
+				LOG4CXX_DEBUG(detail::logger, id << ": " << "Finished subepoch " << subepoch);
 
-			// signal that subepoch is done & wait for go to next subepoch
-			LOG4CXX_DEBUG(detail::logger, id << ": " << "Finished subepoch " << subepoch);
+				// barrier needed when running on one node
+				mpi2::logBeginEvent("barrier");
+				if (ch.world().size() == 1) {
+					workerBarrier(sync, channels);
+				}
+				mpi2::logEndEvent("barrier");
 
-			// barrier needed when running on one node
-			mpi2::logBeginEvent("barrier");
-			if (ch.world().size() == 1) {
-				barrier(channels);
+				// we are done with the subepoch
+				mpi2::logEndEvent("subepoch");
 			}
-			mpi2::logEndEvent("barrier");
 
-			// we are done with the subepoch
-			mpi2::logEndEvent("subepoch");
+			// signal that the epoch is done (all requests have completed at this point)
+			signalEpochDone(sync, ch, loss);
 		}
 
-		// signal done
 		if (ch.world().size() > 1) {
+			delete Hnext;
 			delete H;
 			delete Hprev;
 		}
-
-		ch.send();
 	}
 };
 
 } // detail
 
-template<typename Update, typename Regularize>
-void DsgdPpRunner::epoch(DsgdPpJob<Update, Regularize>& job, double eps) {
+template<typename Update, typename Regularize, typename FD>
+void DsgdPpRunner::epoch(DsgdPpJob<Update, Regularize, FD>& job, double eps) {
 	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
 	boost::mpi::communicator& world = tm.world();
 	unsigned worldSize = world.size();
@@ -336,16 +362,15 @@ void DsgdPpRunner::epoch(DsgdPpJob<Update, Regularize>& job, double eps) {
 	}
 	LOG4CXX_DEBUG(detail::logger, "schedule=" << schedule);
 
-	// fire up the tasks
-	std::vector<mpi2::Channel> channels(worldSize*tasksPerRank, mpi2::UNINITIALIZED);
-	tm.spawnAll<detail::DsgdPpTask<Update, Regularize> >(tasksPerRank, channels, true);
-
-	// send necessary data to each task
-	mpi2::seed(channels, random_);
-	mpi2::sendAll(channels, mpi2::marshal(job, eps, schedule));
-
-	// wait for completion (use same polling delay as task manager)
-	mpi2::economicRecvAll(channels, tm.pollDelay());
+	// run the epoch on the workers started by run(); if called directly, fire up the tasks
+	// for this epoch only
+	if (workers_.runs(&job)) {
+		workers_.runEpoch(eps, schedule, onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	} else {
+		WorkerGroup workers;
+		workers.start<detail::DsgdPpTask<Update, Regularize, FD> >(job, tasksPerRank, random_);
+		workers.runEpoch(eps, schedule, onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	}
 }
 
 } // mf
@@ -0,0 +1,144 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Dynamic block scheduler for shared-memory stratified SGD (in the style of FPSGD).
+ */
+
+#ifndef MF_SGD_FREE_BLOCK_SCHEDULER_H
+#define MF_SGD_FREE_BLOCK_SCHEDULER_H
+
+#include <limits>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <util/random.h>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** Hands out the blocks of a blocks1 x blocks2 grid to concurrent threads such that no two
+ * threads work on blocks that share a row block or a column block. An idle thread claims
+ * a free block (i.e., one whose row and column are both free), preferring the blocks that
+ * have been processed least often so far, and releases it when done. Claiming and releasing
+ * are lock-free; no barriers between the threads are needed, so that threads that happen to
+ * process small blocks do not wait for the others.
+ *
+ * Block (i,j) has index i*blocks2+j. Empty blocks are never handed out. An epoch consists of
+ * as many claims as there are non-empty blocks.
+ */
+class FreeBlockScheduler : boost::noncopyable {
+public:
+	/**
+	 * @param blocks1 number of row blocks
+	 * @param blocks2 number of column blocks
+	 * @param offsets offsets of the blocks in the (block-ordered) data; block b covers
+	 *                positions [offsets[b], offsets[b+1])
+	 */
+	FreeBlockScheduler(mf_size_type blocks1, mf_size_type blocks2, const std::vector<mf_size_type>& offsets)
+	: blocks1_(blocks1), blocks2_(blocks2),
+	  rowBusy_(new boost::atomic<bool>[blocks1]), colBusy_(new boost::atomic<bool>[blocks2]),
+	  tickets_(0) {
+		for (mf_size_type i=0; i<blocks1; i++) rowBusy_[i].store(false);
+		for (mf_size_type j=0; j<blocks2; j++) colBusy_[j].store(false);
+		for (mf_size_type b=0; b<blocks1*blocks2; b++) {
+			if (offsets[b+1] > offsets[b]) blocks_.push_back(b);
+		}
+		counts_.reset(new boost::atomic<unsigned>[blocks_.size()]);
+		for (mf_size_type k=0; k<blocks_.size(); k++) counts_[k].store(0);
+	}
+
+	/** Prepares the next epoch; must not be called while threads are claiming blocks. */
+	void startEpoch() {
+		tickets_.store(blocks_.size());
+	}
+
+	/** Claims a free block for the calling thread. Blocks (spinning) while no block is free.
+	 *
+	 * @param random random number generator of the calling thread (used to break ties)
+	 * @param[out] block index of the claimed block
+	 * @return false if the epoch is over (no block has been claimed)
+	 */
+	bool claim(rg::Random32& random, mf_size_type& block) {
+		if (tickets_.fetch_sub(1, boost::memory_order_relaxed) <= 0) {
+			return false;
+		}
+		const mf_size_type n = blocks_.size();
+		while (true) {
+			// find the least-updated free block (start scanning at a random position)
+			mf_size_type start = random.nextInt(n);
+			mf_size_type best = n;
+			unsigned bestCount = std::numeric_limits<unsigned>::max();
+			for (mf_size_type k=0; k<n; k++) {
+				mf_size_type p = start+k < n ? start+k : start+k-n;
+				mf_size_type b = blocks_[p];
+				if (rowBusy_[b / blocks2_].load(boost::memory_order_relaxed)
+						|| colBusy_[b % blocks2_].load(boost::memory_order_relaxed)) continue;
+				unsigned count = counts_[p].load(boost::memory_order_relaxed);
+				if (count < bestCount) {
+					best = p;
+					bestCount = count;
+				}
+			}
+
+			// try to claim it (another thread may have been faster)
+			if (best < n && tryClaim(blocks_[best])) {
+				counts_[best].fetch_add(1, boost::memory_order_relaxed);
+				block = blocks_[best];
+				return true;
+			}
+			boost::this_thread::yield();
+		}
+	}
+
+	/** Releases a block claimed by the calling thread. */
+	void release(mf_size_type block) {
+		colBusy_[block % blocks2_].store(false, boost::memory_order_release);
+		rowBusy_[block / blocks2_].store(false, boost::memory_order_release);
+	}
+
+	mf_size_type blocks1() const { return blocks1_; }
+	mf_size_type blocks2() const { return blocks2_; }
+
+private:
+	bool tryClaim(mf_size_type block) {
+		bool expected = false;
+		boost::atomic<bool>& row = rowBusy_[block / blocks2_];
+		if (!row.compare_exchange_strong(expected, true, boost::memory_order_acquire)) {
+			return false;
+		}
+		expected = false;
+		if (!colBusy_[block % blocks2_].compare_exchange_strong(expected, true, boost::memory_order_acquire)) {
+			row.store(false, boost::memory_order_release);
+			return false;
+		}
+		return true;
+	}
+
+	const mf_size_type blocks1_;
+	const mf_size_type blocks2_;
+	boost::scoped_array<boost::atomic<bool> > rowBusy_;
+	boost::scoped_array<boost::atomic<bool> > colBusy_;
+	std::vector<mf_size_type> blocks_;                  // indexes of non-empty blocks
+	boost::scoped_array<boost::atomic<unsigned> > counts_; // number of times each block has been processed
+	boost::atomic<long> tickets_;                       // remaining claims in the current epoch
+};
+
+}
+
+#endif
@@ -54,6 +54,9 @@ class UpdateConcept {
  * <td>Performs a GD or SGD step on the factors. Here, eps refers to the current step size.</td></tr>
  * <tr><td>bool rescaleStratumStepsize()</td>
  * <td>True, if the stepsize should be reduced when running on a stratum in DSGD.</td></tr>
+ * <tr><td>void lazy(FactorizationData& job, LazyScale& scale, const double eps)</td>
+ * <td>Optional (see mf::HasLazyRegularize). Records the step in scale instead of changing
+ * the factors.</td></tr>
  * </table>
  *
  * @see mf::Sgd
@@ -0,0 +1,288 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ *
+ * Vectorized kernels for the inner loops of SGD update functions.
+ *
+ * All update functions in mf/sgd/functions share the same structure: an inner product of a row
+ * of W and a column of H, followed by a combined update of both factor vectors. The kernels in
+ * this file implement these two loops once, using AVX-512 or AVX2 intrinsics when the compiler
+ * targets these instruction sets (e.g., with -march=native) and plain loops otherwise.
+ *
+ * Both kernels are available for double and single-precision factors. For single precision, the
+ * inner product is accumulated in double, whereas the update runs at full float SIMD width.
+ *
+ * Each kernel takes the rank as a template argument R. For R>0, the length of the loop is a
+ * compile-time constant so that the compiler can fully unroll it; R=0 selects the generic
+ * version that reads the rank at runtime. Use MF_SGD_KERNEL_DISPATCH to select the
+ * specialization matching a given rank.
+ */
+
+#ifndef MF_SGD_FUNCTIONS_KERNELS_H
+#define MF_SGD_FUNCTIONS_KERNELS_H
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <boost/type_traits/integral_constant.hpp>
+
+#include <mf/factorization.h>
+
+namespace mf {
+
+namespace kernels {
+
+/** Returns the length of a kernel loop: R if R>0, else the runtime rank r. */
+template<unsigned R>
+inline unsigned size(unsigned r) {
+	return R > 0 ? R : r;
+}
+
+/** Computes sum_z w[z]*h[z] for z=0..r-1 (or z=0..R-1 if R>0). */
+template<unsigned R>
+inline double dot(const double* w, const double* h, unsigned r) {
+	const unsigned n = size<R>(r);
+	unsigned z = 0;
+	double result = 0;
+#if defined(__AVX512F__)
+	__m512d acc0 = _mm512_setzero_pd();
+	__m512d acc1 = _mm512_setzero_pd();
+	for (; z+16<=n; z+=16) {
+		acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(w+z), _mm512_loadu_pd(h+z), acc0);
+		acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(w+z+8), _mm512_loadu_pd(h+z+8), acc1);
+	}
+	for (; z+8<=n; z+=8) {
+		acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(w+z), _mm512_loadu_pd(h+z), acc0);
+	}
+	result = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+#elif defined(__AVX2__) && defined(__FMA__)
+	__m256d acc0 = _mm256_setzero_pd();
+	__m256d acc1 = _mm256_setzero_pd();
+	for (; z+8<=n; z+=8) {
+		acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(w+z), _mm256_loadu_pd(h+z), acc0);
+		acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(w+z+4), _mm256_loadu_pd(h+z+4), acc1);
+	}
+	for (; z+4<=n; z+=4) {
+		acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(w+z), _mm256_loadu_pd(h+z), acc0);
+	}
+	acc0 = _mm256_add_pd(acc0, acc1);
+	__m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+	result = _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+#endif
+	for (; z<n; z++) {
+		result += w[z] * h[z];
+	}
+	return result;
+}
+
+/** Performs the combined update
+ *   w[z] <- w[z] - (a*h[z] + bw*w[z])
+ *   h[z] <- h[z] - (a*w[z] + bh*h[z])
+ * for z=0..r-1 (or z=0..R-1 if R>0), where the update of h uses the old value of w[z]. */
+template<unsigned R>
+inline void update(double* w, double* h, unsigned r, double a, double bw, double bh) {
+	const unsigned n = size<R>(r);
+	const double cw = 1. - bw;
+	const double ch = 1. - bh;
+	unsigned z = 0;
+#if defined(__AVX512F__)
+	const __m512d va = _mm512_set1_pd(a);
+	const __m512d vcw = _mm512_set1_pd(cw);
+	const __m512d vch = _mm512_set1_pd(ch);
+	for (; z+8<=n; z+=8) {
+		__m512d vw = _mm512_loadu_pd(w+z);
+		__m512d vh = _mm512_loadu_pd(h+z);
+		_mm512_storeu_pd(w+z, _mm512_fnmadd_pd(va, vh, _mm512_mul_pd(vcw, vw)));
+		_mm512_storeu_pd(h+z, _mm512_fnmadd_pd(va, vw, _mm512_mul_pd(vch, vh)));
+	}
+#elif defined(__AVX2__) && defined(__FMA__)
+	const __m256d va = _mm256_set1_pd(a);
+	const __m256d vcw = _mm256_set1_pd(cw);
+	const __m256d vch = _mm256_set1_pd(ch);
+	for (; z+4<=n; z+=4) {
+		__m256d vw = _mm256_loadu_pd(w+z);
+		__m256d vh = _mm256_loadu_pd(h+z);
+		_mm256_storeu_pd(w+z, _mm256_fnmadd_pd(va, vh, _mm256_mul_pd(vcw, vw)));
+		_mm256_storeu_pd(h+z, _mm256_fnmadd_pd(va, vw, _mm256_mul_pd(vch, vh)));
+	}
+#endif
+	for (; z<n; z++) {
+		double temp = w[z];
+		w[z] = cw * temp - a * h[z];
+		h[z] = ch * h[z] - a * temp;
+	}
+}
+
+/** Single-precision version of dot(). Products and sums are computed in double. */
+template<unsigned R>
+inline double dot(const float* w, const float* h, unsigned r) {
+	const unsigned n = size<R>(r);
+	unsigned z = 0;
+	double result = 0;
+#if defined(__AVX512F__)
+	__m512d acc0 = _mm512_setzero_pd();
+	__m512d acc1 = _mm512_setzero_pd();
+	for (; z+16<=n; z+=16) {
+		acc0 = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(w+z)),
+				_mm512_cvtps_pd(_mm256_loadu_ps(h+z)), acc0);
+		acc1 = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(w+z+8)),
+				_mm512_cvtps_pd(_mm256_loadu_ps(h+z+8)), acc1);
+	}
+	for (; z+8<=n; z+=8) {
+		acc0 = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(w+z)),
+				_mm512_cvtps_pd(_mm256_loadu_ps(h+z)), acc0);
+	}
+	result = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+#elif defined(__AVX2__) && defined(__FMA__)
+	__m256d acc0 = _mm256_setzero_pd();
+	__m256d acc1 = _mm256_setzero_pd();
+	for (; z+8<=n; z+=8) {
+		acc0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(w+z)),
+				_mm256_cvtps_pd(_mm_loadu_ps(h+z)), acc0);
+		acc1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(w+z+4)),
+				_mm256_cvtps_pd(_mm_loadu_ps(h+z+4)), acc1);
+	}
+	for (; z+4<=n; z+=4) {
+		acc0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(w+z)),
+				_mm256_cvtps_pd(_mm_loadu_ps(h+z)), acc0);
+	}
+	acc0 = _mm256_add_pd(acc0, acc1);
+	__m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+	result = _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+#endif
+	for (; z<n; z++) {
+		result += (double)w[z] * h[z];
+	}
+	return result;
+}
+
+/** Single-precision version of update(). The coefficients are rounded to float. */
+template<unsigned R>
+inline void update(float* w, float* h, unsigned r, double a, double bw, double bh) {
+	const unsigned n = size<R>(r);
+	const float fa = (float)a;
+	const float cw = (float)(1. - bw);
+	const float ch = (float)(1. - bh);
+	unsigned z = 0;
+#if defined(__AVX512F__)
+	const __m512 va = _mm512_set1_ps(fa);
+	const __m512 vcw = _mm512_set1_ps(cw);
+	const __m512 vch = _mm512_set1_ps(ch);
+	for (; z+16<=n; z+=16) {
+		__m512 vw = _mm512_loadu_ps(w+z);
+		__m512 vh = _mm512_loadu_ps(h+z);
+		_mm512_storeu_ps(w+z, _mm512_fnmadd_ps(va, vh, _mm512_mul_ps(vcw, vw)));
+		_mm512_storeu_ps(h+z, _mm512_fnmadd_ps(va, vw, _mm512_mul_ps(vch, vh)));
+	}
+#endif
+#if (defined(__AVX512F__) || defined(__AVX2__)) && defined(__FMA__)
+	const __m256 va8 = _mm256_set1_ps(fa);
+	const __m256 vcw8 = _mm256_set1_ps(cw);
+	const __m256 vch8 = _mm256_set1_ps(ch);
+	for (; z+8<=n; z+=8) {
+		__m256 vw = _mm256_loadu_ps(w+z);
+		__m256 vh = _mm256_loadu_ps(h+z);
+		_mm256_storeu_ps(w+z, _mm256_fnmadd_ps(va8, vh, _mm256_mul_ps(vcw8, vw)));
+		_mm256_storeu_ps(h+z, _mm256_fnmadd_ps(va8, vw, _mm256_mul_ps(vch8, vh)));
+	}
+#endif
+	for (; z<n; z++) {
+		float temp = w[z];
+		w[z] = cw * temp - fa * h[z];
+		h[z] = ch * h[z] - fa * temp;
+	}
+}
+
+/** Performs the update
+ *   w[z] <- w[z] - aw*h[z]
+ *   h[z] <- h[z] - ah*w[z]
+ * for z=0..r-1 (or z=0..R-1 if R>0), where the update of h uses the old value of w[z]. Used
+ * when the coefficients of w and h differ, e.g., because the factors carry a lazily applied
+ * scale (see mf::LazyScale). The loop is simple enough to be vectorized by the compiler. */
+template<unsigned R, typename T>
+inline void updateScaled(T* w, T* h, unsigned r, double aw, double ah) {
+	const unsigned n = size<R>(r);
+	const T fw = (T)aw;
+	const T fh = (T)ah;
+	for (unsigned z=0; z<n; z++) {
+		T temp = w[z];
+		w[z] = temp - fw * h[z];
+		h[z] = h[z] - fh * temp;
+	}
+}
+
+} // namespace kernels
+
+/** Indicates whether an update function provides rank-specialized kernels. Such update
+ * functions have a member
+ * <code>template<unsigned R, D, F, I> void apply(FactorizationData<D,F,I>& data, i, j, x, eps)</code>
+ * that behaves like operator() but assumes data.r==R (if R>0). */
+template<typename Update>
+struct HasRankKernels : public boost::false_type {
+};
+
+namespace detail {
+
+/** Calls the rank-specialized version of an update function (if available) or its
+ * operator() (otherwise). */
+template<typename Update, bool = HasRankKernels<Update>::value>
+struct RankedUpdate {
+	template<unsigned R, typename Data, typename Factor, typename Index>
+	static inline void apply(Update& update, FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j, const double x, const double eps) {
+		update(data, i, j, x, eps);
+	}
+};
+
+template<typename Update>
+struct RankedUpdate<Update, true> {
+	template<unsigned R, typename Data, typename Factor, typename Index>
+	static inline void apply(Update& update, FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j, const double x, const double eps) {
+		update.template apply<R>(data, i, j, x, eps);
+	}
+};
+
+/** Returns the rank for which a specialized kernel exists (or 0 if there is none) */
+template<typename Update>
+inline unsigned kernelRank(unsigned r) {
+	if (!HasRankKernels<Update>::value) return 0;
+	switch (r) {
+	case 8: case 16: case 32: case 50: case 64: case 100: case 128:
+		return r;
+	default:
+		return 0;
+	}
+}
+
+} // namespace detail
+
+} // namespace mf
+
+/** Calls F<R> ARGS, where R is the compile-time rank matching the runtime rank r of update
+ * function type U (or 0 if there is no specialization for r). ARGS must be parenthesized. */
+#define MF_SGD_KERNEL_DISPATCH(U, r, F, ARGS) \
+	switch (mf::detail::kernelRank<U>(r)) { \
+	case 8: F<8> ARGS; break; \
+	case 16: F<16> ARGS; break; \
+	case 32: F<32> ARGS; break; \
+	case 50: F<50> ARGS; break; \
+	case 64: F<64> ARGS; break; \
+	case 100: F<100> ARGS; break; \
+	case 128: F<128> ARGS; break; \
+	default: F<0> ARGS; break; \
+	}
+
+#endif
@@ -16,6 +16,7 @@
 
 #include <mf/sgd/functions/functions.h>
 #include <mf/factorization.h>
+#include <mf/sgd/lazy-scale.h>
 
 namespace mf {
 
@@ -23,19 +24,14 @@ struct RegularizeL2 : public RegularizeConcept {
 	RegularizeL2(double lambda) : lambda(lambda) { };
 	RegularizeL2(mpi2::SerializationConstructor _) { };
 
-	inline void operator()(FactorizationData<>& job, const double eps) {
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& job, const double eps) {
 		if (job.tasks > 1) {
 			LOG4CXX_WARN(detail::logger, "Parallel computation of RegularizeL2 not yet implemented, using sequential computation.");
 		}
 
 		if (lambda==0) return;
-		double factor;
-		factor = 1 - eps * 2 * lambda;
-		if (factor < 0.5) {
-			// smoothing to avoid too big reduction; shrinks at speed 1/x
-			// once eps is small enough, this branch won't be reached anymore
-			factor = 0.25 / (1 - factor);
-		}
+		double factor = scaleFactor(eps);
 		for (unsigned p=0; p<job.m*job.r; p++) {
 			job.wValues[p] *= factor;
 		}
@@ -44,11 +40,29 @@ struct RegularizeL2 : public RegularizeConcept {
 		}
 	}
 
+	/** Records the regularize step in scale instead of scaling the factors */
+	template<typename Data, typename Factor, typename Index>
+	inline void lazy(FactorizationData<Data,Factor,Index>& job, LazyScale& scale, const double eps) {
+		if (lambda==0) return;
+		double factor = scaleFactor(eps);
+		scale.scale(factor, factor);
+	}
+
 	inline bool rescaleStratumStepsize() {
 		return true;
 	}
 
 private:
+	inline double scaleFactor(const double eps) const {
+		double factor = 1 - eps * 2 * lambda;
+		if (factor < 0.5) {
+			// smoothing to avoid too big reduction; shrinks at speed 1/x
+			// once eps is small enough, this branch won't be reached anymore
+			factor = 0.25 / (1 - factor);
+		}
+		return factor;
+	}
+
 	friend class ::boost::serialization::access;
 	template<class Archive>
 	void serialize(Archive & ar, const unsigned int version) {
@@ -58,6 +72,10 @@ private:
 	double lambda;
 };
 
+template<>
+struct HasLazyRegularize<RegularizeL2> : public boost::true_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::RegularizeL2);
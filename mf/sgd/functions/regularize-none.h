@@ -23,7 +23,8 @@ struct RegularizeNone : public RegularizeConcept {
 	RegularizeNone() { };
 	RegularizeNone(mpi2::SerializationConstructor _) { };
 
-	inline void operator()(FactorizationData<>& job, const double eps) {
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& job, const double eps) {
 	}
 
 	inline bool rescaleStratumStepsize() {
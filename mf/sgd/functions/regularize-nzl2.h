@@ -16,6 +16,7 @@
 
 #include <mf/sgd/functions/functions.h>
 #include <mf/factorization.h>
+#include <mf/sgd/lazy-scale.h>
 
 namespace mf {
 
@@ -23,20 +24,14 @@ struct RegularizeNzl2 : public RegularizeConcept {
 	RegularizeNzl2(double lambda) : lambda(lambda) { };
 	RegularizeNzl2(mpi2::SerializationConstructor _) { };
 
-	inline void operator()(FactorizationData<>& job, double eps) {
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& job, double eps) {
 		if (job.tasks > 1) {
 			LOG4CXX_WARN(detail::logger, "Parallel computation of RegularizeNzl2 not yet implemented, using sequential computation.");
 		}
 
 		if (lambda==0) return;
-		mf_size_type max=job.nnz12max;
-		//std::cout<<"Max in Regularize: "<<max<<std::endl;
-
-		double eps2Lambda = 2 * eps * lambda;
-		if (1-eps2Lambda*max<0.5){ // find eps that will smooth the factor in the worst case
-			eps=(1/(2*lambda*max))*(1-(0.25/(eps2Lambda*max)));
-			eps2Lambda = 2 * eps * lambda;
-		}
+		double eps2Lambda = scaleCoefficient(job, eps);
 
 		// TODO: rewrite to avoid division by r
 		for (mf_size_type p=0; p<job.m*job.r; p++) {
@@ -47,11 +42,39 @@ struct RegularizeNzl2 : public RegularizeConcept {
 		}
 	}
 
+	/** Records the regularize step in scale (as per-row and per-column scales) instead of
+	 * scaling the factors */
+	template<typename Data, typename Factor, typename Index>
+	inline void lazy(FactorizationData<Data,Factor,Index>& job, LazyScale& scale, double eps) {
+		if (lambda==0) return;
+		double eps2Lambda = scaleCoefficient(job, eps);
+		scale.initRows(job.m);
+		scale.initColumns(job.n);
+		for (mf_size_type i=0; i<job.m; i++) {
+			scale.scaleRow(i, 1 - ( eps2Lambda * (*job.nnz1)[i + job.nnz1offset] ));
+		}
+		for (mf_size_type j=0; j<job.n; j++) {
+			scale.scaleColumn(j, 1 - ( eps2Lambda * (*job.nnz2)[j + job.nnz2offset] ));
+		}
+	}
+
 	inline bool rescaleStratumStepsize() {
 		return true;
 	}
 
 private:
+	/** Returns 2*eps*lambda, where eps is reduced if needed so that no factor shrinks too much */
+	template<typename Data, typename Factor, typename Index>
+	inline double scaleCoefficient(FactorizationData<Data,Factor,Index>& job, double eps) const {
+		mf_size_type max=job.nnz12max;
+		double eps2Lambda = 2 * eps * lambda;
+		if (1-eps2Lambda*max<0.5){ // find eps that will smooth the factor in the worst case
+			eps=(1/(2*lambda*max))*(1-(0.25/(eps2Lambda*max)));
+			eps2Lambda = 2 * eps * lambda;
+		}
+		return eps2Lambda;
+	}
+
 	friend class ::boost::serialization::access;
 	template<class Archive>
 	void serialize(Archive & ar, unsigned int version) {
@@ -61,6 +84,10 @@ private:
 	double lambda;
 };
 
+template<>
+struct HasLazyRegularize<RegularizeNzl2> : public boost::true_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::RegularizeNzl2);
@@ -47,7 +47,8 @@ struct RegularizeTruncate : public RegularizeConcept {
 	{
 	};
 
-	inline void operator()(FactorizationData<>& data, const double eps) {
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data, const double eps) {
 		if (data.tasks > 1) {
 			LOG4CXX_WARN(detail::logger, "Parallel computation of RegularizeTruncate not yet implemented, using sequential computation.");
 		}
@@ -56,7 +57,7 @@ struct RegularizeTruncate : public RegularizeConcept {
 
 		mf_size_type s = data.m * data.r;
 		for (mf_size_type p = 0; p<s; p++) {
-			double& w = data.wValues[p];
+			Factor& w = data.wValues[p];
 			if (w<=wmin) { // eps softens up the boundary a bit
 				w = wmin+eps;
 			} else if (w >= wmax) {
@@ -66,7 +67,7 @@ struct RegularizeTruncate : public RegularizeConcept {
 
 		s = data.r * data.n;
 		for (mf_size_type p = 0; p<s; p++) {
-			double& h = data.hValues[p];
+			Factor& h = data.hValues[p];
 			if (h<=hmin) {
 				h = hmin+eps;
 			} else if (h >= hmax) {
@@ -118,7 +119,8 @@ struct RegularizeTruncate<RegularizeNone> : public RegularizeConcept {
 	{
 	};
 
-	inline void operator()(FactorizationData<>& data, const double eps) {
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data, const double eps) {
 	}
 
 	inline bool rescaleStratumStepsize() {
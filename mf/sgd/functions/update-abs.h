@@ -24,6 +24,7 @@
 #include <mf/sgd/functions/functions.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
 #include <mf/types.h>
 
 namespace mf {
@@ -59,6 +60,10 @@ private:
 	}
 };
 
+template<typename U>
+struct HasOnlineLoss<UpdateAbs<U> > : public HasOnlineLoss<U> {
+};
+
 }
 
 MPI2_SERIALIZATION_CONSTRUCTOR1(mf::UpdateAbs);
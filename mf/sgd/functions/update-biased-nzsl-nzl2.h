@@ -20,8 +20,10 @@
 #include <mpi2/uninitialized.h>
 
 #include <mf/sgd/functions/functions.h>
+#include <mf/sgd/functions/kernels.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
 #include <mf/types.h>
 
 
@@ -32,31 +34,32 @@ struct UpdateBiasedNzslNzl2 : public UpdateConcept {
 		lambdaW(lambdaW), lambdaH(lambdaH), lambdaRow(lambdaRow), lambdaCol(lambdaCol) { };
 	UpdateBiasedNzslNzl2(mpi2::SerializationConstructor _) { };
 
-	inline void operator()(FactorizationData<>& data,
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data,
 			const unsigned int i, const unsigned int j,	const double x,
 			const double eps) {
-		mf_size_type ir = i*data.r;
-		mf_size_type jr = j*data.r;
+		apply<0>(data, i, j, x, eps);
+	}
 
-		double wh = 0;
-		for (unsigned z=1; z<data.r; z++) {
-			wh += data.wValues[ir + z] * data.hValues[z + jr];
-		}
+	/** Performs the update using the kernels for rank R (or the generic kernels if R=0) */
+	template<unsigned R, typename Data, typename Factor, typename Index>
+	inline void apply(FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j, const double x,
+			const double eps) {
+		// index 0 holds the bias; the kernels run over the remaining r-1 entries
+		Factor* w = &data.wValues[i*data.r];
+		Factor* h = &data.hValues[j*data.r];
 
-		double f1 = eps * -2. * (x - data.wValues[ir] - data.hValues[jr] - wh);
+		double wh = kernels::dot<R ? R-1 : 0>(w+1, h+1, data.r-1);
+		OnlineLoss::add(x - w[0] - h[0] - wh);
+		double f1 = eps * -2. * (x - w[0] - h[0] - wh);
 		double f2 = eps * 2. * lambdaW;
 		double f3 = eps * 2. * lambdaH;
 		double f4 = eps * 2. * lambdaRow;
 		double f5 = eps * 2. * lambdaCol;
-		data.wValues[ir] -= f1 + (f4 * data.wValues[ir]);
-		data.hValues[jr] -= f1 + (f5 * data.hValues[jr]);
-		for (unsigned z=1; z<data.r; z++) {
-			double tempW = data.wValues[ir + z];
-			double tempH = data.hValues[z + jr];
-			data.wValues[ir + z] -= (f1 * tempH) + (f2 * tempW);
-			data.hValues[z + jr] -= (f1 * tempW) + (f3 * tempH);
-		}
-
+		w[0] -= f1 + (f4 * w[0]);
+		h[0] -= f1 + (f5 * h[0]);
+		kernels::update<R ? R-1 : 0>(w+1, h+1, data.r-1, f1, f2, f3);
 	}
 
 private:
@@ -75,6 +78,14 @@ private:
 	double lambdaCol;
 };
 
+template<>
+struct HasRankKernels<UpdateBiasedNzslNzl2> : public boost::true_type {
+};
+
+template<>
+struct HasOnlineLoss<UpdateBiasedNzslNzl2> : public boost::true_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::UpdateBiasedNzslNzl2);
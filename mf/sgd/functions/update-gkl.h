@@ -20,6 +20,7 @@
 #include <mpi2/uninitialized.h>
 
 #include <mf/sgd/functions/functions.h>
+#include <mf/sgd/functions/kernels.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
 #include <mf/types.h>
@@ -31,23 +32,24 @@ struct UpdateGkl : public UpdateConcept {
 	UpdateGkl() { };
 	UpdateGkl(mpi2::SerializationConstructor _) { };
 
-	inline void operator()(FactorizationData<>& data,
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data,
 			const mf_size_type i, const mf_size_type j,	const double x,
 			const double eps) {
-		mf_size_type ir = i*data.r;
-		mf_size_type jr = j*data.r;
+		apply<0>(data, i, j, x, eps);
+	}
 
-		double wh = 0;
-		for (unsigned z=0; z<data.r; z++) {
-			wh += data.wValues[ir + z] * data.hValues[z + jr];
-		}
+	/** Performs the update using the kernels for rank R (or the generic kernels if R=0) */
+	template<unsigned R, typename Data, typename Factor, typename Index>
+	inline void apply(FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j, const double x,
+			const double eps) {
+		Factor* w = &data.wValues[i*data.r];
+		Factor* h = &data.hValues[j*data.r];
 
+		double wh = kernels::dot<R>(w, h, data.r);
 		double f = - eps * x/wh;
-		for (unsigned z=0; z<data.r; z++) {
-			double temp = data.wValues[ir + z];
-			data.wValues[ir + z] -= data.hValues[z + jr]*f;
-			data.hValues[z + jr] -= temp*f;
-		}
+		kernels::update<R>(w, h, data.r, f, 0., 0.);
 	}
 
 private:
@@ -57,6 +59,10 @@ private:
 	}
 };
 
+template<>
+struct HasRankKernels<UpdateGkl> : public boost::true_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::UpdateGkl);
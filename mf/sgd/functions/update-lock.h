@@ -16,44 +16,69 @@
 
 #include <math.h>
 
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/locks.hpp>
-#include <boost/shared_array.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <mpi2/types.h>
 #include <mpi2/uninitialized.h>
 
 #include <mf/sgd/functions/functions.h>
+#include <mf/sgd/functions/kernels.h>
+#include <mf/sgd/dirty-columns.h>
+#include <mf/sgd/lock-table.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
 #include <mf/types.h>
 
 namespace mf {
 
+/** An update function that locks the row of W and the column of H of each SGD step while
+ * running the underlying update. Uses a striped lock table (see mf::LockTable), which may be
+ * shared with other tasks that modify the factors concurrently. Optionally marks the columns
+ * of H that have been updated (see mf::DirtyColumns). */
 template<typename U>
 struct UpdateLock : public UpdateConcept {
 	typedef U Update;
 
-	UpdateLock(Update update, mf_size_type size1, mf_size_type size2)
-	: update(update), size1(size1), size2(size2), locks1_(new boost::mutex[size1]), locks2_(new boost::mutex[size2]) {
+	/** Creates a new lock table with at most maxStripes stripes per dimension */
+	UpdateLock(Update update, mf_size_type size1, mf_size_type size2,
+			mf_size_type maxStripes = LockTable::DEFAULT_STRIPES)
+	: update(update), size1(size1), size2(size2), locks_(new LockTable(size1, size2, maxStripes)) {
 	};
 
-	UpdateLock(Update update, mf_size_type size1, mf_size_type size2, boost::shared_array<boost::mutex>& locks1,
-			boost::shared_array<boost::mutex>& locks2)
-	: update(update), size1(size1), size2(size2), locks1_(locks1), locks2_(locks2) {
+	UpdateLock(Update update, mf_size_type size1, mf_size_type size2, boost::shared_ptr<LockTable>& locks)
+	: update(update), size1(size1), size2(size2), locks_(locks) {
 	};
 
-	inline void operator()(FactorizationData<>& data,
+	/** Uses the given lock table and marks every updated column in dirty */
+	UpdateLock(Update update, mf_size_type size1, mf_size_type size2, boost::shared_ptr<LockTable>& locks,
+			boost::shared_ptr<DirtyColumns>& dirty)
+	: update(update), size1(size1), size2(size2), locks_(locks), dirty_(dirty) {
+	};
+
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data,
 			const unsigned i, const unsigned j,	const double x,
 			const double eps) {
 		BOOST_ASSERT(data.m == size1 && data.n == size2);
 
-		boost::mutex::scoped_lock lock1(locks1_[i]);
-		boost::mutex::scoped_lock lock2(locks2_[j]);
+		LockTable::ScopedLock lock(*locks_, i, j);
 		update(data, i, j, x, eps);
+		if (dirty_) dirty_->mark(j);
+	}
+
+	/** Locks and performs the update using the kernels for rank R (see mf::HasRankKernels) */
+	template<unsigned R, typename Data, typename Factor, typename Index>
+	inline void apply(FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j, const double x,
+			const double eps) {
+		BOOST_ASSERT(data.m == size1 && data.n == size2);
+
+		LockTable::ScopedLock lock(*locks_, i, j);
+		detail::RankedUpdate<Update>::template apply<R>(update, data, i, j, x, eps);
+		if (dirty_) dirty_->mark(j);
 	}
 
-	boost::shared_array<boost::mutex>& locks1() { return locks1_; }
-	boost::shared_array<boost::mutex>& locks2() { return locks2_; }
+	boost::shared_ptr<LockTable>& locks() { return locks_; }
 
 private:
 	UpdateLock(); // no implementation
@@ -61,12 +86,20 @@ private:
 	Update update;
 	mf_size_type size1;
 	mf_size_type size2;
-	boost::shared_array<boost::mutex> locks1_;
-	boost::shared_array<boost::mutex> locks2_;
+	boost::shared_ptr<LockTable> locks_;
+	boost::shared_ptr<DirtyColumns> dirty_;
 
 	// no serialization!
 };
 
+template<typename U>
+struct HasRankKernels<UpdateLock<U> > : public HasRankKernels<U> {
+};
+
+template<typename U>
+struct HasOnlineLoss<UpdateLock<U> > : public HasOnlineLoss<U> {
+};
+
 }
 
 #endif
@@ -24,6 +24,7 @@
 #include <mf/sgd/functions/functions.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
 #include <mf/types.h>
 #include <mf/matrix/op/sums.h>
 
@@ -79,6 +80,10 @@ private:
 	}
 };
 
+template<typename U>
+struct HasOnlineLoss<UpdateMaxNorm<U> > : public HasOnlineLoss<U> {
+};
+
 }
 
 MPI2_SERIALIZATION_CONSTRUCTOR1(mf::UpdateMaxNorm);
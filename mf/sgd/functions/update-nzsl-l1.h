@@ -30,6 +30,7 @@
 #include <mf/sgd/functions/functions.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
 #include <mf/types.h>
 
 
@@ -50,6 +51,7 @@ struct UpdateNzslL1 : public UpdateConcept {
 			wh += data.wValues[ir + z] * data.hValues[z + jr];
 		}
 
+		OnlineLoss::add(x-wh);
 		double f1 = eps * -2. * (x-wh);
 
 		double f3 = eps * lambda / (*data.nnz1)[i + data.nnz1offset];
@@ -111,6 +113,10 @@ private:
 
 };
 
+template<>
+struct HasOnlineLoss<UpdateNzslL1> : public boost::true_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::UpdateNzslL1);
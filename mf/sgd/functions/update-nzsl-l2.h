@@ -20,8 +20,11 @@
 #include <mpi2/uninitialized.h>
 
 #include <mf/sgd/functions/functions.h>
+#include <mf/sgd/functions/kernels.h>
+#include <mf/sgd/minibatch.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
 #include <mf/types.h>
 
 
@@ -31,31 +34,42 @@ struct UpdateNzslL2 : public UpdateConcept {
 	UpdateNzslL2(double lambda) : lambda(lambda) { };
 	UpdateNzslL2(mpi2::SerializationConstructor _) { };
 
-	inline void operator()(FactorizationData<>& data,
-			const unsigned i, const unsigned j,	const double x,
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j,	const double x,
 			const double eps) {
-		mf_size_type ir = i*data.r;
-		mf_size_type jr = j*data.r;
+		apply<0>(data, i, j, x, eps);
+	}
 
-		double wh = 0;
-		for (unsigned z=0; z<data.r; z++) {
-			wh += data.wValues[ir + z] * data.hValues[z + jr];
-		}
+	/** Performs the update using the kernels for rank R (or the generic kernels if R=0) */
+	template<unsigned R, typename Data, typename Factor, typename Index>
+	inline void apply(FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j, const double x,
+			const double eps) {
+		Factor* w = &data.wValues[i*data.r];
+		Factor* h = &data.hValues[j*data.r];
 
+		double wh = kernels::dot<R>(w, h, data.r);
+		OnlineLoss::add(x-wh);
 		double f1 = eps * -2. * (x-wh);
 		double f2 = eps * 2. * lambda;
 		double f3 = 1. / (*data.nnz1)[i + data.nnz1offset];
 		double f4 = 1. / (*data.nnz2)[j + data.nnz2offset];
-		for (unsigned z=0; z<data.r; z++) {
-			double temp = data.wValues[ir + z];
-			data.wValues[ir + z] -= f1 * data.hValues[z + jr] +
-					f2 * data.wValues[ir + z] * f3;
-			data.hValues[z + jr] -= f1 * temp +
-					f2 * data.hValues[z + jr] * f4;
-		}
+		kernels::update<R>(w, h, data.r, f1, f2 * f3, f2 * f4);
+	}
 
+	/** Mini-batch support (see mf::HasMiniBatch): L2 regularization weighted by the number of
+	 * training points of the row (column) */
+	template<typename FD>
+	inline double miniBatchW(const FD& data, mf_size_type i) const {
+		return 2. * lambda / (*data.nnz1)[i + data.nnz1offset];
 	}
-	//double lambda;
+
+	template<typename FD>
+	inline double miniBatchH(const FD& data, mf_size_type j) const {
+		return 2. * lambda / (*data.nnz2)[j + data.nnz2offset];
+	}
+
 private:
 	double lambda;
 
@@ -68,6 +82,18 @@ private:
 
 };
 
+template<>
+struct HasRankKernels<UpdateNzslL2> : public boost::true_type {
+};
+
+template<>
+struct HasMiniBatch<UpdateNzslL2> : public boost::true_type {
+};
+
+template<>
+struct HasOnlineLoss<UpdateNzslL2> : public boost::true_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::UpdateNzslL2);
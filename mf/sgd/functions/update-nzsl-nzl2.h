@@ -20,8 +20,11 @@
 #include <mpi2/uninitialized.h>
 
 #include <mf/sgd/functions/functions.h>
+#include <mf/sgd/functions/kernels.h>
+#include <mf/sgd/minibatch.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
 #include <mf/types.h>
 
 
@@ -31,25 +34,37 @@ struct UpdateNzslNzl2 : public UpdateConcept {
 	UpdateNzslNzl2(double lambda) : lambda(lambda) { };
 	UpdateNzslNzl2(mpi2::SerializationConstructor _) { };
 
-	inline void operator()(FactorizationData<>& data,
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data,
 			const unsigned int i, const unsigned int j,	const double x,
 			const double eps) {
-		mf_size_type ir = i*data.r;
-		mf_size_type jr = j*data.r;
+		apply<0>(data, i, j, x, eps);
+	}
 
-		double wh = 0;
-		for (unsigned z=0; z<data.r; z++) {
-			wh += data.wValues[ir + z] * data.hValues[z + jr];
-		}
+	/** Performs the update using the kernels for rank R (or the generic kernels if R=0) */
+	template<unsigned R, typename Data, typename Factor, typename Index>
+	inline void apply(FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j, const double x,
+			const double eps) {
+		Factor* w = &data.wValues[i*data.r];
+		Factor* h = &data.hValues[j*data.r];
 
+		double wh = kernels::dot<R>(w, h, data.r);
+		OnlineLoss::add(x-wh);
 		double f1 = eps * -2. * (x-wh);
 		double f2 = eps * 2. * lambda;
-		for (unsigned z=0; z<data.r; z++) {
-			double temp = data.wValues[ir + z];
-			data.wValues[ir + z] -= f1 * data.hValues[z + jr] + f2 * data.wValues[ir + z];
-			data.hValues[z + jr] -= f1 * temp + f2*data.hValues[z + jr];
-		}
+		kernels::update<R>(w, h, data.r, f1, f2, f2);
+	}
 
+	/** Mini-batch support (see mf::HasMiniBatch): L2 regularization per training point */
+	template<typename FD>
+	inline double miniBatchW(const FD& data, mf_size_type i) const {
+		return 2. * lambda;
+	}
+
+	template<typename FD>
+	inline double miniBatchH(const FD& data, mf_size_type j) const {
+		return 2. * lambda;
 	}
 
 private:
@@ -62,6 +77,18 @@ private:
 	double lambda;
 };
 
+template<>
+struct HasRankKernels<UpdateNzslNzl2> : public boost::true_type {
+};
+
+template<>
+struct HasMiniBatch<UpdateNzslNzl2> : public boost::true_type {
+};
+
+template<>
+struct HasOnlineLoss<UpdateNzslNzl2> : public boost::true_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::UpdateNzslNzl2);
@@ -20,8 +20,12 @@
 #include <mpi2/uninitialized.h>
 
 #include <mf/sgd/functions/functions.h>
+#include <mf/sgd/functions/kernels.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
+#include <mf/sgd/lazy-scale.h>
+#include <mf/sgd/minibatch.h>
 #include <mf/types.h>
 
 namespace mf {
@@ -30,23 +34,46 @@ struct UpdateNzsl : public UpdateConcept {
 	UpdateNzsl() { };
 	UpdateNzsl(mpi2::SerializationConstructor _) { };
 
-	inline void operator()(FactorizationData<>& data,
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data,
 			const unsigned i, const unsigned j,	const double x,
 			const double eps) {
-		mf_size_type ir = i*data.r;
-		mf_size_type jr = j*data.r;
+		apply<0>(data, i, j, x, eps);
+	}
 
-		double wh = 0;
-		for (unsigned z=0; z<data.r; z++) {
-			wh += data.wValues[ir + z] * data.hValues[z + jr];
+	/** Performs the update using the kernels for rank R (or the generic kernels if R=0) */
+	template<unsigned R, typename Data, typename Factor, typename Index>
+	inline void apply(FactorizationData<Data,Factor,Index>& data,
+			const mf_size_type i, const mf_size_type j, const double x,
+			const double eps) {
+		Factor* w = &data.wValues[i*data.r];
+		Factor* h = &data.hValues[j*data.r];
+
+		double wh = kernels::dot<R>(w, h, data.r);
+		if (data.scale == NULL) {
+			OnlineLoss::add(x-wh);
+			double f = eps * -2. * (x-wh);
+			kernels::update<R>(w, h, data.r, f, 0., 0.);
+		} else {
+			// factors are stored unscaled: the actual row is sw*w, the actual column sh*h
+			const double sw = data.scale->w(i);
+			const double sh = data.scale->h(j);
+			wh *= sw*sh;
+			OnlineLoss::add(x-wh);
+			double f = eps * -2. * (x-wh);
+			kernels::updateScaled<R>(w, h, data.r, f*sh/sw, f*sw/sh);
 		}
+	}
 
-		double f = eps * -2. * (x-wh);
-		for (unsigned z=0; z<data.r; z++) {
-			double temp = data.wValues[ir + z];
-			data.wValues[ir + z] -= f * data.hValues[z + jr];
-			data.hValues[z + jr] -= f * temp;
-		}
+	/** Mini-batch support (see mf::HasMiniBatch): no regularization */
+	template<typename FD>
+	inline double miniBatchW(const FD& data, mf_size_type i) const {
+		return 0.;
+	}
+
+	template<typename FD>
+	inline double miniBatchH(const FD& data, mf_size_type j) const {
+		return 0.;
 	}
 
 private:
@@ -82,6 +109,22 @@ private:
 	}
 };
 
+template<>
+struct HasRankKernels<UpdateNzsl> : public boost::true_type {
+};
+
+template<>
+struct SupportsLazyScale<UpdateNzsl> : public boost::true_type {
+};
+
+template<>
+struct HasMiniBatch<UpdateNzsl> : public boost::true_type {
+};
+
+template<>
+struct HasOnlineLoss<UpdateNzsl> : public boost::true_type {
+};
+
 }
 
 MPI2_TYPE_TRAITS(mf::UpdateNzsl);
@@ -24,6 +24,7 @@
 #include <mf/sgd/functions/functions.h>
 #include <mf/matrix/distributed_matrix.h>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/online-loss.h>
 #include <mf/types.h>
 
 namespace mf {
@@ -47,7 +48,8 @@ struct UpdateTruncate : public UpdateConcept {
 	{
 	};
 
-	inline void operator()(FactorizationData<>& data,
+	template<typename Data, typename Factor, typename Index>
+	inline void operator()(FactorizationData<Data,Factor,Index>& data,
 			const unsigned i, const unsigned j,	const double x,
 			const double eps) {
 		update(data, i, j, x, eps);
@@ -55,14 +57,14 @@ struct UpdateTruncate : public UpdateConcept {
 		mf_size_type pi = i*data.r;
 		mf_size_type pj = j*data.r;
 		for (unsigned z=0; z<data.r; z++) {
-			double& w = data.wValues[pi + z];
+			Factor& w = data.wValues[pi + z];
 			if (w<=wmin) { // eps softens up the boundary a bit
 				w = wmin+eps;
 			} else if (w >= wmax) {
 				w = wmax-eps;
 			}
 
-			double& h = data.hValues[z + pj];
+			Factor& h = data.hValues[z + pj];
 			if (h<=hmin) {
 				h = hmin+eps;
 			} else if (h >= hmax) {
@@ -89,6 +91,10 @@ private:
 	}
 };
 
+template<typename U>
+struct HasOnlineLoss<UpdateTruncate<U> > : public HasOnlineLoss<U> {
+};
+
 }
 
 MPI2_SERIALIZATION_CONSTRUCTOR1(mf::UpdateTruncate);
@@ -0,0 +1,203 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Lazily applied scaling of the factor matrices. The L2 and NZL2 regularize steps multiply
+ * each row of W and each column of H by a constant; instead of a pass over the factors, the
+ * constants are recorded and folded into the update function until the factors are needed.
+ */
+
+#ifndef MF_SGD_LAZY_SCALE_H
+#define MF_SGD_LAZY_SCALE_H
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** Scale of the factor matrices that has not been applied yet. The actual value of entry
+ * (i,z) of W is w(i)*W(i,z); the actual value of entry (z,j) of H is h(j)*H(z,j). The scale of
+ * a row (column) is the product of a scale for the entire matrix and, if per-row (per-column)
+ * scales have been initialized, the scale of the row (column).
+ *
+ * Update functions that support lazy scaling (see mf::SupportsLazyScale) read the scales
+ * through FactorizationData::scale. Everything else expects the actual values; use apply()
+ * before the factors are read.
+ */
+class LazyScale : boost::noncopyable {
+public:
+	/** Scales below this value are applied right away to keep the factors in range */
+	static double minScale() {
+		return 1e-6;
+	}
+
+	LazyScale() : w_(1.), h_(1.), wRowsMin_(1.), hColumnsMin_(1.) {
+	}
+
+	/** Returns the scale of row i of W */
+	double w(mf_size_type i) const {
+		return wRows_.empty() ? w_ : w_ * wRows_[i];
+	}
+
+	/** Returns the scale of column j of H */
+	double h(mf_size_type j) const {
+		return hColumns_.empty() ? h_ : h_ * hColumns_[j];
+	}
+
+	/** Scales all of W by fw and all of H by fh */
+	void scale(double fw, double fh) {
+		w_ *= fw;
+		h_ *= fh;
+	}
+
+	/** Scales row i of W by f; initRows() must have been called */
+	void scaleRow(mf_size_type i, double f) {
+		wRows_[i] *= f;
+		if (wRows_[i] < wRowsMin_) wRowsMin_ = wRows_[i];
+	}
+
+	/** Scales column j of H by f; initColumns() must have been called */
+	void scaleColumn(mf_size_type j, double f) {
+		hColumns_[j] *= f;
+		if (hColumns_[j] < hColumnsMin_) hColumnsMin_ = hColumns_[j];
+	}
+
+	/** Enables per-row scales for a W with m rows (if not yet enabled) */
+	void initRows(mf_size_type m) {
+		if (wRows_.empty()) {
+			wRows_.assign(m, 1.);
+			wRowsMin_ = 1.;
+		}
+	}
+
+	/** Enables per-column scales for an H with n columns (if not yet enabled) */
+	void initColumns(mf_size_type n) {
+		if (hColumns_.empty()) {
+			hColumns_.assign(n, 1.);
+			hColumnsMin_ = 1.;
+		}
+	}
+
+	/** Returns true if some scale may be so small that it should be applied. Takes constant
+	 * time: the smallest per-row (per-column) scale is tracked when the scales change. Since
+	 * scales that grow again are not tracked, this may return true a little early (which is
+	 * safe), but never too late. */
+	bool small() const {
+		return w_ * wRowsMin_ < minScale() || h_ * hColumnsMin_ < minScale();
+	}
+
+	/** Multiplies the rows of w (row-major) by their scales and resets the scales */
+	template<typename W>
+	void applyW(W& w) {
+		if (w_ == 1. && wRows_.empty()) return;
+		const mf_size_type r = w.size2();
+		typename W::array_type& values = w.data();
+		for (mf_size_type i=0; i<w.size1(); i++) {
+			const typename W::value_type s = this->w(i);
+			for (mf_size_type p=i*r; p<(i+1)*r; p++) {
+				values[p] *= s;
+			}
+		}
+		w_ = 1.;
+		wRows_.clear();
+		wRowsMin_ = 1.;
+	}
+
+	/** Multiplies the columns of h (column-major) by their scales and resets the scales */
+	template<typename H>
+	void applyH(H& h) {
+		if (h_ == 1. && hColumns_.empty()) return;
+		const mf_size_type r = h.size1();
+		typename H::array_type& values = h.data();
+		for (mf_size_type j=0; j<h.size2(); j++) {
+			const typename H::value_type s = this->h(j);
+			for (mf_size_type p=j*r; p<(j+1)*r; p++) {
+				values[p] *= s;
+			}
+		}
+		h_ = 1.;
+		hColumns_.clear();
+		hColumnsMin_ = 1.;
+	}
+
+	/** Applies the scales to the factors of the given factorization data */
+	template<typename FD>
+	void apply(FD& data) {
+		applyW(data.w);
+		applyH(data.h);
+	}
+
+private:
+	double w_;
+	double h_;
+	std::vector<double> wRows_;    // per-row scales of W (empty if not used)
+	std::vector<double> hColumns_; // per-column scales of H (empty if not used)
+	double wRowsMin_;    // lower bound on the per-row scales (1 if not used)
+	double hColumnsMin_; // lower bound on the per-column scales (1 if not used)
+};
+
+/** Indicates whether an update function reads the lazily applied scale of the factors
+ * (FactorizationData::scale) when it is set. */
+template<typename Update>
+struct SupportsLazyScale : public boost::false_type {
+};
+
+/** Indicates whether a regularize function can be applied lazily. Such regularize functions
+ * have a member
+ * <code>void lazy(FactorizationData<D,F,I>& data, LazyScale& scale, double eps)</code>
+ * that records the regularize step in scale instead of changing the factors. */
+template<typename Regularize>
+struct HasLazyRegularize : public boost::false_type {
+};
+
+namespace detail {
+
+/** Indicates whether the regularize steps of an SGD job can be applied lazily */
+template<typename Update, typename Regularize>
+struct UseLazyScale : public boost::integral_constant<bool,
+		SupportsLazyScale<Update>::value && HasLazyRegularize<Regularize>::value> {
+};
+
+/** Runs a regularize step, lazily if supported by the job and data.scale is set */
+template<bool lazy>
+struct RegularizeStep {
+	template<typename Job>
+	static inline void run(Job& job, double eps) {
+		job.regularize(job, eps);
+	}
+};
+
+template<>
+struct RegularizeStep<true> {
+	template<typename Job>
+	static inline void run(Job& job, double eps) {
+		if (job.scale == NULL) {
+			job.regularize(job, eps);
+			return;
+		}
+		job.regularize.lazy(job, *job.scale, eps);
+		if (job.scale->small()) {
+			job.scale->apply(job);
+		}
+	}
+};
+
+}
+
+}
+
+#endif
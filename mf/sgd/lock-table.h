@@ -0,0 +1,156 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Striped locks for the rows and columns of the factor matrices. Locking SGD steps hold
+ * their locks for a few hundred nanoseconds only; a small table of spinlocks, each in its
+ * own cache line, is much cheaper than one mutex per row and column.
+ */
+
+#ifndef MF_SGD_LOCK_TABLE_H
+#define MF_SGD_LOCK_TABLE_H
+
+#include <new>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** Size of a cache line in bytes */
+const mf_size_type CACHE_LINE_SIZE = 64;
+
+/** A test-and-test-and-set spinlock that occupies a cache line of its own (when allocated
+ * at a cache-line boundary). Waiting threads spin on a read of the lock and yield the
+ * processor every SPINS iterations. Models the Lockable concept of Boost.Thread. */
+class SpinLock : boost::noncopyable {
+public:
+	static const unsigned SPINS = 1u << 10;
+
+	typedef boost::lock_guard<SpinLock> scoped_lock;
+
+	SpinLock() : locked_(false) {
+	}
+
+	inline void lock() {
+		while (locked_.exchange(true, boost::memory_order_acquire)) {
+			unsigned spins = 0;
+			while (locked_.load(boost::memory_order_relaxed)) {
+				if (++spins == SPINS) {
+					boost::this_thread::yield();
+					spins = 0;
+				}
+			}
+		}
+	}
+
+	inline bool try_lock() {
+		return !locked_.load(boost::memory_order_relaxed)
+				&& !locked_.exchange(true, boost::memory_order_acquire);
+	}
+
+	inline void unlock() {
+		locked_.store(false, boost::memory_order_release);
+	}
+
+private:
+	boost::atomic<bool> locked_;
+	char padding_[CACHE_LINE_SIZE - sizeof(boost::atomic<bool>)];
+};
+
+/** A striped table of locks for the rows and the columns of a factorization. Row i is
+ * protected by row stripe i mod stripes1, column j by column stripe j mod stripes2; the
+ * number of stripes is a power of two. Callers that need both a row and a column lock must
+ * always lock the row first (as done by LockTable::ScopedLock); since every thread holds at
+ * most one row and one column stripe, this fixed order rules out deadlocks even though
+ * distinct rows (columns) may share a stripe.
+ */
+class LockTable : boost::noncopyable {
+public:
+	/** Default maximum number of stripes per dimension (1MB of locks) */
+	static const mf_size_type DEFAULT_STRIPES = 1u << 14;
+
+	/** Locks a row and a column stripe (in that order) for the lifetime of the object */
+	class ScopedLock : boost::noncopyable {
+	public:
+		ScopedLock(LockTable& table, mf_size_type i, mf_size_type j)
+		: lock1_(table.row(i)), lock2_(table.column(j)) {
+		}
+
+	private:
+		SpinLock::scoped_lock lock1_;
+		SpinLock::scoped_lock lock2_;
+	};
+
+	/** Creates a lock table for a size1 x size2 matrix. The number of stripes of each
+	 * dimension is the number of rows (columns), but at most maxStripes, rounded up to
+	 * a power of two. */
+	LockTable(mf_size_type size1, mf_size_type size2, mf_size_type maxStripes = DEFAULT_STRIPES) {
+		mask1_ = stripes(size1, maxStripes) - 1;
+		mask2_ = stripes(size2, maxStripes) - 1;
+		storage_.resize((mask1_ + 1 + mask2_ + 1) * sizeof(SpinLock) + CACHE_LINE_SIZE);
+		std::size_t offset = reinterpret_cast<std::size_t>(&storage_[0]) % CACHE_LINE_SIZE;
+		char* begin = &storage_[0] + (offset == 0 ? 0 : CACHE_LINE_SIZE - offset);
+		rows_ = reinterpret_cast<SpinLock*>(begin);
+		columns_ = rows_ + mask1_ + 1;
+		for (SpinLock* p = rows_; p != columns_ + mask2_ + 1; p++) {
+			new (p) SpinLock();
+		}
+	}
+
+	~LockTable() {
+		for (SpinLock* p = rows_; p != columns_ + mask2_ + 1; p++) {
+			p->~SpinLock();
+		}
+	}
+
+	/** Returns the lock of the stripe of row i */
+	inline SpinLock& row(mf_size_type i) {
+		return rows_[i & mask1_];
+	}
+
+	/** Returns the lock of the stripe of column j */
+	inline SpinLock& column(mf_size_type j) {
+		return columns_[j & mask2_];
+	}
+
+	mf_size_type stripes1() const {
+		return mask1_ + 1;
+	}
+
+	mf_size_type stripes2() const {
+		return mask2_ + 1;
+	}
+
+private:
+	static mf_size_type stripes(mf_size_type size, mf_size_type maxStripes) {
+		mf_size_type result = 1;
+		while (result < size && result < maxStripes) result <<= 1;
+		return result;
+	}
+
+	std::vector<char> storage_;
+	SpinLock* rows_;
+	SpinLock* columns_;
+	mf_size_type mask1_;
+	mf_size_type mask2_;
+};
+
+}
+
+#endif
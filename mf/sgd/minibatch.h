@@ -0,0 +1,267 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Support for mini-batch SGD (see SGD_ORDER_MINIBATCH). A mini-batch consists of the training
+ * points of a chunk of consecutive rows of the data matrix. The gradients of all points of a
+ * batch are computed from the same factors and applied in bulk. The columns of H touched by a
+ * batch are gathered into a dense panel, so that the predictions and gradients can be computed
+ * as small dense matrix products of the rows of W and the panel (see the kernels below); the
+ * chunks are chosen such that enough of the entries of these products are training points.
+ */
+
+#ifndef MF_SGD_MINIBATCH_H
+#define MF_SGD_MINIBATCH_H
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/type_traits/integral_constant.hpp>
+
+#include <mf/sgd/functions/kernels.h>
+#include <mf/types.h>
+
+namespace mf {
+
+/** Indicates whether an update function can be applied to mini-batches. Such update functions
+ * minimize the NZSL plus a regularization term that is linear in the factors; they have members
+ * <code>template<typename FD> double miniBatchW(const FD& data, mf_size_type i) const</code>
+ * <code>template<typename FD> double miniBatchH(const FD& data, mf_size_type j) const</code>
+ * that return the coefficient c of the regularization part of a single step: a step with step
+ * size eps on a training point in row i (column j) multiplies row i of W (column j of H) by 1-eps*c.
+ */
+template<typename Update>
+struct HasMiniBatch : public boost::false_type {
+};
+
+namespace detail {
+
+/** Reads the regularization coefficients of an update function that supports mini-batches
+ * (see mf::HasMiniBatch); 0 for all other update functions. */
+template<typename Update, bool = HasMiniBatch<Update>::value>
+struct MiniBatchTerms {
+	template<typename FD>
+	static inline double w(const Update& update, const FD& data, mf_size_type i) {
+		return 0.;
+	}
+
+	template<typename FD>
+	static inline double h(const Update& update, const FD& data, mf_size_type j) {
+		return 0.;
+	}
+};
+
+template<typename Update>
+struct MiniBatchTerms<Update, true> {
+	template<typename FD>
+	static inline double w(const Update& update, const FD& data, mf_size_type i) {
+		return update.miniBatchW(data, i);
+	}
+
+	template<typename FD>
+	static inline double h(const Update& update, const FD& data, mf_size_type j) {
+		return update.miniBatchH(data, j);
+	}
+};
+
+} // namespace detail
+
+/** Temp space of mini-batch SGD */
+struct MiniBatchSpace {
+	std::vector<mf_size_type> offsets;   // batch b covers positions [offsets[b], offsets[b+1])
+	std::vector<mf_size_type> order;     // order in which the batches are processed
+	std::vector<mf_size_type> slot;      // panel column of each column of H (or none())
+	std::vector<mf_size_type> columns;   // columns of H in the panel
+	std::vector<mf_size_type> pointSlot; // panel column of each training point of a batch
+	std::vector<double> buffer;          // panel, gradients, and dense matrices of a batch
+
+	static mf_size_type none() {
+		return (mf_size_type)-1;
+	}
+};
+
+namespace kernels {
+
+/** Minimum fraction of the entries of the dense products of a mini-batch (rows of the batch
+ * times gathered columns) that are training points. Batches are grown while they stay that
+ * dense; sparser batches use one inner product per training point. */
+inline double miniBatchDenseFraction() {
+	return 0.25;
+}
+
+/** Computes c[z] += f*b[z] for z=0..r-1 (or z=0..R-1 if R>0). */
+template<unsigned R, typename T>
+inline void axpy(double f, const T* b, unsigned r, double* c) {
+	const unsigned n = size<R>(r);
+	for (unsigned z=0; z<n; z++) {
+		c[z] += f * b[z];
+	}
+}
+
+/** Computes the m x n matrix C = A B^T, where A (m x r) and B (n x r) are stored row-major,
+ * i.e., c[i*n+j] is the inner product of row i of A and row j of B. B is first transposed into
+ * bt (r x n) so that the innermost loop runs over a row of C; four rows of C are computed at a
+ * time so that every value of bt that is loaded is used four times. */
+template<unsigned R, typename TA, typename TB>
+void gemmNT(const TA* a, const TB* b, mf_size_type m, mf_size_type n, unsigned r,
+		double* bt, double* c) {
+	const unsigned k = size<R>(r);
+	for (mf_size_type j=0; j<n; j++) {
+		for (unsigned z=0; z<k; z++) {
+			bt[z*n + j] = b[j*k + z];
+		}
+	}
+	std::fill(c, c + m*n, 0.);
+
+	mf_size_type i = 0;
+	for (; i+4<=m; i+=4) {
+		const TA* a0 = a + i*k;
+		const TA* a1 = a0 + k;
+		const TA* a2 = a1 + k;
+		const TA* a3 = a2 + k;
+		double* c0 = c + i*n;
+		double* c1 = c0 + n;
+		double* c2 = c1 + n;
+		double* c3 = c2 + n;
+		for (unsigned z=0; z<k; z++) {
+			const double f0 = a0[z], f1 = a1[z], f2 = a2[z], f3 = a3[z];
+			const double* btz = bt + z*n;
+			for (mf_size_type j=0; j<n; j++) {
+				const double v = btz[j];
+				c0[j] += f0 * v;
+				c1[j] += f1 * v;
+				c2[j] += f2 * v;
+				c3[j] += f3 * v;
+			}
+		}
+	}
+	for (; i<m; i++) {
+		const TA* a0 = a + i*k;
+		double* c0 = c + i*n;
+		for (unsigned z=0; z<k; z++) {
+			const double f0 = a0[z];
+			const double* btz = bt + z*n;
+			for (mf_size_type j=0; j<n; j++) {
+				c0[j] += f0 * btz[j];
+			}
+		}
+	}
+}
+
+/** Computes C += E B, where E is m x l, B is l x r (row-major) and C is m x r (row-major).
+ * Entry (i,p) of E is read from e[i*s1 + p*s2], so that E^T can be used without a copy. Four
+ * rows of C are computed at a time; zero entries of E are skipped. */
+template<unsigned R, typename T>
+void gemmAdd(const double* e, mf_size_type s1, mf_size_type s2, const T* b,
+		mf_size_type m, mf_size_type l, unsigned r, double* c) {
+	const unsigned k = size<R>(r);
+	mf_size_type i = 0;
+	for (; i+4<=m; i+=4) {
+		double* c0 = c + i*k;
+		double* c1 = c0 + k;
+		double* c2 = c1 + k;
+		double* c3 = c2 + k;
+		for (mf_size_type p=0; p<l; p++) {
+			const double* ep = e + i*s1 + p*s2;
+			const double f0 = ep[0], f1 = ep[s1], f2 = ep[2*s1], f3 = ep[3*s1];
+			if (f0 == 0. && f1 == 0. && f2 == 0. && f3 == 0.) continue;
+			const T* bp = b + p*k;
+			for (unsigned z=0; z<k; z++) {
+				const double v = bp[z];
+				c0[z] += f0 * v;
+				c1[z] += f1 * v;
+				c2[z] += f2 * v;
+				c3[z] += f3 * v;
+			}
+		}
+	}
+	for (; i<m; i++) {
+		for (mf_size_type p=0; p<l; p++) {
+			const double f = e[i*s1 + p*s2];
+			if (f != 0.) axpy<R>(f, b + p*k, k, c + i*k);
+		}
+	}
+}
+
+} // namespace kernels
+
+namespace detail {
+
+/** Splits the training points of data, which are grouped by row (group g covers positions
+ * [rows[g], rows[g+1]) and the groups are in row order), into mini-batches of consecutive
+ * rows. A batch is grown row by row as long as it spans at most maxRows rows of W and
+ * maxCols distinct columns of H, and as long as its training points make up at least
+ * kernels::miniBatchDenseFraction() of the entries of its dense products. Rows with more than
+ * maxCols training points are split into batches of their own. The batch boundaries are
+ * stored in space.offsets. */
+template<typename FD>
+void formMiniBatches(const FD& data, const std::vector<mf_size_type>& rows,
+		mf_size_type maxRows, mf_size_type maxCols, MiniBatchSpace& space) {
+	std::vector<mf_size_type>& offsets = space.offsets;
+	std::vector<mf_size_type>& mark = space.slot; // id of the last batch that contains each column
+	offsets.clear();
+	mark.assign(data.n, MiniBatchSpace::none());
+	mf_size_type batch = 0, begin = 0, firstRow = 0, cols = 0;
+	for (mf_size_type g=0; g+1<rows.size(); g++) {
+		const mf_size_type p0 = rows[g], p1 = rows[g+1];
+		const mf_size_type row = data.vIndex1[p0];
+		if (p1 - p0 > maxCols) {
+			if (begin < p0) offsets.push_back(begin);
+			for (mf_size_type p=p0; p<p1; p+=maxCols) offsets.push_back(p);
+			begin = p1;
+			batch++;
+			continue;
+		}
+
+		// try to add the row to the current batch
+		if (begin < p0) {
+			mf_size_type added = 0;
+			for (mf_size_type p=p0; p<p1; p++) {
+				const mf_size_type j = data.vIndex2[p];
+				if (mark[j] != batch) {
+					mark[j] = batch;
+					added++;
+				}
+			}
+			const mf_size_type span = row >= firstRow ? row - firstRow + 1 : MiniBatchSpace::none();
+			if (span <= maxRows && cols + added <= maxCols
+					&& p1 - begin >= kernels::miniBatchDenseFraction() * span * (cols + added)) {
+				cols += added;
+				continue;
+			}
+			offsets.push_back(begin);
+			batch++;
+		}
+
+		// start a new batch with the row
+		begin = p0;
+		firstRow = row;
+		cols = 0;
+		for (mf_size_type p=p0; p<p1; p++) {
+			const mf_size_type j = data.vIndex2[p];
+			if (mark[j] != batch) {
+				mark[j] = batch;
+				cols++;
+			}
+		}
+	}
+	if (begin < data.nnz) offsets.push_back(begin);
+	offsets.push_back(data.nnz);
+	mark.assign(data.n, MiniBatchSpace::none()); // reused as slots by the kernels
+}
+
+} // namespace detail
+
+}
+
+#endif
@@ -22,7 +22,9 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/shared_array.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/free-block-scheduler.h>
 //#include <mf/sgd/dsgd-factorization.h>
 
 namespace mf {
@@ -106,6 +108,15 @@ public:
 			std::vector<mf_size_type>& offsets) : random_(random), permutation_(permutation), offsets_(offsets) {
 	}
 
+	/** Creates a runner that schedules the blocks of a blocks1 x blocks2 grid dynamically (see
+	 * FreeBlockScheduler) instead of statically assigning a fixed range of blocks to each task.
+	 * offsets has blocks1*blocks2+1 entries (blocks in row-major order). */
+	StratifiedPsgdRunner(rg::Random32& random, std::vector<mf_size_type>& permutation,
+			std::vector<mf_size_type>& offsets, mf_size_type blocks1, mf_size_type blocks2)
+	: permutation_(permutation), offsets_(offsets), random_(random),
+	  scheduler_(new FreeBlockScheduler(blocks1, blocks2, offsets)) {
+	}
+
 	template<typename Update, typename Regularize, typename Loss,
 		typename AdaptiveDecay,
 		typename TestData, typename TestLoss>
@@ -135,6 +146,7 @@ private:
 	std::vector<mf_size_type> permutation_;
 	std::vector<mf_size_type> offsets_;
 	rg::Random32& random_;
+	boost::scoped_ptr<FreeBlockScheduler> scheduler_; // NULL for static scheduling
 };
 
 }
@@ -151,8 +151,14 @@ struct StratifiedPsgdUpdateWorTask {
 			
 
 			if(blockBegin <  blockEnd){
-			  	myPermute(random, permutation, blockBegin, blockEnd);// WOR for training point selection
-				SgdRunner::updateWor(job, decay, random, blockBegin, blockEnd, 0, permutation);			  
+				if (job.order == SGD_ORDER_WOR_FEISTEL) {
+					// WOR without touching the permutation vector
+					FeistelPermutation blockPermutation(blockEnd - blockBegin, random);
+					SgdRunner::updateFeistel(job, decay, 0, blockEnd - blockBegin, 0, blockPermutation, blockBegin);
+				} else {
+					myPermute(random, permutation, blockBegin, blockEnd);// WOR for training point selection
+					SgdRunner::updateWor(job, decay, random, blockBegin, blockEnd, 0, permutation);
+				}
 			}
 // 			barrier(channels);
 		}
@@ -163,6 +169,47 @@ struct StratifiedPsgdUpdateWorTask {
 };
 
 
+/** Processes blocks handed out by a FreeBlockScheduler until the epoch is over */
+template<typename Update, typename Regularize>
+struct StratifiedPsgdUpdateDynamicTask {
+	static const std::string id() { return std::string("__mf/sgd/StratifiedPsgdUpdateDynamicTask_")
+			+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name(); }
+
+	static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
+		rg::Random32 random = mpi2::getSeed(ch);
+
+		// receive data descriptor
+		double eps;
+		mpi2::PointerIntType pJob, pPermutation, pOffsets, pScheduler;
+		ch.recv(*mpi2::unmarshal(pJob, pPermutation));
+		ch.recv(*mpi2::unmarshal(pOffsets, pScheduler, eps));
+
+		StratifiedPsgdJob<Update, Regularize>& job = *mpi2::intToPointer<StratifiedPsgdJob<Update, Regularize> >(pJob);
+		std::vector<mf_size_type>& permutation = *mpi2::intToPointer<std::vector<mf_size_type> >(pPermutation);
+		std::vector<mf_size_type>& offsets = *mpi2::intToPointer<std::vector<mf_size_type> >(pOffsets);
+		FreeBlockScheduler& scheduler = *mpi2::intToPointer<FreeBlockScheduler>(pScheduler);
+
+		// process free blocks until all blocks of this epoch have been handed out
+		DecayConstant decay(eps);
+		mf_size_type block;
+		while (scheduler.claim(random, block)) {
+			mf_size_type blockBegin = offsets[block];
+			mf_size_type blockEnd = offsets[block+1];
+			if (job.order == SGD_ORDER_WOR_FEISTEL) {
+				FeistelPermutation blockPermutation(blockEnd - blockBegin, random);
+				SgdRunner::updateFeistel(job, decay, 0, blockEnd - blockBegin, 0, blockPermutation, blockBegin);
+			} else {
+				myPermute(random, permutation, blockBegin, blockEnd);
+				SgdRunner::updateWor(job, decay, random, blockBegin, blockEnd, 0, permutation);
+			}
+			scheduler.release(block);
+		}
+
+		ch.send();
+	}
+};
+
+
 template<typename Update, typename Regularize>
 struct StratifiedPsgdUpdateSEQTask {
 	static const std::string id() { return std::string("__mf/sgd/StratifiedPsgdUpdateSEQTask_")
@@ -237,6 +284,19 @@ void StratifiedPsgdRunner::epoch(StratifiedPsgdJob<Update, Regularize>& job, dou
 	std::vector<mf_size_type>& permutation = permutation_;
 	std::vector<mf_size_type>& offsets = offsets_;	
 
+	// dynamic scheduling: tasks claim free blocks; no fixed assignment of blocks to tasks
+	if (scheduler_) {
+		std::vector<mpi2::Channel> channels;
+		scheduler_->startEpoch();
+		tm.spawn<detail::StratifiedPsgdUpdateDynamicTask<Update, Regularize> >(tm.world().rank(), tasks, channels);
+		mpi2::seed(channels, random_);
+		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&job), mpi2::pointerToInt(&permutation)));
+		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&offsets),
+				mpi2::pointerToInt(scheduler_.get()), eps));
+		mpi2::economicRecvAll(channels, tm.pollDelay());
+		return;
+	}
+
 	// fire up the tasks
 // 	std::vector<mpi2::Channel> channels;
 	std::vector<mpi2::Channel> channels(tasks, mpi2::UNINITIALIZED);
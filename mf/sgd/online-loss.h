@@ -0,0 +1,124 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Training loss accumulated during the SGD steps of an epoch ("online" loss). The update
+ * functions of the NZSL family compute the residual of each training point before updating
+ * the factors anyway; adding up its square is much cheaper than a separate pass over the data.
+ */
+
+#ifndef MF_SGD_ONLINE_LOSS_H
+#define MF_SGD_ONLINE_LOSS_H
+
+#include <boost/serialization/serialization.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** Sum of squared residuals of the SGD steps run during an epoch. Update functions report
+ * the residual of each step via OnlineLoss::add(double); it is added to the accumulator that
+ * has been installed for the calling thread with an OnlineLoss::Scope (and ignored if there is
+ * none). Each thread thus writes to its own accumulator; the accumulators of the threads
+ * are merged when the epoch is done.
+ *
+ * Since the factors change during the epoch, the online loss differs from the loss computed
+ * after the epoch. It is an estimate of the NZSL of the training data only, i.e., it does not
+ * contain regularization terms.
+ */
+class OnlineLoss {
+public:
+	OnlineLoss() : sum_(0), count_(0) {
+	}
+
+	/** Installs an accumulator for the calling thread; the previous one is restored
+	 * when the scope is left. */
+	class Scope {
+	public:
+		explicit Scope(OnlineLoss* loss) : previous_(current()) {
+			current() = loss;
+		}
+
+		~Scope() {
+			current() = previous_;
+		}
+
+	private:
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+
+		OnlineLoss* previous_;
+	};
+
+	/** Adds the squared residual of a single SGD step to the accumulator of the calling thread */
+	static inline void add(double residual) {
+		OnlineLoss* loss = current();
+		if (loss != NULL) {
+			loss->sum_ += residual*residual;
+			loss->count_++;
+		}
+	}
+
+	void reset() {
+		sum_ = 0;
+		count_ = 0;
+	}
+
+	/** Adds the steps accumulated by another accumulator */
+	void merge(const OnlineLoss& o) {
+		sum_ += o.sum_;
+		count_ += o.count_;
+	}
+
+	double sum() const {
+		return sum_;
+	}
+
+	mf_size_type count() const {
+		return count_;
+	}
+
+	/** Returns the estimated loss for a data matrix with the given number of nonzero entries
+	 * (i.e., the mean squared residual scaled to nnz). */
+	double value(mf_size_type nnz) const {
+		return count_ == 0 ? 0 : sum_ * nnz / count_;
+	}
+
+private:
+	static inline OnlineLoss*& current() {
+		static __thread OnlineLoss* loss = NULL;
+		return loss;
+	}
+
+	double sum_;
+	mf_size_type count_;
+
+	friend class ::boost::serialization::access;
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int version) {
+		ar & sum_;
+		ar & count_;
+	}
+};
+
+/** Whether an update function reports the residual of each step via OnlineLoss::add(double).
+ * The online loss of all other update functions is always 0; they cannot be used with the
+ * online loss. Specialized by the update functions of the NZSL family. */
+template<typename Update>
+struct HasOnlineLoss : public boost::false_type {
+};
+
+}
+
+#endif
@@ -0,0 +1,315 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * In-place arrangement of the training points of a data matrix. SGD_ORDER_WOR_SHUFFLED
+ * shuffles the three arrays of the data matrix (row indexes, column indexes, values) in place
+ * and then reads them sequentially, instead of gathering from the arrays via a permutation
+ * vector. SGD_ORDER_TILED and SGD_ORDER_MINIBATCH first group them into cache-sized tiles or
+ * row chunks. No copy of the training points is made; the data matrix is marked as unsorted
+ * whenever its storage order changes, so that ublas sorts it again before relying on the order
+ * (e.g., when looking up an entry). The data matrix must thus not be a const object.
+ *
+ * PSGD, which shuffles the training points of the next epoch while the current epoch is running,
+ * additionally keeps a single packed copy of the training points (see mf::PackedTriples).
+ */
+
+#ifndef MF_SGD_PACKED_H
+#define MF_SGD_PACKED_H
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include <util/random.h>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** Marks a coordinate matrix whose arrays have been reordered in place as unsorted. The arrays
+ * and the number of entries are kept. */
+template<typename M>
+void markUnsorted(M& v) {
+	typename M::size_type nnz = v.nnz();
+	v.clear(); // resets the sort state, keeps the arrays
+	v.set_filled(nnz);
+}
+
+/** Writable access to the training points of the data matrix of factorization data FD, used to
+ * reorder them in place. The data matrix is marked as unsorted on construction. */
+template<typename FD>
+class TrainingPoints {
+public:
+	typedef typename FD::V V;
+	typedef typename V::index_array_type::value_type Index;
+
+	explicit TrainingPoints(const FD& data) : v_(const_cast<V&>(data.v)),
+			index1_(v_.index1_data()), index2_(v_.index2_data()), values_(v_.value_data()) {
+		markUnsorted(v_);
+	}
+
+	Index i(mf_size_type p) const {
+		return index1_[p];
+	}
+
+	Index j(mf_size_type p) const {
+		return index2_[p];
+	}
+
+	void swap(mf_size_type p, mf_size_type q) {
+		std::swap(index1_[p], index1_[q]);
+		std::swap(index2_[p], index2_[q]);
+		std::swap(values_[p], values_[q]);
+	}
+
+	void prefetch(mf_size_type p) const {
+		__builtin_prefetch(&index1_[p], 1, 0); // write
+		__builtin_prefetch(&index2_[p], 1, 0);
+		__builtin_prefetch(&values_[p], 1, 0);
+	}
+
+private:
+	V& v_;
+	typename V::index_array_type& index1_;
+	typename V::index_array_type& index2_;
+	typename V::value_array_type& values_;
+};
+
+/** A single training point of a factorization job with data type FD. */
+template<typename FD>
+struct PackedTriple {
+	typedef typename FD::V::index_array_type::value_type Index;
+	typedef typename FD::V::value_type Value;
+
+	Index i;
+	Index j;
+	Value x;
+};
+
+/** A packed copy of the training points of a data matrix. The buffer is bound to the data
+ * matrix it has been filled from and is refilled whenever it is used with a different data
+ * matrix or a different number of training points. The data matrix may be reordered in place in
+ * the meantime, but its training points must not be changed otherwise; call invalidate()
+ * when they are. The element type depends on the type of the factorization data; the buffer
+ * can thus be stored in non-template runners.
+ */
+class PackedTriples {
+public:
+	PackedTriples() : source_(NULL) {
+	}
+
+	/** Makes sure that the buffer holds the training points of the given data.
+	 *
+	 * @return true if the buffer had to be (re)filled; the triples are then in storage order
+	 */
+	template<typename FD>
+	bool pack(const FD& data) {
+		typedef std::vector<PackedTriple<FD> > Triples;
+		Triples* triples = boost::any_cast<Triples>(&triples_);
+		if (triples == NULL) {
+			triples_ = Triples();
+			triples = boost::any_cast<Triples>(&triples_);
+			source_ = NULL;
+		}
+		const void* source = &data.v;
+		if (source == source_ && triples->size() == data.nnz) {
+			return false;
+		}
+
+		triples->resize(data.nnz);
+		for (mf_size_type p=0; p<data.nnz; p++) {
+			PackedTriple<FD>& t = (*triples)[p];
+			t.i = data.vIndex1[p];
+			t.j = data.vIndex2[p];
+			t.x = data.vValues[p];
+		}
+		source_ = source;
+		return true;
+	}
+
+	/** Returns the packed training points. Must be preceded by a call to pack() with
+	 * data of the same type. */
+	template<typename FD>
+	std::vector<PackedTriple<FD> >& get() {
+		return *boost::any_cast<std::vector<PackedTriple<FD> > >(&triples_);
+	}
+
+	/** Frees the buffer; the next call to pack() refills it */
+	void invalidate() {
+		triples_ = boost::any();
+		source_ = NULL;
+	}
+
+private:
+	boost::any triples_;
+	const void* source_; // identifies the data matrix the triples have been taken from
+};
+
+/** Shuffles the first k of the n elements starting at v in place (the remaining elements
+ * form a random subset of the rest). This is the standard Knuth shuffle with prefetching. */
+template<typename T>
+void shuffle(rg::Random32& random, T* v, mf_size_type n, mf_size_type k) {
+	if (n < 2) return;
+	if (k > n-1) k = n-1; // last element does not need to be swapped
+
+	mf_size_type nextIndex = random.nextInt(n);
+	for (mf_size_type step=0; step<k; step++) {
+		mf_size_type currentIndex = nextIndex;
+		if (step+1 < k) {
+			nextIndex = step+1 + random.nextInt(n-step-1);
+			__builtin_prefetch(&v[nextIndex], 1, 0); // write
+		}
+		std::swap(v[step], v[currentIndex]);
+	}
+}
+
+/** Shuffles the first k elements of v in place (see above). */
+template<typename T>
+inline void shuffle(rg::Random32& random, std::vector<T>& v, mf_size_type k) {
+	if (v.empty()) return;
+	shuffle(random, &v[0], v.size(), k);
+}
+
+/** Shuffles the first k of the n training points starting at position begin in place (see
+ * above). */
+template<typename FD>
+void shuffle(rg::Random32& random, TrainingPoints<FD>& points, mf_size_type begin,
+		mf_size_type n, mf_size_type k) {
+	if (n < 2) return;
+	if (k > n-1) k = n-1;
+
+	mf_size_type nextIndex = begin + random.nextInt(n);
+	for (mf_size_type step=0; step<k; step++) {
+		mf_size_type currentIndex = nextIndex;
+		if (step+1 < k) {
+			nextIndex = begin + step+1 + random.nextInt(n-step-1);
+			points.prefetch(nextIndex);
+		}
+		points.swap(begin + step, currentIndex);
+	}
+}
+
+/** The training points of a data matrix grouped in place into tiles of tileRows x tileCols
+ * entries of the data matrix. The rows of W and the columns of H touched by a tile form a small,
+ * contiguous region of the factors; processing a tile at a time thus keeps the factors in cache.
+ * Tiles are stored in row-major order; tile t covers positions [offsets()[t], offsets()[t+1]).
+ * Only the tile boundaries are kept here. They stay valid as long as the training points are
+ * reordered within their tiles only; call invalidate() after any other change.
+ */
+class TiledPoints {
+public:
+	TiledPoints() : source_(NULL), nnz_(0), tileRows_(0), tileCols_(0) {
+	}
+
+	/** Makes sure that the training points of the given data are grouped into tiles of the
+	 * given size.
+	 *
+	 * @return true if the training points had to be (re)arranged
+	 */
+	template<typename FD>
+	bool arrange(const FD& data, mf_size_type tileRows, mf_size_type tileCols) {
+		if (&data.v == source_ && data.nnz == nnz_ && tileRows == tileRows_ && tileCols == tileCols_) {
+			return false;
+		}
+
+		// group by tile row, then each tile row by tile column (both American flag sorts, i.e.,
+		// points that are already in the right place are not moved)
+		TrainingPoints<FD> points(data);
+		const mf_size_type tiles1 = (data.m + tileRows - 1) / tileRows;
+		const mf_size_type tiles2 = (data.n + tileCols - 1) / tileCols;
+		std::vector<mf_size_type> rowOffsets, colOffsets, next;
+		group(points, 0, data.nnz, tileRows, tiles1, true, rowOffsets, next);
+		offsets_.clear();
+		for (mf_size_type t1=0; t1<tiles1; t1++) {
+			if (rowOffsets[t1] == rowOffsets[t1+1]) continue;
+			if (tiles2 == 1) {
+				offsets_.push_back(rowOffsets[t1]);
+				continue;
+			}
+			group(points, rowOffsets[t1], rowOffsets[t1+1], tileCols, tiles2, false, colOffsets, next);
+			for (mf_size_type t2=0; t2<tiles2; t2++) {
+				if (colOffsets[t2] < colOffsets[t2+1]) offsets_.push_back(colOffsets[t2]);
+			}
+		}
+		offsets_.push_back(data.nnz);
+
+		order_.resize(offsets_.size()-1);
+		for (mf_size_type t=0; t<order_.size(); t++) {
+			order_[t] = t;
+		}
+		source_ = &data.v;
+		nnz_ = data.nnz;
+		tileRows_ = tileRows;
+		tileCols_ = tileCols;
+		return true;
+	}
+
+	const std::vector<mf_size_type>& offsets() const {
+		return offsets_;
+	}
+
+	/** Order in which the tiles are processed (initially in storage order) */
+	std::vector<mf_size_type>& order() {
+		return order_;
+	}
+
+	/** Forgets the arrangement; the next call to arrange() groups the training points again */
+	void invalidate() {
+		source_ = NULL;
+	}
+
+private:
+	/** Groups the training points in positions [begin,end) in place by their tile row (byRow)
+	 * or tile column. Afterwards, tile t covers positions [offsets[t], offsets[t+1]). */
+	template<typename FD>
+	static void group(TrainingPoints<FD>& points, mf_size_type begin, mf_size_type end,
+			mf_size_type tileSize, mf_size_type tiles, bool byRow,
+			std::vector<mf_size_type>& offsets, std::vector<mf_size_type>& next) {
+		offsets.assign(tiles+1, 0);
+		for (mf_size_type p=begin; p<end; p++) {
+			offsets[(byRow ? points.i(p) : points.j(p))/tileSize + 1]++;
+		}
+		offsets[0] = begin;
+		for (mf_size_type t=1; t<=tiles; t++) {
+			offsets[t] += offsets[t-1];
+		}
+
+		// move every point into the region of its tile; next[t] is the first position of tile
+		// t that has not been filled yet
+		next.assign(offsets.begin(), offsets.end()-1);
+		for (mf_size_type t=0; t<tiles; t++) {
+			while (next[t] < offsets[t+1]) {
+				const mf_size_type p = next[t];
+				const mf_size_type u = (byRow ? points.i(p) : points.j(p))/tileSize;
+				if (u == t) {
+					next[t]++;
+				} else {
+					points.swap(p, next[u]++);
+				}
+			}
+		}
+	}
+
+	const void* source_; // identifies the data matrix that has been arranged
+	mf_size_type nnz_;
+	std::vector<mf_size_type> offsets_;
+	std::vector<mf_size_type> order_;
+	mf_size_type tileRows_;
+	mf_size_type tileCols_;
+};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Pseudo-random permutations that are computed on the fly (used by SGD_ORDER_WOR_FEISTEL).
+ */
+
+#ifndef MF_SGD_PERMUTATION_H
+#define MF_SGD_PERMUTATION_H
+
+#include <boost/cstdint.hpp>
+
+#include <util/random.h>
+
+#include <mf/types.h>
+
+namespace mf {
+
+/** A keyed pseudo-random permutation of [0,n) that uses O(1) memory. The permutation is
+ * computed by a balanced 4-round Feistel network on the smallest domain of 2^(2h) >= n
+ * elements; values outside of [0,n) are mapped back into the range by cycle walking (on
+ * average, less than 4 rounds of the network are needed per element).
+ *
+ * Each element can be computed independently, so that disjoint ranges of positions give
+ * disjoint, random-looking traversals of the data that can be processed in parallel.
+ */
+class FeistelPermutation {
+public:
+	static const unsigned ROUNDS = 4;
+
+	/** Creates a random permutation of [0,n). The keys are taken from random. */
+	FeistelPermutation(mf_size_type n, rg::Random32& random) : n_(n), halfBits_(1) {
+		while (((boost::uint64_t)1 << (2*halfBits_)) < n_) halfBits_++;
+		halfMask_ = ((boost::uint64_t)1 << halfBits_) - 1;
+		for (unsigned k=0; k<ROUNDS; k++) {
+			keys_[k] = ((boost::uint64_t)random.prng()() << 32) | random.prng()();
+		}
+	}
+
+	/** Returns the element at position i of the permutation (i < n). */
+	inline mf_size_type operator()(mf_size_type i) const {
+		boost::uint64_t x = encrypt(i);
+		while (x >= n_) {
+			x = encrypt(x); // cycle walking
+		}
+		return x;
+	}
+
+	mf_size_type size() const {
+		return n_;
+	}
+
+private:
+	inline boost::uint64_t encrypt(boost::uint64_t x) const {
+		boost::uint64_t left = x >> halfBits_;
+		boost::uint64_t right = x & halfMask_;
+		for (unsigned k=0; k<ROUNDS; k++) {
+			boost::uint64_t temp = right;
+			right = left ^ (mix(right ^ keys_[k]) & halfMask_);
+			left = temp;
+		}
+		return (left << halfBits_) | right;
+	}
+
+	/** Round function (finalizer of MurmurHash3) */
+	static inline boost::uint64_t mix(boost::uint64_t x) {
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ULL;
+		x ^= x >> 33;
+		return x;
+	}
+
+	mf_size_type n_;
+	unsigned halfBits_;
+	boost::uint64_t halfMask_;
+	boost::uint64_t keys_[ROUNDS];
+};
+
+}
+
+#endif
@@ -15,6 +15,7 @@
 #define MF_SGD_PSGD_H
 
 #include <mf/sgd/sgd.h>
+#include <mf/sgd/workers.h>
 
 namespace mf {
 
@@ -24,21 +25,21 @@ enum PsgdShuffle {
 	PSGD_SHUFFLE_PARALLEL_ADDITIONAL_TASK  /**< shuffling is performed in parallel (in an additional task) */
 };
 
-template<typename Update, typename Regularize>
-struct PsgdJob : public SgdJob<Update,Regularize> {
-    using FactorizationData<>::tasks;
+template<typename Update, typename Regularize, typename FD = FactorizationData<> >
+struct PsgdJob : public SgdJob<Update,Regularize,FD> {
+    using FD::tasks;
 
-	PsgdJob(const SparseMatrix& v, DenseMatrix &w, DenseMatrixCM& h,
+	PsgdJob(const typename FD::V& v, typename FD::W &w, typename FD::H& h,
 			Update update, Regularize regularize, SgdOrder order = SGD_ORDER_WR,
 			int tasks = 1, PsgdShuffle shuffle = PSGD_SHUFFLE_PARALLEL)
-	: SgdJob<Update,Regularize>(v, w, h, update, regularize, order), shuffle(shuffle) {
+	: SgdJob<Update,Regularize,FD>(v, w, h, update, regularize, order), shuffle(shuffle) {
 		this->tasks = tasks;
 	}
 
-	PsgdJob(FactorizationData<> data,
+	PsgdJob(FD data,
 			Update update, Regularize regularize, SgdOrder order = SGD_ORDER_WR,
 			int tasks = 1, PsgdShuffle shuffle= PSGD_SHUFFLE_PARALLEL)
-	: SgdJob<Update,Regularize>(data, update, regularize, order), shuffle(shuffle) {
+	: SgdJob<Update,Regularize,FD>(data, update, regularize, order), shuffle(shuffle) {
 		this->tasks = tasks;
 	}
 
@@ -49,7 +50,14 @@ public:
 /** Runs a PSGD-based factorization job */
 class PsgdRunner {
 public:
-	PsgdRunner(rg::Random32& random) : random_(random), nextPermutation(true) {
+	PsgdRunner(rg::Random32& random) : random_(random), nextPermutation(true), readPacked_(true),
+			onlineLossEvery_(0) {
+	}
+
+	/** Uses the training loss accumulated during each epoch instead of the exact loss, which
+	 * is then computed only every k epochs (see SgdRunner::setOnlineLoss()). */
+	void setOnlineLoss(mf_size_type k) {
+		onlineLossEvery_ = k;
 	}
 
 	/** Runs a number of Hogwild SGD epochs using a distributed adaptive decay function. This is the most
@@ -67,10 +75,10 @@ public:
  	 * @tparam Loss type of loss function (model of DistributedLossConcept)
  	 * @tparam AdaptiveDecay type of decay function (model of DistributedAdaptiveDecayConcept)
 	 */
-	template<typename Update, typename Regularize, typename Loss,
+	template<typename Update, typename Regularize, typename FD, typename Loss,
 		typename AdaptiveDecay,
 		typename TestData, typename TestLoss>
-	void run(PsgdJob<Update, Regularize>& job,
+	void run(PsgdJob<Update, Regularize, FD>& job,
 			Loss& loss,
 			mf_size_type epochs,
 			AdaptiveDecay& decay,
@@ -78,9 +86,9 @@ public:
 			BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE,
 			TestData* testData = NULL, TestLoss *testLoss = NULL);
 
-	template<typename Update, typename Regularize, typename Loss,
+	template<typename Update, typename Regularize, typename FD, typename Loss,
 		typename AdaptiveDecay>
-	void run(PsgdJob<Update, Regularize>& job, Loss& loss,
+	void run(PsgdJob<Update, Regularize, FD>& job, Loss& loss,
 			mf_size_type epochs, AdaptiveDecay& decay,
 			Trace& trace, BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE);
 
@@ -94,27 +102,42 @@ public:
  	 * @tparam Update type of update function (model of UpdateConcept)
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
 	 */
-	template<typename Update, typename Regularize>
-	void epoch(PsgdJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void epoch(PsgdJob<Update, Regularize, FD>& job, double eps);
+
+	template<typename Update, typename Regularize, typename FD>
+	void updateSequential(PsgdJob<Update, Regularize, FD>& job, double eps);
 
-	template<typename Update, typename Regularize>
-	void updateSequential(PsgdJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void updateWr(PsgdJob<Update, Regularize, FD>& job, double eps);
 
-	template<typename Update, typename Regularize>
-	void updateWr(PsgdJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void updateWor(PsgdJob<Update, Regularize, FD>& job, double eps);
 
-	template<typename Update, typename Regularize>
-	void updateWor(PsgdJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void updateShuffled(PsgdJob<Update, Regularize, FD>& job, double eps);
+
+	template<typename Update, typename Regularize, typename FD>
+	void updateFeistel(PsgdJob<Update, Regularize, FD>& job, double eps);
 
 	void setPrngState(const rg::Random32& random) {
 		random_ = random;
 	}
 
 private:
+	/** Runs parts 0,...,parts-2 of the given work on the worker pool (adding the requests
+	 * to reqs) and the last part in the current thread */
+	void runParts(LocalWork& work, unsigned parts, std::vector<boost::mpi::request>& reqs);
+
 	rg::Random32& random_;
 	std::vector<mf_size_type> permutation_;
 	std::vector<mf_size_type> permutation2_;
 	bool nextPermutation;
+	PackedTriples packed_; // copy of the training points (WOR_SHUFFLED with parallel shuffling)
+	bool readPacked_; // whether the current epoch reads the copy or the data matrix (WOR_SHUFFLED)
+	LocalWorkerPool workers_; // kept alive across epochs
+	mf_size_type onlineLossEvery_;
+	OnlineLoss onlineLoss_; // online loss of the current epoch (merged from all parts)
 };
 
 }
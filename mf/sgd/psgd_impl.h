@@ -15,16 +15,18 @@
 
 namespace mf {
 
-template<typename Update, typename Regularize, typename Loss,
+template<typename Update, typename Regularize, typename FD, typename Loss,
 	typename AdaptiveDecay,typename TestData,typename TestLoss>
-void PsgdRunner::run(PsgdJob<Update, Regularize>& job, Loss& loss,
+void PsgdRunner::run(PsgdJob<Update, Regularize, FD>& job, Loss& loss,
 		mf_size_type epochs, AdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod,
 		TestData* testData, TestLoss *testLoss) {
 	std::stringstream ss;
-	ss << "sgd tasks: " << job.tasks - (job.order == SGD_ORDER_WOR && job.shuffle == PSGD_SHUFFLE_PARALLEL ? 1 : 0);
+	// orders that use a shuffle task (SGD_ORDER_WOR_FEISTEL does not shuffle)
+	bool wor = job.order == SGD_ORDER_WOR || job.order == SGD_ORDER_WOR_SHUFFLED;
+	ss << "sgd tasks: " << job.tasks - (wor && job.shuffle == PSGD_SHUFFLE_PARALLEL ? 1 : 0);
 	ss << ", ";
-	if (job.order == SGD_ORDER_WOR) {
+	if (wor) {
 		ss << "shuffle tasks: " << (job.shuffle == PSGD_SHUFFLE_SEQ ? 0 : 1);
 		ss << ", ";
 	}
@@ -32,172 +34,254 @@ void PsgdRunner::run(PsgdJob<Update, Regularize>& job, Loss& loss,
 
 	LOG4CXX_INFO(detail::logger, "Starting PSGD (" << ss.str() << ")");
 
+	// all tasks access all of V, W and H; spread them across the NUMA nodes of pinned tasks
+	if (pinTasks()) {
+		interleaveSparse(job.v);
+		interleaveDense(job.w);
+		interleaveDense(job.h);
+	}
+
+	packed_.invalidate(); // the data may have changed since the last run
 	detail::defaultRunner(job, loss, epochs, decay,
-			boost::bind(&PsgdRunner::epoch<Update,Regularize>, this, _1, _2),
-			trace, random_, balanceType, balanceMethod, testData, testLoss);
+			boost::bind(&PsgdRunner::epoch<Update,Regularize,FD>, this, _1, _2),
+			trace, random_, balanceType, balanceMethod, testData, testLoss,
+			onlineLossEvery_, &onlineLoss_);
+	workers_.stop();
+	packed_.invalidate(); // frees the copy
 
 	LOG4CXX_INFO(detail::logger, "Finished PSGD");
 }
 
-template<typename Update, typename Regularize, typename Loss,
+template<typename Update, typename Regularize, typename FD, typename Loss,
 	typename AdaptiveDecay>
-void PsgdRunner::run(PsgdJob<Update, Regularize>& job, Loss& loss,
+void PsgdRunner::run(PsgdJob<Update, Regularize, FD>& job, Loss& loss,
 		mf_size_type epochs, AdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod) {
-	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (FactorizationData<>*)NULL, (NoLoss*)NULL);
+	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (FD*)NULL, (NoLoss*)NULL);
 }
 
 namespace detail {
-	template<typename Update, typename Regularize>
-	struct PsgdUpdateSeqTask {
-		static const std::string id() { return std::string("__mf/sgd/PsgdUpdateSeqTask_")
-				+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name(); }
-
-		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
-			// receive data descriptor
-			mpi2::PointerIntType pJob;
-			double eps;
-			mpi2::PointerIntType pSplits;
-			ch.recv(*mpi2::unmarshal(pJob, eps, pSplits));
-			PsgdJob<Update, Regularize>& job = *mpi2::intToPointer<PsgdJob<Update, Regularize> >(pJob);
-			std::vector<mf_size_type>& splits = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplits);
-
-			// run SGD steps
-			int id = info.groupId();
-			mf_size_type begin = splits[id];
-			mf_size_type end = splits[id+1];
-			DecayConstant decay(eps);
-			SgdRunner::updateSequential(job, decay, begin, end, begin);
-
-			// signal that we are done
-			ch.send();
+	/** Work of a PSGD epoch: part i runs the SGD steps of split i */
+	template<typename Update, typename Regularize, typename FD>
+	struct PsgdUpdateWork : public LocalWork {
+		PsgdUpdateWork(PsgdJob<Update, Regularize, FD>& job, double eps,
+				const std::vector<mf_size_type>& splits)
+		: job(job), eps(eps), splits(splits), loss(NULL) {
+		}
+
+		/** Lets each part accumulate the online loss of its SGD steps; the losses of the parts
+		 * are added to loss by mergeLoss() */
+		void collectLoss(OnlineLoss* loss) {
+			this->loss = loss;
+			if (loss != NULL) partLosses.assign(splits.size()-1, OnlineLoss());
 		}
+
+		void mergeLoss() {
+			if (loss == NULL) return;
+			for (unsigned i=0; i<partLosses.size(); i++) {
+				loss->merge(partLosses[i]);
+			}
+		}
+
+		PsgdJob<Update, Regularize, FD>& job;
+		const double eps;
+		const std::vector<mf_size_type>& splits;
+		OnlineLoss* loss;
+		std::vector<OnlineLoss> partLosses;
 	};
-}
 
-template<typename Update, typename Regularize>
-void PsgdRunner::updateSequential(PsgdJob<Update, Regularize>& job, double eps) {
-	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
-	unsigned tasks = job.tasks;
-	std::vector<mf_size_type> splits = mpi2::split(job.nnz, job.tasks);
+	/** Installs an online loss accumulator for a part of a PsgdUpdateWork. The loss is
+	 * accumulated on the stack of the executing thread (to avoid false sharing) and stored
+	 * with the work when the part is done. */
+	template<typename Work>
+	class PsgdPartLoss {
+	public:
+		PsgdPartLoss(Work& work, unsigned part)
+		: work_(work), part_(part), scope_(work.loss == NULL ? NULL : &loss_) {
+		}
 
-	// spawn task-1 parallel threads and also run sgd in this thread
-	std::vector<mpi2::Channel> channels;
-	if (tasks > 1) {
-		tm.spawn<detail::PsgdUpdateSeqTask<Update, Regularize> >(tm.world().rank(), tasks-1, channels);
-		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&job), eps, mpi2::pointerToInt(&splits)));
-	}
-	DecayConstant decay(eps);
-	SgdRunner::updateSequential(job, decay, splits[tasks-1], splits[tasks], splits[tasks-1]);
+		~PsgdPartLoss() {
+			if (work_.loss != NULL) work_.partLosses[part_] = loss_;
+		}
 
-	// wait for other threads to finish
-	mpi2::economicRecvAll(channels, tm.pollDelay());
-}
+	private:
+		Work& work_;
+		unsigned part_;
+		OnlineLoss loss_;
+		OnlineLoss::Scope scope_;
+	};
 
-namespace detail {
-	template<typename Update, typename Regularize>
-	struct PsgdUpdateWrTask {
-		static const std::string id() { return std::string("__mf/sgd/PsgdUpdateWrTask_")
-				+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name(); }
-
-		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
-			rg::Random32 random = mpi2::getSeed(ch);
-
-			// receive data descriptor
-			mpi2::PointerIntType pJob;
-			double eps;
-			mpi2::PointerIntType pSplits;
-			ch.recv(*mpi2::unmarshal(pJob, eps, pSplits));
-			PsgdJob<Update, Regularize>& job = *mpi2::intToPointer<PsgdJob<Update, Regularize> >(pJob);
-			std::vector<mf_size_type>& splits = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplits);
-
-			// run SGD steps
-			int id = info.groupId();
-			mf_size_type steps = splits[id+1]-splits[id];
-			DecayConstant decay(eps);
-			SgdRunner::updateWr(job, steps, decay, random, 0, job.nnz, 0);
-
-			// signal that we are done
-			ch.send();
+	template<typename Update, typename Regularize, typename FD>
+	struct PsgdUpdateSeqWork : public PsgdUpdateWork<Update, Regularize, FD> {
+		PsgdUpdateSeqWork(PsgdJob<Update, Regularize, FD>& job, double eps,
+				const std::vector<mf_size_type>& splits)
+		: PsgdUpdateWork<Update, Regularize, FD>(job, eps, splits) {
+		}
+
+		void run(unsigned i, rg::Random32& random) {
+			PsgdPartLoss<PsgdUpdateWork<Update, Regularize, FD> > partLoss(*this, i);
+			DecayConstant decay(this->eps);
+			SgdRunner::updateSequential(this->job, decay, this->splits[i], this->splits[i+1], this->splits[i]);
 		}
 	};
-}
 
-template<typename Update, typename Regularize>
-void PsgdRunner::updateWr(PsgdJob<Update, Regularize>& job, double eps) {
-	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
-	unsigned tasks = job.tasks;
-	std::vector<mf_size_type> splits = mpi2::split(job.nnz, job.tasks);
+	template<typename Update, typename Regularize, typename FD>
+	struct PsgdUpdateWrWork : public PsgdUpdateWork<Update, Regularize, FD> {
+		PsgdUpdateWrWork(PsgdJob<Update, Regularize, FD>& job, double eps,
+				const std::vector<mf_size_type>& splits)
+		: PsgdUpdateWork<Update, Regularize, FD>(job, eps, splits) {
+		}
 
-	// spawn task-1 parallel threads and also run sgd in this thread
-	std::vector<mpi2::Channel> channels;
-	if (tasks > 1) {
-		tm.spawn<detail::PsgdUpdateWrTask<Update, Regularize> >(tm.world().rank(), tasks-1, channels);
-		mpi2::seed(channels, random_);
-		mpi2::sendAll(channels, mpi2::marshal(mpi2::pointerToInt(&job), eps, mpi2::pointerToInt(&splits)));
-	}
-	DecayConstant decay(eps);
-	SgdRunner::updateWr(job, splits[tasks]-splits[tasks-1], decay, random_, 0, job.nnz, 0);
+		void run(unsigned i, rg::Random32& random) {
+			PsgdPartLoss<PsgdUpdateWork<Update, Regularize, FD> > partLoss(*this, i);
+			DecayConstant decay(this->eps);
+			mf_size_type steps = this->splits[i+1] - this->splits[i];
+			SgdRunner::updateWr(this->job, steps, decay, random, 0, this->job.nnz, 0);
+		}
+	};
 
-	// wait for other threads to finish
-	mpi2::economicRecvAll(channels, tm.pollDelay());
-}
+	template<typename Update, typename Regularize, typename FD>
+	struct PsgdUpdateWorWork : public PsgdUpdateWork<Update, Regularize, FD> {
+		PsgdUpdateWorWork(PsgdJob<Update, Regularize, FD>& job, double eps,
+				const std::vector<mf_size_type>& splits, const std::vector<mf_size_type>& permutation)
+		: PsgdUpdateWork<Update, Regularize, FD>(job, eps, splits), permutation(permutation) {
+		}
 
-namespace detail {
-	struct PsgdShuffleTask {
-		static const std::string id() { return std::string("__mf/sgd/PsgdShuffleTask"); }
+		void run(unsigned i, rg::Random32& random) {
+			PsgdPartLoss<PsgdUpdateWork<Update, Regularize, FD> > partLoss(*this, i);
+			DecayConstant decay(this->eps);
+			SgdRunner::updateWor(this->job, decay, random, this->splits[i], this->splits[i+1], this->splits[i],
+					permutation);
+		}
+
+		const std::vector<mf_size_type>& permutation;
+	};
+
+	template<typename Update, typename Regularize, typename FD>
+	struct PsgdUpdateShuffledWork : public PsgdUpdateWork<Update, Regularize, FD> {
+		PsgdUpdateShuffledWork(PsgdJob<Update, Regularize, FD>& job, double eps,
+				const std::vector<mf_size_type>& splits,
+				const std::vector<PackedTriple<FD> >& triples)
+		: PsgdUpdateWork<Update, Regularize, FD>(job, eps, splits), triples(triples) {
+		}
+
+		void run(unsigned i, rg::Random32& random) {
+			PsgdPartLoss<PsgdUpdateWork<Update, Regularize, FD> > partLoss(*this, i);
+			DecayConstant decay(this->eps);
+			SgdRunner::updateShuffled(this->job, decay, this->splits[i], this->splits[i+1], this->splits[i],
+					triples);
+		}
+
+		const std::vector<PackedTriple<FD> >& triples;
+	};
+
+	template<typename Update, typename Regularize, typename FD>
+	struct PsgdUpdateFeistelWork : public PsgdUpdateWork<Update, Regularize, FD> {
+		PsgdUpdateFeistelWork(PsgdJob<Update, Regularize, FD>& job, double eps,
+				const std::vector<mf_size_type>& splits, const FeistelPermutation& permutation)
+		: PsgdUpdateWork<Update, Regularize, FD>(job, eps, splits), permutation(permutation) {
+		}
 
-		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
-			rg::Random32 random = mpi2::getSeed(ch);
+		void run(unsigned i, rg::Random32& random) {
+			PsgdPartLoss<PsgdUpdateWork<Update, Regularize, FD> > partLoss(*this, i);
+			DecayConstant decay(this->eps);
+			SgdRunner::updateFeistel(this->job, decay, this->splits[i], this->splits[i+1], this->splits[i],
+					permutation);
+		}
+
+		const FeistelPermutation& permutation;
+	};
 
-			// receive data
-			mpi2::PointerIntType pPermutation;
-			mf_size_type n;
-			ch.recv(*mpi2::unmarshal(pPermutation, n));
-			std::vector<mf_size_type>& permutation = *mpi2::intToPointer<std::vector<mf_size_type> >(pPermutation);
+	/** Shuffles a permutation vector for the next epoch */
+	struct PsgdShuffleWork : public LocalWork {
+		PsgdShuffleWork(std::vector<mf_size_type>& permutation, mf_size_type n)
+		: permutation(permutation), n(n) {
+		}
 
-			// shuffle
+		void run(unsigned part, rg::Random32& random) {
 			SgdRunner::permute(random, permutation, n, n);
+		}
+
+		std::vector<mf_size_type>& permutation;
+		const mf_size_type n;
+	};
 
-			// notify
-			ch.economicSend( mpi2::TaskManager::getInstance().pollDelay() );
+	/** Shuffles the packed copy of the training points for the next epoch */
+	template<typename FD>
+	struct PsgdShufflePackedWork : public LocalWork {
+		PsgdShufflePackedWork(std::vector<PackedTriple<FD> >& triples)
+		: triples(triples) {
 		}
+
+		void run(unsigned part, rg::Random32& random) {
+			shuffle(random, triples, triples.size());
+		}
+
+		std::vector<PackedTriple<FD> >& triples;
 	};
 
-	template<typename Update, typename Regularize>
-	struct PsgdUpdateWorTask {
-		static const std::string id() { return std::string("__mf/sgd/PsgdUpdateWorTask_")
-				+ mpi2::TypeTraits<Update>::name() + "_" + mpi2::TypeTraits<Regularize>::name(); }
-
-		static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
-			rg::Random32 random = mpi2::getSeed(ch);
-
-			// receive data descriptor
-			mpi2::PointerIntType pJob;
-			double eps;
-			mpi2::PointerIntType pPermutation;
-			mpi2::PointerIntType pSplits;
-			ch.recv(*mpi2::unmarshal(pJob, eps, pPermutation, pSplits));
-
-			PsgdJob<Update, Regularize>& job = *mpi2::intToPointer<PsgdJob<Update, Regularize> >(pJob);
-			std::vector<mf_size_type>& permutation = *mpi2::intToPointer<std::vector<mf_size_type> >(pPermutation);
-			std::vector<mf_size_type>& splits = *mpi2::intToPointer<std::vector<mf_size_type> >(pSplits);
-
-			// run SGD steps
-			int id = info.groupId();
-			mf_size_type begin = splits[id];
-			mf_size_type end = splits[id+1];
-			DecayConstant decay(eps);
-			SgdRunner::updateWor(job, decay, random, begin, end, begin, permutation);
-
-			// signal that we are done
-			ch.send();
+	/** Shuffles the training points of the data matrix in place for the next epoch */
+	template<typename FD>
+	struct PsgdShufflePointsWork : public LocalWork {
+		PsgdShufflePointsWork(TrainingPoints<FD>& points, mf_size_type n)
+		: points(points), n(n) {
 		}
+
+		void run(unsigned part, rg::Random32& random) {
+			shuffle(random, points, 0, n, n);
+		}
+
+		TrainingPoints<FD>& points;
+		const mf_size_type n;
 	};
 }
 
-template<typename Update, typename Regularize>
-void PsgdRunner::updateWor(PsgdJob<Update, Regularize>& job, double eps) {
+inline void PsgdRunner::runParts(LocalWork& work, unsigned parts, std::vector<boost::mpi::request>& reqs) {
+	// parts 0,...,parts-2 run on the workers, the last part in this thread
+	for (unsigned i=0; i+1<parts; i++) {
+		reqs.push_back( workers_.run(i, work, i) );
+	}
+	work.run(parts-1, random_);
+}
+
+template<typename Update, typename Regularize, typename FD>
+void PsgdRunner::updateSequential(PsgdJob<Update, Regularize, FD>& job, double eps) {
+	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+	unsigned tasks = job.tasks;
+	std::vector<mf_size_type> splits = mpi2::split(job.nnz, job.tasks);
+	workers_.reserve(tasks-1, random_);
+
+	// run tasks-1 parts on the workers and also run sgd in this thread
+	std::vector<boost::mpi::request> reqs;
+	detail::PsgdUpdateSeqWork<Update, Regularize, FD> work(job, eps, splits);
+	work.collectLoss(onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	runParts(work, tasks, reqs);
+
+	// wait for other threads to finish
+	mpi2::economicWaitAll(reqs, tm.pollDelay());
+	work.mergeLoss();
+}
+
+template<typename Update, typename Regularize, typename FD>
+void PsgdRunner::updateWr(PsgdJob<Update, Regularize, FD>& job, double eps) {
+	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+	unsigned tasks = job.tasks;
+	std::vector<mf_size_type> splits = mpi2::split(job.nnz, job.tasks);
+	workers_.reserve(tasks-1, random_);
+
+	// run tasks-1 parts on the workers and also run sgd in this thread
+	std::vector<boost::mpi::request> reqs;
+	detail::PsgdUpdateWrWork<Update, Regularize, FD> work(job, eps, splits);
+	work.collectLoss(onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	runParts(work, tasks, reqs);
+
+	// wait for other threads to finish
+	mpi2::economicWaitAll(reqs, tm.pollDelay());
+	work.mergeLoss();
+}
+
+template<typename Update, typename Regularize, typename FD>
+void PsgdRunner::updateWor(PsgdJob<Update, Regularize, FD>& job, double eps) {
 	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
 
 	// determine how many SGD tasks to run
@@ -217,46 +301,115 @@ void PsgdRunner::updateWor(PsgdJob<Update, Regularize>& job, double eps) {
 		SgdRunner::permute(random_, permutation, job.nnz, job.nnz);
 	}
 	// at this point, permutation points to a valid permutation
+	bool parallelShuffle = job.shuffle != PSGD_SHUFFLE_SEQ && !forcedSeqShuffle;
+	workers_.reserve(parallelShuffle ? tasks : tasks-1, random_);
 
-	// spawn task-1 parallel threads for SGD (current thread is also used --> tasks threads in total)
-	std::vector<mf_size_type> splits = mpi2::split(job.nnz, tasks);
-	std::vector<mpi2::Channel> channels;
+	// check if we should start a shuffle task for the next epoch (it runs on the worker
+	// following the SGD workers)
 	std::vector<boost::mpi::request> reqs;
-	if (tasks > 1) {
-		tm.spawn<detail::PsgdUpdateWorTask<Update, Regularize> >(tm.world().rank(), tasks-1, channels);
-		mpi2::seed(channels, random_);
-		mpi2::sendAll(channels, mpi2::marshal(
-				mpi2::pointerToInt(&job),
-				eps,
-				mpi2::pointerToInt(&permutation),
-				mpi2::pointerToInt(&splits)));
-		reqs = mpi2::irecvAll(channels);
+	detail::PsgdShuffleWork shuffleWork(nextPermutation ? permutation2_ : permutation_, job.nnz);
+	if (parallelShuffle) {
+		reqs.push_back( workers_.run(tasks-1, shuffleWork, 0) );
 	}
 
-	// check if we should start a shuffle task for the next epoch
-	if (job.shuffle != PSGD_SHUFFLE_SEQ && !forcedSeqShuffle) {
-		std::vector<mf_size_type>& next =
-				nextPermutation ? permutation2_ : permutation_;
-
-		mpi2::Channel ch = tm.spawn<detail::PsgdShuffleTask>(tm.world().rank());
-		mpi2::seed(ch, random_);
-		ch.send( mpi2::marshal(mpi2::pointerToInt(&next), job.nnz) );
-		reqs.push_back( ch.irecv() );
-	}
-
-	// run sgd in this thread
-	DecayConstant decay(eps);
-	SgdRunner::updateWor(job, decay, random_, splits[tasks-1], splits[tasks], splits[tasks-1], permutation);
+	// run tasks-1 parts on the workers and also run sgd in this thread
+	std::vector<mf_size_type> splits = mpi2::split(job.nnz, tasks);
+	detail::PsgdUpdateWorWork<Update, Regularize, FD> work(job, eps, splits, permutation);
+	work.collectLoss(onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	runParts(work, tasks, reqs);
 
 	// wait until all threads are done
 	mpi2::economicWaitAll(reqs, tm.pollDelay());
+	work.mergeLoss();
 
 	// switch permutations
 	if (job.shuffle != PSGD_SHUFFLE_SEQ) nextPermutation = !nextPermutation;
 }
 
-template<typename Update, typename Regularize>
-void PsgdRunner::epoch(PsgdJob<Update, Regularize>& job, double eps) {
+template<typename Update, typename Regularize, typename FD>
+void PsgdRunner::updateShuffled(PsgdJob<Update, Regularize, FD>& job, double eps) {
+	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+
+	// determine how many SGD tasks to run
+	int tasks = job.tasks;
+	if (job.shuffle == PSGD_SHUFFLE_PARALLEL) tasks--;
+	bool forcedSeqShuffle = false;
+	if (tasks == 0) {
+		LOG4CXX_WARN(detail::logger, "Not enough tasks for parallel shuffling; using sequential shuffle");
+		tasks = 1;
+		forcedSeqShuffle = true;
+	}
+	bool parallelShuffle = job.shuffle != PSGD_SHUFFLE_SEQ && !forcedSeqShuffle;
+	workers_.reserve(parallelShuffle ? tasks : tasks-1, random_);
+
+	// the training points are shuffled in place; with parallel shuffling, epochs alternate
+	// between the data matrix and a single packed copy, one being read while the other one is
+	// shuffled for the next epoch
+	TrainingPoints<FD> points(job);
+	std::vector<mf_size_type> splits = mpi2::split(job.nnz, tasks);
+	std::vector<boost::mpi::request> reqs;
+	if (!parallelShuffle) {
+		packed_.invalidate(); // not needed
+		shuffle(random_, points, 0, job.nnz, job.nnz);
+		detail::PsgdUpdateSeqWork<Update, Regularize, FD> work(job, eps, splits);
+		work.collectLoss(onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+		runParts(work, tasks, reqs);
+		mpi2::economicWaitAll(reqs, tm.pollDelay());
+		work.mergeLoss();
+		return;
+	}
+	if (packed_.pack<FD>(job)) {
+		shuffle(random_, packed_.get<FD>(), job.nnz);
+		readPacked_ = true;
+	}
+	std::vector<PackedTriple<FD> >& triples = packed_.get<FD>();
+
+	if (readPacked_) {
+		// shuffle the data matrix for the next epoch while this epoch reads the copy
+		detail::PsgdShufflePointsWork<FD> shuffleWork(points, job.nnz);
+		reqs.push_back( workers_.run(tasks-1, shuffleWork, 0) );
+		detail::PsgdUpdateShuffledWork<Update, Regularize, FD> work(job, eps, splits, triples);
+		work.collectLoss(onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+		runParts(work, tasks, reqs);
+		mpi2::economicWaitAll(reqs, tm.pollDelay());
+		work.mergeLoss();
+	} else {
+		// shuffle the copy for the next epoch while this epoch reads the data matrix
+		detail::PsgdShufflePackedWork<FD> shuffleWork(triples);
+		reqs.push_back( workers_.run(tasks-1, shuffleWork, 0) );
+		detail::PsgdUpdateSeqWork<Update, Regularize, FD> work(job, eps, splits);
+		work.collectLoss(onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+		runParts(work, tasks, reqs);
+		mpi2::economicWaitAll(reqs, tm.pollDelay());
+		work.mergeLoss();
+	}
+	readPacked_ = !readPacked_;
+}
+
+template<typename Update, typename Regularize, typename FD>
+void PsgdRunner::updateFeistel(PsgdJob<Update, Regularize, FD>& job, double eps) {
+	mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+	unsigned tasks = job.tasks;
+	workers_.reserve(tasks-1, random_);
+
+	// every task processes a disjoint range of positions of the same permutation; there is
+	// no shuffle pass, so all tasks run SGD
+	FeistelPermutation permutation(job.nnz, random_);
+	std::vector<mf_size_type> splits = mpi2::split(job.nnz, tasks);
+
+	// run tasks-1 parts on the workers and also run sgd in this thread
+	std::vector<boost::mpi::request> reqs;
+	detail::PsgdUpdateFeistelWork<Update, Regularize, FD> work(job, eps, splits, permutation);
+	work.collectLoss(onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	runParts(work, tasks, reqs);
+
+	// wait for other threads to finish
+	mpi2::economicWaitAll(reqs, tm.pollDelay());
+	work.mergeLoss();
+}
+
+template<typename Update, typename Regularize, typename FD>
+void PsgdRunner::epoch(PsgdJob<Update, Regularize, FD>& job, double eps) {
 	// SGD steps
 	switch  (job.order) {
 	case SGD_ORDER_SEQ:
@@ -268,6 +421,15 @@ void PsgdRunner::epoch(PsgdJob<Update, Regularize>& job, double eps) {
 	case SGD_ORDER_WOR:
 		updateWor(job, eps);
 		break;
+	case SGD_ORDER_WOR_SHUFFLED:
+		updateShuffled(job, eps);
+		break;
+	case SGD_ORDER_WOR_FEISTEL:
+		updateFeistel(job, eps);
+		break;
+	default:
+		RG_THROW(rg::NotImplementedException, "SGD order not supported by PSGD");
+		break;
 	}
 
 	// regularization step
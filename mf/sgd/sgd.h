@@ -32,11 +32,31 @@
 #include <mf/factorization.h>
 #include <mf/trace.h>
 #include <mf/sgd/functions/regularize-none.h>
+#include <mf/sgd/minibatch.h>
+#include <mf/sgd/online-loss.h>
+#include <mf/sgd/packed.h>
+#include <mf/sgd/permutation.h>
 
 namespace mf {
 
 /** Order of selection of training points */
-enum SgdOrder { SGD_ORDER_SEQ, SGD_ORDER_WR, SGD_ORDER_WOR };
+enum SgdOrder {
+	SGD_ORDER_SEQ,         /**< sequential order */
+	SGD_ORDER_WR,          /**< with replacement */
+	SGD_ORDER_WOR,         /**< without replacement (via a permutation vector) */
+	SGD_ORDER_WOR_SHUFFLED, /**< without replacement (training points are shuffled in place
+	                             and then read sequentially, see mf/sgd/packed.h) */
+	SGD_ORDER_TILED,        /**< without replacement, one cache-sized tile of the data matrix at
+	                             a time; both the tile order and the order of the training points
+	                             within each tile are random (see mf::TiledPoints) */
+	SGD_ORDER_WOR_FEISTEL,  /**< without replacement (via a pseudo-random permutation that is
+	                             computed on the fly, see mf::FeistelPermutation) */
+	SGD_ORDER_MINIBATCH     /**< mini-batch SGD: the training points of a chunk of rows form a
+	                             batch whose gradients are computed by dense matrix products and
+	                             applied in bulk; the batches are processed in random order (see
+	                             mf/sgd/minibatch.h); requires an update function that supports
+	                             mini-batches (see mf::HasMiniBatch) */
+};
 
 
 /** Describes an SGD algorithm in terms of (1) an update function that performs a step
@@ -91,17 +111,19 @@ namespace mf {
  *
  * @tparam Update type of update function (model of UpdateConcept)
  * @tparam Regularize type of regularize function (model of RegularizeConcept)
+ * @tparam FD type of factorization data (an instantiation of mf::FactorizationData, e.g.,
+ *            with single-precision factors or compact training data)
  */
-template<typename Update, typename Regularize>
-struct SgdJob : public FactorizationData<>, public Sgd<Update,Regularize> {
-	SgdJob(const SparseMatrix& v, DenseMatrix &w, DenseMatrixCM& h,
+template<typename Update, typename Regularize, typename FD = FactorizationData<> >
+struct SgdJob : public FD, public Sgd<Update,Regularize> {
+	SgdJob(const typename FD::V& v, typename FD::W& w, typename FD::H& h,
 			Update update, Regularize regularize, SgdOrder order = SGD_ORDER_WR)
-	: FactorizationData<>(v, w, h), Sgd<Update,Regularize>(update, regularize, order) {
+	: FD(v, w, h), Sgd<Update,Regularize>(update, regularize, order) {
 	}
 
-	SgdJob(FactorizationData<> data,
+	SgdJob(FD data,
 			Update update, Regularize regularize, SgdOrder order = SGD_ORDER_WR)
-	: FactorizationData<>(data), Sgd<Update,Regularize>(update, regularize, order) {
+	: FD(data), Sgd<Update,Regularize>(update, regularize, order) {
 	}
 };
 
@@ -110,7 +132,33 @@ class PsgdRunner;
 /** Runs an SGD-based factorization job */
 class SgdRunner {
 public:
-	SgdRunner(rg::Random32& random) : random_(random) {
+	SgdRunner(rg::Random32& random) : random_(random), tiles_(&ownTiles_),
+			tileCacheSize_(256*1024), onlineLossEvery_(0) {
+	}
+
+	/** Sets the tiles of the data block processed next (used by SGD_ORDER_TILED and
+	 * SGD_ORDER_MINIBATCH). By default, the runner keeps the tiles of a single data matrix,
+	 * which are rearranged whenever the data matrix changes; a runner that processes several
+	 * blocks in turn should set one instance per block. Pass NULL to return to the default
+	 * instance. The tiles must outlive their use. */
+	void setTiles(TiledPoints* tiles) {
+		tiles_ = tiles == NULL ? &ownTiles_ : tiles;
+	}
+
+	/** Sets the number of bytes of the factor matrices that should fit into the cache when
+	 * processing a tile with SGD_ORDER_TILED or a mini-batch with SGD_ORDER_MINIBATCH
+	 * (default: 256KB, i.e., a typical L2 cache). */
+	void setTileCacheSize(mf_size_type bytes) {
+		tileCacheSize_ = bytes;
+	}
+
+	/** Lets run() use the training loss accumulated during each epoch (see mf::OnlineLoss)
+	 * for the decay function and the trace, and compute the exact loss only after the first
+	 * epoch, every k epochs, and after the last epoch. Only supported by update functions of
+	 * the NZSL family (see mf::HasOnlineLoss; run() throws for all others); use with an NZSL
+	 * loss. If k is 0 (default), the exact loss is computed after every epoch. */
+	void setOnlineLoss(mf_size_type k) {
+		onlineLossEvery_ = k;
 	}
 
 	/** Runs a number of SGD epochs using an adaptive decay function. This is the most
@@ -127,10 +175,11 @@ public:
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
  	 * @tparam Loss type of loss function (model of LossConcept)
  	 * @tparam AdaptiveDecay type of decay function (model of AdaptiveDecayConcept)
+ 	 * @tparam FD type of factorization data
 	 */
 	template<typename Update, typename Regularize, typename Loss, typename AdaptiveDecay,
-		typename TestData, typename TestLoss>
-	void run(SgdJob<Update, Regularize>& job,
+		typename TestData, typename TestLoss, typename FD>
+	void run(SgdJob<Update, Regularize, FD>& job,
 			Loss& loss,
 			mf_size_type epochs,
 			AdaptiveDecay& decay,
@@ -138,8 +187,8 @@ public:
 			BalanceType balanceType = BALANCE_NONE, BalanceMethod balanceMethod = BALANCE_SIMPLE,
 			TestData* testData = NULL, TestLoss *testLoss = NULL);
 
-	template<typename Update, typename Regularize, typename Loss, typename AdaptiveDecay>
-	void run(SgdJob<Update, Regularize>& job,
+	template<typename Update, typename Regularize, typename Loss, typename AdaptiveDecay, typename FD>
+	void run(SgdJob<Update, Regularize, FD>& job,
 			Loss& loss,
 			mf_size_type epochs,
 			AdaptiveDecay& decay,
@@ -156,8 +205,8 @@ public:
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
  	 * @tparam StaticDecay type of decay function (model of StaticDecayConcept)
 	 */
-	template<typename Update, typename Regularize, typename StaticDecay>
-	void update(SgdJob<Update, Regularize>& job, mf_size_type steps, StaticDecay& decay);
+	template<typename Update, typename Regularize, typename StaticDecay, typename FD>
+	void update(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, StaticDecay& decay);
 
 	/** Runs a number of SGD update steps using a fixed step size.
 	 *
@@ -168,8 +217,8 @@ public:
  	 * @tparam Update type of update function (model of UpdateConcept)
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
 	 */
-	template<typename Update, typename Regularize>
-	void update(SgdJob<Update, Regularize>& job, mf_size_type steps, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void update(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, double eps);
 
 	/** Runs a single SGD epoch using a fixed step size. An epoch consists of a number
 	 * of SGD update steps (as many as data points) and a single SGD regularize step.
@@ -180,8 +229,8 @@ public:
  	 * @tparam Update type of update function (model of UpdateConcept)
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
 	 */
-	template<typename Update, typename Regularize>
-	void epoch(SgdJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void epoch(SgdJob<Update, Regularize, FD>& job, double eps);
 
 	/** Runs a single SGD epoch using a fixed step size. An epoch consists of a number
 	 * of SGD update steps (as many as data points) and a single SGD regularize step.
@@ -193,8 +242,8 @@ public:
 	 * @tparam Update type of update function (model of UpdateConcept)
 	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
 	 */
-	template<typename Update, typename Regularize>
-	void epoch(SgdJob<Update, Regularize>& job, double epsUpdate, double epsRegularize);
+	template<typename Update, typename Regularize, typename FD>
+	void epoch(SgdJob<Update, Regularize, FD>& job, double epsUpdate, double epsRegularize);
 
 	/** Runs a single SGD regularize step.
 	 *
@@ -204,42 +253,122 @@ public:
  	 * @tparam Update type of update function (model of UpdateConcept)
  	 * @tparam Regularize type of regularize function (model of RegularizeConcept)
 	 */
-	template<typename Update, typename Regularize>
-	void regularize(SgdJob<Update, Regularize>& job, double eps);
+	template<typename Update, typename Regularize, typename FD>
+	void regularize(SgdJob<Update, Regularize, FD>& job, double eps);
 
 	static void permute(rg::Random32& random, std::vector<mf_size_type>& permutation, int n, int k);
 
 	/** Runs steps SGD steps in sequential order */
-	template<typename Update, typename Regularize, typename Decay>
-	void updateSequential(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay);
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	void updateSequential(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay);
 
 	/** Runs steps SGD steps in sequential order */
-	template<typename Update, typename Regularize, typename Decay>
-	static void updateSequential(SgdJob<Update, Regularize>& job, Decay& decay,
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateSequential(SgdJob<Update, Regularize, FD>& job, Decay& decay,
 			mf_size_type begin, mf_size_type end, mf_size_type decayOffset);
 
 	/** Runs steps SGD steps in WR order */
-	template<typename Update, typename Regularize, typename Decay>
-	void updateWr(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay);
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	void updateWr(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay);
 
 	/** Runs steps SGD steps in WR order */
-	template<typename Update, typename Regularize, typename Decay>
-	static void updateWr(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay,
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateWr(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay,
 			rg::Random32& random, mf_size_type begin, mf_size_type end, mf_size_type decayOffset);
 
 	/** Runs steps SGD steps in WOR order. */
-	template<typename Update, typename Regularize, typename Decay>
-	void updateWor(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay);
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	void updateWor(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay);
 
 	/** Runs steps SGD steps in WOR order. */
-	template<typename Update, typename Regularize, typename Decay>
-	static void updateWor(SgdJob<Update, Regularize>& job, Decay& decay,
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateWor(SgdJob<Update, Regularize, FD>& job, Decay& decay,
 			rg::Random32& random, mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
 			const std::vector<mf_size_type>& permutation);
 
+	/** Runs steps SGD steps in WOR order by shuffling the training points in place. */
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	void updateShuffled(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay);
+
+	/** Runs steps SGD steps in WOR order using a pseudo-random permutation computed on the fly. */
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	void updateFeistel(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay);
+
+	/** Runs SGD steps on positions [begin,end) of the given permutation; position k refers to
+	 * training point offset + permutation(k). */
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateFeistel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+			mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+			const FeistelPermutation& permutation, mf_size_type offset = 0);
+
+	/** Runs steps SGD steps in tiled order (see SGD_ORDER_TILED). */
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	void updateTiled(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay);
+
+	/** Runs SGD steps on the training points in positions [begin,end) of a (shuffled) packed
+	 * copy of the data (used by PSGD, see mf::PackedTriples) */
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateShuffled(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+			mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+			const std::vector<PackedTriple<FD> >& triples);
+
+	/** Runs steps SGD steps in mini-batches of a chunk of rows each (see SGD_ORDER_MINIBATCH).
+	 * Throws an exception if the update function does not support mini-batches. */
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	void updateMiniBatch(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay);
+
+	/** Runs a mini-batch consisting of the training points in positions [begin,end). The
+	 * batch should span few rows and columns (see mf::detail::formMiniBatches()); space is
+	 * temp space. */
+	template<typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateMiniBatch(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+			mf_size_type begin, mf_size_type end, mf_size_type decayOffset, MiniBatchSpace& space);
+
 private:
+	/** Runs SGD steps in sequential order using the kernels for rank R
+	 * (see mf::HasRankKernels) */
+	template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateSequentialKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+			mf_size_type begin, mf_size_type end, mf_size_type decayOffset);
+
+	/** Runs SGD steps in WR order using the kernels for rank R (see mf::HasRankKernels) */
+	template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateWrKernel(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay,
+			rg::Random32& random, mf_size_type begin, mf_size_type end, mf_size_type decayOffset);
+
+	/** Runs SGD steps in WOR order using the kernels for rank R (see mf::HasRankKernels) */
+	template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateWorKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+			rg::Random32& random, mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+			const std::vector<mf_size_type>& permutation);
+
+	/** Runs SGD steps on packed training points using the kernels for rank R
+	 * (see mf::HasRankKernels) */
+	template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateShuffledKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+			mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+			const std::vector<PackedTriple<FD> >& triples);
+
+	/** Runs SGD steps on a pseudo-random permutation using the kernels for rank R
+	 * (see mf::HasRankKernels) */
+	template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateFeistelKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+			mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+			const FeistelPermutation& permutation, mf_size_type offset);
+
+	/** Runs a mini-batch using the kernels for rank R (see mf::HasRankKernels) */
+	template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+	static void updateMiniBatchKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+			mf_size_type begin, mf_size_type end, mf_size_type decayOffset, MiniBatchSpace& space);
+
 	rg::Random32& random_;
 	std::vector<mf_size_type> permutation_; // temp space for WOR ordering
+	TiledPoints ownTiles_; // tiles for TILED and MINIBATCH ordering
+	TiledPoints* tiles_; // tiles of the current block (default: ownTiles_)
+	MiniBatchSpace miniBatch_; // temp space for MINIBATCH ordering
+	mf_size_type tileCacheSize_;
+	mf_size_type onlineLossEvery_;
+	OnlineLoss onlineLoss_;
 	rg::Timer t;
 };
 
@@ -21,6 +21,8 @@
 #include <mf/sgd/sgd.h> // help for compilers
 
 #include <mf/sgd/decay/decay_constant.h>
+#include <mf/sgd/functions/kernels.h>
+#include <mf/sgd/lazy-scale.h>
 #include <mf/loss/loss.h>
 
 
@@ -30,11 +32,49 @@
 namespace mf {
 
 namespace detail {
+/** Adds the sample size and confidence interval to the trace entry if the loss has been estimated */
+template<typename Loss>
+void traceLossEstimate(const Loss& loss, SgdTraceEntry& entry) {
+	const LossEstimate* estimate = lastLossEstimate(loss);
+	if (estimate != NULL) {
+		entry.lossSampleSize = estimate->sampleSize;
+		entry.lossLower = estimate->lower;
+		entry.lossUpper = estimate->upper;
+		LOG4CXX_INFO(detail::logger, "Loss estimated from " << estimate->sampleSize << " samples (confidence interval: ["
+				<< estimate->lower << ", " << estimate->upper << "])");
+	}
+}
+
+/** Applies the lazily applied scale of the factors of an SGD job (if any), see mf::LazyScale */
+template<typename Job>
+inline void applyLazyScale(Job& job) {
+}
+
+template<typename Update, typename Regularize, typename FD>
+inline void applyLazyScale(SgdJob<Update,Regularize,FD>& job) {
+	if (job.scale != NULL) job.scale->apply(job);
+}
+
+/** Whether the regularize steps of an SGD job in the given order are applied lazily (see
+ * mf::LazyScale). Mini-batches compute their predictions and bulk updates from the stored
+ * factors, so the scale is not used with SGD_ORDER_MINIBATCH. */
+template<typename Update, typename Regularize>
+inline bool useLazyScale(SgdOrder order) {
+	return UseLazyScale<Update,Regularize>::value && order != SGD_ORDER_MINIBATCH;
+}
+
+/** Whether the update function reports its residuals to the online loss, see mf::HasOnlineLoss */
+template<typename Update>
+inline bool hasOnlineLoss(const Update&) {
+	return HasOnlineLoss<Update>::value;
+}
+
 template<typename Job, typename Loss, typename AdaptiveDecay, typename Epoch,typename TestData,typename TestLoss>
 void defaultRunner(Job& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& decay,
 		Epoch runEpoch, Trace& trace, rg::Random32& random,
 		BalanceType balanceType, BalanceMethod balanceMethod,
-		TestData* testData, TestLoss *testLoss) {
+		TestData* testData, TestLoss *testLoss,
+		mf_size_type onlineLossEvery = 0, OnlineLoss* onlineLoss = NULL) {
 	// print information about training point order
 	switch (job.order) {
 	case SGD_ORDER_SEQ:
@@ -46,6 +86,18 @@ void defaultRunner(Job& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& dec
 	case SGD_ORDER_WOR:
 		LOG4CXX_INFO(detail::logger, "Using WOR order for selecting training points");
 		break;
+	case SGD_ORDER_WOR_SHUFFLED:
+		LOG4CXX_INFO(detail::logger, "Using WOR order (shuffled training points) for selecting training points");
+		break;
+	case SGD_ORDER_TILED:
+		LOG4CXX_INFO(detail::logger, "Using TILED order for selecting training points");
+		break;
+	case SGD_ORDER_WOR_FEISTEL:
+		LOG4CXX_INFO(detail::logger, "Using WOR order (Feistel permutation) for selecting training points");
+		break;
+	case SGD_ORDER_MINIBATCH:
+		LOG4CXX_INFO(detail::logger, "Using MINIBATCH order for selecting training points");
+		break;
 	}
 
 	// initialize
@@ -79,14 +131,30 @@ void defaultRunner(Job& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& dec
 		// preserve the memory. Otherwise the trace will lose its information. memory release with the program's exit
 		entry=new SgdTraceEntry(currentLoss, timeLoss);
 	}
+	traceLossEstimate(loss, *entry);
 	trace.add(entry);
 
+	// when the online loss is used, the loss is computed exactly only after the first epoch,
+	// every onlineLossEvery epochs, and after the last epoch. The decay function always compares
+	// losses of the same kind: the exact losses before and after the first epoch, and the
+	// online losses of two successive epochs afterwards.
+	bool useOnlineLoss = onlineLoss != NULL && onlineLossEvery > 0;
+	if (useOnlineLoss) {
+		if (!hasOnlineLoss(job.update)) {
+			RG_THROW(rg::InvalidArgumentException,
+					"The update function does not report an online loss; use the exact loss instead");
+		}
+		LOG4CXX_INFO(detail::logger, "Using online loss (exact loss every " << onlineLossEvery << " epochs)");
+	}
+	double lastOnlineLoss = NAN;
+
 	// main loop
 	for (mf_size_type epoch=0; epoch<epochs; epoch++) {
 		// update step size
 		mpi2::logBeginEvent("stepsize");
 		t.start();
 		double eps;
+		if (DecayUsesFactors<AdaptiveDecay>::value) applyLazyScale(job);
 		if (epoch == 0) {
 			eps = decay(job, NULL, &currentLoss, random);
 		} else {
@@ -100,6 +168,7 @@ void defaultRunner(Job& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& dec
 		// run epoch
 		mpi2::logBeginEvent("epoch");
 		LOG4CXX_INFO(detail::logger, "Starting epoch " << (epoch+1));
+		if (useOnlineLoss) onlineLoss->reset();
 		t.start();
 		runEpoch(job, eps);
 		t.stop();
@@ -109,23 +178,43 @@ void defaultRunner(Job& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& dec
 
 		// balance
 		mpi2::logBeginEvent("balance");
+		if (balanceType != BALANCE_NONE) applyLazyScale(job);
 		balance(job, balanceType, balanceMethod);
 		mpi2::logEndEvent("balance");
 
 		// compute loss
-		previousLoss = currentLoss;
-		t.start();
-		mpi2::logBeginEvent("loss");
-		currentLoss = loss(job);
-		mpi2::logEndEvent("loss");
-		t.stop();
-		double timeLoss = t.elapsedTime().nanos();
-		LOG4CXX_INFO(detail::logger, "Loss: " << currentLoss << " (" << t << ")");
+		double currentOnlineLoss = NAN;
+		if (useOnlineLoss) {
+			currentOnlineLoss = onlineLoss->value(job.nnz);
+			LOG4CXX_INFO(detail::logger, "Online loss: " << currentOnlineLoss);
+		}
+		double timeLoss = 0;
+		double traceLoss = currentOnlineLoss;
+		bool lossComputed = !useOnlineLoss || epoch == 0 || (epoch+1) % onlineLossEvery == 0 || epoch+1 == epochs;
+		if (lossComputed) {
+			applyLazyScale(job);
+			t.start();
+			mpi2::logBeginEvent("loss");
+			traceLoss = loss(job);
+			mpi2::logEndEvent("loss");
+			t.stop();
+			timeLoss = t.elapsedTime().nanos();
+			LOG4CXX_INFO(detail::logger, "Loss: " << traceLoss << " (" << t << ")");
+		}
+		if (useOnlineLoss && epoch > 0) {
+			previousLoss = lastOnlineLoss;
+			currentLoss = currentOnlineLoss;
+		} else {
+			previousLoss = currentLoss;
+			currentLoss = traceLoss;
+		}
+		lastOnlineLoss = currentOnlineLoss;
 
 		SgdTraceEntry* entry;
 		currentTestLoss=0.0;
 		timeTestLoss=0.0;
 		if (testData!=0){
+			applyLazyScale(job);
 			t.start();
 			mpi2::logBeginEvent("testloss");
 			currentTestLoss=(*testLoss)(*testData);
@@ -134,35 +223,44 @@ void defaultRunner(Job& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& dec
 			timeTestLoss=t.elapsedTime().nanos();
 			LOG4CXX_INFO(detail::logger, "Test loss: " << currentTestLoss << " (" << t << ")");
 			// preserve the memory. Otherwise the trace will lose its information. memory release with the program's exit
-			entry=new SgdTraceEntry(epoch+1, epoch+1, currentLoss, eps, timeEps, timeEpoch, timeLoss, currentTestLoss, timeTestLoss);
+			entry=new SgdTraceEntry(epoch+1, epoch+1, traceLoss, eps, timeEps, timeEpoch, timeLoss, currentTestLoss, timeTestLoss);
 		}
 		else{
 			// preserve the memory. Otherwise the trace will lose its information. memory release with the program's exit
-			entry=new SgdTraceEntry(epoch+1, epoch+1, currentLoss, eps, timeEps, timeEpoch, timeLoss);
+			entry=new SgdTraceEntry(epoch+1, epoch+1, traceLoss, eps, timeEps, timeEpoch, timeLoss);
 		}
+		entry->onlineLoss = currentOnlineLoss;
+		if (lossComputed) traceLossEstimate(loss, *entry);
 		trace.add(entry);
 	}
+	applyLazyScale(job);
 }
 }
 
-template<typename Update, typename Regularize, typename Loss, typename AdaptiveDecay,typename TestData,typename TestLoss>
-void SgdRunner::run(SgdJob<Update, Regularize>& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& decay,
+template<typename Update, typename Regularize, typename Loss, typename AdaptiveDecay,typename TestData,typename TestLoss, typename FD>
+void SgdRunner::run(SgdJob<Update, Regularize, FD>& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod, TestData* testData, TestLoss *testLoss) {
 	LOG4CXX_INFO(detail::logger, "Starting SGD");
+	OnlineLoss::Scope scope(onlineLossEvery_ > 0 ? &onlineLoss_ : NULL);
+	ownTiles_.invalidate(); // the data may have changed since the last run
+	LazyScale scale; // regularize steps are applied to the factors only when they are read
+	if (detail::useLazyScale<Update,Regularize>(job.order)) job.scale = &scale;
 	detail::defaultRunner(job, loss, epochs, decay,
-			boost::bind(&SgdRunner::epoch<Update,Regularize>, this, _1, _2),
-			trace, random_, balanceType, balanceMethod, testData, testLoss);
+			boost::bind(&SgdRunner::epoch<Update,Regularize,FD>, this, _1, _2),
+			trace, random_, balanceType, balanceMethod, testData, testLoss,
+			onlineLossEvery_, &onlineLoss_);
+	job.scale = NULL;
 	LOG4CXX_INFO(detail::logger, "Finished SGD");
 }
 
-template<typename Update, typename Regularize, typename Loss, typename AdaptiveDecay>
-void SgdRunner::run(SgdJob<Update, Regularize>& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& decay,
+template<typename Update, typename Regularize, typename Loss, typename AdaptiveDecay, typename FD>
+void SgdRunner::run(SgdJob<Update, Regularize, FD>& job, Loss& loss, mf_size_type epochs, AdaptiveDecay& decay,
 		Trace& trace, BalanceType balanceType, BalanceMethod balanceMethod) {
 	run(job, loss, epochs, decay, trace, balanceType, balanceMethod, (FactorizationData<>*)NULL, (NoLoss*)NULL);
 }
 
-template<typename Update, typename Regularize, typename Decay>
-void SgdRunner::update(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay) {
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::update(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay) {
 	switch (job.order) {
 	case SGD_ORDER_SEQ:
 		updateSequential(job, steps, decay);
@@ -173,29 +271,41 @@ void SgdRunner::update(SgdJob<Update, Regularize>& job, mf_size_type steps, Deca
 	case SGD_ORDER_WOR:
 		updateWor(job, steps, decay);
 		break;
+	case SGD_ORDER_WOR_SHUFFLED:
+		updateShuffled(job, steps, decay);
+		break;
+	case SGD_ORDER_TILED:
+		updateTiled(job, steps, decay);
+		break;
+	case SGD_ORDER_WOR_FEISTEL:
+		updateFeistel(job, steps, decay);
+		break;
+	case SGD_ORDER_MINIBATCH:
+		updateMiniBatch(job, steps, decay);
+		break;
 	default:
 		RG_THROW(rg::InvalidArgumentException, "Unknown SGD order");
 		break;
 	}
 }
-template<typename Update, typename Regularize>
-void SgdRunner::update(SgdJob<Update, Regularize>& job, mf_size_type steps, double eps) {
+template<typename Update, typename Regularize, typename FD>
+void SgdRunner::update(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, double eps) {
 	DecayConstant decay(eps);
 	update(job, steps, decay);
 }
 
-template<typename Update, typename Regularize>
-void SgdRunner::epoch(SgdJob<Update, Regularize>& job, double eps) {
+template<typename Update, typename Regularize, typename FD>
+void SgdRunner::epoch(SgdJob<Update, Regularize, FD>& job, double eps) {
 	epoch(job, eps, eps);
 }
-template<typename Update, typename Regularize>
-void SgdRunner::epoch(SgdJob<Update, Regularize>& job, double epsUpdate, double epsRegularize) {
+template<typename Update, typename Regularize, typename FD>
+void SgdRunner::epoch(SgdJob<Update, Regularize, FD>& job, double epsUpdate, double epsRegularize) {
 	update(job, job.nnz, epsUpdate);
 	regularize(job, epsRegularize);
 }
 
-template<typename Update, typename Regularize, typename Decay>
-void SgdRunner::updateSequential(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay) {
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateSequential(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay) {
 	mf_size_type remainingSteps = steps;
 	while (remainingSteps > 0) {
 		mf_size_type end = std::min(remainingSteps, job.nnz);
@@ -204,25 +314,40 @@ void SgdRunner::updateSequential(SgdJob<Update, Regularize>& job, mf_size_type s
 	}
 }
 
-template<typename Update, typename Regularize, typename Decay>
-void SgdRunner::updateSequential(SgdJob<Update, Regularize>& job, Decay& decay,
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateSequential(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+		mf_size_type begin, mf_size_type end, mf_size_type decayOffset) {
+	MF_SGD_KERNEL_DISPATCH(Update, job.r, updateSequentialKernel,
+			(job, decay, begin, end, decayOffset));
+}
+
+template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateSequentialKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
 		mf_size_type begin, mf_size_type end, mf_size_type decayOffset) {
 	mf_size_type n = end - begin;
 	for (mf_size_type step=0; step<n; step++) {
 		// no prefetching needed (sequential read)
 		const mf_size_type pos = begin + step;
 		const double eps = decay(decayOffset + step);
-		job.update(job, job.vIndex1[pos], job.vIndex2[pos], job.vValues[pos], eps);
+		detail::RankedUpdate<Update>::template apply<R>(job.update, job,
+				job.vIndex1[pos], job.vIndex2[pos], job.vValues[pos], eps);
 	}
 }
 
-template<typename Update, typename Regularize, typename Decay>
-void SgdRunner::updateWr(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay) {
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateWr(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay) {
 	updateWr(job, steps, decay, random_, 0, job.nnz, 0);
 }
 
-template<typename Update, typename Regularize, typename Decay>
-void SgdRunner::updateWr(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay,
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateWr(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay,
+		rg::Random32& random, mf_size_type begin, mf_size_type end, mf_size_type decayOffset) {
+	MF_SGD_KERNEL_DISPATCH(Update, job.r, updateWrKernel,
+			(job, steps, decay, random, begin, end, decayOffset));
+}
+
+template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateWrKernel(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay,
 		rg::Random32& random, mf_size_type begin, mf_size_type end, mf_size_type decayOffset) {
 	mf_size_type n = end - begin;
 
@@ -247,7 +372,8 @@ void SgdRunner::updateWr(SgdJob<Update, Regularize>& job, mf_size_type steps, De
 #endif
 		// execute the current step
 		const double eps = decay(decayOffset + step);
-		job.update(job, job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
+		detail::RankedUpdate<Update>::template apply<R>(job.update, job,
+				job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
 	}
 }
 
@@ -278,8 +404,8 @@ inline void SgdRunner::permute(rg::Random32& random, std::vector<mf_size_type>&
 }
 
 
-template<typename Update, typename Regularize, typename Decay>
-void SgdRunner::updateWor(SgdJob<Update, Regularize>& job, mf_size_type steps, Decay& decay) {
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateWor(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay) {
 	mf_size_type remainingSteps = steps;
 	while (remainingSteps > 0) {
 		mf_size_type end = std::min(remainingSteps, job.nnz);
@@ -289,8 +415,16 @@ void SgdRunner::updateWor(SgdJob<Update, Regularize>& job, mf_size_type steps, D
 	}
 }
 
-template<typename Update, typename Regularize, typename Decay>
-void SgdRunner::updateWor(SgdJob<Update, Regularize>& job, Decay& decay,
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateWor(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+		rg::Random32& random, mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+		const std::vector<mf_size_type>& permutation) {
+	MF_SGD_KERNEL_DISPATCH(Update, job.r, updateWorKernel,
+			(job, decay, random, begin, end, decayOffset, permutation));
+}
+
+template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateWorKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
 		rg::Random32& random, mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
 		const std::vector<mf_size_type>& permutation) {
 	// handle border cases
@@ -301,7 +435,8 @@ void SgdRunner::updateWor(SgdJob<Update, Regularize>& job, Decay& decay,
 	} else if (n == 1) {
 		mf_size_type currentPos =  permutation[begin];
 		const double eps = decay(0);
-		job.update(job, job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
+		detail::RankedUpdate<Update>::template apply<R>(job.update, job,
+				job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
 		return;
 	}
 
@@ -328,31 +463,312 @@ void SgdRunner::updateWor(SgdJob<Update, Regularize>& job, Decay& decay,
 
 		// execute the current step
 		const double eps = decay(decayOffset + step);
-		job.update(job, job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
+		detail::RankedUpdate<Update>::template apply<R>(job.update, job,
+				job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
 	}
 
 	currentPos = permutation[begin + n-2];
 	double eps = decay(decayOffset + n-2);
-	job.update(job, job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
+	detail::RankedUpdate<Update>::template apply<R>(job.update, job,
+			job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
 
 	currentPos = permutation[begin + n-1];
 	eps = decay(decayOffset + n-1);
-	job.update(job, job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
+	detail::RankedUpdate<Update>::template apply<R>(job.update, job,
+			job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
 #else // without prefetching
 	mf_size_type currentPos;
 	for (mf_size_type step=0; step<n; step++) {
 		currentPos=permutation[begin+step];
 		// execute the current step
 		const double eps = decay(decayOffset + step);
-		job.update(job, job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
+		detail::RankedUpdate<Update>::template apply<R>(job.update, job,
+				job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
 	}
 
 #endif
 }
 
-template<typename Update, typename Regularize>
-void SgdRunner::regularize(SgdJob<Update, Regularize>& job, double eps) {
-	job.regularize(job, eps);
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateShuffled(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay) {
+	if (job.nnz == 0) return;
+	TrainingPoints<FD> points(job);
+	mf_size_type remainingSteps = steps;
+	while (remainingSteps > 0) {
+		mf_size_type end = std::min(remainingSteps, job.nnz);
+		shuffle(random_, points, 0, job.nnz, end);
+		updateSequential(job, decay, 0, end, steps - remainingSteps);
+		remainingSteps -= end;
+	}
+	tiles_->invalidate(); // the points are no longer grouped by tile
+}
+
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateFeistel(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay) {
+	mf_size_type remainingSteps = steps;
+	while (remainingSteps > 0) {
+		mf_size_type end = std::min(remainingSteps, job.nnz);
+		FeistelPermutation permutation(job.nnz, random_);
+		updateFeistel(job, decay, 0, end, steps - remainingSteps, permutation);
+		remainingSteps -= end;
+	}
+}
+
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateFeistel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+		mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+		const FeistelPermutation& permutation, mf_size_type offset) {
+	MF_SGD_KERNEL_DISPATCH(Update, job.r, updateFeistelKernel,
+			(job, decay, begin, end, decayOffset, permutation, offset));
+}
+
+template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateFeistelKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+		mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+		const FeistelPermutation& permutation, mf_size_type offset) {
+	if (begin >= end) return;
+
+	// positions are computed two steps ahead so that the training point and then its
+	// factors can be prefetched
+	mf_size_type nextPos = offset + permutation(begin);
+	mf_size_type next2Pos = begin+1 < end ? offset + permutation(begin+1) : nextPos;
+	for (mf_size_type k=begin; k<end; k++) {
+		const mf_size_type currentPos = nextPos;
+		nextPos = next2Pos;
+#ifdef USE_PREFETCHING // with prefetching
+		__builtin_prefetch(&job.wValues[job.vIndex1[nextPos]*job.r], 1, 2); // write and locality=2
+		__builtin_prefetch(&job.hValues[job.vIndex2[nextPos]*job.r], 1, 2); // write and locality=2
+#endif
+		if (k+2 < end) {
+			next2Pos = offset + permutation(k+2);
+#ifdef USE_PREFETCHING // with prefetching
+			__builtin_prefetch(&job.vIndex1[next2Pos], 0, 1);
+			__builtin_prefetch(&job.vIndex2[next2Pos], 0, 1);
+			__builtin_prefetch(&job.vValues[next2Pos], 0, 1);
+#endif
+		}
+
+		const double eps = decay(decayOffset + k - begin);
+		detail::RankedUpdate<Update>::template apply<R>(job.update, job,
+				job.vIndex1[currentPos], job.vIndex2[currentPos], job.vValues[currentPos], eps);
+	}
+}
+
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateTiled(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay) {
+	if (job.nnz == 0) return;
+
+	// choose square tiles such that the rows of W and columns of H of a tile fit into the cache
+	mf_size_type tileSize = std::max<mf_size_type>(1,
+			tileCacheSize_ / (2 * job.r * sizeof(typename FD::W::value_type)));
+	tiles_->arrange(job, tileSize, tileSize);
+	TrainingPoints<FD> points(job);
+	const std::vector<mf_size_type>& offsets = tiles_->offsets();
+	std::vector<mf_size_type>& order = tiles_->order();
+
+	mf_size_type step = 0;
+	while (step < steps) {
+		shuffle(random_, order, order.size());
+		for (mf_size_type t=0; t<order.size() && step<steps; t++) {
+			// shuffle the points of the tile right before processing them (so that they are
+			// in cache afterwards)
+			mf_size_type begin = offsets[order[t]];
+			mf_size_type size = offsets[order[t]+1] - begin;
+			mf_size_type n = std::min(size, steps - step);
+			shuffle(random_, points, begin, size, n);
+			updateSequential(job, decay, begin, begin + n, step);
+			step += n;
+		}
+	}
+}
+
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateShuffled(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+		mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+		const std::vector<PackedTriple<FD> >& triples) {
+	MF_SGD_KERNEL_DISPATCH(Update, job.r, updateShuffledKernel,
+			(job, decay, begin, end, decayOffset, triples));
+}
+
+template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateShuffledKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+		mf_size_type begin, mf_size_type end, mf_size_type decayOffset,
+		const std::vector<PackedTriple<FD> >& triples) {
+	// training points are read sequentially; only the factors need to be prefetched
+	for (mf_size_type pos=begin; pos<end; pos++) {
+#ifdef USE_PREFETCHING // with prefetching
+		if (pos+1 < end) {
+			const PackedTriple<FD>& next = triples[pos+1];
+			__builtin_prefetch(&job.wValues[next.i*job.r], 1, 2); // write and locality=2
+			__builtin_prefetch(&job.hValues[next.j*job.r], 1, 2); // write and locality=2
+		}
+#endif
+		const PackedTriple<FD>& t = triples[pos];
+		const double eps = decay(decayOffset + pos - begin);
+		detail::RankedUpdate<Update>::template apply<R>(job.update, job, t.i, t.j, t.x, eps);
+	}
+}
+
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateMiniBatch(SgdJob<Update, Regularize, FD>& job, mf_size_type steps, Decay& decay) {
+	if (!HasMiniBatch<Update>::value) {
+		RG_THROW(rg::InvalidArgumentException, "Update function does not support SGD order MINIBATCH");
+	}
+	if (job.nnz == 0) return;
+	detail::applyLazyScale(job); // mini-batches read and write the actual factors (scale set by the caller)
+
+	// group the training points by row and split them into batches of consecutive rows; the
+	// rows of W and the gathered columns of H of a batch should fit into the cache
+	tiles_->arrange(job, 1, job.n);
+	mf_size_type maxSize = std::max<mf_size_type>(1, tileCacheSize_ / (2 * job.r * sizeof(double)));
+	detail::formMiniBatches(job, tiles_->offsets(), maxSize, maxSize, miniBatch_);
+	const std::vector<mf_size_type>& offsets = miniBatch_.offsets;
+	std::vector<mf_size_type>& order = miniBatch_.order;
+	order.resize(offsets.size()-1);
+	for (mf_size_type b=0; b<order.size(); b++) {
+		order[b] = b;
+	}
+
+	TrainingPoints<FD> points(job);
+	bool partial = false;
+	mf_size_type step = 0;
+	while (step < steps) {
+		shuffle(random_, order, order.size());
+		for (mf_size_type b=0; b<order.size() && step<steps; b++) {
+			mf_size_type begin = offsets[order[b]];
+			mf_size_type size = offsets[order[b]+1] - begin;
+			mf_size_type n = std::min(size, steps - step);
+			if (n < size) { // partial batch
+				shuffle(random_, points, begin, size, n);
+				partial = true;
+			}
+			updateMiniBatch(job, decay, begin, begin + n, step, miniBatch_);
+			step += n;
+		}
+	}
+	if (partial) tiles_->invalidate(); // the points are no longer grouped by row
+}
+
+template<typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateMiniBatch(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+		mf_size_type begin, mf_size_type end, mf_size_type decayOffset, MiniBatchSpace& space) {
+	MF_SGD_KERNEL_DISPATCH(Update, job.r, updateMiniBatchKernel,
+			(job, decay, begin, end, decayOffset, space));
+}
+
+template<unsigned R, typename Update, typename Regularize, typename Decay, typename FD>
+void SgdRunner::updateMiniBatchKernel(SgdJob<Update, Regularize, FD>& job, Decay& decay,
+		mf_size_type begin, mf_size_type end, mf_size_type decayOffset, MiniBatchSpace& space) {
+	typedef typename FD::W::value_type Factor;
+	if (begin == end) return;
+	const unsigned r = job.r;
+	const mf_size_type points = end - begin;
+
+	// rows [i0,i0+m) of W contain the rows of the batch
+	mf_size_type i0 = job.vIndex1[begin], i1 = i0;
+	for (mf_size_type pos=begin+1; pos<end; pos++) {
+		i0 = std::min<mf_size_type>(i0, job.vIndex1[pos]);
+		i1 = std::max<mf_size_type>(i1, job.vIndex1[pos]);
+	}
+	const mf_size_type m = i1 - i0 + 1;
+	Factor* w = &job.wValues[i0*r];
+
+	// the n distinct columns of H of the batch; column c of the panel is column columns[c] of H
+	std::vector<mf_size_type>& slot = space.slot;
+	std::vector<mf_size_type>& columns = space.columns;
+	std::vector<mf_size_type>& pointSlot = space.pointSlot;
+	if (slot.size() != job.n) slot.assign(job.n, MiniBatchSpace::none());
+	columns.clear();
+	pointSlot.resize(points);
+	for (mf_size_type pos=begin; pos<end; pos++) {
+		const mf_size_type j = job.vIndex2[pos];
+		if (slot[j] == MiniBatchSpace::none()) {
+			slot[j] = columns.size();
+			columns.push_back(j);
+		}
+		pointSlot[pos-begin] = slot[j];
+	}
+	const mf_size_type n = columns.size();
+	const bool dense = points >= kernels::miniBatchDenseFraction() * m * n;
+
+	// temp space: gradients of W and H, sum of the step sizes of each row and column and, for
+	// dense batches, the panel, the gradient coefficients of the points and the dense matrices
+	// of the kernels
+	std::vector<double>& buffer = space.buffer;
+	buffer.resize((m + n)*(r + 1) + (dense ? n*r + points + m*n + r*n : 0));
+	double* dw = &buffer[0];
+	double* dh = dw + m*r;
+	double* epsW = dh + n*r;
+	double* epsH = epsW + m;
+	std::fill(dw, epsH + n, 0.);
+
+	// compute the gradients at the current factors
+	if (dense) {
+		double* panel = epsH + n;
+		double* coef = panel + n*r;
+		double* e = coef + points;
+		double* bt = e + m*n;
+		for (mf_size_type c=0; c<n; c++) {
+			const Factor* hj = &job.hValues[columns[c]*r];
+			std::copy(hj, hj + kernels::size<R>(r), panel + c*r);
+		}
+		kernels::gemmNT<R>(w, panel, m, n, r, bt, e); // e holds the predictions
+		for (mf_size_type pos=begin; pos<end; pos++) {
+			const mf_size_type i = job.vIndex1[pos] - i0, c = pointSlot[pos-begin];
+			const double eps = decay(decayOffset + pos - begin);
+			const double diff = job.vValues[pos] - e[i*n + c];
+			OnlineLoss::add(diff);
+			coef[pos-begin] = eps * -2. * diff;
+			epsW[i] += eps;
+			epsH[c] += eps;
+		}
+		std::fill(e, e + m*n, 0.); // e now holds the gradient coefficients
+		for (mf_size_type pos=begin; pos<end; pos++) {
+			e[(job.vIndex1[pos]-i0)*n + pointSlot[pos-begin]] += coef[pos-begin];
+		}
+		kernels::gemmAdd<R>(e, n, 1, panel, m, n, r, dw);
+		kernels::gemmAdd<R>(e, 1, n, w, n, m, r, dh);
+	} else {
+		for (mf_size_type pos=begin; pos<end; pos++) {
+			const mf_size_type i = job.vIndex1[pos] - i0, c = pointSlot[pos-begin];
+			const double eps = decay(decayOffset + pos - begin);
+			const Factor* wi = w + i*r;
+			const Factor* hj = &job.hValues[columns[c]*r];
+			const double diff = job.vValues[pos] - kernels::dot<R>(wi, hj, r);
+			OnlineLoss::add(diff);
+			const double f = eps * -2. * diff;
+			kernels::axpy<R>(f, hj, r, dw + i*r);
+			kernels::axpy<R>(f, wi, r, dh + c*r);
+			epsW[i] += eps;
+			epsH[c] += eps;
+		}
+	}
+
+	// apply the gradients of the rows and columns that occur in the batch
+	for (mf_size_type i=0; i<m; i++) {
+		if (epsW[i] == 0.) continue;
+		const double c = 1. - epsW[i] * detail::MiniBatchTerms<Update>::w(job.update, job, i0+i);
+		Factor* wi = w + i*r;
+		const double* dwi = dw + i*r;
+		for (unsigned z=0; z<kernels::size<R>(r); z++) {
+			wi[z] = (Factor)(c * wi[z] - dwi[z]);
+		}
+	}
+	for (mf_size_type k=0; k<n; k++) {
+		const mf_size_type j = columns[k];
+		const double c = 1. - epsH[k] * detail::MiniBatchTerms<Update>::h(job.update, job, j);
+		Factor* hj = &job.hValues[j*r];
+		const double* dhj = dh + k*r;
+		for (unsigned z=0; z<kernels::size<R>(r); z++) {
+			hj[z] = (Factor)(c * hj[z] - dhj[z]);
+		}
+		slot[j] = MiniBatchSpace::none();
+	}
+}
+
+template<typename Update, typename Regularize, typename FD>
+void SgdRunner::regularize(SgdJob<Update, Regularize, FD>& job, double eps) {
+	detail::RegularizeStep<detail::UseLazyScale<Update,Regularize>::value>::run(job, eps);
 }
 
 
@@ -0,0 +1,410 @@
+//    Copyright 2017 Rainer Gemulla
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+/** \file
+ * Worker tasks that stay alive across SGD epochs. Spawning tasks, marshaling the job
+ * and seeding the random number generators is done once per run instead of once per epoch;
+ * each epoch then only requires a small command message.
+ */
+
+#ifndef MF_SGD_WORKERS_H
+#define MF_SGD_WORKERS_H
+
+#include <map>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <util/random.h>
+
+#include <mpi2/mpi2.h>
+
+#include <mf/numa.h>
+#include <mf/sgd/online-loss.h>
+
+namespace mf {
+
+/** A reusable barrier for threads of the same process. Waiting threads spin for a short
+ * while and then block; the barrier is sense-reversing (the generation counter flips
+ * whenever all threads have arrived), so that it can be reused immediately. */
+class SharedBarrier : boost::noncopyable {
+public:
+	static const unsigned SPINS = 1u << 14;
+
+	explicit SharedBarrier(unsigned n) : n_(n), count_(n), generation_(0) {
+	}
+
+	void wait() {
+		unsigned generation = generation_.load(boost::memory_order_acquire);
+		if (count_.fetch_sub(1, boost::memory_order_acq_rel) == 1) {
+			// last thread to arrive: reset and release the others
+			count_.store(n_, boost::memory_order_relaxed);
+			boost::mutex::scoped_lock lock(mutex_);
+			generation_.fetch_add(1, boost::memory_order_release);
+			cond_.notify_all();
+			return;
+		}
+		for (unsigned i=0; i<SPINS; i++) {
+			if (generation_.load(boost::memory_order_acquire) != generation) return;
+		}
+		boost::mutex::scoped_lock lock(mutex_);
+		while (generation_.load(boost::memory_order_acquire) == generation) {
+			cond_.wait(lock);
+		}
+	}
+
+private:
+	const unsigned n_;
+	boost::atomic<unsigned> count_;
+	boost::atomic<unsigned> generation_;
+	boost::mutex mutex_;
+	boost::condition_variable cond_;
+};
+
+/** An atomic counter that lets a thread wait until a number of threads of the same process
+ * have signaled completion. Waiting spins for a short while and then blocks. */
+class CompletionCounter : boost::noncopyable {
+public:
+	static const unsigned SPINS = 1u << 14;
+
+	CompletionCounter() : count_(0) {
+	}
+
+	/** Expect n more completions; must be called before the threads can complete */
+	void reset(unsigned n) {
+		count_.store(n, boost::memory_order_release);
+	}
+
+	void done() {
+		if (count_.fetch_sub(1, boost::memory_order_acq_rel) == 1) {
+			boost::mutex::scoped_lock lock(mutex_);
+			cond_.notify_all();
+		}
+	}
+
+	void wait() {
+		for (unsigned i=0; i<SPINS; i++) {
+			if (count_.load(boost::memory_order_acquire) == 0) return;
+		}
+		boost::mutex::scoped_lock lock(mutex_);
+		while (count_.load(boost::memory_order_acquire) != 0) {
+			cond_.wait(lock);
+		}
+	}
+
+private:
+	boost::atomic<unsigned> count_;
+	boost::mutex mutex_;
+	boost::condition_variable cond_;
+};
+
+namespace detail {
+
+/** Synchronization of co-located worker tasks through shared memory */
+struct WorkerSync : boost::noncopyable {
+	explicit WorkerSync(unsigned tasks) : barrier(tasks) {
+	}
+
+	SharedBarrier barrier;
+	CompletionCounter epochDone;
+	boost::mutex lossMutex;
+	OnlineLoss loss; // online loss of the current epoch (merged from all workers)
+};
+
+/** Commands sent to persistent workers */
+enum WorkerCommand {
+	WORKER_RUN_EPOCH,
+	WORKER_STOP
+};
+
+/** Used by a persistent (distributed) worker task to wait for its next command. Waiting
+ * does not spin (the polling delay of the task manager is used).
+ *
+ * @param ch channel to the runner
+ * @param[out] eps step size of the next epoch
+ * @param[out] schedule schedule of the next epoch
+ * @return true if an epoch should be run, false if the worker should stop
+ */
+template<typename Schedule>
+inline bool recvWorkerCommand(mpi2::Channel& ch, double& eps, Schedule& schedule) {
+	ch.economicRecv(mpi2::TaskManager::getInstance().pollDelay()); // wake up
+	int command;
+	ch.recv(command);
+	if (command == WORKER_STOP) {
+		ch.send(); // acknowledge
+		return false;
+	}
+	ch.recv(*mpi2::unmarshal(eps, schedule));
+	return true;
+}
+
+/** Used by a persistent (distributed) worker task right after receiving the job. Pins the
+ * worker to a core if requested (see mf::setPinTasks()); if pinned is not NULL, it is set to
+ * whether the worker has been pinned. Returns the shared-memory synchronization object if
+ * all workers run in the same process, else NULL. */
+inline WorkerSync* recvWorkerSync(mpi2::Channel& ch, bool* pinned = NULL) {
+	mpi2::PointerIntType pSync;
+	int slot;
+	ch.recv(*mpi2::unmarshal(pSync, slot));
+	bool result = pinCurrentTask(slot);
+	if (pinned != NULL) *pinned = result;
+	return pSync == 0 ? NULL : mpi2::intToPointer<WorkerSync>(pSync);
+}
+
+/** Used by a pinned worker of a DSGD-style job that works on row block id of W and V. Moves
+ * these blocks to the NUMA node of the worker (first touch). When all workers run on a
+ * single rank, the blocks of H move between the workers; they are interleaved across all
+ * nodes by worker 0. */
+template<typename Job>
+void placeWorkerData(Job& job, int id, bool singleRank) {
+	mpi2::RemoteVar rv = job.dw.block(id, 0);
+	firstTouch(*rv.getLocal<typename Job::W>());
+	for (mf_size_type b2=0; b2<job.dv.blocks2(); b2++) {
+		rv = job.dv.block(id, b2);
+		firstTouch(*rv.getLocal<typename Job::V>());
+	}
+	if (singleRank && id == 0) {
+		for (mf_size_type b2=0; b2<job.dh.blocks2(); b2++) {
+			rv = job.dh.block(0, b2);
+			interleaveDense(*rv.getLocal<typename Job::H>());
+		}
+	}
+}
+
+/** Returns the slot of each task on its rank (for mf::pinCurrentTask()), or -1 for
+ * each task if tasks should not be pinned */
+inline std::vector<int> taskSlots(std::vector<mpi2::Channel>& channels) {
+	std::vector<int> slots(channels.size(), -1);
+	if (!pinTasks()) return slots;
+	std::map<int,int> next; // next slot of each rank
+	for (unsigned i=0; i<channels.size(); i++) {
+		slots[i] = next[channels[i].remote().rank]++;
+	}
+	return slots;
+}
+
+/** Waits until all workers have reached the barrier (via shared memory, if available) */
+inline void workerBarrier(WorkerSync* sync, std::vector<mpi2::Channel>& channels) {
+	if (sync != NULL) {
+		sync->barrier.wait();
+	} else {
+		barrier(channels);
+	}
+}
+
+/** Signals the runner that the current epoch is done (via shared memory, if available).
+ * The online loss accumulated by the worker during the epoch is passed along. */
+inline void signalEpochDone(WorkerSync* sync, mpi2::Channel& ch, const OnlineLoss& loss) {
+	if (sync != NULL) {
+		{
+			boost::mutex::scoped_lock lock(sync->lossMutex);
+			sync->loss.merge(loss);
+		}
+		sync->epochDone.done();
+	} else {
+		ch.send(loss);
+	}
+}
+
+}
+
+/** A group of distributed worker tasks (tasksPerRank tasks on each rank) that run all
+ * epochs of a job. The job is sent to the workers once; each worker keeps its seeded
+ * random number generator across epochs. If mf::pinTasks() is set when the workers are
+ * started, each worker is pinned to a core of its machine (see mf::pinCurrentTask()). The worker task must receive the job, then
+ * call detail::recvWorkerSync() and then detail::recvWorkerCommand() in a loop, running
+ * one epoch and calling detail::signalEpochDone() for each received command. Workers
+ * accumulate the online loss (see mf::OnlineLoss) of each epoch and pass it to the runner
+ * when signaling completion.
+ *
+ * When all workers run on a single rank, subepoch barriers and completion signaling
+ * use shared memory (see detail::WorkerSync) instead of messages and polling.
+ */
+class WorkerGroup : boost::noncopyable {
+public:
+	WorkerGroup() : job_(NULL) {
+	}
+
+	~WorkerGroup() {
+		stop();
+	}
+
+	/** Returns true if the workers have been started for the given job */
+	bool runs(const void* job) const {
+		return job_ != NULL && job_ == job;
+	}
+
+	/** Spawns the workers and sends the job to them. Stops workers that have been started
+	 * previously. */
+	template<typename Task, typename Job>
+	void start(const Job& job, unsigned tasksPerRank, rg::Random32& random) {
+		stop();
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		channels_ = std::vector<mpi2::Channel>(tm.world().size()*tasksPerRank, mpi2::UNINITIALIZED);
+		tm.spawnAll<Task>(tasksPerRank, channels_, true);
+		mpi2::seed(channels_, random);
+		mpi2::sendAll(channels_, job);
+		if (tm.world().size() == 1) {
+			sync_.reset(new detail::WorkerSync(channels_.size()));
+		}
+		std::vector<int> slots = detail::taskSlots(channels_);
+		for (unsigned i=0; i<channels_.size(); i++) {
+			channels_[i].send(mpi2::marshal(mpi2::pointerToInt(sync_.get()), slots[i]));
+		}
+		job_ = &job;
+	}
+
+	/** Runs a single epoch on all workers and waits for its completion. If loss is not NULL,
+	 * the online losses of the workers are added to it. */
+	template<typename Schedule>
+	void runEpoch(double eps, const Schedule& schedule, OnlineLoss* loss = NULL) {
+		if (sync_) {
+			sync_->epochDone.reset(channels_.size());
+			sync_->loss.reset();
+		}
+		wakeUp();
+		mpi2::sendAll(channels_, (int)detail::WORKER_RUN_EPOCH);
+		mpi2::sendAll(channels_, mpi2::marshal(eps, schedule));
+		if (sync_) {
+			sync_->epochDone.wait();
+			if (loss != NULL) loss->merge(sync_->loss);
+		} else {
+			std::vector<OnlineLoss> losses(channels_.size());
+			mpi2::economicRecvAll(channels_, losses, mpi2::TaskManager::getInstance().pollDelay());
+			if (loss != NULL) {
+				for (unsigned i=0; i<losses.size(); i++) {
+					loss->merge(losses[i]);
+				}
+			}
+		}
+	}
+
+	/** Stops the workers (if running) */
+	void stop() {
+		if (job_ == NULL) return;
+		wakeUp();
+		mpi2::sendAll(channels_, (int)detail::WORKER_STOP);
+		mpi2::economicRecvAll(channels_, mpi2::TaskManager::getInstance().pollDelay()); // workers do not use sync_ anymore
+		channels_.clear();
+		sync_.reset();
+		job_ = NULL;
+	}
+
+private:
+	void wakeUp() {
+		for (unsigned i=0; i<channels_.size(); i++) {
+			channels_[i].send();
+		}
+	}
+
+	std::vector<mpi2::Channel> channels_;
+	boost::scoped_ptr<detail::WorkerSync> sync_;
+	const void* job_;
+};
+
+/** Work that can be run by a mf::LocalWorkerPool. Work is split into parts. */
+struct LocalWork {
+	virtual ~LocalWork() {
+	}
+
+	/** Runs the given part of the work; random is the generator of the executing thread */
+	virtual void run(unsigned part, rg::Random32& random) = 0;
+};
+
+namespace detail {
+
+struct LocalWorkerTask {
+	static const std::string id() { return std::string("__mf/sgd/LocalWorkerTask"); }
+
+	static inline void run(mpi2::Channel ch, mpi2::TaskInfo info) {
+		rg::Random32 random = mpi2::getSeed(ch);
+		int slot;
+		ch.recv(slot);
+		pinCurrentTask(slot);
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		while (true) {
+			// wait for work
+			ch.economicRecv(tm.pollDelay());
+			mpi2::PointerIntType pWork;
+			unsigned part;
+			ch.recv(*mpi2::unmarshal(pWork, part));
+			if (pWork == 0) break; // stop
+
+			// run it
+			mpi2::intToPointer<LocalWork>(pWork)->run(part, random);
+
+			// signal that we are done
+			ch.send();
+		}
+	}
+};
+
+}
+
+/** A pool of worker tasks on the local rank that stays alive across epochs. Each worker
+ * keeps its seeded random number generator. If mf::pinTasks() is set when the workers are
+ * started, worker i is pinned to the core of slot i (see mf::NumaTopology::cpu()). */
+class LocalWorkerPool : boost::noncopyable {
+public:
+	LocalWorkerPool() {
+	}
+
+	~LocalWorkerPool() {
+		stop();
+	}
+
+	unsigned size() const {
+		return channels_.size();
+	}
+
+	/** Makes sure that the pool has at least the given number of workers. If new workers
+	 * are needed, all workers are restarted and seeded from random. */
+	void reserve(unsigned workers, rg::Random32& random) {
+		if (workers <= size()) return;
+		stop();
+		mpi2::TaskManager& tm = mpi2::TaskManager::getInstance();
+		tm.spawn<detail::LocalWorkerTask>(tm.world().rank(), workers, channels_);
+		mpi2::seed(channels_, random);
+		mpi2::sendEach(channels_, detail::taskSlots(channels_));
+	}
+
+	/** Starts the given part of work on a worker. The work object must stay alive until
+	 * the returned request has completed. */
+	boost::mpi::request run(unsigned worker, LocalWork& work, unsigned part) {
+		mpi2::Channel& ch = channels_[worker];
+		ch.send(); // wake up
+		ch.send(mpi2::marshal(mpi2::pointerToInt(&work), part));
+		return ch.irecv();
+	}
+
+	/** Stops all workers */
+	void stop() {
+		for (unsigned i=0; i<channels_.size(); i++) {
+			channels_[i].send();
+			channels_[i].send(mpi2::marshal((mpi2::PointerIntType)0, 0u));
+		}
+		channels_.clear();
+	}
+
+private:
+	std::vector<mpi2::Channel> channels_;
+};
+
+}
+
+#endif
@@ -84,13 +84,13 @@ struct TraceEntry {
 struct SgdTraceEntry: public  TraceEntry{
 	SgdTraceEntry(double loss, double timeLoss, double testLoss=NAN, double timeTestLoss=0.0)
 	: TraceEntry( loss,  timeLoss, testLoss, timeTestLoss),
-	  eps(NAN), timeEps(0) {
+	  eps(NAN), timeEps(0), onlineLoss(NAN), lossSampleSize(0), lossLower(NAN), lossUpper(NAN) {
         }
 
 	SgdTraceEntry(mf_size_type epoch, mf_size_type iteration, double loss, double eps,
 			double timeEps, double timeEpoch, double timeLoss, double testLoss=NAN, double timeTestLoss=0.0)
 	: TraceEntry(epoch, iteration, loss,timeLoss,  timeEpoch,  testLoss, timeTestLoss),
-	  eps(eps), timeEps(timeEps){
+	  eps(eps), timeEps(timeEps), onlineLoss(NAN), lossSampleSize(0), lossLower(NAN), lossUpper(NAN) {
 	}
 
 	/** Passes the additional information of the entry
@@ -110,9 +110,25 @@ struct SgdTraceEntry: public  TraceEntry{
 			out << eps;
 		}
 
+		out<<", loss.online=";
+		if (isnan(onlineLoss)) {
+			out << "NA";
+		} else {
+			out << onlineLoss;
+		}
+
+		// estimated loss: sample size and confidence interval
+		if (lossSampleSize > 0) {
+			out << ", loss.sample=" << lossSampleSize << ", loss.lower=" << lossLower
+					<< ", loss.upper=" << lossUpper;
+		}
 	}
 	double eps; // learning rate
 	double timeEps;
+	double onlineLoss; // loss accumulated during the epoch (NAN if not used)
+	mf_size_type lossSampleSize; // sample size if the loss has been estimated (0 if exact)
+	double lossLower; // confidence interval of an estimated loss
+	double lossUpper;
 };
 /** Describes an entry for the trace for the ALS algorithm.
  * 	It is a derived struct of TraceEntry. Additionally, the entry contains:
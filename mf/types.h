@@ -23,6 +23,7 @@
 
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/matrix_sparse.hpp>
+#include <boost/cstdint.hpp>
 
 #include <util/exception.h>
 
@@ -39,7 +40,27 @@ typedef boost::numeric::ublas::matrix<double, boost::numeric::ublas::row_major>
 typedef boost::numeric::ublas::matrix<double, boost::numeric::ublas::column_major>
 	DenseMatrixCM;
 
+// single-precision factor matrices
+typedef boost::numeric::ublas::matrix<float, boost::numeric::ublas::row_major>
+	DenseMatrixF;
+typedef boost::numeric::ublas::matrix<float, boost::numeric::ublas::column_major>
+	DenseMatrixFCM;
+
 typedef SparseMatrix::size_type mf_size_type;
+
+// compact training data: 32-bit row/column indexes (struct-of-arrays as in SparseMatrix) and
+// double or single-precision values; each matrix must have less than 2^32 rows, columns and
+// nonzero entries (use for blocks of a large matrix). The distributed algorithms DSGD, DSGD++
+// and ASGD accept blocks of type CompactSparseMatrixF with the NZSL losses (see
+// CompactSparseMatrixTypes and mf/register/register_impl.cc).
+typedef boost::numeric::ublas::coordinate_matrix<double, boost::numeric::ublas::row_major, 0,
+		boost::numeric::ublas::unbounded_array<boost::uint32_t>,
+		boost::numeric::ublas::unbounded_array<double> >
+	CompactSparseMatrix;
+typedef boost::numeric::ublas::coordinate_matrix<float, boost::numeric::ublas::row_major, 0,
+		boost::numeric::ublas::unbounded_array<boost::uint32_t>,
+		boost::numeric::ublas::unbounded_array<float> >
+	CompactSparseMatrixF;
 }
 
 // register matrix types
@@ -47,6 +68,10 @@ MPI2_TYPE_TRAITS(mf::SparseMatrix);
 MPI2_TYPE_TRAITS(mf::SparseMatrixCM);
 MPI2_TYPE_TRAITS(mf::DenseMatrix);
 MPI2_TYPE_TRAITS(mf::DenseMatrixCM);
+MPI2_TYPE_TRAITS(mf::DenseMatrixF);
+MPI2_TYPE_TRAITS(mf::DenseMatrixFCM);
+MPI2_TYPE_TRAITS(mf::CompactSparseMatrix);
+MPI2_TYPE_TRAITS(mf::CompactSparseMatrixF);
 
 namespace mf {
 
@@ -57,6 +82,12 @@ typedef
 		> >
 SparseMatrixTypes;
 
+/** A list of compact sparse matrix types to be registered to the mf library. */
+typedef
+		mpi2::Cons<CompactSparseMatrixF
+		>
+CompactSparseMatrixTypes;
+
 /** A list of dense matrix types to be registered to the mf library. */
 typedef
 		mpi2::Cons<DenseMatrix,
@@ -64,12 +95,21 @@ typedef
 		> >
 DenseMatrixTypes;
 
+/** A list of single-precision dense matrix types (factors of the distributed algorithms with
+ * float factors) to be registered to the mf library. */
+typedef
+		mpi2::Cons<DenseMatrixF,
+		mpi2::Cons<DenseMatrixFCM
+		> >
+FloatDenseMatrixTypes;
+
 /** A list of all matrix types. */
 typedef mpi2::Concat<SparseMatrixTypes, DenseMatrixTypes> MatrixTypes;
 
 /** A list of all built-in types relevant to the mf package. */
 typedef
-		MatrixTypes
+		mpi2::Concat<MatrixTypes,
+		mpi2::Concat<CompactSparseMatrixTypes, FloatDenseMatrixTypes> >
 MfBuiltinTypes;
 
 }
@@ -15,32 +15,54 @@
 #define MFDSGD_ARGS_H
 
 #include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 #include <boost/mpi/communicator.hpp>
 #include <util/random.h>
 #include <mf/types.h>
 #include <mf/trace.h>
+#include <mf/matrix/op/relabel.h>
+#include <mf/matrix/io/loadDistributedMatrix.h>
 #include <mf/sgd/sgd.h>
 #include <mf/sgd/dsgd.h>
+#include <mf/sgd/asgd.h>
+#include <mf/sgd/functions/update-nzsl.h>
+#include <mf/sgd/functions/update-nzsl-l2.h>
+#include <mf/sgd/functions/update-nzsl-nzl2.h>
+#include <mf/sgd/functions/update-truncate.h>
+#include <mf/sgd/functions/regularize-none.h>
+#include <mf/sgd/functions/regularize-truncate.h>
 
 using namespace std;
 
 struct Args {
 	std::string inputMatrixFile, inputTestMatrixFile, inputRowFacFile, inputColFacFile, outputRowFacFile,
 		   outputColFacFile, traceFile, traceVar, sgdOrderString, stratumOrderString,
-		   updateString, regularizeString, lossString, decayString, inputSampleMatrixFile, truncateString, absString, balanceString;
+		   updateString, regularizeString, lossString, decayString, inputSampleMatrixFile, truncateString, absString, balanceString, balanceMethodString,
+		   blockingString, relabelFile;
 
 	std::string updateName, regularizeName, lossName, decayName;
 	std::vector<double> updateArgs, regularizeArgs, lossArgs, truncateArgs;//, absArgs;
 	std::vector<string> decayArgs;
 
 	mf::mf_size_type epochs, rank, blocks1, blocks2;
+	mf::mf_size_type onlineLoss; // compute the exact loss every onlineLoss epochs (0 = every epoch)
+	double lossSample; // fraction of the data used to estimate the loss (0 = exact loss)
+	bool compactData; // store the data blocks as mf::CompactSparseMatrixF
+	std::string factorPrecisionString;
+	bool floatFactors; // store the factors as mf::DenseMatrixF and mf::DenseMatrixFCM
 	unsigned seed;
 	rg::Random32 random;
 	mf::SgdOrder sgdOrder;
 	mf::StratumOrder stratumOrder;
+	mf::BlockingType blocking;
+	bool relabel; // set when --relabel or --relabel-file is given
+	mf::Relabeling relabeling; // stored in relabelFile (an mfp descriptor) if given
 	bool mapReduce;
+	unsigned pipelineChunks; // number of chunks in which blocks of H are sent (1 = no pipelining)
 	double epsilon, epsIncrease, epsDecrease, improvement,alpha, A;
 	unsigned tries;
+	unsigned decayHalving; // number of candidates for successive halving in the auto decay (0 = disabled)
 	int tasksPerRank;
 	int worldSize;
 	int worldRank;
@@ -49,6 +71,11 @@ struct Args {
 	mf::BalanceType balanceType;
 	mf::BalanceMethod balanceMethod;
 	bool averageDeltas;
+	std::string deltaCodecString;
+	mf::DeltaCodec deltaCodec; // compression of the deltas exchanged by ASGD
+	std::string asgdSyncString;
+	mf::AsgdSync asgdSync;
+	unsigned staleness; // staleness bound of the ASGD parameter server (0 = unbounded)
 
 	void createTraceFields(mf::Trace& trace) {
 		trace.addField("update", updateString);
@@ -61,6 +88,53 @@ struct Args {
 		trace.addField("threads", tasksPerRank);
 		trace.addField("barrier", mapReduce ? "true" : "false");
 	}
+
+	/** Sets up the relabeling of the input files. If relabelFile exists, the relabeling is
+	 * read from it; otherwise, if relabel is set, a random relabeling is created and, if
+	 * relabelFile is given, written to it (so that later runs and the output factors can be
+	 * related to the relabeled blocks). */
+	void setupRelabeling() {
+		if (relabelFile.length() > 0 && boost::filesystem::exists(relabelFile)) {
+			mf::readRelabeling(relabelFile, inputMatrixFile, relabeling);
+		} else if (relabel && mf::randomRelabeling(random, inputMatrixFile, relabeling)
+				&& relabelFile.length() > 0) {
+			mf::writeRelabeling(relabeling, relabelFile, inputMatrixFile);
+		}
+	}
 };
 
+/** Whether the data blocks of a run with update function U can be stored as
+ * mf::CompactSparseMatrixF (NZSL update functions only) */
+template<typename U> struct CompactDataUpdate : boost::false_type {};
+template<> struct CompactDataUpdate<mf::UpdateNzsl> : boost::true_type {};
+template<> struct CompactDataUpdate<mf::UpdateNzslL2> : boost::true_type {};
+template<> struct CompactDataUpdate<mf::UpdateNzslNzl2> : boost::true_type {};
+template<typename U> struct CompactDataUpdate<mf::UpdateTruncate<U> > : CompactDataUpdate<U> {};
+
+/** Whether --compact-data is supported for update function U and regularization function R,
+ * i.e., whether the DSGD, DSGD++ and ASGD tasks for compact data blocks have been registered
+ * (see mf/register/register_impl.cc). Derives from boost::true_type or boost::false_type. */
+template<typename U, typename R> struct CompactDataSupported : boost::false_type {};
+template<typename U> struct CompactDataSupported<U, mf::RegularizeNone> : CompactDataUpdate<U> {};
+template<typename U> struct CompactDataSupported<U, mf::RegularizeTruncate<mf::RegularizeNone> >
+	: CompactDataUpdate<U> {};
+
+/** Whether --factor-precision=float is supported for update function U and regularization
+ * function R. The tasks for single-precision factors are registered for the same update and
+ * regularization functions as the ones for compact data blocks. */
+template<typename U, typename R> struct FloatFactorsSupported : CompactDataSupported<U,R> {};
+
+/** Parses the value of --factor-precision ("double" or "float") into args.floatFactors. Returns
+ * false if the value is invalid. */
+inline bool parseFactorPrecision(Args& args) {
+	if (args.factorPrecisionString.compare("double") == 0) {
+		args.floatFactors = false;
+	} else if (args.factorPrecisionString.compare("float") == 0) {
+		args.floatFactors = true;
+	} else {
+		return false;
+	}
+	return true;
+}
+
 #endif
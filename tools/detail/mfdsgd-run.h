@@ -35,6 +35,7 @@
 #include <tools/detail/mfdsgd-args.h>
 
 #include <mf/loss/nzsl.h>
+#include <mf/loss/nzsl-sample.h>
 #include <mf/loss/biased-nzsl.h>
 #include <mf/loss/nzrmse.h>
 #include <mf/loss/sl.h>
@@ -51,21 +52,58 @@ using namespace rg;
 
 extern log4cxx::LoggerPtr logger;
 
+/** Runs DSGD using the given loss or, if requested, an estimate of the NZSL computed from a sample */
+template<typename U,typename R,typename L, typename D, typename TL>
+void runDsgdWithLoss(Args& args, DsgdRunner& dsgdRunner, DsgdJob<U,R>& dsgdJob, L& loss, D& decay,
+		Trace& trace, DsgdFactorizationData<>* testData, TL* testLoss) {
+	if (args.lossSample > 0) {
+		NzslSampleLoss sampleLoss(args.random, args.lossSample);
+		dsgdRunner.run(dsgdJob, sampleLoss, args.epochs, decay, trace, args.balanceType, args.balanceMethod, testData, testLoss);
+		sampleLoss.erase();
+	} else {
+		dsgdRunner.run(dsgdJob, loss, args.epochs, decay, trace, args.balanceType, args.balanceMethod, testData, testLoss);
+	}
+}
+
+/** Runs DSGD on compact data blocks or with single-precision factors using the given loss (the
+ * NZSL cannot be estimated from a sample in this case) */
+template<typename U,typename R,typename L, typename D, typename TL, typename FD>
+void runDsgdWithLoss(Args& args, DsgdRunner& dsgdRunner, DsgdJob<U,R,FD>& dsgdJob, L& loss, D& decay,
+		Trace& trace, FD* testData, TL* testLoss) {
+	dsgdRunner.run(dsgdJob, loss, args.epochs, decay, trace, args.balanceType, args.balanceMethod, testData, testLoss);
+}
+
+/** Runs DSGD with the biased NZSL as test loss */
 template<typename U,typename R,typename L, typename D>
+void runDsgdWithBiasedTestLoss(Args& args, DsgdRunner& dsgdRunner, DsgdJob<U,R>& dsgdJob, L& loss, D& decay,
+		Trace& trace, DsgdFactorizationData<>& testData) {
+	BiasedNzslLoss testLoss;
+	runDsgdWithLoss(args, dsgdRunner, dsgdJob, loss, decay, trace, &testData, &testLoss);
+}
+
+/** The biased NZSL is not supported for compact data blocks or single-precision factors */
+template<typename U,typename R,typename L, typename D, typename FD>
+void runDsgdWithBiasedTestLoss(Args& args, DsgdRunner& dsgdRunner, DsgdJob<U,R,FD>& dsgdJob, L& loss, D& decay,
+		Trace& trace, FD& testData) {
+	RG_THROW(rg::InvalidArgumentException, "BiasedNzslLoss is not supported for compact data blocks or single-precision factors");
+}
+
+template<typename U,typename R,typename L, typename D, typename FD>
 //void runDsgd2(Args& args, U update, R regularize, L loss, D decay,
 //		DsgdJob<U,R>& dsgdJob, DistributedDenseMatrix& dw, DistributedDenseMatrixCM& dh, Trace& trace) {
 void runDsgd2(Args& args, U update, R regularize, L loss, D decay,
-		DsgdJob<U,R>& dsgdJob, std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM>& factorsPair,
-		std::vector<DistributedSparseMatrix>& dataVector, Trace& trace) {
+		DsgdJob<U,R,FD>& dsgdJob, std::pair<typename FD::DW, typename FD::DH>& factorsPair,
+		std::vector<typename FD::DV>& dataVector, Trace& trace) {
 
 	mf_size_type blocks1 = args.worldSize * args.tasksPerRank;
 	mf_size_type blocks2 = args.worldSize * args.tasksPerRank;
 	Timer t;
 	DsgdRunner dsgdRunner(args.random);
+	dsgdRunner.setOnlineLoss(args.onlineLoss);
 	if (args.inputTestMatrixFile.length() == 0) {
 		// run DSGD
 		t.start();
-		dsgdRunner.run(dsgdJob, loss, args.epochs, decay, trace, args.balanceType, args.balanceMethod);
+		runDsgdWithLoss(args, dsgdRunner, dsgdJob, loss, decay, trace, (FD*)NULL, (NoLoss*)NULL);
 		t.stop();
 		LOG4CXX_INFO(logger, "Total time: " << t);
 	} else {
@@ -77,13 +115,12 @@ void runDsgd2(Args& args, U update, R regularize, L loss, D decay,
 //
 //		DsgdFactorizationData<> testData(dvTest,dw,dh,args.tasksPerRank);
 
-		DsgdFactorizationData<> testData(dataVector[1], factorsPair.first, factorsPair.second, args.tasksPerRank);
+		FD testData(dataVector[1], factorsPair.first, factorsPair.second, args.tasksPerRank);
 		if (args.lossName.compare("Biased_Nzsl_Nzl2") == 0) {
 			LOG4CXX_INFO(logger, "Using BiasedNzslLoss for test data");
-			BiasedNzslLoss testLoss;
 			// run DSGD
 			t.start();
-			dsgdRunner.run(dsgdJob, loss, args.epochs, decay, trace, args.balanceType, args.balanceMethod, &testData, &testLoss);
+			runDsgdWithBiasedTestLoss(args, dsgdRunner, dsgdJob, loss, decay, trace, testData);
 			t.stop();
 			LOG4CXX_INFO(logger, "Total time: " << t);
 		} else {
@@ -91,32 +128,36 @@ void runDsgd2(Args& args, U update, R regularize, L loss, D decay,
 			NzslLoss testLoss;
 			// run DSGD
 			t.start();
-			dsgdRunner.run(dsgdJob, loss, args.epochs, decay, trace, args.balanceType, args.balanceMethod, &testData, &testLoss);
+			runDsgdWithLoss(args, dsgdRunner, dsgdJob, loss, decay, trace, &testData, &testLoss);
 			t.stop();
 			LOG4CXX_INFO(logger, "Total time: " << t);
 		}
 	}
 }
 
-// run DSGD
-template<typename U,typename R,typename L>
-void runDsgd(Args& args, U update, R regularize, L loss) {
+// run DSGD on data and factor blocks of the types used by FD
+template<typename FD, typename U,typename R,typename L>
+void runDsgdWithData(Args& args, U update, R regularize, L loss) {
 
 	mf_size_type blocks1 = args.worldSize * args.tasksPerRank;
 	mf_size_type blocks2 = args.worldSize * args.tasksPerRank;
 	Timer t;
 	t.start();
-	std::vector<DistributedSparseMatrix> dataVector;
+	std::vector<typename FD::DV> dataVector;
+	args.setupRelabeling();
 	if (args.inputTestMatrixFile.length() == 0) {
-		dataVector=getDataMatrices<SparseMatrix>(args.inputMatrixFile, "V", true, args.tasksPerRank,
-				args.worldSize, blocks1, blocks2, false, false);
+		dataVector=getDataMatrices<typename FD::V>(args.inputMatrixFile, "V", true, args.tasksPerRank,
+				args.worldSize, blocks1, blocks2, false, false, NULL, args.blocking, &args.relabeling);
 	}else{
-		dataVector=getDataMatrices<SparseMatrix>(args.inputMatrixFile, "V", true, args.tasksPerRank,
-				args.worldSize, blocks1, blocks2, false, false, &args.inputTestMatrixFile);
+		dataVector=getDataMatrices<typename FD::V>(args.inputMatrixFile, "V", true, args.tasksPerRank,
+				args.worldSize, blocks1, blocks2, false, false, &args.inputTestMatrixFile, args.blocking,
+				&args.relabeling);
 	}
 
-	std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> factorsPair= getFactors(args.inputRowFacFile,
-			args.inputColFacFile,  args.tasksPerRank, args.worldSize, blocks1, blocks2, false);
+	// block the factors like the data
+	std::pair<typename FD::DW, typename FD::DH> factorsPair= getFactors<typename FD::W, typename FD::H>(args.inputRowFacFile,
+			args.inputColFacFile,  args.tasksPerRank, args.worldSize, blocks1, blocks2, false,
+			dataVector[0].blockOffsets1(), dataVector[0].blockOffsets2(), &args.relabeling);
 	
 	t.stop();
 	LOG4CXX_INFO(logger, "Total time for loading matrices: " << t);
@@ -140,7 +181,8 @@ void runDsgd(Args& args, U update, R regularize, L loss) {
 //	DsgdRunner dsgdRunner(args.random);
 //	DsgdJob<U,R> dsgdJob(dv, dw, dh, update, regularize, args.sgdOrder, args.stratumOrder, args.mapReduce, args.tasksPerRank);
 
-	DsgdJob<U,R> dsgdJob(dataVector[0], factorsPair.first, factorsPair.second, update, regularize, args.sgdOrder, args.stratumOrder, args.mapReduce, args.tasksPerRank);
+	DsgdJob<U,R,FD> dsgdJob(dataVector[0], factorsPair.first, factorsPair.second, update, regularize, args.sgdOrder, args.stratumOrder, args.mapReduce, args.tasksPerRank);
+	dsgdJob.pipelineChunks = args.pipelineChunks;
 
 	Trace trace;
 	// add trace fields
@@ -155,6 +197,7 @@ void runDsgd(Args& args, U update, R regularize, L loss) {
 			<< vsample.size1 << " x " << vsample.size2 << ", " << vsample.data.nnz() << " nonzeros");
 
 		DistributedDecayAuto<U,R,L> decay(dsgdJob, loss, vsample, "decay", args.epsilon, args.tries);
+		if (args.decayHalving > 0) decay.setSuccessiveHalving(args.decayHalving);
 //		runDsgd2<>(args, update, regularize, loss, decay, dsgdJob, dw, dh, trace);
 		runDsgd2<>(args, update, regularize, loss, decay, dsgdJob, factorsPair, dataVector, trace);
 
@@ -200,19 +243,61 @@ void runDsgd(Args& args, U update, R regularize, L loss) {
 	// write computed factors to file
 	if (args.outputRowFacFile.length() > 0) {
 		LOG4CXX_INFO(logger, "Writing row factors to " << args.outputRowFacFile);
-		DenseMatrix w0;
+		typename FD::W w0;
 //		unblock(dw, w0);
 		unblock(factorsPair.first, w0);
+		unrelabel1(w0, args.relabeling.map1); // back to original row ids
 		writeMatrix(args.outputRowFacFile, w0);
 	}
 	if (args.outputColFacFile.length() > 0) {
 		LOG4CXX_INFO(logger, "Writing column factors to " << args.outputColFacFile);
-		DenseMatrixCM h0;
+		typename FD::H h0;
 //		unblock(dh, h0);
 		unblock(factorsPair.second, h0);
+		unrelabel2(h0, args.relabeling.map2); // back to original column ids
 		writeMatrix(args.outputColFacFile, h0);
 	}
 }
 
+/** Runs DSGD on data blocks of type mf::CompactSparseMatrixF */
+template<typename U,typename R,typename L>
+void runDsgdCompact(Args& args, U update, R regularize, L loss, boost::true_type) {
+	LOG4CXX_INFO(logger, "Using compact data blocks (32-bit indexes, single-precision values)");
+	runDsgdWithData<DsgdFactorizationData<float,double,boost::uint32_t> >(args, update, regularize, loss);
+}
+
+template<typename U,typename R,typename L>
+void runDsgdCompact(Args& args, U update, R regularize, L loss, boost::false_type) {
+	cerr << "Compact data is only supported for the Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions "
+			"without regularization" << endl;
+	exit(1);
+}
+
+/** Runs DSGD with factors of type mf::DenseMatrixF and mf::DenseMatrixFCM */
+template<typename U,typename R,typename L>
+void runDsgdFloat(Args& args, U update, R regularize, L loss, boost::true_type) {
+	LOG4CXX_INFO(logger, "Using single-precision factors");
+	runDsgdWithData<DsgdFactorizationData<double,float> >(args, update, regularize, loss);
+}
+
+template<typename U,typename R,typename L>
+void runDsgdFloat(Args& args, U update, R regularize, L loss, boost::false_type) {
+	cerr << "Single-precision factors are only supported for the Nzsl, Nzsl_L2 and Nzsl_Nzl2 update "
+			"functions without regularization" << endl;
+	exit(1);
+}
+
+// run DSGD
+template<typename U,typename R,typename L>
+void runDsgd(Args& args, U update, R regularize, L loss) {
+	if (args.compactData) {
+		runDsgdCompact(args, update, regularize, loss, CompactDataSupported<U,R>());
+	} else if (args.floatFactors) {
+		runDsgdFloat(args, update, regularize, loss, FloatFactorsSupported<U,R>());
+	} else {
+		runDsgdWithData<DsgdFactorizationData<> >(args, update, regularize, loss);
+	}
+}
+
 
 #endif
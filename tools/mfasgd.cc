@@ -45,12 +45,12 @@ MPI2_TYPE_TRAITS(UpdateLockNzslTruncate);
 MPI2_TYPE_TRAITS(UpdateLockNzslL2Truncate);
 MPI2_TYPE_TRAITS(UpdateLockNzslNzl2Truncate);
 
-template<typename U,typename R,typename L, typename D>
+template<typename U,typename R,typename L, typename D, typename FD>
 //void runAsgd2(Args& args, U update, R regularize, L loss, D decay,
 //		AsgdJob<U,R>& asgdJob, DistributedDenseMatrix& dw, DistributedDenseMatrixCM& dh, Trace& trace) {
 void runAsgd2(Args& args, U update, R regularize, L loss, D decay,
-			AsgdJob<U,R>& asgdJob, std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM>& factorsPair,
-			std::vector<DistributedSparseMatrix>& dataVector, Trace& trace) {
+			AsgdJob<U,R,FD>& asgdJob, std::pair<typename FD::DW, typename FD::DH>& factorsPair,
+			std::vector<typename FD::DV>& dataVector, Trace& trace) {
 
 	mf_size_type blocks1 = args.worldSize;
 	mf_size_type blocks2 = args.worldSize;
@@ -70,7 +70,7 @@ void runAsgd2(Args& args, U update, R regularize, L loss, D decay,
 //			<< dvTest.blocks1() << " x " << dvTest.blocks2() << " blocks");
 //
 //		AsgdFactorizationData<> testData(dvTest,dw,dh,args.tasksPerRank);
-		AsgdFactorizationData<> testData(dataVector[1],factorsPair.first,factorsPair.second,args.tasksPerRank);
+		FD testData(dataVector[1],factorsPair.first,factorsPair.second,args.tasksPerRank);
 		LOG4CXX_INFO(logger, "Using NzslLoss for test data");
 		NzslLoss testLoss;
 		// run ASGD
@@ -81,22 +81,26 @@ void runAsgd2(Args& args, U update, R regularize, L loss, D decay,
 	}
 }
 
-// run ASGD
-template<typename U,typename R,typename L>
-void runAsgd(Args& args, U update, R regularize, L loss) {
+// run ASGD on data and factor blocks of the types used by FD
+template<typename FD, typename U,typename R,typename L>
+void runAsgdWithData(Args& args, U update, R regularize, L loss) {
 
 	mf_size_type blocks1 = args.worldSize;
 	mf_size_type blocks2 = args.worldSize;
 
-	std::vector<DistributedSparseMatrix> dataVector;
+	std::vector<typename FD::DV> dataVector;
+	args.setupRelabeling();
 	if (args.inputTestMatrixFile.length() == 0) {
-		dataVector=getDataMatrices<SparseMatrix>(args.inputMatrixFile,"V",true,args.tasksPerRank, args.worldSize, blocks1, 1,true,false);
+		dataVector=getDataMatrices<typename FD::V>(args.inputMatrixFile,"V",true,args.tasksPerRank, args.worldSize, blocks1, 1,true,false,
+				NULL, BLOCKING_EQUAL_SIZE, &args.relabeling);
 	}else{
-		dataVector=getDataMatrices<SparseMatrix>(args.inputMatrixFile,"V",true,args.tasksPerRank, args.worldSize, blocks1, 1,true,false, &args.inputTestMatrixFile);
+		dataVector=getDataMatrices<typename FD::V>(args.inputMatrixFile,"V",true,args.tasksPerRank, args.worldSize, blocks1, 1,true,false, &args.inputTestMatrixFile,
+				BLOCKING_EQUAL_SIZE, &args.relabeling);
 	}
 
-	std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> factorsPair= getFactors(args.inputRowFacFile,
-			args.inputColFacFile,  args.tasksPerRank, args.worldSize,blocks1,blocks2,true);
+	std::pair<typename FD::DW, typename FD::DH> factorsPair= getFactors<typename FD::W, typename FD::H>(args.inputRowFacFile,
+			args.inputColFacFile,  args.tasksPerRank, args.worldSize,blocks1,blocks2,true,
+			std::vector<mf_size_type>(), std::vector<mf_size_type>(), &args.relabeling);
 
 //	// distribute the input matrices
 //	DistributedSparseMatrix dv=loadMatrix<SparseMatrix>(args.inputMatrixFile,
@@ -116,8 +120,11 @@ void runAsgd(Args& args, U update, R regularize, L loss) {
 //
 //	AsgdJob<U,R> asgdJob(dv, dw, dh, update, regularize, args.sgdOrder, args.stratumOrder, args.tasksPerRank, args.averageDeltas);
 
-	AsgdJob<U,R> asgdJob(dataVector[0], factorsPair.first, factorsPair.second,
+	AsgdJob<U,R,FD> asgdJob(dataVector[0], factorsPair.first, factorsPair.second,
 			update, regularize, args.sgdOrder, args.stratumOrder, args.tasksPerRank, args.averageDeltas);
+	asgdJob.codec = args.deltaCodec;
+	asgdJob.sync = args.asgdSync;
+	asgdJob.staleness = args.staleness;
 
 	Trace trace;
 	// add trace fields
@@ -153,20 +160,62 @@ void runAsgd(Args& args, U update, R regularize, L loss) {
 	// write computed factors to file
 	if (args.outputRowFacFile.length() > 0) {
 		LOG4CXX_INFO(logger, "Writing row factors to " << args.outputRowFacFile);
-		DenseMatrix w0;
+		typename FD::W w0;
 //		unblock(dw, w0);
 		unblock(factorsPair.first, w0);
+		unrelabel1(w0, args.relabeling.map1); // back to original row ids
 		writeMatrix(args.outputRowFacFile, w0);
 	}
 	if (args.outputColFacFile.length() > 0) {
 		LOG4CXX_INFO(logger, "Writing column factors to " << args.outputColFacFile);
-		DenseMatrixCM h0;
+		typename FD::H h0;
 //		unblock(dh, h0);
 		unblock(factorsPair.second, h0);
+		unrelabel2(h0, args.relabeling.map2); // back to original column ids
 		writeMatrix(args.outputColFacFile, h0);
 	}
 }
 
+/** Runs ASGD on data blocks of type mf::CompactSparseMatrixF */
+template<typename U,typename R,typename L>
+void runAsgdCompact(Args& args, U update, R regularize, L loss, boost::true_type) {
+	LOG4CXX_INFO(logger, "Using compact data blocks (32-bit indexes, single-precision values)");
+	runAsgdWithData<AsgdFactorizationData<float,double,boost::uint32_t> >(args, update, regularize, loss);
+}
+
+template<typename U,typename R,typename L>
+void runAsgdCompact(Args& args, U update, R regularize, L loss, boost::false_type) {
+	cerr << "Compact data is only supported for the Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions "
+			"without regularization" << endl;
+	exit(1);
+}
+
+/** Runs ASGD with factors of type mf::DenseMatrixF and mf::DenseMatrixFCM */
+template<typename U,typename R,typename L>
+void runAsgdFloat(Args& args, U update, R regularize, L loss, boost::true_type) {
+	LOG4CXX_INFO(logger, "Using single-precision factors");
+	runAsgdWithData<AsgdFactorizationData<double,float> >(args, update, regularize, loss);
+}
+
+template<typename U,typename R,typename L>
+void runAsgdFloat(Args& args, U update, R regularize, L loss, boost::false_type) {
+	cerr << "Single-precision factors are only supported for the Nzsl, Nzsl_L2 and Nzsl_Nzl2 update "
+			"functions without regularization" << endl;
+	exit(1);
+}
+
+// run ASGD
+template<typename U,typename R,typename L>
+void runAsgd(Args& args, U update, R regularize, L loss) {
+	if (args.compactData) {
+		runAsgdCompact(args, update, regularize, loss, CompactDataSupported<U,R>());
+	} else if (args.floatFactors) {
+		runAsgdFloat(args, update, regularize, loss, FloatFactorsSupported<U,R>());
+	} else {
+		runAsgdWithData<AsgdFactorizationData<> >(args, update, regularize, loss);
+	}
+}
+
 bool runArgs(Args& args) {
 	using namespace mf;
 	using namespace mpi2;
@@ -397,7 +446,9 @@ int main(int argc, char *argv[]) {
 			("trace-var", value<string>(&args.traceVar), "variable name for trace [traceVar]")
 			("epochs", value<mf_size_type>(&args.epochs), "number of epochs to run [10]")
 			("tasks-per-rank", value<int>(&args.tasksPerRank), "number of concurrent tasks per rank [1]")
-			("sgd-order", value<string>(&args.sgdOrderString), "order of SGD steps [WOR] (e.g., \"SEQ\", \"WR\", \"WOR\")")
+			("sgd-order", value<string>(&args.sgdOrderString), "order of SGD steps [WOR] (e.g., \"SEQ\", \"WR\", \"WOR\", \"SWOR\", \"FWOR\")")
+			("relabel", "if present, rows and columns of unblocked input files are relabeled randomly before blocking")
+			("relabel-file", value<string>(&args.relabelFile), "mfp descriptor of the relabeling; read if the file exists, otherwise the random relabeling is written to it (implies --relabel)")
 			("seed", value<unsigned>(&args.seed), "seed for random number generator (system time if not set)")
 			("rank", value<mf_size_type>(&args.rank), "rank of factorization")
 			("update", value<string>(&args.updateString), "SGD update function (e.g., \"Sl\", \"Nzsl\", \"GklData\")")
@@ -407,7 +458,15 @@ int main(int argc, char *argv[]) {
 			("truncate", value<string>(&args.truncateString), "if present, truncatation is enabled (e.g., --truncate \"(-1000, 1000)\"")
 			("decay", value<string>(&args.decayString), "decay function (constant, bold driver, or auto)")
 			("balance", value<string>(&args.balanceString), "Type of balancing (None, L2, Nzl2)")
+			("compact-data", "if present, the data blocks are stored with 32-bit indexes and single-precision values (Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions without regularization only)")
+			("factor-precision", value<string>(&args.factorPrecisionString)->default_value("double"), "precision of the factor matrices (double or float); float halves the size of the copies of H kept on each rank (Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions without regularization only) [double]")
+			("balance-method", value<string>(&args.balanceMethodString), "Balancing method (e.g., \"Simple\", \"Optimal\") [Simple]")
 			("average-deltas", value<bool>(&args.averageDeltas), "Whether to average deltas when synchronizing [false]")
+			("delta-codec", value<string>(&args.deltaCodecString), "Compression of the deltas exchanged when synchronizing [none] (\"none\", \"fp16\", \"int8\", \"topk\")")
+			("delta-threshold", value<double>(&args.deltaCodec.threshold), "Columns of H whose delta has a smaller L2 norm are not sent when synchronizing [0]")
+			("delta-topk", value<double>(&args.deltaCodec.fraction), "Fraction of the entries of the deltas sent by the topk codec [0.01]")
+			("sync", value<string>(&args.asgdSyncString), "Synchronization of H [shuffle] (\"shuffle\" for bulk-synchronous shuffles, \"ps\" for a parameter server)")
+			("staleness", value<unsigned>(&args.staleness), "Maximum number of rounds a rank may run ahead of the slowest rank with --sync ps [3] (0 = unbounded)")
 		;
 
 		positional_options_description pdesc;
@@ -446,7 +505,13 @@ int main(int argc, char *argv[]) {
 		if (vm.count("output-row-file") == 0) { args.outputRowFacFile = ""; }
 		if (vm.count("output-col-file") == 0) { args.outputColFacFile = ""; }
 		if (vm.count("balance") == 0) { args.balanceString = "None"; }
+		if (vm.count("balance-method") == 0) { args.balanceMethodString = "Simple"; }
 		if (vm.count("average-deltas") == 0) { args.averageDeltas = false; }
+		if (vm.count("delta-codec") == 0) { args.deltaCodecString = "none"; }
+		if (vm.count("delta-threshold") == 0) { args.deltaCodec.threshold = 0.; }
+		if (vm.count("delta-topk") == 0) { args.deltaCodec.fraction = 0.01; }
+		if (vm.count("sync") == 0) { args.asgdSyncString = "shuffle"; }
+		if (vm.count("staleness") == 0) { args.staleness = 3; }
 
 		// print some information
 		LOG4CXX_INFO(logger, "Input");
@@ -473,9 +538,19 @@ int main(int argc, char *argv[]) {
 		LOG4CXX_INFO(logger, "    Regularize function: " << args.regularizeString);
 		LOG4CXX_INFO(logger, "    Loss function: " << args.lossString);
 		LOG4CXX_INFO(logger, "    Decay: " << args.decayString);
+		args.compactData = vm.count("compact-data") > 0;
+		LOG4CXX_INFO(logger, "    Compact data: " << (args.compactData ? "Enabled" : "Disabled"));
+		if (!parseFactorPrecision(args)) {
+			cerr << "Invalid factor precision: " << args.factorPrecisionString << " (has to be double or float)" << endl;
+			exit(1);
+		}
+		LOG4CXX_INFO(logger, "    Factor precision: " << args.factorPrecisionString);
+		if (args.floatFactors && args.compactData) {
+			cerr << "Invalid arguments: factor-precision=float is not supported with compact-data" << endl;
+			exit(1);
+		}
 
 		// parse balancing
-		args.balanceMethod = BALANCE_SIMPLE;
 		if (args.balanceString.compare("None") == 0) {
 			LOG4CXX_INFO(logger, "    Balancing: Disabled");
 			args.balanceType = BALANCE_NONE;
@@ -489,6 +564,17 @@ int main(int argc, char *argv[]) {
 			cerr << "Invalid arguments for balance; expected \"None\", \"L2\" or \"Nzl2\"" << endl;
 			exit(1);
 		}
+		if (args.balanceMethodString.compare("Simple") == 0) {
+			args.balanceMethod = BALANCE_SIMPLE;
+		} else if (args.balanceMethodString.compare("Optimal") == 0) {
+			args.balanceMethod = BALANCE_OPTIMAL;
+		} else {
+			cerr << "Error: Invalid value for --balance-method: " << args.balanceMethodString << endl;
+			exit(1);
+		}
+		if (args.balanceType != BALANCE_NONE) {
+			LOG4CXX_INFO(logger, "    Balancing method: " << args.balanceMethodString);
+		}
 
 		// parse abs
 		if (vm.count("abs") == 0) {
@@ -517,17 +603,62 @@ int main(int argc, char *argv[]) {
 		} else if (args.sgdOrderString.compare("WOR") == 0) {
 			LOG4CXX_INFO(logger, "    SGD step sequence: WOR");
 			args.sgdOrder = SGD_ORDER_WOR;
+		} else if (args.sgdOrderString.compare("SWOR") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: WOR (shuffled training points)");
+			args.sgdOrder = SGD_ORDER_WOR_SHUFFLED;
+		} else if (args.sgdOrderString.compare("FWOR") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: WOR (Feistel permutation)");
+			args.sgdOrder = SGD_ORDER_WOR_FEISTEL;
 		} else if (args.sgdOrderString.compare("WR") == 0) {
 			LOG4CXX_INFO(logger, "    SGD step sequence: WR");
 			args.sgdOrder = SGD_ORDER_WR;
 		} else {
-			cerr << "Invalid arguments for sgdOrder; expected \"SEQUENTIAL\", \"WOR\" or \"WR\"" << endl;
+			cerr << "Invalid arguments for sgdOrder; expected \"SEQUENTIAL\", \"WOR\", \"SWOR\", \"FWOR\" or \"WR\"" << endl;
 			exit(1);
 		}
 
 		// print averaging
 		LOG4CXX_INFO(logger, "    Average deltas: " << args.averageDeltas);
 
+		// parse delta compression
+		if (args.deltaCodecString.compare("none") == 0) {
+			args.deltaCodec.type = DELTA_CODEC_NONE;
+		} else if (args.deltaCodecString.compare("fp16") == 0) {
+			args.deltaCodec.type = DELTA_CODEC_FP16;
+		} else if (args.deltaCodecString.compare("int8") == 0) {
+			args.deltaCodec.type = DELTA_CODEC_INT8;
+		} else if (args.deltaCodecString.compare("topk") == 0) {
+			args.deltaCodec.type = DELTA_CODEC_TOPK;
+		} else {
+			cerr << "Invalid arguments for delta-codec; expected \"none\", \"fp16\", \"int8\" or \"topk\"" << endl;
+			exit(1);
+		}
+		if (args.deltaCodec.fraction <= 0 || args.deltaCodec.fraction > 1) {
+			cerr << "Invalid arguments for delta-topk; expected a value in (0,1]" << endl;
+			exit(1);
+		}
+		LOG4CXX_INFO(logger, "    Delta compression: " << args.deltaCodecString);
+		LOG4CXX_INFO(logger, "    Delta threshold: " << args.deltaCodec.threshold);
+		if (args.deltaCodec.type == DELTA_CODEC_TOPK) {
+			LOG4CXX_INFO(logger, "    Delta top-k fraction: " << args.deltaCodec.fraction);
+		}
+
+		args.relabel = vm.count("relabel") > 0 || vm.count("relabel-file") > 0;
+		LOG4CXX_INFO(logger, "    Random relabeling: " << (args.relabel ? "Enabled" : "Disabled")
+				<< (args.relabelFile.length() > 0 ? " (" + args.relabelFile + ")" : ""));
+
+		// parse synchronization
+		if (args.asgdSyncString.compare("shuffle") == 0) {
+			LOG4CXX_INFO(logger, "    Synchronization: shuffle");
+			args.asgdSync = ASGD_SYNC_SHUFFLE;
+		} else if (args.asgdSyncString.compare("ps") == 0) {
+			LOG4CXX_INFO(logger, "    Synchronization: parameter server (staleness bound: " << args.staleness << ")");
+			args.asgdSync = ASGD_SYNC_PS;
+		} else {
+			cerr << "Invalid arguments for sync; expected \"shuffle\" or \"ps\"" << endl;
+			exit(1);
+		}
+
 		// fill fields
 		args.random = Random32(args.seed);
 		args.world = world;
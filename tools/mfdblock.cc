@@ -26,6 +26,7 @@ int main(int argc, char *argv[]) {
 	mf_size_type blocks1;
 	mf_size_type blocks2;
 	string extension;
+	string blockingString;
 	string inFilename;
 	string outBaseFilename;
 	int tasksPerRank;
@@ -36,6 +37,7 @@ int main(int argc, char *argv[]) {
 		("help", "produce help message")
 	    ("blocks1", value<mf_size_type>(&blocks1)->default_value(1), "number of row blocks")
 	    ("blocks2", value<mf_size_type>(&blocks2)->default_value(1), "number of column blocks")
+	    ("blocking", value<string>(&blockingString)->default_value("equal"), "how to choose block boundaries (\"equal\" for blocks of equal size, \"nnz\" for blocks with equal number of nonzero entries)")
 	    ("threads", value<int>(&tasksPerRank)->default_value(1), "number of threads per node")
 	    ("format", value<string>(&extension)->default_value(""), "file format of blocks (default: one of the matrix market formats)")
 	    ("input-file", value<string>(&inFilename), "input file")
@@ -56,6 +58,16 @@ int main(int argc, char *argv[]) {
 	    return 1;
 	}
 
+	BlockingType blocking;
+	if (blockingString.compare("equal") == 0) {
+		blocking = BLOCKING_EQUAL_SIZE;
+	} else if (blockingString.compare("nnz") == 0) {
+		blocking = BLOCKING_BALANCED_NNZ;
+	} else {
+		cerr << "Invalid arguments for blocking; expected \"equal\" or \"nnz\"" << endl;
+		return 1;
+	}
+
 	// fire up
 	boost::mpi::communicator& world = mfInit(argc, argv);
 	mfStart();
@@ -72,6 +84,7 @@ int main(int argc, char *argv[]) {
 		cout << "Output file       : " << outFile << ".xml (+ blocks)" << endl;
 		cout << "Output format     : " << (extension=="" ? "AUTOMATIC" : extension) << endl;
 		cout << "Blocks            : " << blocks1 << "x" << blocks2 << endl;
+		cout << "Blocking          : " << blockingString << endl;
 		cout << "Threads@nodes     : " << tasksPerRank << "@" << world.size() << endl;
 		cout << endl;
 
@@ -79,7 +92,8 @@ int main(int argc, char *argv[]) {
 		MatrixFileFormat format = getMatrixFormat(inFilename);
 		if (isSparse(format)) {
 			cout << "Reading " << inFilename << "... " << endl;
-			DistributedSparseMatrix mV = loadMatrix<SparseMatrix>("V", blocks1, blocks2, true, inFilename);
+			DistributedSparseMatrix mV = loadMatrix<SparseMatrix>("V", blocks1, blocks2, true, inFilename,
+					format, blocking);
 			cout << endl;
 
 			cout << "Writing blocks ... " << endl;
@@ -94,7 +108,8 @@ int main(int argc, char *argv[]) {
 			f.save(outDir + outFile + ".xml");
 		} else {
 			cout << "Reading " << inFilename << "... " << endl;
-			DistributedDenseMatrix mV = loadMatrix<DenseMatrix>("V", blocks1, blocks2, true, inFilename);
+			DistributedDenseMatrix mV = loadMatrix<DenseMatrix>("V", blocks1, blocks2, true, inFilename,
+					format, blocking);
 			cout << endl;
 
 			cout << "Writing blocks ... " << endl;
@@ -58,9 +58,14 @@ int main(int argc, char *argv[]) {
 			("trace-var", value<string>(&args.traceVar), "variable name for trace [traceVar]")
 			("epochs", value<mf_size_type>(&args.epochs), "number of epochs to run [10]")
 			("tasks-per-rank", value<int>(&args.tasksPerRank), "number of concurrent tasks per rank [1]")
-			("sgd-order", value<string>(&args.sgdOrderString), "order of SGD steps [WOR] (e.g., \"SEQ\", \"WR\", \"WOR\")")
+			("pin-tasks", "if present, worker tasks are pinned to cores (spread across NUMA nodes), and their data is placed on their node")
+			("sgd-order", value<string>(&args.sgdOrderString), "order of SGD steps [WOR] (e.g., \"SEQ\", \"WR\", \"WOR\", \"SWOR\", \"FWOR\", \"TILED\", \"MINIBATCH\")")
 			("stratum-order", value<string>(&args.stratumOrderString), "order of strata [COWOR] (e.g., \"SEQ\", \"RSEQ\", \"WR\", \"WOR\", \"COWOR\")")
+			("blocking", value<string>(&args.blockingString), "how to block unblocked input files [equal] (\"equal\" or \"nnz\" for blocks with equal number of nonzero entries)")
+			("relabel", "if present, rows and columns of unblocked input files are relabeled randomly before blocking")
+			("relabel-file", value<string>(&args.relabelFile), "mfp descriptor of the relabeling; read if the file exists, otherwise the random relabeling is written to it (implies --relabel)")
 			("map-reduce", value<bool>(&args.mapReduce), "whether to use the (slower) MapReduce implementation [false])")
+			("pipeline-chunks", value<unsigned>(&args.pipelineChunks), "number of chunks in which blocks of H are sent between tasks; SGD starts on the first chunk while the others are in transit (SGD orders SEQ, WR, and WOR only) [1, no pipelining]")
 			("seed", value<unsigned>(&args.seed), "seed for random number generator (system time if not set)")
 			("rank", value<mf_size_type>(&args.rank), "rank of factorization")
 			("update", value<string>(&args.updateString), "SGD update function (e.g., \"Sl\", \"Nzsl\", \"GklData\")")
@@ -69,7 +74,12 @@ int main(int argc, char *argv[]) {
 			("abs", "if present, absolute values are taken after every SGD step")
 			("truncate", value<string>(&args.truncateString), "if present, truncatation is enabled (e.g., --truncate \"(-1000, 1000)\"")
 			("decay", value<string>(&args.decayString), "decay function (constant, bold driver, or auto)")
+			("decay-halving", value<unsigned>(&args.decayHalving), "if present, the auto decay selects the step size among the given number of candidates by successive halving on the sample [0, disabled]")
+			("loss-sample", value<double>(&args.lossSample), "if present, the NZSL is estimated from the given fraction of each data block (sampled once) instead of being computed exactly [0, disabled]")
+			("online-loss", value<mf_size_type>(&args.onlineLoss), "if present, use the NZSL accumulated during each epoch for step size selection and trace, and compute the exact loss only every given number of epochs (NZSL update functions only) [0, disabled]")
 			("balance", value<string>(&args.balanceString), "Type of balancing (None, L2, Nzl2)")
+			("compact-data", "if present, the data blocks are stored with 32-bit indexes and single-precision values (Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions without regularization only)")
+			("factor-precision", value<string>(&args.factorPrecisionString)->default_value("double"), "precision of the factor matrices (double or float); float halves the size of the blocks of H sent between ranks (Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions without regularization only) [double]")
 		;
 
 		positional_options_description pdesc;
@@ -105,7 +115,12 @@ int main(int argc, char *argv[]) {
 		if (vm.count("tasks-per-rank") == 0) args.tasksPerRank = 1;
 		if (vm.count("sgd-order") == 0) { args.sgdOrderString = "WOR"; args.sgdOrder = SGD_ORDER_WOR; }
 		if (vm.count("stratum-order") == 0) { args.stratumOrderString = "COWOR"; args.stratumOrder = STRATUM_ORDER_COWOR; }
+		if (vm.count("blocking") == 0) { args.blockingString = "equal"; }
+		if (vm.count("online-loss") == 0) { args.onlineLoss = 0; }
+		if (vm.count("loss-sample") == 0) { args.lossSample = 0; }
+		if (vm.count("decay-halving") == 0) { args.decayHalving = 0; }
 		if (vm.count("map-reduce") == 0) { args.mapReduce = false; }
+		if (vm.count("pipeline-chunks") == 0 || args.pipelineChunks == 0) { args.pipelineChunks = 1; }
 		if (vm.count("output-row-file") == 0) { args.outputRowFacFile = ""; }
 		if (vm.count("output-col-file") == 0) { args.outputColFacFile = ""; }
 		if (vm.count("balance") == 0) { args.balanceString = "None"; }
@@ -127,6 +142,8 @@ int main(int argc, char *argv[]) {
 		LOG4CXX_INFO(logger, "Parallelization");
 		LOG4CXX_INFO(logger, "    MPI ranks: " << world.size());
 		LOG4CXX_INFO(logger, "    Tasks per rank: " << args.tasksPerRank);
+		setPinTasks(vm.count("pin-tasks") > 0);
+		LOG4CXX_INFO(logger, "    Pinned tasks: " << (pinTasks() ? "Enabled" : "Disabled"));
 		LOG4CXX_INFO(logger, "DSGD options");
 		LOG4CXX_INFO(logger, "    Seed: " << args.seed);
 		LOG4CXX_INFO(logger, "    Epochs: " << args.epochs);
@@ -135,6 +152,40 @@ int main(int argc, char *argv[]) {
 		LOG4CXX_INFO(logger, "    Regularize function: " << args.regularizeString);
 		LOG4CXX_INFO(logger, "    Loss function: " << args.lossString);
 		LOG4CXX_INFO(logger, "    Decay: " << args.decayString);
+		args.compactData = vm.count("compact-data") > 0;
+		LOG4CXX_INFO(logger, "    Compact data: " << (args.compactData ? "Enabled" : "Disabled"));
+		if (args.compactData && args.lossSample > 0) {
+			cerr << "Invalid arguments: loss-sample is not supported with compact-data" << endl;
+			exit(1);
+		}
+		if (!parseFactorPrecision(args)) {
+			cerr << "Invalid factor precision: " << args.factorPrecisionString << " (has to be double or float)" << endl;
+			exit(1);
+		}
+		LOG4CXX_INFO(logger, "    Factor precision: " << args.factorPrecisionString);
+		if (args.floatFactors && (args.compactData || args.lossSample > 0)) {
+			cerr << "Invalid arguments: factor-precision=float is not supported with compact-data or loss-sample" << endl;
+			exit(1);
+		}
+		if (args.decayHalving == 1) {
+			cerr << "Invalid arguments for decay-halving; expected 0 or at least 2 candidates" << endl;
+			exit(1);
+		} else if (args.decayHalving > 0) {
+			LOG4CXX_INFO(logger, "    Step size search: Successive halving over " << args.decayHalving << " candidates");
+		}
+		if (args.lossSample == 0) {
+			LOG4CXX_INFO(logger, "    Loss sample: Disabled");
+		} else if (args.lossSample > 0 && args.lossSample <= 1) {
+			LOG4CXX_INFO(logger, "    Loss sample: " << args.lossSample << " of each block");
+		} else {
+			cerr << "Invalid arguments for loss-sample; expected a fraction in (0,1]" << endl;
+			exit(1);
+		}
+		if (args.onlineLoss == 0) {
+			LOG4CXX_INFO(logger, "    Online loss: Disabled");
+		} else {
+			LOG4CXX_INFO(logger, "    Online loss: Enabled (exact loss every " << args.onlineLoss << " epochs)");
+		}
 
 		// parse balancing
 		args.balanceMethod = BALANCE_SIMPLE;
@@ -182,8 +233,20 @@ int main(int argc, char *argv[]) {
 		} else if (args.sgdOrderString.compare("WOR") == 0) {
 			LOG4CXX_INFO(logger, "    SGD step sequence: WOR");
 			args.sgdOrder = SGD_ORDER_WOR;
+		} else if (args.sgdOrderString.compare("SWOR") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: WOR (shuffled training points)");
+			args.sgdOrder = SGD_ORDER_WOR_SHUFFLED;
+		} else if (args.sgdOrderString.compare("FWOR") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: WOR (Feistel permutation)");
+			args.sgdOrder = SGD_ORDER_WOR_FEISTEL;
+		} else if (args.sgdOrderString.compare("TILED") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: TILED");
+			args.sgdOrder = SGD_ORDER_TILED;
+		} else if (args.sgdOrderString.compare("MINIBATCH") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: MINIBATCH");
+			args.sgdOrder = SGD_ORDER_MINIBATCH;
 		} else {
-			cerr << "Invalid arguments for sgdOrder; expected \"SEQ\", \"WR\" or \"WOR\"" << endl;
+			cerr << "Invalid arguments for sgdOrder; expected \"SEQ\", \"WR\", \"WOR\", \"SWOR\", \"FWOR\", \"TILED\" or \"MINIBATCH\"" << endl;
 			exit(1);
 		}
 
@@ -208,7 +271,24 @@ int main(int argc, char *argv[]) {
 			exit(1);
 		}
 
+		// parse blocking
+		if (args.blockingString.compare("equal") == 0) {
+			LOG4CXX_INFO(logger, "    Blocking: blocks of equal size");
+			args.blocking = BLOCKING_EQUAL_SIZE;
+		} else if (args.blockingString.compare("nnz") == 0) {
+			LOG4CXX_INFO(logger, "    Blocking: blocks with equal number of nonzero entries");
+			args.blocking = BLOCKING_BALANCED_NNZ;
+		} else {
+			cerr << "Invalid arguments for blocking; expected \"equal\" or \"nnz\"" << endl;
+			exit(1);
+		}
+
+		args.relabel = vm.count("relabel") > 0 || vm.count("relabel-file") > 0;
+		LOG4CXX_INFO(logger, "    Random relabeling: " << (args.relabel ? "Enabled" : "Disabled")
+				<< (args.relabelFile.length() > 0 ? " (" + args.relabelFile + ")" : ""));
+
 		LOG4CXX_INFO(logger, "    Slow MapReduce implementation: " << args.mapReduce);
+		LOG4CXX_INFO(logger, "    Chunks per block of H: " << args.pipelineChunks);
 
 		// fill fields
 		args.random = Random32(args.seed);
@@ -225,6 +305,12 @@ int main(int argc, char *argv[]) {
 		parse::parseArg("regularize", args.regularizeString, args.regularizeName, args.regularizeArgs);
 		parse::parseArg("loss", args.lossString, args.lossName, args.lossArgs);
 		parse::parseDecay("decay", args.decayString, args);
+		if (args.onlineLoss > 0 && args.lossName.compare("Nzsl") != 0) {
+			LOG4CXX_WARN(logger, "The online loss contains the NZSL only; it does not match loss " << args.lossString);
+		}
+		if (args.lossSample > 0 && args.lossName.compare("Nzsl") != 0) {
+			LOG4CXX_WARN(logger, "The sampled loss estimates the NZSL only; it does not match loss " << args.lossString);
+		}
 
 		// let's go
 		result = runArgs(args);
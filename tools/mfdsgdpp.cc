@@ -31,12 +31,12 @@ log4cxx::LoggerPtr logger(log4cxx::Logger::getLogger("main"));
 using namespace mf;
 using namespace rg;
 
-template<typename U,typename R,typename L, typename D>
+template<typename U,typename R,typename L, typename D, typename FD>
 //void runDsgdPp2(Args& args, U update, R regularize, L loss, D decay,
 //		DsgdPpJob<U,R>& dsgdPpJob, DistributedDenseMatrix& dw, DistributedDenseMatrixCM& dh, Trace& trace) {
 void runDsgdPp2(Args& args, U update, R regularize, L loss, D decay,
-		DsgdPpJob<U,R>& dsgdPpJob, std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM>& factorsPair,
-		std::vector<DistributedSparseMatrix>& dataVector, Trace& trace) {
+		DsgdPpJob<U,R,FD>& dsgdPpJob, std::pair<typename FD::DW, typename FD::DH>& factorsPair,
+		std::vector<typename FD::DV>& dataVector, Trace& trace) {
 
 	mf_size_type blocks1 = args.worldSize * args.tasksPerRank;
 	mf_size_type blocks2 = blocks1*2;
@@ -57,7 +57,7 @@ void runDsgdPp2(Args& args, U update, R regularize, L loss, D decay,
 //
 //		DsgdPpFactorizationData<> testData(dvTest,dw,dh,args.tasksPerRank);
 
-		DsgdPpFactorizationData<> testData(dataVector[1],factorsPair.first,factorsPair.second,args.tasksPerRank);
+		FD testData(dataVector[1],factorsPair.first,factorsPair.second,args.tasksPerRank);
 		
 		LOG4CXX_INFO(logger, "Using NzslLoss for test data");
 		NzslLoss testLoss;
@@ -69,24 +69,28 @@ void runDsgdPp2(Args& args, U update, R regularize, L loss, D decay,
 	}
 }
 
-// run ASGD
-template<typename U,typename R,typename L>
-void runDsgdPp(Args& args, U update, R regularize, L loss) {
+// run DSGD++ on data and factor blocks of the types used by FD
+template<typename FD, typename U,typename R,typename L>
+void runDsgdPpWithData(Args& args, U update, R regularize, L loss) {
 
 	mf_size_type blocks1 = args.worldSize * args.tasksPerRank;
 	mf_size_type blocks2 = blocks1*2;
 
-	std::vector<DistributedSparseMatrix> dataVector;
+	std::vector<typename FD::DV> dataVector;
 	Timer t;
 	t.start();
+	args.setupRelabeling();
 	if (args.inputTestMatrixFile.length() == 0) {
-		dataVector=getDataMatrices<SparseMatrix>(args.inputMatrixFile,"V",true,args.tasksPerRank, args.worldSize, blocks1, blocks2,false,false);
+		dataVector=getDataMatrices<typename FD::V>(args.inputMatrixFile,"V",true,args.tasksPerRank, args.worldSize, blocks1, blocks2,false,false,
+				NULL, BLOCKING_EQUAL_SIZE, &args.relabeling);
 	}else{		
-		dataVector=getDataMatrices<SparseMatrix>(args.inputMatrixFile,"V",true,args.tasksPerRank, args.worldSize, blocks1, blocks2,false,false, &args.inputTestMatrixFile);
+		dataVector=getDataMatrices<typename FD::V>(args.inputMatrixFile,"V",true,args.tasksPerRank, args.worldSize, blocks1, blocks2,false,false, &args.inputTestMatrixFile,
+				BLOCKING_EQUAL_SIZE, &args.relabeling);
 	}
 
-	std::pair<DistributedDenseMatrix, DistributedDenseMatrixCM> factorsPair= getFactors(args.inputRowFacFile,
-			args.inputColFacFile,  args.tasksPerRank, args.worldSize,blocks1,blocks2,false);
+	std::pair<typename FD::DW, typename FD::DH> factorsPair= getFactors<typename FD::W, typename FD::H>(args.inputRowFacFile,
+			args.inputColFacFile,  args.tasksPerRank, args.worldSize,blocks1,blocks2,false,
+			std::vector<mf_size_type>(), std::vector<mf_size_type>(), &args.relabeling);
 	t.stop();
 	LOG4CXX_INFO(logger, "Total time for loading matrices: " << t);
 	
@@ -109,7 +113,7 @@ void runDsgdPp(Args& args, U update, R regularize, L loss) {
 //
 //	DsgdPpJob<U,R> dsgdPpJob(dv, dw, dh, update, regularize, args.sgdOrder, args.stratumOrder, args.tasksPerRank);
 
-	DsgdPpJob<U,R> dsgdPpJob(dataVector[0], factorsPair.first, factorsPair.second, update, regularize, args.sgdOrder, args.stratumOrder, args.tasksPerRank);
+	DsgdPpJob<U,R,FD> dsgdPpJob(dataVector[0], factorsPair.first, factorsPair.second, update, regularize, args.sgdOrder, args.stratumOrder, args.tasksPerRank);
 
 	Trace trace;
 	// add trace fields
@@ -145,20 +149,62 @@ void runDsgdPp(Args& args, U update, R regularize, L loss) {
 	// write computed factors to file
 	if (args.outputRowFacFile.length() > 0) {
 		LOG4CXX_INFO(logger, "Writing row factors to " << args.outputRowFacFile);
-		DenseMatrix w0;
+		typename FD::W w0;
 //		unblock(dw, w0);
 		unblock(factorsPair.first, w0);
+		unrelabel1(w0, args.relabeling.map1); // back to original row ids
 		writeMatrix(args.outputRowFacFile, w0);
 	}
 	if (args.outputColFacFile.length() > 0) {
 		LOG4CXX_INFO(logger, "Writing column factors to " << args.outputColFacFile);
-		DenseMatrixCM h0;
+		typename FD::H h0;
 //		unblock(dh, h0);
 		unblock(factorsPair.second, h0);
+		unrelabel2(h0, args.relabeling.map2); // back to original column ids
 		writeMatrix(args.outputColFacFile, h0);
 	}
 }
 
+/** Runs DSGD++ on data blocks of type mf::CompactSparseMatrixF */
+template<typename U,typename R,typename L>
+void runDsgdPpCompact(Args& args, U update, R regularize, L loss, boost::true_type) {
+	LOG4CXX_INFO(logger, "Using compact data blocks (32-bit indexes, single-precision values)");
+	runDsgdPpWithData<DsgdPpFactorizationData<float,double,boost::uint32_t> >(args, update, regularize, loss);
+}
+
+template<typename U,typename R,typename L>
+void runDsgdPpCompact(Args& args, U update, R regularize, L loss, boost::false_type) {
+	cerr << "Compact data is only supported for the Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions "
+			"without regularization" << endl;
+	exit(1);
+}
+
+/** Runs DSGD++ with factors of type mf::DenseMatrixF and mf::DenseMatrixFCM */
+template<typename U,typename R,typename L>
+void runDsgdPpFloat(Args& args, U update, R regularize, L loss, boost::true_type) {
+	LOG4CXX_INFO(logger, "Using single-precision factors");
+	runDsgdPpWithData<DsgdPpFactorizationData<double,float> >(args, update, regularize, loss);
+}
+
+template<typename U,typename R,typename L>
+void runDsgdPpFloat(Args& args, U update, R regularize, L loss, boost::false_type) {
+	cerr << "Single-precision factors are only supported for the Nzsl, Nzsl_L2 and Nzsl_Nzl2 update "
+			"functions without regularization" << endl;
+	exit(1);
+}
+
+// run DSGD++
+template<typename U,typename R,typename L>
+void runDsgdPp(Args& args, U update, R regularize, L loss) {
+	if (args.compactData) {
+		runDsgdPpCompact(args, update, regularize, loss, CompactDataSupported<U,R>());
+	} else if (args.floatFactors) {
+		runDsgdPpFloat(args, update, regularize, loss, FloatFactorsSupported<U,R>());
+	} else {
+		runDsgdPpWithData<DsgdPpFactorizationData<> >(args, update, regularize, loss);
+	}
+}
+
 bool runArgs(Args& args) {
 	using namespace mf;
 	using namespace mpi2;
@@ -390,8 +436,11 @@ int main(int argc, char *argv[]) {
 			("trace-var", value<string>(&args.traceVar), "variable name for trace [traceVar]")
 			("epochs", value<mf_size_type>(&args.epochs), "number of epochs to run [10]")
 			("tasks-per-rank", value<int>(&args.tasksPerRank), "number of concurrent tasks per rank [1]")
-			("sgd-order", value<string>(&args.sgdOrderString), "order of SGD steps [WOR] (e.g., \"SEQ\", \"WR\", \"WOR\")")
+			("pin-tasks", "if present, worker tasks are pinned to cores (spread across NUMA nodes), and their data is placed on their node")
+			("sgd-order", value<string>(&args.sgdOrderString), "order of SGD steps [WOR] (e.g., \"SEQ\", \"WR\", \"WOR\", \"SWOR\", \"FWOR\", \"TILED\", \"MINIBATCH\")")
 			("stratum-order", value<string>(&args.stratumOrderString), "order of strata [COWOR] (e.g., \"SEQ\", \"RSEQ\", \"WR\", \"WOR\", \"COWOR\")")
+			("relabel", "if present, rows and columns of unblocked input files are relabeled randomly before blocking")
+			("relabel-file", value<string>(&args.relabelFile), "mfp descriptor of the relabeling; read if the file exists, otherwise the random relabeling is written to it (implies --relabel)")
 			("seed", value<unsigned>(&args.seed), "seed for random number generator (system time if not set)")
 			("rank", value<mf_size_type>(&args.rank), "rank of factorization")
 			("update", value<string>(&args.updateString), "SGD update function (e.g., \"Sl\", \"Nzsl\", \"GklData\")")
@@ -401,6 +450,8 @@ int main(int argc, char *argv[]) {
 			("truncate", value<string>(&args.truncateString), "if present, truncatation is enabled (e.g., --truncate \"(-1000, 1000)\"")
 			("decay", value<string>(&args.decayString), "decay function (constant, bold driver, or auto)")
 			("balance", value<string>(&args.balanceString), "Type of balancing (None, L2, Nzl2)")
+			("compact-data", "if present, the data blocks are stored with 32-bit indexes and single-precision values (Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions without regularization only)")
+			("factor-precision", value<string>(&args.factorPrecisionString)->default_value("double"), "precision of the factor matrices (double or float); float halves the size of the blocks of H sent between ranks (Nzsl, Nzsl_L2 and Nzsl_Nzl2 update functions without regularization only) [double]")
 		;
 
 		positional_options_description pdesc;
@@ -457,6 +508,8 @@ int main(int argc, char *argv[]) {
 		LOG4CXX_INFO(logger, "Parallelization");
 		LOG4CXX_INFO(logger, "    MPI ranks: " << world.size());
 		LOG4CXX_INFO(logger, "    Tasks per rank: " << args.tasksPerRank);
+		setPinTasks(vm.count("pin-tasks") > 0);
+		LOG4CXX_INFO(logger, "    Pinned tasks: " << (pinTasks() ? "Enabled" : "Disabled"));
 		LOG4CXX_INFO(logger, "DSGD++ options");
 		LOG4CXX_INFO(logger, "    Seed: " << args.seed);
 		LOG4CXX_INFO(logger, "    Epochs: " << args.epochs);
@@ -465,6 +518,17 @@ int main(int argc, char *argv[]) {
 		LOG4CXX_INFO(logger, "    Regularize function: " << args.regularizeString);
 		LOG4CXX_INFO(logger, "    Loss function: " << args.lossString);
 		LOG4CXX_INFO(logger, "    Decay: " << args.decayString);
+		args.compactData = vm.count("compact-data") > 0;
+		LOG4CXX_INFO(logger, "    Compact data: " << (args.compactData ? "Enabled" : "Disabled"));
+		if (!parseFactorPrecision(args)) {
+			cerr << "Invalid factor precision: " << args.factorPrecisionString << " (has to be double or float)" << endl;
+			exit(1);
+		}
+		LOG4CXX_INFO(logger, "    Factor precision: " << args.factorPrecisionString);
+		if (args.floatFactors && args.compactData) {
+			cerr << "Invalid arguments: factor-precision=float is not supported with compact-data" << endl;
+			exit(1);
+		}
 
 		// parse balancing
 		args.balanceMethod = BALANCE_SIMPLE;
@@ -512,8 +576,20 @@ int main(int argc, char *argv[]) {
 		} else if (args.sgdOrderString.compare("WOR") == 0) {
 			LOG4CXX_INFO(logger, "    SGD step sequence: WOR");
 			args.sgdOrder = SGD_ORDER_WOR;
+		} else if (args.sgdOrderString.compare("SWOR") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: WOR (shuffled training points)");
+			args.sgdOrder = SGD_ORDER_WOR_SHUFFLED;
+		} else if (args.sgdOrderString.compare("FWOR") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: WOR (Feistel permutation)");
+			args.sgdOrder = SGD_ORDER_WOR_FEISTEL;
+		} else if (args.sgdOrderString.compare("TILED") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: TILED");
+			args.sgdOrder = SGD_ORDER_TILED;
+		} else if (args.sgdOrderString.compare("MINIBATCH") == 0) {
+			LOG4CXX_INFO(logger, "    SGD step sequence: MINIBATCH");
+			args.sgdOrder = SGD_ORDER_MINIBATCH;
 		} else {
-			cerr << "Invalid arguments for sgdOrder; expected \"SEQ\", \"WR\" or \"WOR\"" << endl;
+			cerr << "Invalid arguments for sgdOrder; expected \"SEQ\", \"WR\", \"WOR\", \"SWOR\", \"FWOR\", \"TILED\" or \"MINIBATCH\"" << endl;
 			exit(1);
 		}
 
@@ -538,6 +614,10 @@ int main(int argc, char *argv[]) {
 			exit(1);
 		}
 
+		args.relabel = vm.count("relabel") > 0 || vm.count("relabel-file") > 0;
+		LOG4CXX_INFO(logger, "    Random relabeling: " << (args.relabel ? "Enabled" : "Disabled")
+				<< (args.relabelFile.length() > 0 ? " (" + args.relabelFile + ")" : ""));
+
 		// fill fields
 		args.random = Random32(args.seed);
 		args.world = world;
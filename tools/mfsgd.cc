@@ -30,11 +30,70 @@ using namespace boost::program_options;
 
 log4cxx::LoggerPtr logger(log4cxx::Logger::getLogger("main"));
 
+template<typename FD>
+void runSgd(const typename FD::V& v, const ProjectedSparseMatrix& Vsample, Random32& random,
+		mf_size_type epochs, const string& traceFile, const string& traceVar) {
+	mf_size_type size1 = v.size1();
+	mf_size_type size2 = v.size2();
+	mf_size_type r = 50;
+
+	// generate initial factors by sampling from a uniform[-0.5,0.5] distribution
+	typename FD::W w(size1, r);
+	typename FD::H h(r, size2);
+	generateRandom(w, random, boost::uniform_real<>(-0.5, 0.5));
+	generateRandom(h, random, boost::uniform_real<>(-0.5, 0.5));
+
+	// parameters for SGD
+	double epsMax = 0.1;
+	double lambda = 50;
+	typedef UpdateTruncate<UpdateNzsl> Update;
+	typedef RegularizeL2 Regularize;
+	typedef SumLoss<NzslLoss, L2Loss> Loss;
+	Update update = Update(UpdateNzsl(), -1000, 10100); // truncate for numerical stability
+	Regularize regularize = Regularize(lambda);
+	Loss loss((NzslLoss()), L2Loss(lambda));
+
+	// initialize the SGD
+	Timer t;
+	SgdRunner sgdRunner(random);
+	SgdJob<Update,Regularize,FD> job(v, w, h, update, regularize, SGD_ORDER_WOR);
+	DecayAuto<Update,Regularize,Loss> decay(job, loss, Vsample, epsMax, 7);
+	Trace trace;
+
+	// run SGD
+	t.start();
+	sgdRunner.run(job, loss, epochs, decay, trace, BALANCE_NONE, BALANCE_SIMPLE);
+	t.stop();
+	LOG4CXX_INFO(logger, "Total time: " << t);
+
+
+	// write trace to an R file
+	LOG4CXX_INFO(logger, "Writing trace to " << traceFile);
+	trace.toRfile(traceFile, traceVar);
+}
+
+template<typename Factor>
+void runSgdWithFactor(SparseMatrix& v, bool compact, const ProjectedSparseMatrix& Vsample,
+		Random32& random, mf_size_type epochs, const string& traceFile, const string& traceVar) {
+	if (compact) {
+		CompactSparseMatrixF vCompact;
+		copyCompact(v, vCompact);
+		SparseMatrix empty;
+		v.swap(empty); // release the original representation
+		LOG4CXX_INFO(logger, "Using compact data matrix (32-bit indexes, single-precision values)");
+		runSgd<FactorizationData<float,Factor,boost::uint32_t> >(vCompact, Vsample, random,
+				epochs, traceFile, traceVar);
+	} else {
+		runSgd<FactorizationData<double,Factor> >(v, Vsample, random, epochs, traceFile, traceVar);
+	}
+}
+
 int main(int argc, char *argv[]) {
 	string traceFile;
 	string traceVar;
 	string inputMatrixFile;
 	mf_size_type epochs;
+	string factorPrecision;
 
 	// read command line
 	options_description desc("Options");
@@ -43,6 +102,8 @@ int main(int argc, char *argv[]) {
 		("epochs", value<mf_size_type>(&epochs)->default_value(10), "number of epochs to run [10]")
 		("trace", value<string>(&traceFile)->default_value("trace.R"), "filename of trace [trace.R]")
 		("traceVar", value<string>(&traceVar)->default_value("trace"), "variable name for trace [traceVar]")
+		("factor-precision", value<string>(&factorPrecision)->default_value("double"), "precision of the factor matrices (double or float) [double]")
+		("compact-data", "if present, store the data matrix with 32-bit indexes and single-precision values")
 	    ("input-file", value<string>(&inputMatrixFile), "input matrix")
 	    ;
 
@@ -58,15 +119,16 @@ int main(int argc, char *argv[]) {
 	    cout << desc << endl;
 	    return 1;
 	}
+	if (factorPrecision != "double" && factorPrecision != "float") {
+		cerr << "Invalid factor precision: " << factorPrecision << " (has to be double or float)" << endl;
+		return 1;
+	}
 
 	// read input matrix
 	SparseMatrix v;
 	readMatrix(inputMatrixFile, v);
 	LOG4CXX_INFO(logger, "Data matrix: "
 		<< v.size1() << " x " << v.size2() << ", " << v.nnz() << " nonzeros");
-	mf_size_type size1 = v.size1();
-	mf_size_type size2 = v.size2();
-	mf_size_type r = 50;
 
 	// compute sample matrix
 	Random32 random; // note: this takes a default seed (not randomized!)
@@ -77,39 +139,13 @@ int main(int argc, char *argv[]) {
 		<< Vsample.data.size1() << " x " << Vsample.data.size2()
 		<< ", " << Vsample.data.nnz() << " nonzeros");
 
-	// generate initial factors by sampling from a uniform[-0.5,0.5] distribution
-	DenseMatrix w(size1, r);
-	DenseMatrixCM h(r, size2);
-	generateRandom(w, random, boost::uniform_real<>(-0.5, 0.5));
-	generateRandom(h, random, boost::uniform_real<>(-0.5, 0.5));
-
-	// parameters for SGD
-	double epsMax = 0.1;
-	double lambda = 50;
-	typedef UpdateTruncate<UpdateNzsl> Update;
-	typedef RegularizeL2 Regularize;
-	typedef SumLoss<NzslLoss, L2Loss> Loss;
-	Update update = Update(UpdateNzsl(), -1000, 10100); // truncate for numerical stability
-	Regularize regularize = Regularize(lambda);
-	Loss loss((NzslLoss()), L2Loss(lambda));
-
-	// initialize the SGD
-	Timer t;
-	SgdRunner sgdRunner(random);
-	SgdJob<Update,Regularize> job(v, w, h, update, regularize, SGD_ORDER_WOR);
-	DecayAuto<Update,Regularize,Loss> decay(job, loss, Vsample, epsMax, 7);
-	Trace trace;
-
 	// run SGD
-	t.start();
-	sgdRunner.run(job, loss, epochs, decay, trace, BALANCE_NONE, BALANCE_SIMPLE);
-	t.stop();
-	LOG4CXX_INFO(logger, "Total time: " << t);
-
-
-	// write trace to an R file
-	LOG4CXX_INFO(logger, "Writing trace to " << traceFile);
-	trace.toRfile(traceFile, traceVar);
+	bool compact = vm.count("compact-data") > 0;
+	if (factorPrecision == "double") {
+		runSgdWithFactor<double>(v, compact, Vsample, random, epochs, traceFile, traceVar);
+	} else {
+		runSgdWithFactor<float>(v, compact, Vsample, random, epochs, traceFile, traceVar);
+	}
 
 	return 0;
 }
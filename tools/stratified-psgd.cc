@@ -31,6 +31,7 @@
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/math/distributions/normal.hpp>
 #include <boost/random/uniform_real.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <mf/matrix/io/generateDistributedMatrix.h>
 #include <mpi2/mpi2.h>
 #include <mf/mf.h>
@@ -147,6 +148,7 @@ int main(int argc, char* argv[]) {
 		string outputColFacFile;
 		string inputTestMatrixFile;
 		string traceFile,traceVar;
+		string scheduleName;
 
 
 
@@ -159,6 +161,7 @@ int main(int argc, char* argv[]) {
 				("lambda", value<double>(&lambda)->default_value(0.05), "lambda")
 				("eps0", value<double>(&eps0)->default_value(0.01), "initial step size for BoldDriver")
 				("tasks-per-rank", value<int>(&tasks)->default_value(1), "number of concurrent tasks [1]")
+				("schedule", value<string>(&scheduleName)->default_value("dynamic"), "block schedule (static, dynamic) [dynamic]")
 				("trace", value<string>(&traceFile)->default_value("trace.R"), "filename of trace [trace]")
 				("traceVar", value<string>(&traceVar)->default_value("trace"), "variable name for trace [traceVar]")
 				("input-file", value<string>(&inputMatrixFile), "input matrix")
@@ -189,6 +192,16 @@ int main(int argc, char* argv[]) {
 		if (vm.count("output-col-file") == 0) { outputColFacFile = ""; }
 
 		LOG4CXX_INFO(logger, "Using " << tasks << " parallel tasks");
+		bool dynamicSchedule;
+		if (scheduleName.compare("dynamic") == 0) {
+			dynamicSchedule = true;
+		} else if (scheduleName.compare("static") == 0) {
+			dynamicSchedule = false;
+		} else {
+			cerr << "Invalid arguments for schedule; expected \"static\" or \"dynamic\"" << endl;
+			exit(1);
+		}
+		LOG4CXX_INFO(logger, "Using " << scheduleName << " block schedule");
 		
 		
 		///////////////////////////////////////
@@ -310,7 +323,10 @@ int main(int argc, char* argv[]) {
 
 		// initialize
 		
-		StratifiedPsgdRunner stratifiedPsgdRunner (random, permutation, offsets);
+		boost::scoped_ptr<StratifiedPsgdRunner> runner(dynamicSchedule
+				? new StratifiedPsgdRunner(random, permutation, offsets, b1, b2)
+				: new StratifiedPsgdRunner(random, permutation, offsets));
+		StratifiedPsgdRunner& stratifiedPsgdRunner = *runner;
 		StratifiedPsgdJob<Update,Regularize> stratifiedPsgdJob(v, w, h, update, regularize, order, tasks);
 		BoldDriver decay(eps0);
 		Trace trace;